@@ -0,0 +1,256 @@
+#include "CloudOccupancyMap.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace
+{
+    // getDensity中的五次cloudMap采样：coord = (pos.xz + offset) * scale
+    // 须与CloudSky.frag保持一致
+    struct DensityTap
+    {
+        float offsetX;
+        float offsetZ;
+        float scale;
+        float weight;
+    };
+
+    const DensityTap kDensityTaps[] = {
+        {  500.0f,  500.0f, 0.0002f, 0.6f  },
+        {  500.0f,  500.0f, 0.0004f, 0.3f  },
+        {  500.0f,  500.0f, 0.0008f, 0.1f  },
+        { 1500.0f, 2500.0f, 0.0004f, 0.05f },
+        { 1500.0f, 2500.0f, 0.0008f, 0.02f },
+    };
+
+    // 距离场上限（单通道8位）
+    const int kMaxSkipCells = 255;
+
+    // 将可能越过纹理边界的texel区间[a, b]按REPEAT拆成不回绕的若干段
+    void splitWrapped(int a, int b, int size, std::vector<std::pair<int, int>>& out)
+    {
+        if (b - a + 1 >= size) {
+            out.push_back(std::make_pair(0, size - 1));
+            return;
+        }
+        int start = ((a % size) + size) % size;
+        int end = start + (b - a);
+        if (end < size) {
+            out.push_back(std::make_pair(start, end));
+        } else {
+            out.push_back(std::make_pair(start, size - 1));
+            out.push_back(std::make_pair(0, end - size));
+        }
+    }
+}
+
+CloudOccupancyMap::CloudOccupancyMap(osg::Image* cloudMap, float boxHalfWidth, int resolution)
+    : _boxHalfWidth(boxHalfWidth)
+    , _cellSize(2.0f * boxHalfWidth / resolution)
+    , _resolution(resolution)
+{
+    buildMaxPyramid(cloudMap);
+
+    _fieldImage = new osg::Image;
+    _fieldImage->allocateImage(_resolution, _resolution, 1, GL_LUMINANCE, GL_UNSIGNED_BYTE);
+    std::fill(_fieldImage->data(), _fieldImage->data() + _fieldImage->getTotalSizeInBytes(), 0);
+    // 阈值变化时重写，上传后保留CPU数据
+    _fieldImage->setDataVariance(osg::Object::DYNAMIC);
+
+    // 逐格查询，必须最近点采样，不能让插值把空格子和非空格子混在一起
+    _texture = new osg::Texture2D(_fieldImage.get());
+    _texture->setFilter(osg::Texture2D::MIN_FILTER, osg::Texture2D::NEAREST);
+    _texture->setFilter(osg::Texture2D::MAG_FILTER, osg::Texture2D::NEAREST);
+    _texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+    _texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+    _texture->setResizeNonPowerOfTwoHint(false);
+}
+
+void CloudOccupancyMap::buildMaxPyramid(osg::Image* image)
+{
+    _levels.clear();
+
+    Level base;
+    base.width = (image && image->s() > 0) ? image->s() : 1;
+    base.height = (image && image->t() > 0) ? image->t() : 1;
+    base.maxValues.resize(base.width * base.height, 1.0f);
+    if (image && image->data()) {
+        for (int t = 0; t < base.height; ++t) {
+            for (int s = 0; s < base.width; ++s) {
+                // 着色器取.x并clamp到[0,1]
+                float value = image->getColor(s, t).r();
+                base.maxValues[t * base.width + s] = std::min(std::max(value, 0.0f), 1.0f);
+            }
+        }
+    }
+    _levels.push_back(base);
+
+    // 逐层2x2取最大值，非2的幂尺寸向上取整
+    while (_levels.back().width > 1 || _levels.back().height > 1) {
+        const Level& prev = _levels.back();
+        Level next;
+        next.width = (prev.width + 1) / 2;
+        next.height = (prev.height + 1) / 2;
+        next.maxValues.resize(next.width * next.height);
+        for (int y = 0; y < next.height; ++y) {
+            for (int x = 0; x < next.width; ++x) {
+                int px1 = std::min(2 * x + 1, prev.width - 1);
+                int py1 = std::min(2 * y + 1, prev.height - 1);
+                float m = prev.maxValues[2 * y * prev.width + 2 * x];
+                m = std::max(m, prev.maxValues[2 * y * prev.width + px1]);
+                m = std::max(m, prev.maxValues[py1 * prev.width + 2 * x]);
+                m = std::max(m, prev.maxValues[py1 * prev.width + px1]);
+                next.maxValues[y * next.width + x] = m;
+            }
+        }
+        _levels.push_back(next);
+    }
+}
+
+float CloudOccupancyMap::maxOverTexels(int level, int x0, int y0, int x1, int y1) const
+{
+    const Level& lv = _levels[level];
+    float m = 0.0f;
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            m = std::max(m, lv.maxValues[y * lv.width + x]);
+        }
+    }
+    return m;
+}
+
+float CloudOccupancyMap::maxOverRect(float u0, float v0, float u1, float v1) const
+{
+    const Level& base = _levels[0];
+
+    // 双线性采样会用到左下角texel及其+1邻居
+    int x0 = static_cast<int>(std::floor(u0 * base.width - 0.5f));
+    int x1 = static_cast<int>(std::floor(u1 * base.width - 0.5f)) + 1;
+    int y0 = static_cast<int>(std::floor(v0 * base.height - 0.5f));
+    int y1 = static_cast<int>(std::floor(v1 * base.height - 0.5f)) + 1;
+
+    // 选一层使区间只覆盖2x2左右的格子
+    int span = std::max(x1 - x0, y1 - y0) + 1;
+    int level = 0;
+    while (level + 1 < static_cast<int>(_levels.size()) && (span >> level) > 2) {
+        ++level;
+    }
+
+    std::vector<std::pair<int, int>> xs, ys;
+    splitWrapped(x0, x1, base.width, xs);
+    splitWrapped(y0, y1, base.height, ys);
+
+    float m = 0.0f;
+    for (const auto& ySeg : ys) {
+        for (const auto& xSeg : xs) {
+            m = std::max(m, maxOverTexels(level,
+                                          xSeg.first >> level, ySeg.first >> level,
+                                          xSeg.second >> level, ySeg.second >> level));
+        }
+    }
+    return m;
+}
+
+float CloudOccupancyMap::sampleBilinear(float u, float v) const
+{
+    const Level& base = _levels[0];
+    float fx = u * base.width - 0.5f;
+    float fy = v * base.height - 0.5f;
+    int ix = static_cast<int>(std::floor(fx));
+    int iy = static_cast<int>(std::floor(fy));
+    float tx = fx - ix;
+    float ty = fy - iy;
+
+    int x0 = ((ix % base.width) + base.width) % base.width;
+    int y0 = ((iy % base.height) + base.height) % base.height;
+    int x1 = (x0 + 1) % base.width;
+    int y1 = (y0 + 1) % base.height;
+
+    float a = base.maxValues[y0 * base.width + x0] * (1.0f - tx) + base.maxValues[y0 * base.width + x1] * tx;
+    float b = base.maxValues[y1 * base.width + x0] * (1.0f - tx) + base.maxValues[y1 * base.width + x1] * tx;
+    return a * (1.0f - ty) + b * ty;
+}
+
+float CloudOccupancyMap::sampleNoise(float x, float z) const
+{
+    float noise = 0.0f;
+    for (const DensityTap& tap : kDensityTaps) {
+        noise += tap.weight * sampleBilinear((x + tap.offsetX) * tap.scale, (z + tap.offsetZ) * tap.scale);
+    }
+    return noise;
+}
+
+bool CloudOccupancyMap::isEmptyAt(const std::vector<unsigned char>& field, float x, float z) const
+{
+    int cx = static_cast<int>(std::floor((x + _boxHalfWidth) / _cellSize));
+    int cz = static_cast<int>(std::floor((z + _boxHalfWidth) / _cellSize));
+    cx = std::min(std::max(cx, 0), _resolution - 1);
+    cz = std::min(std::max(cz, 0), _resolution - 1);
+    return field[cz * _resolution + cx] > 0;
+}
+
+std::vector<unsigned char> CloudOccupancyMap::computeField(float densityThreshold) const
+{
+    const int res = _resolution;
+    std::vector<int> dist(res * res);
+
+    // 密度上界：高度权重不超过1，因此只看水平方向的噪声叠加
+    for (int cz = 0; cz < res; ++cz) {
+        float z0 = -_boxHalfWidth + cz * _cellSize;
+        float z1 = z0 + _cellSize;
+        for (int cx = 0; cx < res; ++cx) {
+            float x0 = -_boxHalfWidth + cx * _cellSize;
+            float x1 = x0 + _cellSize;
+
+            float bound = 0.0f;
+            for (const DensityTap& tap : kDensityTaps) {
+                bound += tap.weight * maxOverRect((x0 + tap.offsetX) * tap.scale, (z0 + tap.offsetZ) * tap.scale,
+                                                  (x1 + tap.offsetX) * tap.scale, (z1 + tap.offsetZ) * tap.scale);
+            }
+            dist[cz * res + cx] = (bound >= densityThreshold) ? 0 : kMaxSkipCells;
+        }
+    }
+
+    // 两遍扫描求切比雪夫距离（8邻域代价均为1时结果精确）
+    auto relax = [&](int x, int z, int& d) {
+        if (x >= 0 && x < res && z >= 0 && z < res) {
+            d = std::min(d, dist[z * res + x] + 1);
+        }
+    };
+    for (int z = 0; z < res; ++z) {
+        for (int x = 0; x < res; ++x) {
+            int& d = dist[z * res + x];
+            relax(x - 1, z, d);
+            relax(x - 1, z - 1, d);
+            relax(x, z - 1, d);
+            relax(x + 1, z - 1, d);
+        }
+    }
+    for (int z = res - 1; z >= 0; --z) {
+        for (int x = res - 1; x >= 0; --x) {
+            int& d = dist[z * res + x];
+            relax(x + 1, z, d);
+            relax(x + 1, z + 1, d);
+            relax(x, z + 1, d);
+            relax(x - 1, z + 1, d);
+        }
+    }
+
+    std::vector<unsigned char> field(res * res);
+    for (int i = 0; i < res * res; ++i) {
+        field[i] = static_cast<unsigned char>(std::min(dist[i], kMaxSkipCells));
+    }
+    return field;
+}
+
+void CloudOccupancyMap::setField(const std::vector<unsigned char>& field)
+{
+    std::copy(field.begin(), field.end(), _fieldImage->data());
+    _fieldImage->dirty();
+}
+
+std::vector<unsigned char> CloudOccupancyMap::getField() const
+{
+    const unsigned char* data = _fieldImage->data();
+    return std::vector<unsigned char>(data, data + _resolution * _resolution);
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <osg/Referenced>
+#include <osg/Image>
+#include <osg/Texture2D>
+#include <vector>
+
+// 体积云空域跳跃加速结构
+// 在CPU上对cloudMap建立max mip金字塔，按CloudSky.frag中getDensity的采样方式
+// 求出云盒水平面上每个格子的密度上界，低于密度阈值的格子视为空；
+// 再生成每个格子到最近非空格子的切比雪夫距离场，着色器据此整段越过空区域。
+// 金字塔只依赖贴图，构造时建一次；距离场可在后台线程计算，再在更新遍历中写入纹理
+class CloudOccupancyMap : public osg::Referenced
+{
+public:
+    // boxHalfWidth需与CloudSky.frag中的width一致
+    CloudOccupancyMap(osg::Image* cloudMap, float boxHalfWidth, int resolution = 128);
+
+    // 任意线程：按密度阈值求距离场（每格一字节）
+    std::vector<unsigned char> computeField(float densityThreshold) const;
+    // 更新遍历中调用：写入纹理；getField返回当前纹理中的距离场
+    void setField(const std::vector<unsigned char>& field);
+    std::vector<unsigned char> getField() const;
+
+    osg::Texture2D* getTexture() const { return _texture.get(); }
+    float getCellSize() const { return _cellSize; }
+
+    // 任意线程：在CPU上复现getDensity的五次噪声采样（未乘高度权重）
+    float sampleNoise(float x, float z) const;
+    // 任意线程：(x, z)所在格子在field对应的阈值下是否一定无云
+    bool isEmptyAt(const std::vector<unsigned char>& field, float x, float z) const;
+
+protected:
+    virtual ~CloudOccupancyMap() {}
+
+private:
+    struct Level
+    {
+        int width;
+        int height;
+        std::vector<float> maxValues;
+    };
+
+    void buildMaxPyramid(osg::Image* image);
+    // 纹理坐标矩形内双线性采样可能取到的最大值
+    float maxOverRect(float u0, float v0, float u1, float v1) const;
+    float maxOverTexels(int level, int x0, int y0, int x1, int y1) const;
+    // 与GL_LINEAR + GL_REPEAT一致的双线性采样
+    float sampleBilinear(float u, float v) const;
+
+    std::vector<Level> _levels;
+    float _boxHalfWidth;
+    float _cellSize;
+    int _resolution;
+
+    osg::ref_ptr<osg::Image> _fieldImage;
+    osg::ref_ptr<osg::Texture2D> _texture;
+};
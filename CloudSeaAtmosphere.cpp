@@ -1,15 +1,18 @@
 #include "CloudSeaAtmosphere.h"
 #include <osgUtil/CullVisitor>
 #include <osgDB/ReadFile>
+#include <osgDB/FileUtils>
 #include <QDir>
 #include <osg/Depth>
 #include <osg/Texture2D>
 #include <chrono>
+#include "shaderprogramcache.h"
 
+// 相机位置和视图逆矩阵由着色器从各视口的osg_ViewMatrixInverse读取，这里只切换质量档位
 class CloudSeaCB : public osg::StateSet::Callback
 {
 public:
-    explicit CloudSeaCB(osg::Camera* camera) : pCamera_(camera)
+    explicit CloudSeaCB(CloudSeaAtmosphere* atmosphere) : pAtmosphere_(atmosphere)
     {
     }
 
@@ -20,27 +23,18 @@ public:
 
     void process(osg::StateSet* ss)
     {
-        if (pCamera_)
+        // 界面切换质量档位后在这里换着色器变体
+        if (pAtmosphere_)
         {
-            osg::Vec3f eye, center, up;
-            pCamera_->getViewMatrixAsLookAt(eye, center, up);
-            ss->getOrCreateUniform("cameraPosition", osg::Uniform::FLOAT_VEC3)->set(eye);
-
-            osg::Matrixf viewMat = pCamera_->getViewMatrix();
-            osg::Matrixf viewInverse = osg::Matrixf::inverse(viewMat);
-            ss->getOrCreateUniform("viewInverse", osg::Uniform::FLOAT_MAT4)->set(viewInverse);
+            pAtmosphere_->setQuality(currentSkyQuality());
         }
     }
 
 private:
-    osg::Camera* pCamera_ = nullptr;
+    CloudSeaAtmosphere* pAtmosphere_ = nullptr;
 };
 
 CloudSeaAtmosphere::CloudSeaAtmosphere()
-{
-}
-
-CloudSeaAtmosphere::CloudSeaAtmosphere(osg::Camera* pCamera)
 {
     setReferenceFrame(osg::Transform::ABSOLUTE_RF);
     setCullingActive(false);
@@ -54,25 +48,19 @@ CloudSeaAtmosphere::CloudSeaAtmosphere(osg::Camera* pCamera)
     ss->setRenderBinDetails(0, "RenderBin");
     initUniforms();
     
-    osg::ref_ptr<osg::Program> program = new osg::Program;
     std::string resourcePath = QDir::currentPath().toStdString() + "/../../shader/";
     
-    // 使用云海着色器
-    osg::Shader* pV = osgDB::readShaderFile(osg::Shader::VERTEX, resourcePath + "CloudSea.vert");
-    if (!pV) {
-        pV = osgDB::readShaderFile(osg::Shader::VERTEX, resourcePath + "X1.vert");
+    // 使用云海着色器，缺失时回退到X1着色器
+    _vertFile = resourcePath + "CloudSea.vert";
+    if (!osgDB::fileExists(_vertFile)) {
+        _vertFile = resourcePath + "X1.vert";
     }
-    pV->setName("CloudSea.vert");
-    
-    osg::Shader* pF = osgDB::readShaderFile(osg::Shader::FRAGMENT, resourcePath + "CloudSea.frag");
-    if (!pF) {
-        pF = osgDB::readShaderFile(osg::Shader::FRAGMENT, resourcePath + "X1.frag");
+    _fragFile = resourcePath + "CloudSea.frag";
+    if (!osgDB::fileExists(_fragFile)) {
+        _fragFile = resourcePath + "X1.frag";
     }
-    pF->setName("CloudSea.frag");
-    
-    program->addShader(pV);
-    program->addShader(pF);
-    ss->setAttributeAndModes(program.get(), osg::StateAttribute::ON);
+    _quality = currentSkyQuality();
+    applyProgramVariant();
 
     ss->addUniform(_turbidity.get());
     ss->addUniform(_rayleigh.get());
@@ -86,7 +74,7 @@ CloudSeaAtmosphere::CloudSeaAtmosphere(osg::Camera* pCamera)
     ss->addUniform(_cloudHeight.get());
     ss->addUniform(_atmosphereColor.get());
 
-    CloudSeaCB* pCB = new CloudSeaCB(pCamera);
+    CloudSeaCB* pCB = new CloudSeaCB(this);
     ss->setUpdateCallback(pCB);
 }
 
@@ -165,3 +153,21 @@ void CloudSeaAtmosphere::setAtmosphereColor(osg::Vec3 color)
         _atmosphereColor->set(color);
     }
 }
+
+// 按当前质量档位从缓存中取着色器变体
+void CloudSeaAtmosphere::applyProgramVariant()
+{
+    osg::ref_ptr<osg::Program> program = ShaderProgramCache::instance().getProgramFromFiles(
+        _vertFile, _fragFile, skyQualityDefines(_quality));
+    if (program.valid()) {
+        getOrCreateStateSet()->setAttributeAndModes(program.get(), osg::StateAttribute::ON);
+    }
+}
+
+// 设置质量档位
+void CloudSeaAtmosphere::setQuality(SkyQuality quality)
+{
+    if (quality == _quality) return;
+    _quality = quality;
+    applyProgramVariant();
+}
@@ -2,7 +2,7 @@
 
 #include <osg/Transform>
 #include <osg/Uniform>
-#include <osg/Camera>
+#include "SkyQuality.h"
 
 /**
  * 云海大气效果
@@ -12,7 +12,6 @@ class CloudSeaAtmosphere : public osg::Transform
 {
 public:
     CloudSeaAtmosphere();
-    CloudSeaAtmosphere(osg::Camera* pCamera);
 
     CloudSeaAtmosphere(const CloudSeaAtmosphere& copy, osg::CopyOp copyop = osg::CopyOp::SHALLOW_COPY) 
         : osg::Transform(copy, copyop) {}
@@ -23,6 +22,7 @@ public:
     void setCloudDensity(float density);
     void setCloudHeight(float height);
     void setAtmosphereColor(osg::Vec3 color);
+    void setQuality(SkyQuality quality);  // 切换着色器质量档位（编译期变体）
 
     META_Node(osg, CloudSeaAtmosphere);
 
@@ -44,4 +44,10 @@ private:
     osg::ref_ptr<osg::Uniform> _cloudDensity;
     osg::ref_ptr<osg::Uniform> _cloudHeight;
     osg::ref_ptr<osg::Uniform> _atmosphereColor;
+
+    // 着色器变体
+    void applyProgramVariant();
+    std::string _vertFile;
+    std::string _fragFile;
+    SkyQuality _quality = SkyQuality::High;
 };
@@ -0,0 +1,152 @@
+#include "CloudShadowMap.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+    // 每个texel沿光线方向穿过云盒的采样数
+    const int kShadowSteps = 32;
+    // 与原光照步进中exp(-density * stepLength * 1.5)的系数一致
+    const float kExtinctionScale = 1.5f;
+}
+
+CloudShadowMap::CloudShadowMap(const CloudOccupancyMap* occupancy, float boxHalfWidth, float bottom, float top, int resolution)
+    : _occupancy(occupancy)
+    , _boxHalfWidth(boxHalfWidth)
+    , _bottom(bottom)
+    , _top(top)
+    , _resolution(resolution)
+{
+    _image = new osg::Image;
+    _image->allocateImage(_resolution, _resolution, 1, GL_RGB, GL_FLOAT);
+    std::fill(_image->data(), _image->data() + _image->getTotalSizeInBytes(), 0);
+    // 太阳方向变化时重写，上传后保留CPU数据
+    _image->setDataVariance(osg::Object::DYNAMIC);
+
+    _texture = new osg::Texture2D(_image.get());
+    _texture->setInternalFormat(GL_RGB32F_ARB);
+    _texture->setFilter(osg::Texture2D::MIN_FILTER, osg::Texture2D::LINEAR);
+    _texture->setFilter(osg::Texture2D::MAG_FILTER, osg::Texture2D::LINEAR);
+    _texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+    _texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+    _texture->setResizeNonPowerOfTwoHint(false);
+}
+
+float CloudShadowMap::density(const osg::Vec3& pos, const CloudParameters& params) const
+{
+    // 高度衰减 - 云层中部密度最大
+    float mid = (_bottom + _top) * 0.5f;
+    float h = _top - _bottom;
+    float weight = 1.0f - 2.0f * std::fabs(mid - pos.y()) / h;
+    weight = std::pow(std::max(weight, 0.0f), 0.8f);
+
+    float noise = _occupancy->sampleNoise(pos.x(), pos.z()) * weight;
+    if (noise < params.densityThreshold) {
+        noise = 0.0f;
+    } else {
+        noise = std::pow(noise, std::min(std::max(params.contrast, 1.0f), 3.0f));
+    }
+
+    noise *= params.densityFactor * 0.8f;
+    return std::min(std::max(noise, 0.0f), 1.0f);
+}
+
+CloudShadowMap::Result CloudShadowMap::compute(const osg::Vec3& sunDirection, const CloudParameters& params, const std::vector<unsigned char>& field) const
+{
+    // 光照空间基：forward为光线传播方向（指向地面）
+    osg::Vec3 forward = -sunDirection;
+    forward.normalize();
+    osg::Vec3 helper = (std::fabs(forward.y()) > 0.99f) ? osg::Vec3(1.0f, 0.0f, 0.0f) : osg::Vec3(0.0f, 1.0f, 0.0f);
+    osg::Vec3 right = forward ^ helper;
+    right.normalize();
+    osg::Vec3 upAxis = right ^ forward;
+    upAxis.normalize();
+
+    const osg::Vec3 boundsMin(-_boxHalfWidth, _bottom, -_boxHalfWidth);
+    const osg::Vec3 boundsMax(_boxHalfWidth, _top, _boxHalfWidth);
+    const osg::Vec3 center = (boundsMin + boundsMax) * 0.5f;
+
+    // 云盒8个角投影到光照平面，求正交投影范围
+    float minR = FLT_MAX, maxR = -FLT_MAX, minU = FLT_MAX, maxU = -FLT_MAX;
+    for (int i = 0; i < 8; ++i) {
+        osg::Vec3 corner((i & 1) ? boundsMax.x() : boundsMin.x(),
+                         (i & 2) ? boundsMax.y() : boundsMin.y(),
+                         (i & 4) ? boundsMax.z() : boundsMin.z());
+        osg::Vec3 d = corner - center;
+        minR = std::min(minR, d * right);
+        maxR = std::max(maxR, d * right);
+        minU = std::min(minU, d * upAxis);
+        maxU = std::max(maxU, d * upAxis);
+    }
+    float sizeR = maxR - minR;
+    float sizeU = maxU - minU;
+
+    // 世界坐标 -> (u, v, depth)，depth为相对云盒中心沿forward的距离
+    Result result;
+    result.shadowMatrix.set(
+        right.x() / sizeR, upAxis.x() / sizeU, forward.x(), 0.0f,
+        right.y() / sizeR, upAxis.y() / sizeU, forward.y(), 0.0f,
+        right.z() / sizeR, upAxis.z() / sizeU, forward.z(), 0.0f,
+        (-(center * right) - minR) / sizeR, (-(center * upAxis) - minU) / sizeU, -(center * forward), 1.0f);
+
+    result.texels.assign(_resolution * _resolution * 3, 0.0f);
+    float* data = result.texels.data();
+    for (int j = 0; j < _resolution; ++j) {
+        for (int i = 0; i < _resolution; ++i) {
+            float* texel = data + (j * _resolution + i) * 3;
+
+            // texel中心对应的光线起点位于过云盒中心、垂直于forward的平面上，因此t即depth
+            float a = minR + (i + 0.5f) / _resolution * sizeR;
+            float b = minU + (j + 0.5f) / _resolution * sizeU;
+            osg::Vec3 origin = center + right * a + upAxis * b;
+
+            // 光线与云盒求交
+            float tNear = -FLT_MAX, tFar = FLT_MAX;
+            bool hit = true;
+            for (int k = 0; k < 3 && hit; ++k) {
+                if (std::fabs(forward[k]) < 1e-6f) {
+                    hit = origin[k] >= boundsMin[k] && origin[k] <= boundsMax[k];
+                    continue;
+                }
+                float t0 = (boundsMin[k] - origin[k]) / forward[k];
+                float t1 = (boundsMax[k] - origin[k]) / forward[k];
+                tNear = std::max(tNear, std::min(t0, t1));
+                tFar = std::min(tFar, std::max(t0, t1));
+            }
+            if (!hit || tFar <= tNear) continue;
+
+            float dt = (tFar - tNear) / kShadowSteps;
+            bool found = false;
+            float front = 0.0f, back = 0.0f, opticalDepth = 0.0f;
+            for (int s = 0; s < kShadowSteps; ++s) {
+                float t = tNear + (s + 0.5f) * dt;
+                osg::Vec3 p = origin + forward * t;
+                if (_occupancy->isEmptyAt(field, p.x(), p.z())) continue;
+
+                float sigma = density(p, params) * kExtinctionScale;
+                if (sigma <= 0.0f) continue;
+
+                if (!found) {
+                    front = t - dt * 0.5f;
+                    found = true;
+                }
+                back = t + dt * 0.5f;
+                opticalDepth += sigma * dt;
+            }
+            if (!found) continue;
+
+            texel[0] = front;
+            texel[1] = opticalDepth / std::max(back - front, 1e-4f);
+            texel[2] = opticalDepth;
+        }
+    }
+    return result;
+}
+
+void CloudShadowMap::apply(const Result& result)
+{
+    std::copy(result.texels.begin(), result.texels.end(), reinterpret_cast<float*>(_image->data()));
+    _image->dirty();
+    _shadowMatrix = result.shadowMatrix;
+}
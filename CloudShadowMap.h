@@ -0,0 +1,58 @@
+#pragma once
+#include <osg/Referenced>
+#include <osg/Image>
+#include <osg/Texture2D>
+#include <osg/Matrixf>
+#include <osg/Vec3>
+#include "CloudOccupancyMap.h"
+#include <vector>
+
+// 体积云光照空间透射率图（Beer shadow map）
+// 沿太阳方向做正交投影，每个texel记录：云的前表面深度、平均消光系数、最大光学厚度，
+// 着色器对任意点做一次采样即可得到到太阳的透射率，替代逐步的光照步进。
+// 只在太阳方向或云参数变化时在CPU上重算：compute可在后台线程执行，结果在更新遍历中apply
+class CloudShadowMap : public osg::Referenced
+{
+public:
+    // 云盒范围需与CloudSky.frag中的width/bottom/top一致
+    CloudShadowMap(const CloudOccupancyMap* occupancy, float boxHalfWidth, float bottom, float top, int resolution = 128);
+
+    struct CloudParameters
+    {
+        float densityThreshold;
+        float contrast;
+        float densityFactor;
+    };
+
+    struct Result
+    {
+        osg::Matrixf shadowMatrix;
+        std::vector<float> texels;
+    };
+
+    // 任意线程：field为与params.densityThreshold对应的空域距离场，用于跳过一定无云的格子
+    Result compute(const osg::Vec3& sunDirection, const CloudParameters& params, const std::vector<unsigned char>& field) const;
+    // 更新遍历中调用：写入纹理并更新投影矩阵
+    void apply(const Result& result);
+
+    osg::Texture2D* getTexture() const { return _texture.get(); }
+    // 世界坐标 -> (u, v, 光照方向深度)，地形等其他着色器也可直接用来投射云影
+    const osg::Matrixf& getShadowMatrix() const { return _shadowMatrix; }
+
+protected:
+    virtual ~CloudShadowMap() {}
+
+private:
+    // 与CloudSky.frag中getDensity一致
+    float density(const osg::Vec3& pos, const CloudParameters& params) const;
+
+    osg::ref_ptr<const CloudOccupancyMap> _occupancy;
+    float _boxHalfWidth;
+    float _bottom;
+    float _top;
+    int _resolution;
+
+    osg::Matrixf _shadowMatrix;
+    osg::ref_ptr<osg::Image> _image;
+    osg::ref_ptr<osg::Texture2D> _texture;
+};
@@ -7,16 +7,17 @@
 #include <chrono>
 #include <osg/Geometry>
 #include <osg/Geode>
+#include "shaderprogramcache.h"
 
 
+// 相机位置和视图逆矩阵由着色器从各视口的osg_ViewMatrixInverse读取，这里只更新时间
 class SkyCloudCB : public osg::StateSet::Callback
 {
 private:
-    osg::Camera* pCamera_ = nullptr;
     std::chrono::high_resolution_clock::time_point _startTime;
 
 public:
-    explicit SkyCloudCB(osg::Camera* camera) : pCamera_(camera), _startTime(std::chrono::high_resolution_clock::now())
+    SkyCloudCB() : _startTime(std::chrono::high_resolution_clock::now())
     {
     }
 
@@ -27,29 +28,15 @@ public:
 
     void process(osg::StateSet* ss)
     {
-        if (pCamera_)
-        {
-            osg::Vec3f eye, center, up;
-            pCamera_->getViewMatrixAsLookAt(eye, center, up);
-            ss->getOrCreateUniform("cameraPosition", osg::Uniform::FLOAT_VEC3)->set(eye);
-
-            // 视图矩阵逆矩阵计算
-            osg::Matrixf viewMat = pCamera_->getViewMatrix();
-            osg::Matrixf viewInverse = osg::Matrixf::inverse(viewMat);
-            ss->getOrCreateUniform("viewInverse", osg::Uniform::FLOAT_MAT4)->set(viewInverse);
-            
-            // 更新时间uniform
-            auto now = std::chrono::high_resolution_clock::now();
-            float elapsed = std::chrono::duration<float>(now - _startTime).count();
-            ss->getOrCreateUniform("time", osg::Uniform::FLOAT)->set(elapsed);
-            
-            // 计算太阳方向（基于天顶角和方位角）
-        }
+        // 更新时间uniform
+        auto now = std::chrono::high_resolution_clock::now();
+        float elapsed = std::chrono::duration<float>(now - _startTime).count();
+        ss->getOrCreateUniform("time", osg::Uniform::FLOAT)->set(elapsed);
     }
 };
 
 
-SkyCloud::SkyCloud(osg::Camera* camera)
+SkyCloud::SkyCloud()
 {
     // 使用绝对参考框架，使天空盒不受场景变换影响
     setReferenceFrame(osg::Transform::ABSOLUTE_RF);
@@ -71,15 +58,11 @@ SkyCloud::SkyCloud(osg::Camera* camera)
     initUniforms();
     
     // 创建着色器程序
-    osg::ref_ptr<osg::Program> program = new osg::Program;
     std::string resourcePath = QDir::currentPath().toStdString() + "/../../shader/";
-    osg::Shader* pV = osgDB::readShaderFile(osg::Shader::VERTEX, resourcePath + "VolumeSkyCloud.vert");
-    pV->setName("SkyAtmosphere.vert");
-    osg::Shader* pF = osgDB::readShaderFile(osg::Shader::FRAGMENT, resourcePath + "VolumeSkyCloud.frag");
-    pF->setName("SkyAtmosphere.frag");
-    program->addShader(pV);
-    program->addShader(pF);
-    ss->setAttributeAndModes(program.get(), osg::StateAttribute::ON);
+    osg::ref_ptr<osg::Program> program = ShaderProgramCache::instance().getProgramFromFiles(resourcePath + "VolumeSkyCloud.vert", resourcePath + "VolumeSkyCloud.frag");
+    if (program.valid()) {
+        ss->setAttributeAndModes(program.get(), osg::StateAttribute::ON);
+    }
 
     // 添加uniforms
     ss->addUniform(_cloudDensity.get());
@@ -183,14 +166,10 @@ SkyCloud::SkyCloud(osg::Camera* camera)
 
     // 不在这里创建几何体，而是在demoshader.cpp中创建球体并添加为子节点
 
-    SkyCloudCB* pCB = new SkyCloudCB(camera);
+    SkyCloudCB* pCB = new SkyCloudCB();
     ss->setUpdateCallback(pCB);
 }
 
-SkyCloud::SkyCloud() : osg::Transform()
-{
-}
-
 void SkyCloud::initUniforms()
 {
 
@@ -8,7 +8,6 @@ class SkyCloud : public osg::Transform
 {
 public:
     SkyCloud();
-    SkyCloud(osg::Camera* camera);
 
     SkyCloud(const SkyCloud& copy, osg::CopyOp copyop = osg::CopyOp::SHALLOW_COPY) : osg::Transform(copy, copyop) {}
 
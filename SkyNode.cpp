@@ -8,15 +8,18 @@
 #include<Qdir>
 #include "osg/Texture2D"  // 添加纹理头文件
 #include <chrono>         // 添加时间头文件
+#include "shaderprogramcache.h"
 
+// 相机位置和视图逆矩阵因视口而异，着色器直接读取各视口SceneView设置的osg_ViewMatrixInverse，
+// 这里只更新所有视口共用的时间和质量档位
 class SkyCB : public osg::StateSet::Callback
 {
 private:
-    osg::Camera * pCamera_ = nullptr;
+    SkyBoxThree * pSky_ = nullptr;
     std::chrono::high_resolution_clock::time_point _startTime;  // 添加时间变量
 
 public:
-    explicit SkyCB(osg::Camera * camera) : pCamera_(camera), _startTime(std::chrono::high_resolution_clock::now())
+    explicit SkyCB(SkyBoxThree * sky) : pSky_(sky), _startTime(std::chrono::high_resolution_clock::now())
     {
     }
 
@@ -27,31 +30,20 @@ public:
 
     void preocess(osg::StateSet* ss)
     {
-        if (pCamera_)
+        // 更新时间uniform
+        auto now = std::chrono::high_resolution_clock::now();
+        float elapsed = std::chrono::duration<float>(now - _startTime).count();
+        ss->getOrCreateUniform("iTime", osg::Uniform::FLOAT)->set(elapsed);
+
+        // 界面切换质量档位后在这里换着色器变体，档位不变时不做任何事
+        if (pSky_)
         {
-            osg::Vec3f eye, center, up;
-            pCamera_->getViewMatrixAsLookAt(eye, center, up);
-            ss->getOrCreateUniform("cameraPosition", osg::Uniform::FLOAT_VEC3)->set(eye);
-
-            // 修复视图矩阵逆矩阵计算
-            osg::Matrixf viewMat = pCamera_->getViewMatrix();
-            osg::Matrixf viewInverse = osg::Matrixf::inverse(viewMat);
-            ss->getOrCreateUniform("viewInverse", osg::Uniform::FLOAT_MAT4)->set(viewInverse);
-            
-            // 更新时间uniform
-            auto now = std::chrono::high_resolution_clock::now();
-            float elapsed = std::chrono::duration<float>(now - _startTime).count();
-            ss->getOrCreateUniform("iTime", osg::Uniform::FLOAT)->set(elapsed);
+            pSky_->setQuality(currentSkyQuality());
         }
     }
 };
 
 SkyBoxThree::SkyBoxThree()
-{
-
-}
-
-SkyBoxThree::SkyBoxThree(osg::Camera * pCamera)
 {
     // 使用绝对参考框架，使天空盒不受场景变换影响
     setReferenceFrame(osg::Transform::ABSOLUTE_RF);
@@ -68,15 +60,9 @@ SkyBoxThree::SkyBoxThree(osg::Camera * pCamera)
 
     //add
     initUniforms();
-    osg::ref_ptr<osg::Program> program = new osg::Program;
-    std::string resourcePath = QDir::currentPath().toStdString() + "/../../shader/";
-    osg::Shader* pV = osgDB::readShaderFile(osg::Shader::VERTEX, resourcePath + "x1.vert");
-    pV->setName("X1.vert");
-    osg::Shader* pF = osgDB::readShaderFile(osg::Shader::FRAGMENT, resourcePath + "x1.frag");
-    pF->setName("X1.frag");
-    program->addShader(pV);
-    program->addShader(pF);
-    ss->setAttributeAndModes(program.get(), osg::StateAttribute::ON);
+    _shaderPath = QDir::currentPath().toStdString() + "/../../shader/";
+    _quality = currentSkyQuality();
+    applyProgramVariant();
 
     ss->addUniform(_turbidity.get());
     ss->addUniform(_rayleigh.get());
@@ -121,7 +107,7 @@ SkyBoxThree::SkyBoxThree(osg::Camera * pCamera)
     }
 
 
-    SkyCB* pCB = new SkyCB(pCamera);
+    SkyCB* pCB = new SkyCB(this);
     ss->setUpdateCallback(pCB);
 
 }
@@ -224,3 +210,21 @@ void SkyBoxThree::setCloudRangeMax(float rangeMax)
         _cloudRangeMax->set(rangeMax);
     }
 }
+
+// 按当前质量档位从缓存中取着色器变体
+void SkyBoxThree::applyProgramVariant()
+{
+    osg::ref_ptr<osg::Program> program = ShaderProgramCache::instance().getProgramFromFiles(
+        _shaderPath + "x1.vert", _shaderPath + "x1.frag", skyQualityDefines(_quality));
+    if (program.valid()) {
+        getOrCreateStateSet()->setAttributeAndModes(program.get(), osg::StateAttribute::ON);
+    }
+}
+
+// 设置质量档位
+void SkyBoxThree::setQuality(SkyQuality quality)
+{
+    if (quality == _quality) return;
+    _quality = quality;
+    applyProgramVariant();
+}
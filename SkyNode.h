@@ -2,6 +2,7 @@
 #pragma once
 #include "osg/Transform"
 #include <osg/TextureCubeMap>
+#include "SkyQuality.h"
 
 
 //构件对象
@@ -9,7 +10,6 @@ class  SkyBoxThree : public osg::Transform
 {
 public:
     SkyBoxThree();
-    SkyBoxThree(osg::Camera * pCamera);
 
     SkyBoxThree(const SkyBoxThree& copy, osg::CopyOp copyop = osg::CopyOp::SHALLOW_COPY) : osg::Transform(copy, copyop) {}
 
@@ -21,6 +21,7 @@ public:
     void setCloudBaseHeight(float baseHeight);  // 新增：设置云层底部高度的方法
     void setCloudRangeMin(float rangeMin);  // 新增：设置云层近裁剪距离的方法
     void setCloudRangeMax(float rangeMax);  // 新增：设置云层远裁剪距离的方法
+    void setQuality(SkyQuality quality);  // 切换着色器质量档位（编译期变体）
 
     META_Node(osg, SkyBoxThree);
 
@@ -46,4 +47,8 @@ private:
     osg::ref_ptr<osg::Uniform> _cloudRangeMin;  // 新增：云层近裁剪距离uniform
     osg::ref_ptr<osg::Uniform> _cloudRangeMax;  // 新增：云层远裁剪距离uniform
 
+    // 着色器变体
+    void applyProgramVariant();
+    std::string _shaderPath;
+    SkyQuality _quality = SkyQuality::High;
 };
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+#include "shaderprogramcache.h"
+#include <atomic>
+#include <string>
+
+// 天空/云着色器质量档位
+// 各档位以#define注入着色器，循环次数成为编译期常量，每个档位在ShaderProgramCache中各缓存一个变体
+enum class SkyQuality
+{
+    Low,
+    Medium,
+    High    // 与原先硬编码的循环次数一致
+};
+
+// 当前档位（所有视口共用）：界面在任意线程设置，SkyBoxThree/CloudSeaAtmosphere/VolumeCloudSky在各自的更新回调中切换到该档位的变体
+inline std::atomic<int>& skyQualitySetting()
+{
+    static std::atomic<int> quality(static_cast<int>(SkyQuality::High));
+    return quality;
+}
+
+inline void setCurrentSkyQuality(SkyQuality quality) { skyQualitySetting() = static_cast<int>(quality); }
+inline SkyQuality currentSkyQuality() { return static_cast<SkyQuality>(skyQualitySetting().load()); }
+
+// X1.frag / CloudSea.frag 中fbm与云形状噪声的叠加层数
+inline ShaderProgramCache::Defines skyQualityDefines(SkyQuality quality)
+{
+    ShaderProgramCache::Defines defines;
+    switch (quality) {
+    case SkyQuality::Low:
+        defines["FBM_OCTAVES"] = "4";
+        defines["FBM_SHAPE_OCTAVES"] = "4";
+        break;
+    case SkyQuality::Medium:
+        defines["FBM_OCTAVES"] = "5";
+        defines["FBM_SHAPE_OCTAVES"] = "6";
+        break;
+    case SkyQuality::High:
+    default:
+        defines["FBM_OCTAVES"] = "7";
+        defines["FBM_SHAPE_OCTAVES"] = "8";
+        break;
+    }
+    return defines;
+}
+
+// CloudSky.frag的步进上限按32步分档，避免滑块拖动时每个取值都编译一个变体
+inline int cloudMaxStepsVariant(int maxSteps)
+{
+    const int bucket = 32;
+    int steps = ((maxSteps + bucket - 1) / bucket) * bucket;
+    if (steps < bucket) steps = bucket;
+    if (steps > 256) steps = 256;
+    return steps;
+}
+
+// 各档位下CloudSky.frag的步进上限，滑块取值超过上限时按上限编译
+inline int cloudMaxStepsLimit(SkyQuality quality)
+{
+    switch (quality) {
+    case SkyQuality::Low:
+        return 64;
+    case SkyQuality::Medium:
+        return 128;
+    case SkyQuality::High:
+    default:
+        return 256;
+    }
+}
@@ -4,19 +4,35 @@
 #include "osgDB/ReadFile"
 #include <QDir>
 #include "osg/Texture2D"
+#include <algorithm>
 #include <chrono>
 #include <osg/Geometry>
 #include <osg/Geode>
+#include "shaderprogramcache.h"
+#include "SkyQuality.h"
 
 
+// 根据天顶角和方位角计算太阳方向
+static osg::Vec3 computeSunDirection(float sunZenithAngle, float sunAzimuthAngle)
+{
+    osg::Vec3 sunDirection(
+        sin(sunZenithAngle) * cos(sunAzimuthAngle),
+        sin(sunZenithAngle) * sin(sunAzimuthAngle),
+        cos(sunZenithAngle)
+    );
+    sunDirection.normalize();
+    return sunDirection;
+}
+
+// 相机位置和视图逆矩阵由着色器从各视口的osg_ViewMatrixInverse读取，这里只更新所有视口共用的状态
 class VolumeCloudCB : public osg::StateSet::Callback
 {
 private:
-    osg::Camera* pCamera_ = nullptr;
+    VolumeCloudSky* pSky_ = nullptr;
     std::chrono::high_resolution_clock::time_point _startTime;
 
 public:
-    explicit VolumeCloudCB(osg::Camera* camera) : pCamera_(camera), _startTime(std::chrono::high_resolution_clock::now())
+    explicit VolumeCloudCB(VolumeCloudSky* sky) : pSky_(sky), _startTime(std::chrono::high_resolution_clock::now())
     {
     }
 
@@ -27,41 +43,22 @@ public:
 
     void process(osg::StateSet* ss)
     {
-        if (pCamera_)
+        // 更新时间uniform
+        auto now = std::chrono::high_resolution_clock::now();
+        float elapsed = std::chrono::duration<float>(now - _startTime).count();
+        ss->getOrCreateUniform("iTime", osg::Uniform::FLOAT)->set(elapsed);
+
+        // 太阳方向由节点的sunDirection uniform维护，这里只在参数变化后重算透射率图；
+        // 界面切换质量档位后同样在这里换着色器变体
+        if (pSky_)
         {
-            osg::Vec3f eye, center, up;
-            pCamera_->getViewMatrixAsLookAt(eye, center, up);
-            ss->getOrCreateUniform("cameraPosition", osg::Uniform::FLOAT_VEC3)->set(eye);
-
-            // 视图矩阵逆矩阵计算
-            osg::Matrixf viewMat = pCamera_->getViewMatrix();
-            osg::Matrixf viewInverse = osg::Matrixf::inverse(viewMat);
-            ss->getOrCreateUniform("viewInverse", osg::Uniform::FLOAT_MAT4)->set(viewInverse);
-            
-            // 更新时间uniform
-            auto now = std::chrono::high_resolution_clock::now();
-            float elapsed = std::chrono::duration<float>(now - _startTime).count();
-            ss->getOrCreateUniform("iTime", osg::Uniform::FLOAT)->set(elapsed);
-            
-            // 计算太阳方向（基于天顶角和方位角）
-            float sunZenithAngle = 75.0f * 3.14159f / 180.0f;  // 75度天顶角
-            float sunAzimuthAngle = 40.0f * 3.14159f / 180.0f; // 40度方位角
-            osg::Vec3 sunDirection(
-                sin(sunZenithAngle) * cos(sunAzimuthAngle),
-                sin(sunZenithAngle) * sin(sunAzimuthAngle),
-                cos(sunZenithAngle)
-            );
-            sunDirection.normalize();
-            ss->getOrCreateUniform("sunDirection", osg::Uniform::FLOAT_VEC3)->set(sunDirection);
+            pSky_->setQuality(currentSkyQuality());
+            pSky_->updateCloudShadow();
         }
     }
 };
 
 VolumeCloudSky::VolumeCloudSky()
-{
-}
-
-VolumeCloudSky::VolumeCloudSky(osg::Camera* camera)
 {
     // 使用绝对参考框架，使天空盒不受场景变换影响
     setReferenceFrame(osg::Transform::ABSOLUTE_RF);
@@ -83,15 +80,8 @@ VolumeCloudSky::VolumeCloudSky(osg::Camera* camera)
     initUniforms();
     
     // 创建着色器程序
-    osg::ref_ptr<osg::Program> program = new osg::Program;
-    std::string resourcePath = QDir::currentPath().toStdString() + "/../../shader/";
-    osg::Shader* pV = osgDB::readShaderFile(osg::Shader::VERTEX, resourcePath + "SkyAtmosphere.vert");
-    pV->setName("SkyAtmosphere.vert");
-    osg::Shader* pF = osgDB::readShaderFile(osg::Shader::FRAGMENT, resourcePath + "SkyAtmosphere.frag");
-    pF->setName("SkyAtmosphere.frag");
-    program->addShader(pV);
-    program->addShader(pF);
-    ss->setAttributeAndModes(program.get(), osg::StateAttribute::ON);
+    _shaderPath = QDir::currentPath().toStdString() + "/../../shader/";
+    _quality = currentSkyQuality();
 
     // 添加uniforms
     ss->addUniform(_sunZenithAngle.get());
@@ -108,10 +98,13 @@ VolumeCloudSky::VolumeCloudSky(osg::Camera* camera)
     ss->addUniform(_densityFactor.get());
     ss->addUniform(_stepSize.get());
     ss->addUniform(_maxSteps.get());
+    ss->addUniform(_sunDirection.get());
+    ss->addUniform(_cloudShadowMatrix.get());
     ss->addUniform(new osg::Uniform("iTime", 0.0f));
 
     // 加载2D噪声贴图 - 定义云的分布区域
     osg::ref_ptr<osg::Image> cloudMapImage = osgDB::readImageFile("E:/a.png");
+    osg::ref_ptr<osg::Image> occupancySource = cloudMapImage;
     if (cloudMapImage.valid()) {
         osg::ref_ptr<osg::Texture2D> cloudMapTexture = new osg::Texture2D();
         cloudMapTexture->setImage(cloudMapImage.get());
@@ -127,6 +120,9 @@ VolumeCloudSky::VolumeCloudSky(osg::Camera* camera)
         unsigned char* data = new unsigned char[4];
         data[0] = data[1] = data[2] = 255; data[3] = 255;
         defaultImage->setImage(1, 1, 1, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE, data, osg::Image::USE_NEW_DELETE);
+        occupancySource = defaultImage;
+        // 1x1默认纹理处处有云，距离场没有可跳过的格子
+        _skipEmptySpace = false;
         osg::ref_ptr<osg::Texture2D> defaultTexture = new osg::Texture2D();
         defaultTexture->setImage(defaultImage.get());
         defaultTexture->setFilter(osg::Texture2D::MIN_FILTER, osg::Texture2D::LINEAR);
@@ -164,9 +160,22 @@ VolumeCloudSky::VolumeCloudSky(osg::Camera* camera)
         ss->addUniform(new osg::Uniform("blueNoise", 1));
     }
 
+    // 空域跳跃距离场 - 云盒半宽与CloudSky.frag中的width一致；首次更新遍历时在后台生成，之前全为0（不跳跃）
+    _occupancyMap = new CloudOccupancyMap(occupancySource.get(), 400.0f);
+    ss->setTextureAttributeAndModes(2, _occupancyMap->getTexture(), osg::StateAttribute::ON);
+    ss->addUniform(new osg::Uniform("cloudSkipMap", 2));
+    ss->addUniform(new osg::Uniform("skipCellSize", _occupancyMap->getCellSize()));
+
+    // 光照空间透射率图 - 云盒范围与CloudSky.frag中的width/bottom/top一致
+    _cloudShadowMap = new CloudShadowMap(_occupancyMap.get(), 400.0f, 130.0f, 200.0f);
+    ss->setTextureAttributeAndModes(3, _cloudShadowMap->getTexture(), osg::StateAttribute::ON);
+    ss->addUniform(new osg::Uniform("cloudShadowMap", 3));
+
+    applyProgramVariant();
+
     // 不在这里创建几何体，而是在demoshader.cpp中创建球体并添加为子节点
 
-    VolumeCloudCB* pCB = new VolumeCloudCB(camera);
+    VolumeCloudCB* pCB = new VolumeCloudCB(this);
     ss->setUpdateCallback(pCB);
 }
 
@@ -198,6 +207,58 @@ void VolumeCloudSky::initUniforms()
     _densityFactor = new osg::Uniform("densityFactor", 0.01f);       // 调整密度因子
     _stepSize = new osg::Uniform("stepSize", 2.5f);                 // 调整步长
     _maxSteps = new osg::Uniform("maxSteps", 200);
+
+    float sunZenithAngle = 0.0f, sunAzimuthAngle = 0.0f;
+    _sunZenithAngle->get(sunZenithAngle);
+    _sunAzimuthAngle->get(sunAzimuthAngle);
+    _sunDirection = new osg::Uniform("sunDirection", computeSunDirection(sunZenithAngle, sunAzimuthAngle));
+    _cloudShadowMatrix = new osg::Uniform("cloudShadowMatrix", osg::Matrixf());
+}
+
+void VolumeCloudSky::updateCloudShadow()
+{
+    if (!_cloudShadowMap.valid()) return;
+
+    if (_pendingFields.valid()) {
+        if (_pendingFields.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+
+        // 距离场、透射率图和投影矩阵在同一帧切换
+        CloudFields fields = _pendingFields.get();
+        if (fields.occupancyRebuilt) {
+            _occupancyMap->setField(fields.occupancy);
+        }
+        _cloudShadowMap->apply(fields.shadow);
+        _cloudShadowMatrix->set(fields.shadow.shadowMatrix);
+    }
+
+    // 拖动滑块时参数每帧都在变，计算期间的变化合并到下一次
+    if (!_cloudShadowDirty.exchange(false)) return;
+
+    osg::Vec3 sunDirection;
+    _sunDirection->get(sunDirection);
+
+    CloudShadowMap::CloudParameters params;
+    _densityThreshold->get(params.densityThreshold);
+    _contrast->get(params.contrast);
+    _densityFactor->get(params.densityFactor);
+
+    // 阈值不变时沿用当前距离场，只重算透射率图
+    const bool rebuildOccupancy = params.densityThreshold != _occupancyThreshold;
+    _occupancyThreshold = params.densityThreshold;
+    std::vector<unsigned char> occupancy;
+    if (!rebuildOccupancy) {
+        occupancy = _occupancyMap->getField();
+    }
+
+    osg::ref_ptr<CloudOccupancyMap> occupancyMap = _occupancyMap;
+    osg::ref_ptr<CloudShadowMap> shadowMap = _cloudShadowMap;
+    _pendingFields = std::async(std::launch::async, [occupancyMap, shadowMap, sunDirection, params, rebuildOccupancy, occupancy]() {
+        CloudFields fields;
+        fields.occupancyRebuilt = rebuildOccupancy;
+        fields.occupancy = rebuildOccupancy ? occupancyMap->computeField(params.densityThreshold) : occupancy;
+        fields.shadow = shadowMap->compute(sunDirection, params, fields.occupancy);
+        return fields;
+    });
 }
 
 bool VolumeCloudSky::computeLocalToWorldMatrix(osg::Matrix& matrix, osg::NodeVisitor* nv) const
@@ -227,16 +288,33 @@ bool VolumeCloudSky::computeWorldToLocalMatrix(osg::Matrix& matrix, osg::NodeVis
 // 设置太阳天顶角度
 void VolumeCloudSky::setSunZenithAngle(float angle)
 {
-    if (_sunZenithAngle.valid()) {
-        _sunZenithAngle->set(angle);
+    // 界面每次拖动都会把全部参数一起传进来，值不变时不触发透射率图重算
+    if (!_sunZenithAngle.valid()) return;
+    float current = 0.0f;
+    _sunZenithAngle->get(current);
+    if (current == angle) return;
+    _sunZenithAngle->set(angle);
+    if (_sunDirection.valid()) {
+        float sunAzimuthAngle = 0.0f;
+        _sunAzimuthAngle->get(sunAzimuthAngle);
+        _sunDirection->set(computeSunDirection(angle, sunAzimuthAngle));
+        _cloudShadowDirty = true;
     }
 }
 
 // 设置太阳方位角度
 void VolumeCloudSky::setSunAzimuthAngle(float angle)
 {
-    if (_sunAzimuthAngle.valid()) {
-        _sunAzimuthAngle->set(angle);
+    if (!_sunAzimuthAngle.valid()) return;
+    float current = 0.0f;
+    _sunAzimuthAngle->get(current);
+    if (current == angle) return;
+    _sunAzimuthAngle->set(angle);
+    if (_sunDirection.valid()) {
+        float sunZenithAngle = 0.0f;
+        _sunZenithAngle->get(sunZenithAngle);
+        _sunDirection->set(computeSunDirection(sunZenithAngle, angle));
+        _cloudShadowDirty = true;
     }
 }
 
@@ -251,22 +329,35 @@ void VolumeCloudSky::setCloudDensity(float density)
 // 设置密度阈值
 void VolumeCloudSky::setDensityThreshold(float threshold)
 {
-    if (_densityThreshold.valid())
-        _densityThreshold->set(threshold);
+    if (!_densityThreshold.valid()) return;
+    float current = 0.0f;
+    _densityThreshold->get(current);
+    if (current == threshold) return;
+    _densityThreshold->set(threshold);
+    // 阈值决定哪些格子为空，距离场和透射率图都在后台重建
+    _cloudShadowDirty = true;
 }
 
 // 设置对比度
 void VolumeCloudSky::setContrast(float contrast)
 {
-    if (_contrast.valid())
-        _contrast->set(contrast);
+    if (!_contrast.valid()) return;
+    float current = 0.0f;
+    _contrast->get(current);
+    if (current == contrast) return;
+    _contrast->set(contrast);
+    _cloudShadowDirty = true;
 }
 
 // 设置密度因子
 void VolumeCloudSky::setDensityFactor(float factor)
 {
-    if (_densityFactor.valid())
-        _densityFactor->set(factor);
+    if (!_densityFactor.valid()) return;
+    float current = 0.0f;
+    _densityFactor->get(current);
+    if (current == factor) return;
+    _densityFactor->set(factor);
+    _cloudShadowDirty = true;
 }
 
 // 设置步长
@@ -281,4 +372,35 @@ void VolumeCloudSky::setMaxSteps(int steps)
 {
     if (_maxSteps.valid())
         _maxSteps->set(steps);
+    // 跨档时切换到对应的编译期变体，档内只更新uniform
+    if (!_shaderPath.empty() && std::min(cloudMaxStepsVariant(steps), cloudMaxStepsLimit(_quality)) != _maxStepsVariant)
+        applyProgramVariant();
+}
+
+// 设置质量档位
+void VolumeCloudSky::setQuality(SkyQuality quality)
+{
+    if (quality == _quality) return;
+    _quality = quality;
+    if (!_shaderPath.empty())
+        applyProgramVariant();
+}
+
+// 按当前步进上限、质量档位和功能开关从缓存中取着色器变体
+void VolumeCloudSky::applyProgramVariant()
+{
+    int maxSteps = 200;
+    _maxSteps->get(maxSteps);
+    _maxStepsVariant = std::min(cloudMaxStepsVariant(maxSteps), cloudMaxStepsLimit(_quality));
+
+    ShaderProgramCache::Defines defines;
+    defines["MAX_STEPS"] = std::to_string(_maxStepsVariant);
+    defines["CLOUD_SKIP_EMPTY"] = _skipEmptySpace ? "1" : "0";
+
+    // CloudSky.frag是本节点uniform（步进参数、空域跳跃距离场、透射率图）对应的体积云步进着色器
+    osg::ref_ptr<osg::Program> program = ShaderProgramCache::instance().getProgramFromFiles(
+        _shaderPath + "CloudSky.vert", _shaderPath + "CloudSky.frag", defines);
+    if (program.valid()) {
+        getOrCreateStateSet()->setAttributeAndModes(program.get(), osg::StateAttribute::ON);
+    }
 }
@@ -2,13 +2,19 @@
 #include "osg/Transform"
 #include <osg/Texture2D>
 #include <osg/Uniform>
+#include "CloudOccupancyMap.h"
+#include "CloudShadowMap.h"
+#include "SkyQuality.h"
+#include <atomic>
+#include <future>
+#include <string>
+#include <vector>
 
-// 体积云天空盒类
+// 体积云天空盒类（CloudSky.vert/.frag，在云盒内做光线步进）
 class VolumeCloudSky : public osg::Transform
 {
 public:
     VolumeCloudSky();
-    VolumeCloudSky(osg::Camera* camera);
 
     VolumeCloudSky(const VolumeCloudSky& copy, osg::CopyOp copyop = osg::CopyOp::SHALLOW_COPY) : osg::Transform(copy, copyop) {}
 
@@ -41,6 +47,12 @@ public:
     void updateFromSkyNodeParameters(float turbidity, float rayleigh, float mieCoefficient, float mieDirectionalG, 
                                    float sunZenithAngle, float sunAzimuthAngle, float cloudDensity);
                                    
+    // 太阳方向或云参数变化后在后台线程重算距离场和透射率图，完成后在下一次调用时换入；由更新回调每帧调用
+    void updateCloudShadow();
+    CloudShadowMap* getCloudShadowMap() const { return _cloudShadowMap.get(); }
+
+    void setQuality(SkyQuality quality);  // 切换着色器质量档位（限制MAX_STEPS变体）
+
     META_Node(osg, VolumeCloudSky);
 
     virtual bool computeLocalToWorldMatrix(osg::Matrix& matrix, osg::NodeVisitor* nv) const;
@@ -66,4 +78,30 @@ private:
     osg::ref_ptr<osg::Uniform> _densityFactor;
     osg::ref_ptr<osg::Uniform> _stepSize;
     osg::ref_ptr<osg::Uniform> _maxSteps;
+
+    // 空域跳跃距离场，随密度阈值重建
+    osg::ref_ptr<CloudOccupancyMap> _occupancyMap;
+    float _occupancyThreshold = -1.0f;
+
+    // 光照空间透射率图，替代着色器中的逐步光照步进
+    osg::ref_ptr<osg::Uniform> _sunDirection;
+    osg::ref_ptr<osg::Uniform> _cloudShadowMatrix;
+    osg::ref_ptr<CloudShadowMap> _cloudShadowMap;
+
+    // 后台重算的结果；参数在计算期间再次变化时，换入后再算一次
+    struct CloudFields
+    {
+        bool occupancyRebuilt = false;
+        std::vector<unsigned char> occupancy;
+        CloudShadowMap::Result shadow;
+    };
+    std::future<CloudFields> _pendingFields;
+    std::atomic<bool> _cloudShadowDirty{true};
+
+    // 着色器变体：MAX_STEPS按maxSteps分档，云图加载失败时关闭空域跳跃
+    void applyProgramVariant();
+    std::string _shaderPath;
+    int _maxStepsVariant = 0;
+    SkyQuality _quality = SkyQuality::High;
+    bool _skipEmptySpace = true;
 };
\ No newline at end of file
@@ -0,0 +1,320 @@
+#include "aerialperspective.h"
+#include "shaderprogramcache.h"
+#include "SkyNode.h"
+#include <osg/BlendFunc>
+#include <osg/Depth>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+    // 后台重算的最小间隔（帧）
+    const unsigned int kRefreshInterval = 6;
+    // 体素在屏幕方向比视锥略大，相机在两次重算之间转动时边缘仍有数据
+    const float kGuardBand = 1.15f;
+
+    // 与X1天空着色器相同的常量
+    const float kPi = 3.14159265358979f;
+    const osg::Vec3f kTotalRayleigh(5.804542996261093e-6f, 1.3562911419845635e-5f, 3.0265902468824876e-5f);
+    const osg::Vec3f kMieConst(1.8399918514433978e14f, 2.7798023919660528e14f, 4.0790479543861094e14f);
+    const float kRayleighScaleHeight = 8.4e3f;
+    const float kMieScaleHeight = 1.25e3f;
+    const float kCutoffAngle = 1.6110731556870734f;
+    const float kSteepness = 1.5f;
+    const float kSunIntensity = 1000.0f;
+
+    // 叠加pass：位置变换与固定管线一致（ftransform），深度LEQUAL时与模型本身逐像素重合
+    const char* const kHazeVert = R"(#version 330 compatibility
+        uniform mat4 osg_ViewMatrixInverse;
+        out vec3 vWorldPosition;
+        void main()
+        {
+            vWorldPosition = (osg_ViewMatrixInverse * (gl_ModelViewMatrix * gl_Vertex)).xyz;
+            gl_Position = ftransform();
+        }
+    )";
+
+    // 按体素重算时的视图投影矩阵定位，深度方向按 sqrt(距离 / 最远距离) 分层，近处分辨率更高
+    const char* const kHazeFrag = R"(#version 330 compatibility
+        in vec3 vWorldPosition;
+        out vec4 FragColor;
+        uniform sampler3D froxelVolume;
+        uniform mat4 froxelViewProjection;
+        uniform vec3 froxelEye;
+        uniform float froxelMaxDistance;
+        uniform float froxelGuardBand;
+        void main()
+        {
+            vec4 clip = froxelViewProjection * vec4(vWorldPosition, 1.0);
+            vec2 ndc = clip.xy / max(clip.w, 0.0001);
+            float depth = sqrt(clamp(distance(vWorldPosition, froxelEye) / froxelMaxDistance, 0.0, 1.0));
+            // rgb内散射，a透过率，混合方式为 src + dst * src.a
+            FragColor = texture(froxelVolume, vec3(ndc / froxelGuardBand * 0.5 + 0.5, depth));
+        }
+    )";
+
+    float uniformFloat(const osg::StateSet* stateSet, const char* name, float fallback)
+    {
+        const osg::Uniform* uniform = stateSet->getUniform(name);
+        float value = fallback;
+        if (uniform) {
+            uniform->get(value);
+        }
+        return value;
+    }
+
+    osg::Vec3f mul(const osg::Vec3f& a, const osg::Vec3f& b)
+    {
+        return osg::Vec3f(a.x() * b.x(), a.y() * b.y(), a.z() * b.z());
+    }
+
+    osg::Vec3f pow3(const osg::Vec3f& v, float exponent)
+    {
+        return osg::Vec3f(std::pow(std::max(v.x(), 0.0f), exponent),
+                          std::pow(std::max(v.y(), 0.0f), exponent),
+                          std::pow(std::max(v.z(), 0.0f), exponent));
+    }
+
+    osg::Vec3f exp3(const osg::Vec3f& v)
+    {
+        return osg::Vec3f(std::exp(v.x()), std::exp(v.y()), std::exp(v.z()));
+    }
+
+    // 从高度h0出发、方向余弦mu、长度s的射线上，按标高H指数衰减的密度积分（地面处密度为1）
+    float opticalLength(float h0, float mu, float s, float scaleHeight)
+    {
+        float base = std::exp(-h0 / scaleHeight);
+        float k = mu * s / scaleHeight;
+        if (std::fabs(k) < 1.0e-3f) {
+            return base * s * (1.0f - 0.5f * k);
+        }
+        return base * scaleHeight * (1.0f - std::exp(-k)) / mu;
+    }
+}
+
+bool AerialPerspective::Parameters::operator==(const Parameters& other) const
+{
+    return view == other.view && projection == other.projection
+        && turbidity == other.turbidity && rayleigh == other.rayleigh
+        && mieCoefficient == other.mieCoefficient && mieDirectionalG == other.mieDirectionalG
+        && sunZenithAngle == other.sunZenithAngle && sunAzimuthAngle == other.sunAzimuthAngle
+        && up == other.up && metersPerUnit == other.metersPerUnit && maxDistance == other.maxDistance;
+}
+
+AerialPerspective::AerialPerspective(SkyBoxThree* sky, osg::Camera* camera)
+    : _skyStateSet(sky ? sky->getOrCreateStateSet() : nullptr)
+    , _camera(camera)
+    , _metersPerUnit(1.0f)
+    , _maxDistance(30000.0f)
+    , _hasApplied(false)
+    , _framesSinceLaunch(kRefreshInterval)
+{
+    setName("aerial_perspective");
+
+    // 第一次重算完成之前透过率为1、内散射为0，模型不受影响
+    _image = new osg::Image;
+    _image->allocateImage(kFroxelSize, kFroxelSize, kFroxelSize, GL_RGBA, GL_FLOAT);
+    _image->setInternalTextureFormat(GL_RGBA16F_ARB);
+    std::fill_n(reinterpret_cast<osg::Vec4f*>(_image->data()), kFroxelSize * kFroxelSize * kFroxelSize,
+                osg::Vec4f(0.0f, 0.0f, 0.0f, 1.0f));
+    // 每次重算后重写，上传后保留CPU数据
+    _image->setDataVariance(osg::Object::DYNAMIC);
+
+    _texture = new osg::Texture3D(_image.get());
+    _texture->setInternalFormat(GL_RGBA16F_ARB);
+    _texture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::LINEAR);
+    _texture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::LINEAR);
+    _texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+    _texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+    _texture->setWrap(osg::Texture::WRAP_R, osg::Texture::CLAMP_TO_EDGE);
+    _texture->setResizeNonPowerOfTwoHint(false);
+
+    _viewProjection = new osg::Uniform("froxelViewProjection", osg::Matrixf());
+    _eye = new osg::Uniform("froxelEye", osg::Vec3f());
+    _maxDistanceUniform = new osg::Uniform("froxelMaxDistance", _maxDistance);
+
+    // 叠加pass的状态覆盖模型自身的程序、纹理、混合和深度设置；排在不透明物体之后、透明物体之前
+    osg::StateSet* stateSet = getOrCreateStateSet();
+    const osg::StateAttribute::GLModeValue overrideOn = osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE;
+    stateSet->setAttributeAndModes(ShaderProgramCache::instance().getProgram("AerialPerspective", kHazeVert, kHazeFrag),
+                                   overrideOn);
+    stateSet->setTextureAttribute(kFroxelUnit, _texture.get(), osg::StateAttribute::OVERRIDE);
+    stateSet->addUniform(new osg::Uniform("froxelVolume", static_cast<int>(kFroxelUnit)));
+    stateSet->addUniform(new osg::Uniform("froxelGuardBand", kGuardBand));
+    stateSet->addUniform(_viewProjection.get());
+    stateSet->addUniform(_eye.get());
+    stateSet->addUniform(_maxDistanceUniform.get());
+    // 颜色 = 内散射 + 模型颜色 * 透过率，目标alpha保持不变（MSAA合成按预乘alpha）
+    stateSet->setAttributeAndModes(new osg::BlendFunc(GL_ONE, GL_SRC_ALPHA, GL_ZERO, GL_ONE), overrideOn);
+    stateSet->setAttributeAndModes(new osg::Depth(osg::Depth::LEQUAL, 0.0, 1.0, false), overrideOn);
+    stateSet->setRenderBinDetails(5, "RenderBin", osg::StateSet::OVERRIDE_RENDERBIN_DETAILS);
+
+    // 本节点没有更新回调，加载的模型通常也没有，需要显式要求更新遍历才会进入traverse()重算体素
+    setNumChildrenRequiringUpdateTraversal(getNumChildrenRequiringUpdateTraversal() + 1);
+}
+
+AerialPerspective::~AerialPerspective()
+{
+    // 等后台计算结束，它只读取自己的参数副本
+    if (_pending.valid()) {
+        _pending.wait();
+    }
+}
+
+void AerialPerspective::setMaxDistance(float maxDistance)
+{
+    _maxDistance = std::max(maxDistance, 1.0f);
+}
+
+void AerialPerspective::addModel(osg::Node* model)
+{
+    if (model) {
+        addChild(model);
+    }
+}
+
+AerialPerspective* AerialPerspective::find(osg::Group* root)
+{
+    if (!root) return nullptr;
+
+    for (unsigned int i = 0; i < root->getNumChildren(); ++i) {
+        osg::Node* child = root->getChild(i);
+        if (AerialPerspective* aerial = dynamic_cast<AerialPerspective*>(child)) {
+            return aerial;
+        }
+        osg::Group* group = child ? child->asGroup() : nullptr;
+        if (!group) continue;
+        for (unsigned int j = 0; j < group->getNumChildren(); ++j) {
+            if (AerialPerspective* aerial = dynamic_cast<AerialPerspective*>(group->getChild(j))) {
+                return aerial;
+            }
+        }
+    }
+    return nullptr;
+}
+
+bool AerialPerspective::gatherParameters(Parameters& parameters) const
+{
+    osg::ref_ptr<osg::Camera> camera;
+    if (!_skyStateSet.valid() || !_camera.lock(camera)) return false;
+
+    parameters.view = camera->getViewMatrix();
+    parameters.projection = camera->getProjectionMatrix();
+    parameters.turbidity = uniformFloat(_skyStateSet.get(), "turbidity", 2.0f);
+    parameters.rayleigh = uniformFloat(_skyStateSet.get(), "rayleigh", 1.0f);
+    parameters.mieCoefficient = uniformFloat(_skyStateSet.get(), "mieCoefficient", 0.005f);
+    parameters.mieDirectionalG = uniformFloat(_skyStateSet.get(), "mieDirectionalG", 0.8f);
+    parameters.sunZenithAngle = uniformFloat(_skyStateSet.get(), "sunZenithAngle", 0.0f);
+    parameters.sunAzimuthAngle = uniformFloat(_skyStateSet.get(), "sunAzimuthAngle", 0.0f);
+    parameters.up = osg::Vec3f(0.0f, 0.0f, 1.0f);
+    if (const osg::Uniform* up = _skyStateSet->getUniform("up")) {
+        up->get(parameters.up);
+    }
+    parameters.metersPerUnit = _metersPerUnit;
+    parameters.maxDistance = _maxDistance;
+    return true;
+}
+
+std::vector<osg::Vec4f> AerialPerspective::computeFroxels(const Parameters& parameters)
+{
+    // 太阳方向、强度和消光系数的算法与X1.vert一致
+    osg::Vec3f sunDirection(std::cos(parameters.sunZenithAngle) * std::cos(parameters.sunAzimuthAngle),
+                            std::sin(parameters.sunZenithAngle),
+                            std::cos(parameters.sunZenithAngle) * std::sin(parameters.sunAzimuthAngle));
+    sunDirection.normalize();
+    float sunCos = osg::clampBetween(sunDirection * parameters.up, -1.0f, 1.0f);
+    float sunE = kSunIntensity * std::max(0.0f, 1.0f - std::exp(-(kCutoffAngle - std::acos(sunCos)) / kSteepness));
+    float sunfade = 1.0f - osg::clampBetween(1.0f - std::exp(sunDirection.z() / 450000.0f), 0.0f, 1.0f);
+    osg::Vec3f betaR = kTotalRayleigh * (parameters.rayleigh - (1.0f - sunfade));
+    osg::Vec3f betaM = kMieConst * (0.434f * 0.2f * parameters.turbidity * 10e-18f * parameters.mieCoefficient);
+    osg::Vec3f betaSum = betaR + betaM;
+    float horizonBlend = osg::clampBetween(std::pow(1.0f - sunCos, 5.0f), 0.0f, 1.0f);
+    float exponent = 1.0f / (1.2f + 1.2f * sunfade);
+    float g = parameters.mieDirectionalG;
+    float g2 = g * g;
+
+    osg::Matrixd inverseView = osg::Matrixd::inverse(parameters.view);
+    osg::Matrixd inverseProjection = osg::Matrixd::inverse(parameters.projection);
+    osg::Vec3d eye = inverseView.getTrans();
+    float h0 = std::max(0.0f, static_cast<float>(eye * osg::Vec3d(parameters.up)) * parameters.metersPerUnit);
+
+    std::vector<osg::Vec4f> froxels(kFroxelSize * kFroxelSize * kFroxelSize);
+    for (unsigned int y = 0; y < kFroxelSize; ++y) {
+        for (unsigned int x = 0; x < kFroxelSize; ++x) {
+            // 体素列中心的世界方向
+            osg::Vec3d ndc(((x + 0.5) / kFroxelSize * 2.0 - 1.0) * kGuardBand,
+                           ((y + 0.5) / kFroxelSize * 2.0 - 1.0) * kGuardBand, 1.0);
+            osg::Vec3d viewPoint = ndc * inverseProjection;
+            osg::Vec3f direction = osg::Vec3f(osg::Matrixd::transform3x3(viewPoint, inverseView));
+            direction.normalize();
+            float mu = direction * parameters.up;
+
+            // 相位函数只与方向有关
+            float cosTheta = direction * sunDirection;
+            float rayleighCos = cosTheta * 0.5f + 0.5f;
+            float rPhase = 3.0f / (16.0f * kPi) * (1.0f + rayleighCos * rayleighCos);
+            float mPhase = (1.0f / (4.0f * kPi)) * (1.0f - g2) / std::pow(1.0f + g2 - 2.0f * g * cosTheta, 1.5f);
+            osg::Vec3f phaseRatio = betaR * rPhase + betaM * mPhase;
+            phaseRatio = osg::Vec3f(phaseRatio.x() / betaSum.x(), phaseRatio.y() / betaSum.y(), phaseRatio.z() / betaSum.z());
+
+            for (unsigned int z = 0; z < kFroxelSize; ++z) {
+                float w = (z + 0.5f) / kFroxelSize;
+                float s = w * w * parameters.maxDistance * parameters.metersPerUnit;
+                osg::Vec3f tau = betaR * opticalLength(h0, mu, s, kRayleighScaleHeight)
+                               + betaM * opticalLength(h0, mu, s, kMieScaleHeight);
+                osg::Vec3f fex = exp3(-tau);
+
+                // 天空着色器对 (1 - Fex) 的内散射做的非线性映射，距离无穷远时与地平线天空颜色一致
+                osg::Vec3f scatter = phaseRatio * sunE;
+                osg::Vec3f lin = pow3(mul(scatter, osg::Vec3f(1.0f, 1.0f, 1.0f) - fex), 1.5f);
+                osg::Vec3f horizon = pow3(mul(scatter, fex), 0.5f);
+                lin = mul(lin, osg::Vec3f(1.0f, 1.0f, 1.0f) * (1.0f - horizonBlend) + horizon * horizonBlend);
+                osg::Vec3f color = pow3(lin * 0.08f, exponent) * 0.2f;
+
+                float transmittance = fex * osg::Vec3f(0.2126f, 0.7152f, 0.0722f);
+                froxels[(z * kFroxelSize + y) * kFroxelSize + x] = osg::Vec4f(color, transmittance);
+            }
+        }
+    }
+    return froxels;
+}
+
+void AerialPerspective::applyFroxels(const std::vector<osg::Vec4f>& froxels, const Parameters& parameters)
+{
+    std::copy(froxels.begin(), froxels.end(), reinterpret_cast<osg::Vec4f*>(_image->data()));
+    _image->dirty();
+    _viewProjection->set(osg::Matrixf(parameters.view * parameters.projection));
+    _eye->set(osg::Vec3f(osg::Matrixd::inverse(parameters.view).getTrans()));
+    _maxDistanceUniform->set(parameters.maxDistance);
+    _appliedParameters = parameters;
+    _hasApplied = true;
+}
+
+void AerialPerspective::traverse(osg::NodeVisitor& nv)
+{
+    if (nv.getVisitorType() == osg::NodeVisitor::UPDATE_VISITOR) {
+        // 模型本身已在场景中更新过，这里不再遍历子节点
+        ++_framesSinceLaunch;
+        if (_pending.valid() && _pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            // 纹理和定位用的矩阵在同一帧切换
+            applyFroxels(_pending.get(), _pendingParameters);
+        }
+
+        Parameters parameters;
+        if (!_pending.valid() && _framesSinceLaunch >= kRefreshInterval && gatherParameters(parameters)
+            && !(_hasApplied && parameters == _appliedParameters)) {
+            _pendingParameters = parameters;
+            _pending = std::async(std::launch::async, &AerialPerspective::computeFroxels, parameters);
+            _framesSinceLaunch = 0;
+        }
+        return;
+    }
+
+    // 第一次重算完成之前叠加pass不改变颜色，不必再画一遍模型
+    if (nv.getVisitorType() == osg::NodeVisitor::CULL_VISITOR && !_hasApplied) {
+        return;
+    }
+
+    osg::Group::traverse(nv);
+}
@@ -0,0 +1,88 @@
+#ifndef AERIALPERSPECTIVE_H
+#define AERIALPERSPECTIVE_H
+
+#include <osg/Camera>
+#include <osg/Group>
+#include <osg/Image>
+#include <osg/Matrix>
+#include <osg/Texture3D>
+#include <osg/Uniform>
+#include <osg/observer_ptr>
+#include <osg/ref_ptr>
+#include <future>
+#include <vector>
+
+class SkyBoxThree;
+
+// 空气透视（远处物体的大气雾化）
+// 按相机视锥划分32x32x32的体素（froxel），每格存放从相机到该格的内散射颜色（rgb）和透过率（a），
+// 与X1天空着色器用同一套Rayleigh/Mie参数，光学厚度按高度指数衰减解析求出；
+// 每隔几帧在后台线程按当时的相机和天空参数重算一次，两者都不变时不重算。
+// 加载的模型保持原有的固定管线外观，再由本节点以叠加pass各画一遍：
+// 一次3D纹理采样，按 颜色 * 透过率 + 内散射 混合到已画好的模型上
+class AerialPerspective : public osg::Group
+{
+public:
+    static const unsigned int kFroxelSize = 32;
+    static const unsigned int kFroxelUnit = 0;
+
+    AerialPerspective(SkyBoxThree* sky, osg::Camera* camera);
+
+    // 场景单位对应的米数，以及体素覆盖的最远距离（场景单位）
+    void setMetersPerUnit(float metersPerUnit) { _metersPerUnit = metersPerUnit; }
+    void setMaxDistance(float maxDistance);
+
+    // 给模型叠加空气透视；模型仍需单独加入场景
+    void addModel(osg::Node* model);
+
+    // 在根节点及其子节点中查找（大气场景的根节点挂在rootNode下）
+    static AerialPerspective* find(osg::Group* root);
+
+    virtual void traverse(osg::NodeVisitor& nv) override;
+
+protected:
+    virtual ~AerialPerspective();
+
+private:
+    // 计算一次体素所需的全部输入，在更新遍历中采集后交给后台线程
+    struct Parameters
+    {
+        osg::Matrixd view;
+        osg::Matrixd projection;
+        float turbidity = 0.0f;
+        float rayleigh = 0.0f;
+        float mieCoefficient = 0.0f;
+        float mieDirectionalG = 0.0f;
+        float sunZenithAngle = 0.0f;
+        float sunAzimuthAngle = 0.0f;
+        osg::Vec3f up;
+        float metersPerUnit = 1.0f;
+        float maxDistance = 0.0f;
+
+        bool operator==(const Parameters& other) const;
+    };
+
+    bool gatherParameters(Parameters& parameters) const;
+    static std::vector<osg::Vec4f> computeFroxels(const Parameters& parameters);
+    void applyFroxels(const std::vector<osg::Vec4f>& froxels, const Parameters& parameters);
+
+    osg::ref_ptr<osg::StateSet> _skyStateSet;
+    osg::observer_ptr<osg::Camera> _camera;
+    float _metersPerUnit;
+    float _maxDistance;
+
+    osg::ref_ptr<osg::Image> _image;
+    osg::ref_ptr<osg::Texture3D> _texture;
+    osg::ref_ptr<osg::Uniform> _viewProjection;
+    osg::ref_ptr<osg::Uniform> _eye;
+    osg::ref_ptr<osg::Uniform> _maxDistanceUniform;
+
+    // 更新遍历中使用
+    std::future<std::vector<osg::Vec4f> > _pending;
+    Parameters _pendingParameters;
+    Parameters _appliedParameters;
+    bool _hasApplied;
+    unsigned int _framesSinceLaunch;
+};
+
+#endif // AERIALPERSPECTIVE_H
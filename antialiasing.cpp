@@ -0,0 +1,614 @@
+#include "antialiasing.h"
+#include "shaderprogramcache.h"
+#include "skybox.h"
+#include "SkyNode.h"
+#include "SkyCloud.h"
+#include "VolumeCloudSky.h"
+#include "CloudSeaAtmosphere.h"
+#include <osg/BlendFunc>
+#include <osg/Depth>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/NodeCallback>
+#include <osgUtil/CullVisitor>
+#include <osgViewer/Renderer>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // 全屏三角形，顶点直接给出裁剪坐标
+    const char* const kFullScreenVert = R"(#version 330 core
+        layout(location = 0) in vec3 position;
+        out vec2 uv;
+        void main()
+        {
+            uv = position.xy * 0.5 + 0.5;
+            gl_Position = vec4(position.xy, 0.0, 1.0);
+        }
+    )";
+
+    // 中间纹理按全尺寸分配，降分辨率时只用左下角sourceScale的区域，采样坐标钳在该区域内
+    // 原样输出（双线性放大）；MSAA合成时配合预乘alpha混合
+    const char* const kCopyFrag = R"(#version 330 core
+        in vec2 uv;
+        out vec4 FragColor;
+        uniform sampler2D sourceTexture;
+        uniform vec2 sourceScale;
+        uniform vec2 texelSize;
+        void main()
+        {
+            FragColor = texture(sourceTexture, clamp(uv * sourceScale, 0.5 * texelSize, sourceScale - 0.5 * texelSize));
+        }
+    )";
+
+    // FXAA：沿亮度梯度的垂直方向做两级采样，超出邻域亮度范围时退回到较短的一级
+    const char* const kFxaaFrag = R"(#version 330 core
+        in vec2 uv;
+        out vec4 FragColor;
+        uniform sampler2D sourceTexture;
+        uniform vec2 sourceScale;
+        uniform vec2 texelSize;
+
+        const float FXAA_REDUCE_MIN = 1.0 / 128.0;
+        const float FXAA_REDUCE_MUL = 1.0 / 8.0;
+        const float FXAA_SPAN_MAX = 8.0;
+
+        float luma(vec3 color)
+        {
+            return dot(color, vec3(0.299, 0.587, 0.114));
+        }
+
+        vec3 fetch(vec2 p)
+        {
+            return texture(sourceTexture, clamp(p, 0.5 * texelSize, sourceScale - 0.5 * texelSize)).rgb;
+        }
+
+        void main()
+        {
+            vec2 p = uv * sourceScale;
+            vec3 rgbM = fetch(p);
+            float lumaNW = luma(fetch(p + vec2(-1.0, -1.0) * texelSize));
+            float lumaNE = luma(fetch(p + vec2( 1.0, -1.0) * texelSize));
+            float lumaSW = luma(fetch(p + vec2(-1.0,  1.0) * texelSize));
+            float lumaSE = luma(fetch(p + vec2( 1.0,  1.0) * texelSize));
+            float lumaM = luma(rgbM);
+            float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+            float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+
+            vec2 dir = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+            float dirReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25 * FXAA_REDUCE_MUL, FXAA_REDUCE_MIN);
+            float rcpDirMin = 1.0 / (min(abs(dir.x), abs(dir.y)) + dirReduce);
+            dir = clamp(dir * rcpDirMin, vec2(-FXAA_SPAN_MAX), vec2(FXAA_SPAN_MAX)) * texelSize;
+
+            vec3 rgbA = 0.5 * (fetch(p + dir * (1.0 / 3.0 - 0.5)) + fetch(p + dir * (2.0 / 3.0 - 0.5)));
+            vec3 rgbB = rgbA * 0.5 + 0.25 * (fetch(p - dir * 0.5) + fetch(p + dir * 0.5));
+            float lumaB = luma(rgbB);
+            FragColor = vec4((lumaB < lumaMin || lumaB > lumaMax) ? rgbA : rgbB, 1.0);
+        }
+    )";
+
+    // TAA：按深度重建世界坐标并投影到上一帧，历史颜色裁剪到当前3x3邻域的包围盒内再混合
+    const char* const kTaaFrag = R"(#version 330 core
+        in vec2 uv;
+        out vec4 FragColor;
+        uniform sampler2D sourceTexture;
+        uniform sampler2D depthTexture;
+        uniform sampler2D historyTexture;
+        uniform vec2 sourceScale;
+        uniform vec2 texelSize;
+        uniform mat4 invViewProjection;
+        uniform mat4 previousViewProjection;
+        uniform bool historyValid;
+        uniform float historyWeight;
+
+        vec2 sourceUv(vec2 p)
+        {
+            return clamp(p * sourceScale, 0.5 * texelSize, sourceScale - 0.5 * texelSize);
+        }
+
+        void main()
+        {
+            vec2 p = sourceUv(uv);
+            vec3 current = texture(sourceTexture, p).rgb;
+            if (!historyValid) {
+                FragColor = vec4(current, 1.0);
+                return;
+            }
+
+            vec3 neighborMin = current;
+            vec3 neighborMax = current;
+            for (int y = -1; y <= 1; ++y) {
+                for (int x = -1; x <= 1; ++x) {
+                    vec3 neighbor = texture(sourceTexture, sourceUv(uv + vec2(x, y) * texelSize / sourceScale)).rgb;
+                    neighborMin = min(neighborMin, neighbor);
+                    neighborMax = max(neighborMax, neighbor);
+                }
+            }
+
+            float depth = texture(depthTexture, p).r;
+            vec4 world = invViewProjection * vec4(uv * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+            world /= world.w;
+            vec4 previousClip = previousViewProjection * world;
+            vec2 previousUv = previousClip.xy / previousClip.w * 0.5 + 0.5;
+            if (previousClip.w <= 0.0 || any(lessThan(previousUv, vec2(0.0))) || any(greaterThan(previousUv, vec2(1.0)))) {
+                FragColor = vec4(current, 1.0);
+                return;
+            }
+
+            vec3 history = clamp(texture(historyTexture, sourceUv(previousUv)).rgb, neighborMin, neighborMax);
+            FragColor = vec4(mix(current, history, historyWeight), 1.0);
+        }
+    )";
+
+    // Halton序列，TAA取(2,3)两个基的前8项作为抖动
+    float halton(unsigned int index, unsigned int base)
+    {
+        float result = 0.0f;
+        float fraction = 1.0f / base;
+        while (index > 0) {
+            result += fraction * (index % base);
+            index /= base;
+            fraction /= base;
+        }
+        return result;
+    }
+    const unsigned int kJitterSamples = 8;
+
+    bool isSkyNode(const osg::Node* node)
+    {
+        return dynamic_cast<const SkyBox*>(node) || dynamic_cast<const SkyBoxThree*>(node) ||
+               dynamic_cast<const VolumeCloudSky*>(node) || dynamic_cast<const SkyCloud*>(node) ||
+               dynamic_cast<const CloudSeaAtmosphere*>(node);
+    }
+
+    // 天空节点保留原有掩码位（拾取等仍可用），因此不能只靠相机的裁剪掩码排除；
+    // 裁剪掩码不含kSkyNodeMask的相机（MSAA的场景pass）在这里跳过天空子树
+    class SkyPassFilter : public osg::NodeCallback
+    {
+    public:
+        void operator()(osg::Node* node, osg::NodeVisitor* nv) override
+        {
+            osgUtil::CullVisitor* cv = nv->asCullVisitor();
+            if (cv && cv->getCurrentCamera() &&
+                (cv->getCurrentCamera()->getCullMask() & AntiAliasing::kSkyNodeMask) == 0) {
+                return;
+            }
+            traverse(node, nv);
+        }
+    };
+
+    // 天空/云层节点加上kSkyNodeMask位，不含天空的子树去掉该位，含天空的祖先保留两类；
+    // 掩码为0的节点保持隐藏不动；返回子树中是否有可见的天空节点
+    bool markSubtree(osg::Node* node)
+    {
+        if (node->getNodeMask() == 0) {
+            return false;
+        }
+        if (isSkyNode(node)) {
+            node->setNodeMask(node->getNodeMask() | AntiAliasing::kSkyNodeMask);
+            // 重复标记时复用已挂的回调
+            bool filtered = false;
+            for (osg::Callback* callback = node->getCullCallback(); callback && !filtered; callback = callback->getNestedCallback()) {
+                filtered = dynamic_cast<SkyPassFilter*>(callback) != nullptr;
+            }
+            if (!filtered) {
+                node->addCullCallback(new SkyPassFilter);
+            }
+            return true;
+        }
+
+        bool containsSky = false;
+        if (osg::Group* group = node->asGroup()) {
+            for (unsigned int i = 0; i < group->getNumChildren(); ++i) {
+                containsSky = markSubtree(group->getChild(i)) || containsSky;
+            }
+        }
+        node->setNodeMask(containsSky ? (node->getNodeMask() | AntiAliasing::kSkyNodeMask)
+                                      : (node->getNodeMask() & ~AntiAliasing::kSkyNodeMask));
+        return containsSky;
+    }
+
+    // 裁剪时记录主相机（不含抖动）的视图投影矩阵，提供当前帧的逆矩阵和上一帧的矩阵
+    class TemporalMatricesCallback : public osg::NodeCallback
+    {
+    public:
+        TemporalMatricesCallback(osg::Camera* master, osg::StateSet* stateSet, osg::Uniform* historyValid)
+            : _master(master)
+            , _invViewProjection(stateSet->getOrCreateUniform("invViewProjection", osg::Uniform::FLOAT_MAT4))
+            , _previousViewProjection(stateSet->getOrCreateUniform("previousViewProjection", osg::Uniform::FLOAT_MAT4))
+            , _historyValid(historyValid)
+            , _hasPrevious(false) {}
+
+        void operator()(osg::Node* node, osg::NodeVisitor* nv) override
+        {
+            osg::ref_ptr<osg::Camera> master;
+            if (_master.lock(master)) {
+                osg::Matrixd viewProjection = master->getViewMatrix() * master->getProjectionMatrix();
+                _invViewProjection->set(osg::Matrixf(osg::Matrixd::inverse(viewProjection)));
+                bool historyValid = false;
+                _historyValid->get(historyValid);
+                _historyValid->set(historyValid && _hasPrevious);
+                if (_hasPrevious) {
+                    _previousViewProjection->set(osg::Matrixf(_previous));
+                }
+                _previous = viewProjection;
+                _hasPrevious = true;
+            }
+            traverse(node, nv);
+        }
+
+    private:
+        osg::observer_ptr<osg::Camera> _master;
+        osg::ref_ptr<osg::Uniform> _invViewProjection;
+        osg::ref_ptr<osg::Uniform> _previousViewProjection;
+        osg::ref_ptr<osg::Uniform> _historyValid;
+        osg::Matrixd _previous;
+        bool _hasPrevious;
+    };
+
+    // 历史帧写完后才可用，由history拷贝pass的绘制回调置位
+    class HistoryWrittenCallback : public osg::Camera::DrawCallback
+    {
+    public:
+        explicit HistoryWrittenCallback(osg::Uniform* historyValid) : _historyValid(historyValid) {}
+
+        void operator()(osg::RenderInfo&) const override
+        {
+            _historyValid->set(true);
+        }
+
+    private:
+        osg::ref_ptr<osg::Uniform> _historyValid;
+    };
+}
+
+AntiAliasing::AntiAliasing(Mode mode)
+    : _requestedMode(mode)
+    , _mode(MODE_NONE)
+    , _dynamicResolution(false)
+    , _scaled(false)
+    , _renderScale(1.0f)
+    , _appliedScale(1.0f)
+    , _width(0)
+    , _height(0)
+    , _scaledWidth(0)
+    , _scaledHeight(0)
+    , _masterCullMask(~0u)
+    , _masterClearMask(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT)
+    , _frameIndex(0)
+{
+}
+
+osg::Texture2D* AntiAliasing::createTarget(GLenum internalFormat, GLenum sourceFormat, GLenum sourceType)
+{
+    osg::Texture2D* texture = new osg::Texture2D;
+    texture->setTextureSize(_width, _height);
+    texture->setInternalFormat(internalFormat);
+    texture->setSourceFormat(sourceFormat);
+    texture->setSourceType(sourceType);
+    texture->setResizeNonPowerOfTwoHint(false);
+    texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+    texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+    osg::Texture::FilterMode filter = sourceFormat == GL_DEPTH_COMPONENT ? osg::Texture::NEAREST : osg::Texture::LINEAR;
+    texture->setFilter(osg::Texture::MIN_FILTER, filter);
+    texture->setFilter(osg::Texture::MAG_FILTER, filter);
+    _targets.push_back(texture);
+    return texture;
+}
+
+osg::Camera* AntiAliasing::createRenderTargetCamera(int renderOrderNum, osg::Texture2D* color, osg::Texture2D* depth,
+                                                    unsigned int samples)
+{
+    osg::Camera* camera = new osg::Camera;
+    camera->setRenderOrder(osg::Camera::PRE_RENDER, renderOrderNum);
+    camera->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
+    camera->setViewport(0, 0, _width, _height);
+    camera->attach(osg::Camera::COLOR_BUFFER, color, 0, 0, false, samples, samples);
+    if (depth) {
+        camera->attach(osg::Camera::DEPTH_BUFFER, depth);
+    } else {
+        camera->attach(osg::Camera::DEPTH_BUFFER, GL_DEPTH_COMPONENT24);
+    }
+    return camera;
+}
+
+osg::Camera* AntiAliasing::createFullScreenPass(osg::Camera::RenderOrder order, int renderOrderNum, osg::Program* program)
+{
+    osg::Camera* camera = new osg::Camera;
+    camera->setRenderOrder(order, renderOrderNum);
+    camera->setReferenceFrame(osg::Transform::ABSOLUTE_RF);
+    camera->setViewMatrix(osg::Matrix::identity());
+    camera->setProjectionMatrix(osg::Matrix::identity());
+    camera->setComputeNearFarMode(osg::CullSettings::DO_NOT_COMPUTE_NEAR_FAR);
+    camera->setClearMask(0);
+    camera->setViewport(0, 0, _width, _height);
+
+    // 覆盖整个视口的三角形
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    vertices->push_back(osg::Vec3(-1.0f, -1.0f, 0.0f));
+    vertices->push_back(osg::Vec3(3.0f, -1.0f, 0.0f));
+    vertices->push_back(osg::Vec3(-1.0f, 3.0f, 0.0f));
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    geometry->setVertexArray(vertices);
+    geometry->setVertexAttribArray(0, vertices, osg::Array::BIND_PER_VERTEX);
+    geometry->addPrimitiveSet(new osg::DrawArrays(GL_TRIANGLES, 0, 3));
+    geometry->setCullingActive(false);
+
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    geode->addDrawable(geometry);
+    geode->setCullingActive(false);
+
+    osg::StateSet* stateSet = geode->getOrCreateStateSet();
+    stateSet->setAttributeAndModes(program, osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    stateSet->setMode(GL_DEPTH_TEST, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    stateSet->setMode(GL_CULL_FACE, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    stateSet->setAttributeAndModes(new osg::Depth(osg::Depth::ALWAYS, 0.0, 1.0, false));
+    stateSet->addUniform(new osg::Uniform("sourceTexture", 0));
+    stateSet->addUniform(_texelSize.get());
+    stateSet->addUniform(_sourceScale.get());
+
+    camera->addChild(geode);
+    return camera;
+}
+
+void AntiAliasing::addPassCamera(osg::Camera* camera, bool useMastersSceneData)
+{
+    osg::ref_ptr<osgViewer::Viewer> viewer;
+    if (!_viewer.lock(viewer)) return;
+
+    // 使用主相机场景的从相机相对主相机，全屏pass只画自己的子节点
+    camera->setGraphicsContext(viewer->getCamera()->getGraphicsContext());
+    viewer->addSlave(camera, useMastersSceneData);
+    if (!camera->getRenderer()) {
+        camera->setRenderer(new osgViewer::Renderer(camera));
+    }
+    _cameras.push_back(camera);
+}
+
+void AntiAliasing::build(osgViewer::Viewer* viewer, int width, int height)
+{
+    _viewer = viewer;
+    _scaled = _dynamicResolution;
+    _width = width;
+    _height = height;
+    _frameIndex = 0;
+
+    osg::Camera* master = viewer->getCamera();
+    _masterCullMask = master->getCullMask();
+    _masterClearMask = master->getClearMask();
+
+    _texelSize = new osg::Uniform("texelSize", osg::Vec2(1.0f / std::max(width, 1), 1.0f / std::max(height, 1)));
+    _sourceScale = new osg::Uniform("sourceScale", osg::Vec2(1.0f, 1.0f));
+
+    ShaderProgramCache& programs = ShaderProgramCache::instance();
+
+    switch (_mode) {
+    case MODE_MSAA2:
+    case MODE_MSAA4:
+    case MODE_MSAA8: {
+        unsigned int samples = _mode == MODE_MSAA2 ? 2 : (_mode == MODE_MSAA4 ? 4 : 8);
+
+        // 非天空部分画到多重采样目标，清成透明，解析后边缘像素的alpha即覆盖率
+        osg::Texture2D* color = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+        _sceneCamera = createRenderTargetCamera(0, color, nullptr, samples);
+        _sceneCamera->setClearColor(osg::Vec4(0.0f, 0.0f, 0.0f, 0.0f));
+        _sceneCamera->setCullMask(~kSkyNodeMask);
+        addPassCamera(_sceneCamera.get(), true);
+
+        int compositeOrder = 1;
+        if (_scaled) {
+            // 降分辨率时天空和云层也画到单采样纹理，先放大输出，主相机不再绘制
+            osg::Texture2D* sky = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+            _skyCamera = createRenderTargetCamera(0, sky);
+            _skyCamera->setCullMask(kSkyNodeMask);
+            addPassCamera(_skyCamera.get(), true);
+
+            master->setCullMask(0);
+            master->setClearMask(0);
+            osg::Camera* present = createFullScreenPass(osg::Camera::POST_RENDER, compositeOrder++,
+                programs.getProgram("AntiAliasingCopy", kFullScreenVert, kCopyFrag));
+            present->getChild(0)->getStateSet()->setTextureAttributeAndModes(0, sky);
+            addPassCamera(present);
+        } else {
+            // 主相机只画天空和云层
+            master->setCullMask(kSkyNodeMask);
+        }
+
+        // 场景按预乘alpha合成上去
+        osg::Camera* composite = createFullScreenPass(osg::Camera::POST_RENDER, compositeOrder,
+            programs.getProgram("AntiAliasingCopy", kFullScreenVert, kCopyFrag));
+        osg::StateSet* stateSet = composite->getChild(0)->getStateSet();
+        stateSet->setTextureAttributeAndModes(0, color);
+        stateSet->setAttributeAndModes(new osg::BlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+        addPassCamera(composite);
+        break;
+    }
+    case MODE_FXAA: {
+        osg::Texture2D* color = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+        _sceneCamera = createRenderTargetCamera(0, color);
+        addPassCamera(_sceneCamera.get(), true);
+
+        // 主相机不再绘制，由FXAA pass写满Qt的FBO
+        master->setCullMask(0);
+        master->setClearMask(0);
+        osg::Camera* fxaa = createFullScreenPass(osg::Camera::POST_RENDER, 1,
+            programs.getProgram("AntiAliasingFXAA", kFullScreenVert, kFxaaFrag));
+        fxaa->getChild(0)->getStateSet()->setTextureAttributeAndModes(0, color);
+        addPassCamera(fxaa);
+        break;
+    }
+    case MODE_TAA: {
+        osg::Texture2D* color = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+        osg::Texture2D* depth = createTarget(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT);
+        osg::Texture2D* resolved = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+        osg::Texture2D* history = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+
+        _sceneCamera = createRenderTargetCamera(0, color, depth);
+        addPassCamera(_sceneCamera.get(), true);
+
+        // 解析：当前帧 + 重投影的历史帧 -> resolved
+        _historyValid = new osg::Uniform("historyValid", false);
+        osg::Camera* resolve = createFullScreenPass(osg::Camera::PRE_RENDER, 1,
+            programs.getProgram("AntiAliasingTAA", kFullScreenVert, kTaaFrag));
+        resolve->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
+        resolve->attach(osg::Camera::COLOR_BUFFER, resolved);
+        osg::Node* resolveQuad = resolve->getChild(0);
+        osg::StateSet* stateSet = resolveQuad->getStateSet();
+        stateSet->setTextureAttributeAndModes(0, color);
+        stateSet->setTextureAttributeAndModes(1, depth);
+        stateSet->setTextureAttributeAndModes(2, history);
+        stateSet->addUniform(new osg::Uniform("depthTexture", 1));
+        stateSet->addUniform(new osg::Uniform("historyTexture", 2));
+        stateSet->addUniform(new osg::Uniform("historyWeight", 0.9f));
+        stateSet->addUniform(_historyValid.get());
+        resolveQuad->setCullCallback(new TemporalMatricesCallback(master, stateSet, _historyValid.get()));
+        addPassCamera(resolve);
+
+        // resolved拷贝到history供下一帧使用
+        osg::Camera* copy = createFullScreenPass(osg::Camera::PRE_RENDER, 2,
+            programs.getProgram("AntiAliasingCopy", kFullScreenVert, kCopyFrag));
+        copy->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
+        copy->attach(osg::Camera::COLOR_BUFFER, history);
+        copy->getChild(0)->getStateSet()->setTextureAttributeAndModes(0, resolved);
+        copy->setFinalDrawCallback(new HistoryWrittenCallback(_historyValid.get()));
+        addPassCamera(copy);
+
+        // 输出到Qt的FBO
+        master->setCullMask(0);
+        master->setClearMask(0);
+        osg::Camera* present = createFullScreenPass(osg::Camera::POST_RENDER, 1,
+            programs.getProgram("AntiAliasingCopy", kFullScreenVert, kCopyFrag));
+        present->getChild(0)->getStateSet()->setTextureAttributeAndModes(0, resolved);
+        addPassCamera(present);
+        break;
+    }
+    case MODE_NONE:
+    default:
+        if (_scaled) {
+            // 不抗锯齿但降分辨率：场景画到纹理，再放大输出
+            osg::Texture2D* color = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+            _sceneCamera = createRenderTargetCamera(0, color);
+            addPassCamera(_sceneCamera.get(), true);
+
+            master->setCullMask(0);
+            master->setClearMask(0);
+            osg::Camera* present = createFullScreenPass(osg::Camera::POST_RENDER, 1,
+                programs.getProgram("AntiAliasingCopy", kFullScreenVert, kCopyFrag));
+            present->getChild(0)->getStateSet()->setTextureAttributeAndModes(0, color);
+            addPassCamera(present);
+        }
+        break;
+    }
+
+    applyViewports(false);
+}
+
+void AntiAliasing::detach()
+{
+    osg::ref_ptr<osgViewer::Viewer> viewer;
+    if (_viewer.lock(viewer)) {
+        for (const osg::ref_ptr<osg::Camera>& camera : _cameras) {
+            unsigned int index = viewer->findSlaveIndexForCamera(camera.get());
+            if (index < viewer->getNumSlaves()) {
+                viewer->removeSlave(index);
+            }
+            camera->setGraphicsContext(nullptr);
+        }
+        if (_mode != MODE_NONE || _scaled) {
+            viewer->getCamera()->setCullMask(_masterCullMask);
+            viewer->getCamera()->setClearMask(_masterClearMask);
+        }
+    }
+
+    _cameras.clear();
+    _targets.clear();
+    _sceneCamera = nullptr;
+    _skyCamera = nullptr;
+    _historyValid = nullptr;
+    _viewer = nullptr;
+}
+
+void AntiAliasing::resize(int width, int height)
+{
+    _width = width;
+    _height = height;
+    _texelSize->set(osg::Vec2(1.0f / std::max(width, 1), 1.0f / std::max(height, 1)));
+
+    // 纹理按新尺寸重建，FBO随渲染缓存一起重建
+    for (const osg::ref_ptr<osg::Texture2D>& texture : _targets) {
+        texture->setTextureSize(width, height);
+        texture->dirtyTextureObject();
+    }
+    applyViewports(true);
+}
+
+void AntiAliasing::applyViewports(bool resetRenderingCache)
+{
+    float scale = _scaled ? _renderScale : 1.0f;
+    _appliedScale = scale;
+    _scaledWidth = std::max(1, static_cast<int>(std::lround(_width * scale)));
+    _scaledHeight = std::max(1, static_cast<int>(std::lround(_height * scale)));
+    _sourceScale->set(osg::Vec2(static_cast<float>(_scaledWidth) / std::max(_width, 1),
+                                static_cast<float>(_scaledHeight) / std::max(_height, 1)));
+
+    // 渲染到纹理的相机只画左下角的缩放区域，输出到Qt FBO的pass保持全尺寸；
+    // 纹理不重新分配，渲染缓冲按视口创建，视口变大时随渲染缓存一起重建
+    for (const osg::ref_ptr<osg::Camera>& camera : _cameras) {
+        if (camera->getRenderTargetImplementation() == osg::Camera::FRAME_BUFFER_OBJECT) {
+            camera->setViewport(0, 0, _scaledWidth, _scaledHeight);
+        } else {
+            camera->setViewport(0, 0, _width, _height);
+        }
+        if (resetRenderingCache) {
+            camera->setRenderingCache(nullptr);
+        }
+    }
+    if (_historyValid.valid()) {
+        _historyValid->set(false);
+    }
+}
+
+void AntiAliasing::markSkyNodes(osg::Node* node)
+{
+    if (node) {
+        markSubtree(node);
+    }
+}
+
+void AntiAliasing::update(osgViewer::Viewer* viewer, int width, int height)
+{
+    if (!viewer) return;
+
+    Mode mode = getMode();
+    if (mode != _mode || viewer != _viewer.get() || _dynamicResolution != _scaled) {
+        detach();
+        _mode = mode;
+        build(viewer, width, height);
+    } else if (width != _width || height != _height) {
+        resize(width, height);
+    } else if (_scaled && _renderScale != _appliedScale) {
+        applyViewports(true);
+    }
+
+    if (_mode == MODE_MSAA2 || _mode == MODE_MSAA4 || _mode == MODE_MSAA8) {
+        if (_skyCamera.valid()) {
+            _skyCamera->setClearColor(viewer->getCamera()->getClearColor());
+        }
+    } else if (_sceneCamera.valid()) {
+        // 场景切换时会修改主相机的清屏色
+        _sceneCamera->setClearColor(viewer->getCamera()->getClearColor());
+    }
+
+    if (_mode == MODE_TAA && _sceneCamera.valid() && _scaledWidth > 0 && _scaledHeight > 0) {
+        // 亚像素抖动以投影偏移的形式加在从相机上，更新遍历中由updateSlaves生效
+        unsigned int sample = (_frameIndex++ % kJitterSamples) + 1;
+        float jitterX = halton(sample, 2) - 0.5f;
+        float jitterY = halton(sample, 3) - 0.5f;
+        unsigned int index = viewer->findSlaveIndexForCamera(_sceneCamera.get());
+        if (index < viewer->getNumSlaves()) {
+            viewer->getSlave(index)._projectionOffset =
+                osg::Matrix::translate(2.0f * jitterX / _scaledWidth, 2.0f * jitterY / _scaledHeight, 0.0f);
+        }
+    }
+}
@@ -0,0 +1,108 @@
+#ifndef ANTIALIASING_H
+#define ANTIALIASING_H
+
+#include <osg/Camera>
+#include <osg/Group>
+#include <osg/Referenced>
+#include <osg/Texture2D>
+#include <osg/Uniform>
+#include <osg/observer_ptr>
+#include <osg/ref_ptr>
+#include <osgViewer/Viewer>
+#include <atomic>
+#include <vector>
+
+// 可选的抗锯齿管线
+// Qt的FBO始终为单采样，Qt不再逐帧解析多重采样；抗锯齿在OSG内部用从相机完成：
+//   MSAA：天空和云层由主相机直接画到Qt的FBO（单采样），其余场景画到清成透明的多重采样RTT，
+//         解析后按预乘alpha合成上去，全屏的天空/云层pass不付多重采样带宽
+//   FXAA：整个场景画到单采样纹理，再经FXAA全屏pass输出
+//   TAA：场景按Halton序列做亚像素抖动画到颜色+深度纹理，用深度和上一帧的视图投影矩阵重投影历史帧，
+//        邻域裁剪后与当前帧混合，结果同时作为下一帧的历史
+// 动态分辨率：场景（MSAA时包括天空和云层）画到纹理左下角按比例缩小的视口里，输出pass双线性放大到Qt的FBO；
+//            比例变化只改视口，不重新分配纹理
+class AntiAliasing : public osg::Referenced
+{
+public:
+    enum Mode
+    {
+        MODE_NONE = 0,
+        MODE_MSAA2,
+        MODE_MSAA4,
+        MODE_MSAA8,
+        MODE_FXAA,
+        MODE_TAA
+    };
+
+    // 天空和云层节点在原掩码上加的位，MSAA模式下它们只由裁剪掩码含该位的相机绘制
+    static const unsigned int kSkyNodeMask = 0x1;
+
+    explicit AntiAliasing(Mode mode = MODE_MSAA4);
+
+    // 任意线程调用，下一帧生效
+    void setMode(Mode mode) { _requestedMode = mode; }
+    Mode getMode() const { return static_cast<Mode>(_requestedMode.load()); }
+
+    // 渲染线程，update之前调用：开关动态分辨率会重建管线，比例变化只调整视口
+    void setDynamicResolution(bool enabled) { _dynamicResolution = enabled; }
+    void setRenderScale(float scale) { _renderScale = scale; }
+
+    // 渲染线程，更新遍历之前调用：应用模式切换，跟随视口尺寸，推进TAA抖动
+    void update(osgViewer::Viewer* viewer, int width, int height);
+
+    // 场景加入场景图之前调用一次（构建线程上，此时没有其他线程遍历它）：天空/云层节点加上kSkyNodeMask位，
+    // 不含天空的子树去掉该位；标记与抗锯齿模式无关，各视口共用同一份节点掩码
+    static void markSkyNodes(osg::Node* node);
+
+    // 渲染线程，移除添加到viewer上的从相机并恢复主相机
+    void detach();
+
+protected:
+    virtual ~AntiAliasing() {}
+
+private:
+    void build(osgViewer::Viewer* viewer, int width, int height);
+    void resize(int width, int height);
+    void applyViewports(bool resetRenderingCache);
+
+    osg::Texture2D* createTarget(GLenum internalFormat, GLenum sourceFormat, GLenum sourceType);
+    osg::Camera* createRenderTargetCamera(int renderOrderNum, osg::Texture2D* color, osg::Texture2D* depth = nullptr,
+                                          unsigned int samples = 0);
+    osg::Camera* createFullScreenPass(osg::Camera::RenderOrder order, int renderOrderNum, osg::Program* program);
+    void addPassCamera(osg::Camera* camera, bool useMastersSceneData = false);
+
+    std::atomic<int> _requestedMode;
+    Mode _mode;
+    osg::observer_ptr<osgViewer::Viewer> _viewer;
+
+    // 请求的和当前管线使用的动态分辨率设置
+    bool _dynamicResolution;
+    bool _scaled;
+    float _renderScale;
+    float _appliedScale;
+
+    // Qt FBO尺寸和缩放后的渲染尺寸
+    int _width;
+    int _height;
+    int _scaledWidth;
+    int _scaledHeight;
+
+    // 主相机原来的设置，detach时恢复
+    unsigned int _masterCullMask;
+    GLbitfield _masterClearMask;
+
+    // 本管线添加的从相机和随视口缩放的纹理
+    std::vector<osg::ref_ptr<osg::Camera>> _cameras;
+    std::vector<osg::ref_ptr<osg::Texture2D>> _targets;
+
+    // 从主相机继承场景、需要同步清屏色的从相机（FXAA/TAA/降分辨率）
+    osg::ref_ptr<osg::Camera> _sceneCamera;
+    // 降分辨率的MSAA模式下单独绘制天空和云层的从相机
+    osg::ref_ptr<osg::Camera> _skyCamera;
+    osg::ref_ptr<osg::Uniform> _texelSize;
+    osg::ref_ptr<osg::Uniform> _sourceScale;
+    osg::ref_ptr<osg::Uniform> _historyValid;
+    unsigned int _frameIndex;
+};
+
+#endif // ANTIALIASING_H
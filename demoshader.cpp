@@ -24,11 +24,15 @@ const float DemoShader::kSunAngularRadius = 0.00935f / 2.0f;
 const float DemoShader::kLengthUnitInMeters = 1000.0f;
 #include "SkyNode.h"
 #include "shaderpbr.h"
+#include "environmentcapture.h"
+#include "aerialperspective.h"
 #include "shadercube.h"
 #include "skyboxmanipulator.h"
 #include "CloudSeaAtmosphere.h"
 #include "VolumeCloudSky.h"
 #include "SkyCloud.h"
+#include "pbrmaterialtable.h"
+#include "logger.h"
 
 DemoShader::DemoShader()
     : _viewDistanceMeters(5000.0f)  // 初始观察距离5km，更接近地球表面
@@ -76,7 +80,7 @@ osg::Node* DemoShader::createSkyboxAtmosphereScene(osgViewer::Viewer* viewer)
     geode->addDrawable(drawable);
     geode->setCullingActive(false);
     
-    osg::ref_ptr<SkyBoxThree> skybox = new SkyBoxThree(viewer->getCamera());
+    osg::ref_ptr<SkyBoxThree> skybox = new SkyBoxThree();
     skybox->setName("skybox");
     skybox->addChild(geode.get());
     
@@ -88,13 +92,11 @@ osg::Node* DemoShader::createSkyboxAtmosphereScene(osgViewer::Viewer* viewer)
         return nullptr;
     }
     
-    // 只在大气渲染的天空盒上使用SkyBoxManipulator
-    // 为viewer设置自定义的SkyBoxManipulator操纵器
-    osg::ref_ptr<SkyBoxManipulator> manipulator = new SkyBoxManipulator();
-    viewer->setCameraManipulator(manipulator.get());
+    // 之后加载的模型叠加与天空一致的空气透视
+    root->addChild(new AerialPerspective(skybox.get(), viewer->getCamera()));
     
+    // SkyBoxManipulator由UIHandler在场景切换上来时设置，这里可能运行在后台线程，不能修改viewer
     std::cout << "Skybox atmosphere scene created successfully" << std::endl;
-    std::cout << "SkyBoxManipulator enabled for atmosphere skybox" << std::endl;
     
     return root.release();
 }
@@ -120,7 +122,7 @@ osg::Node* DemoShader::createImprovedAtmosphereScene(osgViewer::Viewer* viewer)
     geode->setCullingActive(false);
     
     // 创建SkyBoxThree对象
-    osg::ref_ptr<SkyBoxThree> skybox = new SkyBoxThree(viewer->getCamera());
+    osg::ref_ptr<SkyBoxThree> skybox = new SkyBoxThree();
     skybox->setName("improved_skybox");
     skybox->addChild(geode.get());
     
@@ -132,13 +134,16 @@ osg::Node* DemoShader::createImprovedAtmosphereScene(osgViewer::Viewer* viewer)
         return nullptr;
     }
     
+    // 之后加载的模型叠加与天空一致的空气透视
+    root->addChild(new AerialPerspective(skybox.get(), viewer->getCamera()));
+    
     std::cout << "Improved atmosphere scene created successfully" << std::endl;
      
     return root.release();
 }
 
 // 新增：创建PBR立方体
-osg::Node* DemoShader::createPBRCube()
+osg::Node* DemoShader::createPBRCube(EnvironmentCapture* environment)
 {
     osg::ref_ptr<osg::Group> root = new osg::Group;
     
@@ -149,20 +154,22 @@ osg::Node* DemoShader::createPBRCube()
         // 获取立方体的状态集
         osg::StateSet* cubeStateSet = cube->getOrCreateStateSet();
         
-        // 使用ShaderPBR创建PBR着色器程序
-        osg::ref_ptr<osg::Program> program = ShaderPBR::createPBRShaderSimpleIBL();
+        // 移除原有的着色器程序和纹理
+        cubeStateSet->removeAttribute(osg::StateAttribute::PROGRAM);
+        
+        // 使用ShaderPBR创建PBR着色器程序；有环境捕获时用捕获的天空做IBL
+        osg::ref_ptr<osg::Program> program = environment ? ShaderPBR::createPBRShaderCapturedIBL()
+                                                         : ShaderPBR::createPBRShaderSimpleIBL();
         if (program.valid()) {
             cubeStateSet->setAttributeAndModes(program, osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
         }
+        if (environment) {
+            environment->apply(cubeStateSet);
+        }
         
-        // 移除原有的着色器程序和纹理
-        cubeStateSet->removeAttribute(osg::StateAttribute::PROGRAM);
-        
-        // 设置PBR材质参数
-        cubeStateSet->addUniform(new osg::Uniform("albedo", osg::Vec3(0.8f, 0.2f, 0.2f))); // 红色基础颜色
-        cubeStateSet->addUniform(new osg::Uniform("metallic", 0.0f)); // 非金属
-        cubeStateSet->addUniform(new osg::Uniform("roughness", 0.5f)); // 中等粗糙度
-        cubeStateSet->addUniform(new osg::Uniform("ao", 1.0f)); // 完全环境光遮蔽
+        // 设置PBR材质参数：红色基础颜色、非金属、中等粗糙度、完全环境光遮蔽
+        PBRMaterialTable::instance().assign(cubeStateSet,
+            PBRMaterialTable::Material(osg::Vec4(0.8f, 0.2f, 0.2f, 1.0f), 0.0f, 0.5f, 1.0f));
         
         // 设置光源位置
         osg::ref_ptr<osg::Uniform> lightPositions = new osg::Uniform(osg::Uniform::FLOAT_VEC3, "lightPositions", 4);
@@ -175,7 +182,8 @@ osg::Node* DemoShader::createPBRCube()
         // 设置光源颜色
         osg::ref_ptr<osg::Uniform> lightColors = new osg::Uniform(osg::Uniform::FLOAT_VEC3, "lightColors", 4);
         for(int i = 0; i < 4; i++) {
-            lightColors->setElement(i, osg::Vec3(500.0f, 500.0f, 500.0f)); // 光源强度
+            // 光源强度；环境光来自天空捕获时不再叠加固定点光源，太阳已在捕获的贴图里
+            lightColors->setElement(i, environment ? osg::Vec3(0.0f, 0.0f, 0.0f) : osg::Vec3(500.0f, 500.0f, 500.0f));
         }
         cubeStateSet->addUniform(lightColors);
         
@@ -209,11 +217,12 @@ osg::Node* DemoShader::createSkyboxAtmosphereWithPBRScene(osgViewer::Viewer* vie
     // 创建一个球体几何体作为天空盒
     osg::ref_ptr<osg::Geode> geode = new osg::Geode;
     // 使用较大的球体以包围整个场景
-    geode->addDrawable(new osg::ShapeDrawable(new osg::Sphere(osg::Vec3(0.0, 0.0, 0.0), 1000.0)));
+    const float skyRadius = 1000.0f;
+    geode->addDrawable(new osg::ShapeDrawable(new osg::Sphere(osg::Vec3(0.0, 0.0, 0.0), skyRadius)));
     geode->setCullingActive(false);
     
     // 创建SkyBoxThree对象
-    osg::ref_ptr<SkyBoxThree> skybox = new SkyBoxThree(viewer->getCamera());
+    osg::ref_ptr<SkyBoxThree> skybox = new SkyBoxThree();
     skybox->setName("improved_skybox");
     skybox->addChild(geode.get());
     
@@ -225,8 +234,15 @@ osg::Node* DemoShader::createSkyboxAtmosphereWithPBRScene(osgViewer::Viewer* vie
         return nullptr;
     }
     
+    // 之后加载的模型叠加与天空一致的空气透视
+    root->addChild(new AerialPerspective(skybox.get(), viewer->getCamera()));
+    
+    // 天空参数变化时把大气捕获成环境贴图，分帧滤波后作为PBR立方体的IBL
+    osg::ref_ptr<EnvironmentCapture> environment = new EnvironmentCapture(skybox.get(), skyRadius);
+    root->addChild(environment);
+    
     // 创建PBR立方体
-    osg::ref_ptr<osg::Node> pbrCube = createPBRCube();
+    osg::ref_ptr<osg::Node> pbrCube = createPBRCube(environment.get());
     if (pbrCube.valid()) {
         root->addChild(pbrCube);
     }
@@ -244,10 +260,8 @@ void DemoShader::updateSkyNodeAtmosphereParameters(osgViewer::Viewer* viewer, os
 {
     if (!viewer || !rootNode) return;
     
-    std::cout << "Updating SkyNode atmosphere parameters..." << std::endl;
-    std::cout << "  Turbidity: " << turbidity << ", Rayleigh: " << rayleigh 
-              << ", Mie Coefficient: " << mieCoefficient << ", Mie Directional G: " << mieDirectionalG 
-              << ", Sun Zenith Angle: " << sunZenithAngle << ", Sun Azimuth Angle: " << sunAzimuthAngle << std::endl;
+    LOG_DEBUG("demoshader", "update sky atmosphere turbidity=%g rayleigh=%g mieCoefficient=%g mieDirectionalG=%g sunZenith=%g sunAzimuth=%g",
+              turbidity, rayleigh, mieCoefficient, mieDirectionalG, sunZenithAngle, sunAzimuthAngle);
     
     // 查找场景中的SkyBoxThree节点
     osg::Node* skyboxNode = nullptr;
@@ -266,17 +280,17 @@ void DemoShader::updateSkyNodeAtmosphereParameters(osgViewer::Viewer* viewer, os
         // 首先检查当前子节点是否为SkyBoxThree
         if (child->getName() == "skybox" || child->getName() == "improved_skybox" || dynamic_cast<SkyBoxThree*>(child))  {
             skyboxNode = child;
-            std::cout << "Found SkyBoxThree node at root level: " << child->getName() << std::endl;
+            LOG_DEBUG("demoshader", "found=SkyBoxThree name=%s search=root", child->getName().c_str());
         }
         // 检查是否为VolumeCloudSky节点
         else if (child->getName() == "volume_cloud_sky" || dynamic_cast<VolumeCloudSky*>(child)) {
             volumeCloudNode = child;
-            std::cout << "Found VolumeCloudSky node at root level: " << child->getName() << std::endl;
+            LOG_DEBUG("demoshader", "found=VolumeCloudSky name=%s search=root", child->getName().c_str());
         }
         // 检查是否为SkyCloud节点
         else if (child->getName() == "sky_cloud" || dynamic_cast<SkyCloud*>(child)) {
             skyCloudNode = child;
-            std::cout << "Found SkyCloud node at root level: " << child->getName() << std::endl;
+            LOG_DEBUG("demoshader", "found=SkyCloud name=%s search=root", child->getName().c_str());
         }
         
         // 如果当前子节点是Group，继续在其子节点中查找
@@ -289,17 +303,17 @@ void DemoShader::updateSkyNodeAtmosphereParameters(osgViewer::Viewer* viewer, os
                 // 检查孙节点是否为SkyBoxThree
                 if (grandChild->getName() == "skybox" || grandChild->getName() == "improved_skybox" || dynamic_cast<SkyBoxThree*>(grandChild)) {
                     skyboxNode = grandChild;
-                    std::cout << "Found SkyBoxThree node nested in group: " << grandChild->getName() << std::endl;
+                    LOG_DEBUG("demoshader", "found=SkyBoxThree name=%s search=group", grandChild->getName().c_str());
                 }
                 // 检查是否为VolumeCloudSky节点
                 else if (grandChild->getName() == "volume_cloud_sky" || dynamic_cast<VolumeCloudSky*>(grandChild)) {
                     volumeCloudNode = grandChild;
-                    std::cout << "Found VolumeCloudSky node nested in group: " << grandChild->getName() << std::endl;
+                    LOG_DEBUG("demoshader", "found=VolumeCloudSky name=%s search=group", grandChild->getName().c_str());
                 }
                 // 检查是否为SkyCloud节点
                 else if (grandChild->getName() == "sky_cloud" || dynamic_cast<SkyCloud*>(grandChild)) {
                     skyCloudNode = grandChild;
-                    std::cout << "Found SkyCloud node nested in group: " << grandChild->getName() << std::endl;
+                    LOG_DEBUG("demoshader", "found=SkyCloud name=%s search=group", grandChild->getName().c_str());
                 }
             }
         }
@@ -307,7 +321,7 @@ void DemoShader::updateSkyNodeAtmosphereParameters(osgViewer::Viewer* viewer, os
     
     // 如果还是没有找到，尝试更广泛的搜索
     if (!skyboxNode && !volumeCloudNode && !skyCloudNode) {
-        std::cout << "Performing extensive search for SkyBoxThree, VolumeCloudSky and SkyCloud nodes..." << std::endl;
+        LOG_DEBUG("demoshader", "recursive search for SkyBoxThree, VolumeCloudSky and SkyCloud nodes");
         for (unsigned int i = 0; i < rootNode->getNumChildren(); ++i) {
             osg::Node* child = rootNode->getChild(i);
             if (!child) continue;
@@ -318,17 +332,17 @@ void DemoShader::updateSkyNodeAtmosphereParameters(osgViewer::Viewer* viewer, os
             
             if (foundSkyboxNode && !skyboxNode) {
                 skyboxNode = foundSkyboxNode;
-                std::cout << "Found SkyBoxThree node through recursive search: " << skyboxNode->getName() << std::endl;
+                LOG_DEBUG("demoshader", "found=SkyBoxThree name=%s search=recursive", skyboxNode->getName().c_str());
             }
             
             if (foundVolumeCloudNode && !volumeCloudNode) {
                 // 检查找到的节点是VolumeCloudSky还是SkyCloud
                 if (foundVolumeCloudNode->getName() == "sky_cloud" || dynamic_cast<SkyCloud*>(foundVolumeCloudNode)) {
                     skyCloudNode = foundVolumeCloudNode;
-                    std::cout << "Found SkyCloud node through recursive search: " << skyCloudNode->getName() << std::endl;
+                    LOG_DEBUG("demoshader", "found=SkyCloud name=%s search=recursive", skyCloudNode->getName().c_str());
                 } else {
                     volumeCloudNode = foundVolumeCloudNode;
-                    std::cout << "Found VolumeCloudSky node through recursive search: " << volumeCloudNode->getName() << std::endl;
+                    LOG_DEBUG("demoshader", "found=VolumeCloudSky name=%s search=recursive", volumeCloudNode->getName().c_str());
                 }
             }
         }
@@ -339,62 +353,54 @@ void DemoShader::updateSkyNodeAtmosphereParameters(osgViewer::Viewer* viewer, os
         // 获取SkyBoxThree节点的状态集
         osg::StateSet* stateset = skyboxNode->getOrCreateStateSet();
         if (stateset) {
-            std::cout << "StateSet acquired successfully for SkyBoxThree" << std::endl;
-            
             // 更新uniform变量
             // 注意：这里我们直接通过stateset来更新uniform，而不是通过SkyBoxThree的成员变量
             osg::Uniform* turbidityUniform = stateset->getUniform("turbidity");
             if (turbidityUniform) {
                 turbidityUniform->set(turbidity);
-                std::cout << "Turbidity uniform updated to: " << turbidity << std::endl;
             } else {
-                std::cout << "Turbidity uniform not found" << std::endl;
+                LOG_WARNING("demoshader", "uniform=turbidity not found");
             }
             
             osg::Uniform* rayleighUniform = stateset->getUniform("rayleigh");
             if (rayleighUniform) {
                 rayleighUniform->set(rayleigh);
-                std::cout << "Rayleigh uniform updated to: " << rayleigh << std::endl;
             } else {
-                std::cout << "Rayleigh uniform not found" << std::endl;
+                LOG_WARNING("demoshader", "uniform=rayleigh not found");
             }
             
             osg::Uniform* mieCoefficientUniform = stateset->getUniform("mieCoefficient");
             if (mieCoefficientUniform) {
                 mieCoefficientUniform->set(mieCoefficient);
-                std::cout << "Mie Coefficient uniform updated to: " << mieCoefficient << std::endl;
             } else {
-                std::cout << "Mie Coefficient uniform not found" << std::endl;
+                LOG_WARNING("demoshader", "uniform=mieCoefficient not found");
             }
             
             osg::Uniform* mieDirectionalGUniform = stateset->getUniform("mieDirectionalG");
             if (mieDirectionalGUniform) {
                 mieDirectionalGUniform->set(mieDirectionalG);
-                std::cout << "Mie Directional G uniform updated to: " << mieDirectionalG << std::endl;
             } else {
-                std::cout << "Mie Directional G uniform not found" << std::endl;
+                LOG_WARNING("demoshader", "uniform=mieDirectionalG not found");
             }
             
             // 新增：更新太阳天顶角度uniform
             osg::Uniform* sunZenithAngleUniform = stateset->getUniform("sunZenithAngle");
             if (sunZenithAngleUniform) {
                 sunZenithAngleUniform->set(sunZenithAngle);
-                std::cout << "Sun Zenith Angle uniform updated to: " << sunZenithAngle << std::endl;
             } else {
-                std::cout << "Sun Zenith Angle uniform not found" << std::endl;
+                LOG_WARNING("demoshader", "uniform=sunZenithAngle not found");
             }
             
             // 新增：更新太阳方位角度uniform
             osg::Uniform* sunAzimuthAngleUniform = stateset->getUniform("sunAzimuthAngle");
             if (sunAzimuthAngleUniform) {
                 sunAzimuthAngleUniform->set(sunAzimuthAngle);
-                std::cout << "Sun Azimuth Angle uniform updated to: " << sunAzimuthAngle << std::endl;
             } else {
-                std::cout << "Sun Azimuth Angle uniform not found" << std::endl;
+                LOG_WARNING("demoshader", "uniform=sunAzimuthAngle not found");
             }
         }
     } else {
-        std::cout << "SkyBoxThree node not found in the scene" << std::endl;
+        LOG_DEBUG("demoshader", "SkyBoxThree node not found");
     }
     
     // 更新VolumeCloudSky节点（如果找到）
@@ -403,12 +409,11 @@ void DemoShader::updateSkyNodeAtmosphereParameters(osgViewer::Viewer* viewer, os
         VolumeCloudSky* volumeCloudSky = dynamic_cast<VolumeCloudSky*>(volumeCloudNode);
         if (volumeCloudSky) {
             // 使用新的函数设置所有参数
-            std::cout << "VolumeCloudSky parameters updated successfully with SkyNode parameters" << std::endl;
         } else {
-            std::cerr << "Failed to cast node to VolumeCloudSky" << std::endl;
+            LOG_WARNING("demoshader", "node is not a VolumeCloudSky");
         }
     } else {
-        std::cout << "VolumeCloudSky node not found in the scene" << std::endl;
+        LOG_DEBUG("demoshader", "VolumeCloudSky node not found");
     }
     
     // 更新SkyCloud节点（如果找到）
@@ -421,29 +426,28 @@ void DemoShader::updateSkyNodeAtmosphereParameters(osgViewer::Viewer* viewer, os
             skyCloud->setTurbidity(turbidity);
             skyCloud->setMieCoefficient(mieCoefficient);
             skyCloud->setMieDirectionalG(mieDirectionalG);
-            std::cout << "SkyCloud atmosphere parameters updated successfully" << std::endl;
         } else {
-            std::cerr << "Failed to cast node to SkyCloud" << std::endl;
+            LOG_WARNING("demoshader", "node is not a SkyCloud");
         }
     } else {
-        std::cout << "SkyCloud node not found in the scene" << std::endl;
+        LOG_DEBUG("demoshader", "SkyCloud node not found");
     }
     
     // 如果都没有找到节点，打印所有子节点的信息以便调试
     if (!skyboxNode && !volumeCloudNode && !skyCloudNode) {
-        std::cout << "Scene children count: " << rootNode->getNumChildren() << std::endl;
+        LOG_DEBUG("demoshader", "scene children=%u", rootNode->getNumChildren());
         for (unsigned int i = 0; i < rootNode->getNumChildren(); ++i) {
             osg::Node* child = rootNode->getChild(i);
             if (child) {
-                std::cout << "  Child " << i << ": " << child->getName() << " (class: " << child->className() << ")" << std::endl;
+                LOG_DEBUG("demoshader", "child=%u name=%s class=%s", i, child->getName().c_str(), child->className());
                 // 如果是Group，打印其子节点
                 osg::Group* group = child->asGroup();
                 if (group) {
-                    std::cout << "    Group children count: " << group->getNumChildren() << std::endl;
+                    LOG_DEBUG("demoshader", "child=%u children=%u", i, group->getNumChildren());
                     for (unsigned int j = 0; j < group->getNumChildren(); ++j) {
                         osg::Node* grandChild = group->getChild(j);
                         if (grandChild) {
-                            std::cout << "      Grandchild " << j << ": " << grandChild->getName() << " (class: " << grandChild->className() << ")" << std::endl;
+                            LOG_DEBUG("demoshader", "child=%u grandchild=%u name=%s class=%s", i, j, grandChild->getName().c_str(), grandChild->className());
                         }
                     }
                 }
@@ -453,7 +457,6 @@ void DemoShader::updateSkyNodeAtmosphereParameters(osgViewer::Viewer* viewer, os
     
     // 强制更新视图
     if (viewer) {
-        std::cout << "Requesting redraw..." << std::endl;
         viewer->advance();
         viewer->requestRedraw();
     }
@@ -467,11 +470,8 @@ void DemoShader::updateSkyNodeCloudParameters(osgViewer::Viewer* viewer, osg::Gr
 {
     if (!viewer || !rootNode) return;
     
-    std::cout << "Updating SkyNode cloud parameters..." << std::endl;
-    std::cout << "  Sun Zenith Angle: " << sunZenithAngle << ", Sun Azimuth Angle: " << sunAzimuthAngle 
-              << ", Cloud Density: " << cloudDensity << ", Cloud Height: " << cloudHeight
-              << ", Cloud Base Height: " << cloudBaseHeight << ", Cloud Range Min: " << cloudRangeMin
-              << ", Cloud Range Max: " << cloudRangeMax << std::endl;
+    LOG_DEBUG("demoshader", "update sky clouds sunZenith=%g sunAzimuth=%g density=%g height=%g baseHeight=%g rangeMin=%g rangeMax=%g",
+              sunZenithAngle, sunAzimuthAngle, cloudDensity, cloudHeight, cloudBaseHeight, cloudRangeMin, cloudRangeMax);
     
     // 查找场景中的SkyBoxThree节点
     osg::Node* skyboxNode = nullptr;
@@ -484,7 +484,7 @@ void DemoShader::updateSkyNodeCloudParameters(osgViewer::Viewer* viewer, osg::Gr
         // 首先检查当前子节点是否为SkyBoxThree
         if (child->getName() == "skybox" || child->getName() == "improved_skybox" || dynamic_cast<SkyBoxThree*>(child)|| child->getName() == "volume_cloud_sky") {
             skyboxNode = child;
-            std::cout << "Found SkyBoxThree node at root level: " << child->getName() << std::endl;
+            LOG_DEBUG("demoshader", "found=SkyBoxThree name=%s search=root", child->getName().c_str());
             break;
         }
         
@@ -498,7 +498,7 @@ void DemoShader::updateSkyNodeCloudParameters(osgViewer::Viewer* viewer, osg::Gr
                 // 检查孙节点是否为SkyBoxThree
                 if (grandChild->getName() == "skybox" || grandChild->getName() == "improved_skybox" || dynamic_cast<SkyBoxThree*>(grandChild)|| child->getName() == "volume_cloud_sky") {
                     skyboxNode = grandChild;
-                    std::cout << "Found SkyBoxThree node nested in group: " << grandChild->getName() << std::endl;
+                    LOG_DEBUG("demoshader", "found=SkyBoxThree name=%s search=group", grandChild->getName().c_str());
                     break;
                 }
             }
@@ -510,7 +510,7 @@ void DemoShader::updateSkyNodeCloudParameters(osgViewer::Viewer* viewer, osg::Gr
     
     // 如果还是没有找到，尝试更广泛的搜索
     if (!skyboxNode) {
-        std::cout << "Performing extensive search for SkyBoxThree nodes..." << std::endl;
+        LOG_DEBUG("demoshader", "recursive search for SkyBoxThree nodes");
         for (unsigned int i = 0; i < rootNode->getNumChildren(); ++i) {
             osg::Node* child = rootNode->getChild(i);
             if (!child) continue;
@@ -518,7 +518,7 @@ void DemoShader::updateSkyNodeCloudParameters(osgViewer::Viewer* viewer, osg::Gr
             // 递归搜索所有子节点
             skyboxNode = findSkyBoxThreeNode(child);
             if (skyboxNode) {
-                std::cout << "Found SkyBoxThree node through recursive search: " << skyboxNode->getName() << std::endl;
+                LOG_DEBUG("demoshader", "found=SkyBoxThree name=%s search=recursive", skyboxNode->getName().c_str());
                 break;
             }
         }
@@ -528,73 +528,63 @@ void DemoShader::updateSkyNodeCloudParameters(osgViewer::Viewer* viewer, osg::Gr
         // 获取SkyBoxThree节点的状态集
         osg::StateSet* stateset = skyboxNode->getOrCreateStateSet();
         if (stateset) {
-            std::cout << "StateSet acquired successfully" << std::endl;
-            
             // 更新太阳角度uniform变量
             osg::Uniform* sunZenithAngleUniform = stateset->getUniform("sunZenithAngle");
             if (sunZenithAngleUniform) {
                 sunZenithAngleUniform->set(sunZenithAngle);
-                std::cout << "Sun Zenith Angle uniform updated to: " << sunZenithAngle << std::endl;
             } else {
-                std::cout << "Sun Zenith Angle uniform not found" << std::endl;
+                LOG_WARNING("demoshader", "uniform=sunZenithAngle not found");
             }
             
             osg::Uniform* sunAzimuthAngleUniform = stateset->getUniform("sunAzimuthAngle");
             if (sunAzimuthAngleUniform) {
                 sunAzimuthAngleUniform->set(sunAzimuthAngle);
-                std::cout << "Sun Azimuth Angle uniform updated to: " << sunAzimuthAngle << std::endl;
             } else {
-                std::cout << "Sun Azimuth Angle uniform not found" << std::endl;
+                LOG_WARNING("demoshader", "uniform=sunAzimuthAngle not found");
             }
             
             // 更新云海参数uniform变量
             osg::Uniform* cloudDensityUniform = stateset->getUniform("cloudDensity");
             if (cloudDensityUniform) {
                 cloudDensityUniform->set(cloudDensity);
-                std::cout << "Cloud Density uniform updated to: " << cloudDensity << std::endl;
             } else {
-                std::cout << "Cloud Density uniform not found" << std::endl;
+                LOG_WARNING("demoshader", "uniform=cloudDensity not found");
             }
             
             osg::Uniform* cloudHeightUniform = stateset->getUniform("cloudHeight");
             if (cloudHeightUniform) {
                 cloudHeightUniform->set(cloudHeight);
-                std::cout << "Cloud Height uniform updated to: " << cloudHeight << std::endl;
             } else {
-                std::cout << "Cloud Height uniform not found" << std::endl;
+                LOG_WARNING("demoshader", "uniform=cloudHeight not found");
             }
             
             osg::Uniform* cloudBaseHeightUniform = stateset->getUniform("cloudBaseHeight");
             if (cloudBaseHeightUniform) {
                 cloudBaseHeightUniform->set(cloudBaseHeight);
-                std::cout << "Cloud Base Height uniform updated to: " << cloudBaseHeight << std::endl;
             } else {
-                std::cout << "Cloud Base Height uniform not found" << std::endl;
+                LOG_WARNING("demoshader", "uniform=cloudBaseHeight not found");
             }
             
             osg::Uniform* cloudRangeMinUniform = stateset->getUniform("cloudRangeMin");
             if (cloudRangeMinUniform) {
                 cloudRangeMinUniform->set(cloudRangeMin);
-                std::cout << "Cloud Range Min uniform updated to: " << cloudRangeMin << std::endl;
             } else {
-                std::cout << "Cloud Range Min uniform not found" << std::endl;
+                LOG_WARNING("demoshader", "uniform=cloudRangeMin not found");
             }
             
             osg::Uniform* cloudRangeMaxUniform = stateset->getUniform("cloudRangeMax");
             if (cloudRangeMaxUniform) {
                 cloudRangeMaxUniform->set(cloudRangeMax);
-                std::cout << "Cloud Range Max uniform updated to: " << cloudRangeMax << std::endl;
             } else {
-                std::cout << "Cloud Range Max uniform not found" << std::endl;
+                LOG_WARNING("demoshader", "uniform=cloudRangeMax not found");
             }
         }
     } else {
-        std::cout << "SkyCloud node not found in the scene" << std::endl;
+        LOG_DEBUG("demoshader", "SkyCloud node not found");
     }
     
     // 强制更新视图
     if (viewer) {
-        std::cout << "Requesting redraw..." << std::endl;
         viewer->advance();
         viewer->requestRedraw();
     }
@@ -638,14 +628,14 @@ osg::Node* DemoShader::createVolumeCloudSkyScene(osgViewer::Viewer* viewer)
     geode->addDrawable(drawable);
     geode->setCullingActive(false);
     
-    // 创建体积云天空盒对象
-    osg::ref_ptr<SkyCloud> skyCloud = new SkyCloud(viewer->getCamera());
-    skyCloud->setName("sky_cloud");
-    skyCloud->addChild(geode.get());
+    // 创建体积云天空盒对象（CloudSky着色器：空域跳跃、透射率图和质量变体都在这条路径上）
+    osg::ref_ptr<VolumeCloudSky> volumeCloudSky = new VolumeCloudSky();
+    volumeCloudSky->setName("volume_cloud_sky");
+    volumeCloudSky->addChild(geode.get());
     
     // 将天空盒添加到根节点
-    if (skyCloud.valid()) {
-        root->addChild(skyCloud);
+    if (volumeCloudSky.valid()) {
+        root->addChild(volumeCloudSky);
     } else {
         std::cerr << "Failed to create volume cloud sky" << std::endl;
         return nullptr;
@@ -742,17 +732,9 @@ void DemoShader::updateAtmosphereUniforms(osg::StateSet* stateset)
         stateset->addUniform(new osg::Uniform("viewInverse", osg::Matrix::identity()));
     }
     
-    std::cout << "Updated atmosphere uniforms:" << std::endl;
-    std::cout << "  Sun zenith angle: " << _sunZenithAngleRadians << " (" << _sunZenithAngleRadians * 180.0 / M_PI << " degrees)" << std::endl;
-    std::cout << "  Sun azimuth angle: " << _sunAzimuthAngleRadians << " (" << _sunAzimuthAngleRadians * 180.0 / M_PI << " degrees)" << std::endl;
-    std::cout << "  Sun direction: " << sunDirection.x() << ", " << sunDirection.y() << ", " << sunDirection.z() << std::endl;
-    std::cout << "  Rayleigh scattering: " << _rayleighScattering << std::endl;
-    std::cout << "  Atmosphere density: " << _atmosphereDensity << std::endl;
-    std::cout << "  Mie scattering: " << _mieScattering << std::endl;
-    std::cout << "  Sun intensity: " << _sunIntensity << std::endl;
-    
-    // 添加额外的调试信息
-    std::cout << "  Sun direction length: " << sunDirection.length() << std::endl;
+    LOG_DEBUG("demoshader", "update atmosphere uniforms sunZenith=%g sunAzimuth=%g sunDirection=(%g,%g,%g) rayleigh=%g density=%g mie=%g sunIntensity=%g",
+              _sunZenithAngleRadians, _sunAzimuthAngleRadians, sunDirection.x(), sunDirection.y(), sunDirection.z(),
+              _rayleighScattering, _atmosphereDensity, _mieScattering, _sunIntensity);
 }
 
 // 新增：创建云海大气效果场景
@@ -773,39 +755,44 @@ osg::Node* DemoShader::createCloudSeaAtmosphereScene(osgViewer::Viewer* viewer)
     geode->addDrawable(drawable);
     geode->setCullingActive(false);
     
-    // 创建云海大气效果对象并保存引用
-    _cloudSeaAtmosphere = new CloudSeaAtmosphere(viewer->getCamera());
-    _cloudSeaAtmosphere->setName("cloud_sea_skybox");
-    _cloudSeaAtmosphere->addChild(geode.get());
-    
-    // 创建初始云海参数
-    _cloudSeaAtmosphere->setCloudDensity(_cloudSeaDensity);
-    _cloudSeaAtmosphere->setCloudHeight(_cloudSeaHeight);
+    // 创建云海大气效果对象；这里可能运行在后台线程，引用由activateCloudSeaAtmosphereScene在渲染线程保存
+    osg::ref_ptr<CloudSeaAtmosphere> cloudSeaAtmosphere = new CloudSeaAtmosphere();
+    cloudSeaAtmosphere->setName("cloud_sea_skybox");
+    cloudSeaAtmosphere->addChild(geode.get());
     
     // 将天空盒添加到根节点
-    if (_cloudSeaAtmosphere.valid()) {
-        root->addChild(_cloudSeaAtmosphere.get());
-    } else {
-        std::cerr << "Failed to create cloud sea atmosphere" << std::endl;
-        return nullptr;
-    }
-    
-    // 仅在云海大气的天空盒上使用SkyBoxManipulator
-    osg::ref_ptr<SkyBoxManipulator> manipulator = new SkyBoxManipulator();
-    viewer->setCameraManipulator(manipulator.get());
+    root->addChild(cloudSeaAtmosphere.get());
     
+    // SkyBoxManipulator由UIHandler在场景切换上来时设置，不能在这里修改viewer
     std::cout << "Cloud Sea Atmosphere scene created successfully" << std::endl;
-    std::cout << "SkyBoxManipulator enabled for cloud sea atmosphere" << std::endl;
     
     return root.release();
 }
 
+void DemoShader::activateCloudSeaAtmosphereScene(osg::Node* scene)
+{
+    osg::Group* root = scene ? scene->asGroup() : nullptr;
+    CloudSeaAtmosphere* cloudSeaAtmosphere = nullptr;
+    for (unsigned int i = 0; root && !cloudSeaAtmosphere && i < root->getNumChildren(); ++i) {
+        cloudSeaAtmosphere = dynamic_cast<CloudSeaAtmosphere*>(root->getChild(i));
+    }
+    if (!cloudSeaAtmosphere) {
+        LOG_WARNING("demoshader", "cloud sea atmosphere scene has no CloudSeaAtmosphere node");
+        return;
+    }
+
+    // 场景可能来自缓存，按当前参数重新设置云海
+    _cloudSeaAtmosphere = cloudSeaAtmosphere;
+    _cloudSeaAtmosphere->setCloudDensity(_cloudSeaDensity);
+    _cloudSeaAtmosphere->setCloudHeight(_cloudSeaHeight);
+}
+
 void DemoShader::updateCloudSeaAtmosphereParameters(float sunZenithAngle, float sunAzimuthAngle,
                                                    float cloudDensity, float cloudHeight,
                                                    float cloudBaseHeight, float cloudRangeMin, float cloudRangeMax)
 {
     if (!_cloudSeaAtmosphere.valid()) {
-        std::cerr << "Cloud sea atmosphere is not initialized" << std::endl;
+        LOG_WARNING("demoshader", "cloud sea atmosphere is not initialized");
         return;
     }
     
@@ -837,12 +824,8 @@ void DemoShader::updateVolumeCloudParameters(osgViewer::Viewer* viewer, osg::Gro
 {
     if (!viewer || !rootNode) return;
     
-    std::cout << "Updating Volume Cloud parameters..." << std::endl;
-    std::cout << "  Sun Zenith Angle: " << sunZenithAngle << ", Sun Azimuth Angle: " << sunAzimuthAngle 
-              << ", Cloud Density: " << cloudDensity << ", Cloud Height: " << cloudHeight
-              << ", Density Threshold: " << densityThreshold << ", Contrast: " << contrast
-              << ", Density Factor: " << densityFactor << ", Step Size: " << stepSize
-              << ", Max Steps: " << maxSteps << std::endl;
+    LOG_DEBUG("demoshader", "update volume clouds sunZenith=%g sunAzimuth=%g density=%g height=%g densityThreshold=%g contrast=%g densityFactor=%g stepSize=%g maxSteps=%g",
+              sunZenithAngle, sunAzimuthAngle, cloudDensity, cloudHeight, densityThreshold, contrast, densityFactor, stepSize, maxSteps);
     
     // 查找场景中的VolumeCloudSky节点
     osg::Node* volumeCloudNode = nullptr;
@@ -855,7 +838,7 @@ void DemoShader::updateVolumeCloudParameters(osgViewer::Viewer* viewer, osg::Gro
         // 首先检查当前子节点是否为VolumeCloudSky
         if (child->getName() == "volume_cloud_sky" || dynamic_cast<VolumeCloudSky*>(child)) {
             volumeCloudNode = child;
-            std::cout << "Found VolumeCloudSky node at root level: " << child->getName() << std::endl;
+            LOG_DEBUG("demoshader", "found=VolumeCloudSky name=%s search=root", child->getName().c_str());
             break;
         }
         
@@ -869,7 +852,7 @@ void DemoShader::updateVolumeCloudParameters(osgViewer::Viewer* viewer, osg::Gro
                 // 检查孙节点是否为VolumeCloudSky
                 if (grandChild->getName() == "volume_cloud_sky" || dynamic_cast<VolumeCloudSky*>(grandChild)) {
                     volumeCloudNode = grandChild;
-                    std::cout << "Found VolumeCloudSky node nested in group: " << grandChild->getName() << std::endl;
+                    LOG_DEBUG("demoshader", "found=VolumeCloudSky name=%s search=group", grandChild->getName().c_str());
                     break;
                 }
             }
@@ -881,7 +864,7 @@ void DemoShader::updateVolumeCloudParameters(osgViewer::Viewer* viewer, osg::Gro
     
     // 如果还是没有找到，尝试更广泛的搜索
     if (!volumeCloudNode) {
-        std::cout << "Performing extensive search for VolumeCloudSky nodes..." << std::endl;
+        LOG_DEBUG("demoshader", "recursive search for VolumeCloudSky nodes");
         for (unsigned int i = 0; i < rootNode->getNumChildren(); ++i) {
             osg::Node* child = rootNode->getChild(i);
             if (!child) continue;
@@ -889,7 +872,7 @@ void DemoShader::updateVolumeCloudParameters(osgViewer::Viewer* viewer, osg::Gro
             // 递归搜索所有子节点
             volumeCloudNode = findVolumeCloudSkyNode(child);
             if (volumeCloudNode) {
-                std::cout << "Found VolumeCloudSky node through recursive search: " << volumeCloudNode->getName() << std::endl;
+                LOG_DEBUG("demoshader", "found=VolumeCloudSky name=%s search=recursive", volumeCloudNode->getName().c_str());
                 break;
             }
         }
@@ -907,26 +890,25 @@ void DemoShader::updateVolumeCloudParameters(osgViewer::Viewer* viewer, osg::Gro
             volumeCloudSky->setDensityFactor(densityFactor);
             volumeCloudSky->setStepSize(stepSize);
             volumeCloudSky->setMaxSteps((int)maxSteps);
-            std::cout << "Volume Cloud parameters updated successfully" << std::endl;
         } else {
-            std::cerr << "Failed to cast node to VolumeCloudSky" << std::endl;
+            LOG_WARNING("demoshader", "node is not a VolumeCloudSky");
         }
     } else {
-        std::cerr << "Failed to find VolumeCloudSky node in the scene" << std::endl;
+        LOG_DEBUG("demoshader", "VolumeCloudSky node not found");
         // 打印所有子节点的信息以便调试
-        std::cout << "Scene children count: " << rootNode->getNumChildren() << std::endl;
+        LOG_DEBUG("demoshader", "scene children=%u", rootNode->getNumChildren());
         for (unsigned int i = 0; i < rootNode->getNumChildren(); ++i) {
             osg::Node* child = rootNode->getChild(i);
             if (child) {
-                std::cout << "  Child " << i << ": " << child->getName() << " (class: " << child->className() << ")" << std::endl;
+                LOG_DEBUG("demoshader", "child=%u name=%s class=%s", i, child->getName().c_str(), child->className());
                 // 如果是Group，打印其子节点
                 osg::Group* group = child->asGroup();
                 if (group) {
-                    std::cout << "    Group children count: " << group->getNumChildren() << std::endl;
+                    LOG_DEBUG("demoshader", "child=%u children=%u", i, group->getNumChildren());
                     for (unsigned int j = 0; j < group->getNumChildren(); ++j) {
                         osg::Node* grandChild = group->getChild(j);
                         if (grandChild) {
-                            std::cout << "      Grandchild " << j << ": " << grandChild->getName() << " (class: " << grandChild->className() << ")" << std::endl;
+                            LOG_DEBUG("demoshader", "child=%u grandchild=%u name=%s class=%s", i, j, grandChild->getName().c_str(), grandChild->className());
                         }
                     }
                 }
@@ -936,7 +918,6 @@ void DemoShader::updateVolumeCloudParameters(osgViewer::Viewer* viewer, osg::Gro
     
     // 强制更新视图
     if (viewer) {
-        std::cout << "Requesting redraw..." << std::endl;
         viewer->advance();
         viewer->requestRedraw();
     }
@@ -976,10 +957,8 @@ osg::Node* DemoShader::findVolumeCloudSkyNode(osg::Node* node)
 
 void DemoShader::updateSkyCloudParameters(osgViewer::Viewer* viewer, osg::Group* rootNode, float cloudDensity, float cloudHeight, float coverageThreshold, float densityThreshold, float edgeThreshold)
 {
-    std::cout << "Updating Sky Cloud parameters..." << std::endl;
-    std::cout << "  Cloud Density: " << cloudDensity << ", Cloud Height: " << cloudHeight
-              << ", Coverage Threshold: " << coverageThreshold << ", Density Threshold: " << densityThreshold
-              << ", Edge Threshold: " << edgeThreshold << std::endl;
+    LOG_DEBUG("demoshader", "update sky cloud density=%g height=%g coverageThreshold=%g densityThreshold=%g edgeThreshold=%g",
+              cloudDensity, cloudHeight, coverageThreshold, densityThreshold, edgeThreshold);
               
     // 查找场景中的SkyCloud节点
     osg::Node* skyCloudNode = nullptr;
@@ -1000,11 +979,10 @@ void DemoShader::updateSkyCloudParameters(osgViewer::Viewer* viewer, osg::Group*
             skyCloud->setCoverageThreshold(coverageThreshold);
             skyCloud->setDensityThreshold(densityThreshold);
             skyCloud->setEdgeThreshold(edgeThreshold);
-            std::cout << "SkyCloud parameters updated successfully" << std::endl;
         } else {
-            std::cerr << "Failed to cast node to SkyCloud" << std::endl;
+            LOG_WARNING("demoshader", "node is not a SkyCloud");
         }
     } else {
-        std::cerr << "Failed to find SkyCloud node in the scene" << std::endl;
+        LOG_DEBUG("demoshader", "SkyCloud node not found");
     }
 }
\ No newline at end of file
@@ -27,6 +27,7 @@
 class SkyBoxThree;
 class VolumeCloudSky;
 class SkyCloud;
+class EnvironmentCapture;
 class DemoShader : public osg::Referenced
 {
 public:
@@ -83,8 +84,8 @@ public:
     // 新增：创建结合天空盒和大气渲染的场景
     osg::Node* createSkyboxAtmosphereScene(osgViewer::Viewer* viewer);
     
-    // 新增：创建PBR立方体
-    osg::Node* createPBRCube();
+    // 新增：创建PBR立方体；传入环境捕获时使用捕获的天空作为IBL
+    osg::Node* createPBRCube(EnvironmentCapture* environment = nullptr);
 
     // 新增：创建使用改进大气着色器的场景
     osg::Node* createImprovedAtmosphereScene(osgViewer::Viewer* viewer);
@@ -92,8 +93,10 @@ public:
     // 新增：创建结合天空盒大气和PBR立方体的场景
     osg::Node* createSkyboxAtmosphereWithPBRScene(osgViewer::Viewer* viewer);
     
-    // 新增：创建云海大气效果场景
+    // 新增：创建云海大气效果场景（可在后台线程调用，不修改成员）
     osg::Node* createCloudSeaAtmosphereScene(osgViewer::Viewer* viewer);
+    // 云海场景切换上来后在渲染线程调用，记下场景中的CloudSeaAtmosphere供参数更新使用
+    void activateCloudSeaAtmosphereScene(osg::Node* scene);
     
     // 新增：更新云海大气参数
     void updateCloudSeaAtmosphereParameters(float sunZenithAngle, float sunAzimuthAngle,
@@ -147,11 +150,6 @@ private:
     osg::ref_ptr<osg::Texture3D> _scatteringTexture;
     osg::ref_ptr<osg::Texture2D> _irradianceTexture;
     
-    // 纹理数据
-    std::vector<float> _transmittanceData;
-    std::vector<float> _scatteringData;
-    std::vector<float> _irradianceData;
-    
     // 几何体
     osg::ref_ptr<osg::Geometry> _fullScreenQuad;
     
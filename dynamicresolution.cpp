@@ -0,0 +1,145 @@
+#include "dynamicresolution.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // 默认目标60fps
+    const double kDefaultTargetFrameTime = 16.6;
+    // 每隔多少个有效样本才调整一次，避免来回抖动
+    const int kAdjustInterval = 20;
+    // 滑动平均的权重
+    const double kSmoothing = 0.15;
+    // 超过目标5%才降，低于目标80%才升
+    const double kDecreaseThreshold = 1.05;
+    const double kIncreaseThreshold = 0.8;
+    const float kScaleStep = 0.05f;
+
+    float quantize(float scale)
+    {
+        scale = std::round(scale / kScaleStep) * kScaleStep;
+        return std::min(std::max(scale, DynamicResolution::kMinScale), DynamicResolution::kMaxScale);
+    }
+}
+
+DynamicResolution::DynamicResolution()
+    : _enabled(false)
+    , _targetFrameTime(kDefaultTargetFrameTime)
+    , _scale(kMaxScale)
+    , _extensions(nullptr)
+    , _timerQuerySupported(false)
+    , _currentSlot(0)
+    , _frameOpen(false)
+    , _averageMs(0.0)
+    , _samples(0)
+{
+}
+
+void DynamicResolution::reset()
+{
+    for (FrameSlot& slot : _slots) {
+        slot.pending = false;
+    }
+    _averageMs = 0.0;
+    _samples = 0;
+}
+
+void DynamicResolution::beginFrame(osg::State& state)
+{
+    _frameOpen = false;
+    if (!_enabled) {
+        if (_scale != kMaxScale) {
+            _scale = kMaxScale;
+            reset();
+        }
+        return;
+    }
+
+    if (!_extensions) {
+        _extensions = state.get<osg::GLExtensions>();
+        _timerQuerySupported = _extensions->isTimerQuerySupported || _extensions->isARBTimerQuerySupported;
+        if (_timerQuerySupported) {
+            for (FrameSlot& slot : _slots) {
+                _extensions->glGenQueries(2, slot.queries);
+            }
+        }
+    }
+    if (!_timerQuerySupported) return;
+
+    // 轮到的这一组还没读回就先读，结果没出来时丢弃
+    FrameSlot& slot = _slots[_currentSlot];
+    if (slot.pending) {
+        resolveSlot(slot);
+    }
+    _extensions->glQueryCounter(slot.queries[0], GL_TIMESTAMP);
+    _frameOpen = true;
+}
+
+void DynamicResolution::endFrame(osg::State&)
+{
+    if (!_frameOpen) return;
+    _frameOpen = false;
+
+    FrameSlot& slot = _slots[_currentSlot];
+    _extensions->glQueryCounter(slot.queries[1], GL_TIMESTAMP);
+    slot.pending = true;
+    _currentSlot = (_currentSlot + 1) % kFrameSlots;
+}
+
+void DynamicResolution::resolveSlot(FrameSlot& slot)
+{
+    slot.pending = false;
+
+    GLint available = 0;
+    _extensions->glGetQueryObjectiv(slot.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) return;
+
+    GLuint64 begin = 0;
+    GLuint64 end = 0;
+    _extensions->glGetQueryObjectui64v(slot.queries[0], GL_QUERY_RESULT, &begin);
+    _extensions->glGetQueryObjectui64v(slot.queries[1], GL_QUERY_RESULT, &end);
+    if (end > begin) {
+        adjust((end - begin) * 1e-6);
+    }
+}
+
+void DynamicResolution::adjust(double frameMs)
+{
+    _averageMs = _samples == 0 ? frameMs : _averageMs + (frameMs - _averageMs) * kSmoothing;
+    if (++_samples < kAdjustInterval) return;
+    _samples = 0;
+
+    double target = _targetFrameTime;
+    float scale = _scale;
+    if (target <= 0.0 || _averageMs <= 0.0) return;
+
+    // 像素数与比例的平方成正比，按耗时比的平方根估算合适的比例
+    float ideal = scale * static_cast<float>(std::sqrt(target / _averageMs));
+    float next = scale;
+    if (_averageMs > target * kDecreaseThreshold) {
+        next = quantize(std::min(ideal, scale - kScaleStep));
+    } else if (_averageMs < target * kIncreaseThreshold) {
+        // 回升每次只升一级，防止升过头后又立刻降
+        next = quantize(std::min(ideal, scale + kScaleStep));
+    }
+
+    if (next != scale) {
+        _scale = next;
+        // 平均值按新比例下的像素数折算，重新累积样本
+        _averageMs *= (next * next) / (scale * scale);
+    }
+}
+
+void DynamicResolution::releaseGLObjects()
+{
+    if (!_extensions) return;
+    if (_timerQuerySupported) {
+        for (FrameSlot& slot : _slots) {
+            _extensions->glDeleteQueries(2, slot.queries);
+            slot.queries[0] = slot.queries[1] = 0;
+        }
+    }
+    reset();
+    _frameOpen = false;
+    _extensions = nullptr;
+}
@@ -0,0 +1,69 @@
+#ifndef DYNAMICRESOLUTION_H
+#define DYNAMICRESOLUTION_H
+
+#include <osg/GL>
+#include <osg/GLExtensions>
+#include <osg/Referenced>
+#include <osg/State>
+#include <atomic>
+
+// 动态分辨率控制器
+// OSG一帧的绘制前后各打一个GL时间戳，延迟几帧非阻塞读回得到GPU帧耗时；
+// 滑动平均超过目标帧耗时时按面积比例降低渲染比例，明显低于目标时逐级回升，比例按5%量化，范围50%~100%
+class DynamicResolution : public osg::Referenced
+{
+public:
+    static constexpr float kMinScale = 0.5f;
+    static constexpr float kMaxScale = 1.0f;
+
+    DynamicResolution();
+
+    // 任意线程调用，下一帧生效；关闭后比例回到100%
+    void setEnabled(bool enabled) { _enabled = enabled; }
+    bool isEnabled() const { return _enabled; }
+
+    void setTargetFrameTime(double ms) { _targetFrameTime = ms; }
+    double getTargetFrameTime() const { return _targetFrameTime; }
+
+    // 当前渲染比例，任意线程调用
+    float getScale() const { return _scale; }
+
+    // 渲染线程，OSG绘制前后调用
+    void beginFrame(osg::State& state);
+    void endFrame(osg::State& state);
+
+    // 渲染线程，GL上下文有效时调用
+    void releaseGLObjects();
+
+protected:
+    virtual ~DynamicResolution() {}
+
+private:
+    // 查询轮换使用的帧数，第kFrameSlots帧时读回最早的一组
+    static const int kFrameSlots = 3;
+
+    struct FrameSlot
+    {
+        GLuint queries[2] = {0, 0};
+        bool pending = false;
+    };
+
+    void resolveSlot(FrameSlot& slot);
+    void adjust(double frameMs);
+    void reset();
+
+    std::atomic<bool> _enabled;
+    std::atomic<double> _targetFrameTime;
+    std::atomic<float> _scale;
+
+    osg::GLExtensions* _extensions;
+    bool _timerQuerySupported;
+    FrameSlot _slots[kFrameSlots];
+    int _currentSlot;
+    bool _frameOpen;
+
+    double _averageMs;
+    int _samples;
+};
+
+#endif // DYNAMICRESOLUTION_H
@@ -0,0 +1,394 @@
+#include "environmentcapture.h"
+#include "iblbaker.h"
+#include "shaderprogramcache.h"
+#include "SkyNode.h"
+#include <osg/Depth>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/ShapeDrawable>
+#include <osg/Uniform>
+#include <functional>
+
+namespace
+{
+    const unsigned int kFaceCount = 6;
+    // 捕获分辨率很低：天空本身是低频信号，镜面高光只需要粗糙度不为0时的模糊结果
+    const unsigned int kRadianceSize = 64;
+    const unsigned int kRadianceLevels = 7;
+    const unsigned int kPrefilteredSize = 32;
+    const unsigned int kPrefilteredLevels = 4;
+    const unsigned int kIrradianceSize = 8;
+    const unsigned int kIrradianceUnit = 3;
+
+    // 立方体贴图各面的视线和上方向（GL约定）
+    const osg::Vec3 kFaceDirections[kFaceCount] = {
+        osg::Vec3(1.0f, 0.0f, 0.0f), osg::Vec3(-1.0f, 0.0f, 0.0f),
+        osg::Vec3(0.0f, 1.0f, 0.0f), osg::Vec3(0.0f, -1.0f, 0.0f),
+        osg::Vec3(0.0f, 0.0f, 1.0f), osg::Vec3(0.0f, 0.0f, -1.0f)
+    };
+    const osg::Vec3 kFaceUps[kFaceCount] = {
+        osg::Vec3(0.0f, -1.0f, 0.0f), osg::Vec3(0.0f, -1.0f, 0.0f),
+        osg::Vec3(0.0f, 0.0f, 1.0f), osg::Vec3(0.0f, 0.0f, -1.0f),
+        osg::Vec3(0.0f, -1.0f, 0.0f), osg::Vec3(0.0f, -1.0f, 0.0f)
+    };
+
+    // 大气参数；每帧变化的相机位置、时间等不参与比较
+    const char* const kAtmosphereUniforms[] = {
+        "turbidity", "rayleigh", "mieCoefficient", "mieDirectionalG",
+        "sunPosition", "up", "sunZenithAngle", "sunAzimuthAngle"
+    };
+    const char* const kCloudUniforms[] = {
+        "cloudDensity", "cloudHeight", "cloudBaseHeight", "cloudRangeMin", "cloudRangeMax"
+    };
+
+    // 全屏三角形，与AntiAliasing的全屏pass相同
+    const char* const kFilterVert = R"(#version 330 core
+        layout(location = 0) in vec3 position;
+        out vec2 uv;
+        void main()
+        {
+            uv = position.xy * 0.5 + 0.5;
+            gl_Position = vec4(position.xy, 0.0, 1.0);
+        }
+    )";
+
+    // 两个滤波pass共用：由面序号和纹理坐标还原方向，Hammersley序列，按pdf选源mip（filtered importance sampling）
+    const char* const kFilterCommon = R"(#version 330 core
+        in vec2 uv;
+        out vec4 FragColor;
+        uniform samplerCube environmentMap;
+        uniform int faceIndex;
+        uniform float sourceSize;
+
+        const float PI = 3.14159265359;
+        const uint SAMPLE_COUNT = 64u;
+
+        vec3 faceDirection(vec2 st)
+        {
+            vec2 p = st * 2.0 - 1.0;
+            if (faceIndex == 0) return vec3(1.0, -p.y, -p.x);
+            if (faceIndex == 1) return vec3(-1.0, -p.y, p.x);
+            if (faceIndex == 2) return vec3(p.x, 1.0, p.y);
+            if (faceIndex == 3) return vec3(p.x, -1.0, -p.y);
+            if (faceIndex == 4) return vec3(p.x, -p.y, 1.0);
+            return vec3(-p.x, -p.y, -1.0);
+        }
+
+        vec2 hammersley(uint i)
+        {
+            uint bits = i;
+            bits = (bits << 16u) | (bits >> 16u);
+            bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+            bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+            bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+            bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+            return vec2(float(i) / float(SAMPLE_COUNT), float(bits) * 2.3283064365386963e-10);
+        }
+
+        // 立体角为saSample的样本对应的源mip
+        float sourceLod(float pdf)
+        {
+            float saTexel = 4.0 * PI / (6.0 * sourceSize * sourceSize);
+            float saSample = 1.0 / (float(SAMPLE_COUNT) * pdf + 0.0001);
+            return max(0.5 * log2(saSample / saTexel) + 1.0, 0.0);
+        }
+
+        mat3 tangentFrame(vec3 N)
+        {
+            vec3 up = abs(N.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+            vec3 T = normalize(cross(up, N));
+            return mat3(T, cross(N, T), N);
+        }
+    )";
+
+    // GGX预滤波，假设N = V = R；roughness为0的一级直接拷贝
+    const char* const kPrefilterMain = R"(
+        uniform float roughness;
+        void main()
+        {
+            vec3 N = normalize(faceDirection(uv));
+            if (roughness <= 0.0) {
+                FragColor = vec4(textureLod(environmentMap, N, 0.0).rgb, 1.0);
+                return;
+            }
+            mat3 frame = tangentFrame(N);
+            float a = roughness * roughness;
+            float a2 = a * a;
+            vec3 color = vec3(0.0);
+            float weight = 0.0;
+            for (uint i = 0u; i < SAMPLE_COUNT; ++i) {
+                vec2 xi = hammersley(i);
+                float phi = 2.0 * PI * xi.x;
+                float cosTheta = sqrt((1.0 - xi.y) / (1.0 + (a2 - 1.0) * xi.y));
+                float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+                vec3 H = frame * vec3(cos(phi) * sinTheta, sin(phi) * sinTheta, cosTheta);
+                vec3 L = 2.0 * dot(N, H) * H - N;
+                float NdotL = dot(N, L);
+                if (NdotL > 0.0) {
+                    float d = cosTheta * cosTheta * (a2 - 1.0) + 1.0;
+                    float D = a2 / (PI * d * d);
+                    // N = V时 pdf = D * NdotH / (4 * VdotH) = D / 4
+                    color += textureLod(environmentMap, L, sourceLod(D * 0.25)).rgb * NdotL;
+                    weight += NdotL;
+                }
+            }
+            FragColor = vec4(color / max(weight, 0.0001), 1.0);
+        }
+    )";
+
+    // 余弦加权半球采样，结果是辐照度除以π，着色器里乘基础色即可
+    const char* const kIrradianceMain = R"(
+        void main()
+        {
+            vec3 N = normalize(faceDirection(uv));
+            mat3 frame = tangentFrame(N);
+            vec3 color = vec3(0.0);
+            for (uint i = 0u; i < SAMPLE_COUNT; ++i) {
+                vec2 xi = hammersley(i);
+                float phi = 2.0 * PI * xi.x;
+                float cosTheta = sqrt(1.0 - xi.y);
+                float sinTheta = sqrt(xi.y);
+                vec3 L = frame * vec3(cos(phi) * sinTheta, sin(phi) * sinTheta, cosTheta);
+                color += textureLod(environmentMap, L, sourceLod(cosTheta / PI)).rgb;
+            }
+            FragColor = vec4(color / float(SAMPLE_COUNT), 1.0);
+        }
+    )";
+
+    osg::TextureCubeMap* createCubeMap(unsigned int size, unsigned int levels)
+    {
+        osg::TextureCubeMap* texture = new osg::TextureCubeMap;
+        texture->setTextureSize(size, size);
+        texture->setInternalFormat(GL_RGBA16F_ARB);
+        texture->setSourceFormat(GL_RGBA);
+        texture->setSourceType(GL_FLOAT);
+        texture->setNumMipmapLevels(levels);
+        texture->setFilter(osg::Texture::MIN_FILTER, levels > 1 ? osg::Texture::LINEAR_MIPMAP_LINEAR : osg::Texture::LINEAR);
+        texture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::LINEAR);
+        texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+        texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+        texture->setWrap(osg::Texture::WRAP_R, osg::Texture::CLAMP_TO_EDGE);
+        return texture;
+    }
+
+    osg::Camera* createRenderToFaceCamera(osg::TextureCubeMap* target, unsigned int face, unsigned int level,
+                                          unsigned int size, int renderOrderNum, bool mipMapGeneration = false)
+    {
+        osg::Camera* camera = new osg::Camera;
+        camera->setRenderOrder(osg::Camera::PRE_RENDER, renderOrderNum);
+        camera->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
+        camera->setReferenceFrame(osg::Transform::ABSOLUTE_RF);
+        // 不继承外层相机的裁剪掩码和远近平面计算
+        camera->setInheritanceMask(0);
+        camera->setComputeNearFarMode(osg::CullSettings::DO_NOT_COMPUTE_NEAR_FAR);
+        camera->setViewport(0, 0, size, size);
+        camera->setClearMask(GL_COLOR_BUFFER_BIT);
+        camera->setClearColor(osg::Vec4(0.0f, 0.0f, 0.0f, 1.0f));
+        camera->attach(osg::Camera::COLOR_BUFFER, target, level, face, mipMapGeneration);
+
+        osg::StateSet* stateSet = camera->getOrCreateStateSet();
+        stateSet->setMode(GL_DEPTH_TEST, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+        stateSet->setMode(GL_CULL_FACE, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+        stateSet->setMode(GL_BLEND, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+        return camera;
+    }
+}
+
+EnvironmentCapture::EnvironmentCapture(SkyBoxThree* sky, float skyRadius)
+    : _skyStateSet(sky ? sky->getOrCreateStateSet() : nullptr)
+    , _captureClouds(true)
+    , _step(-1)
+    , _signature(0)
+    , _dirty(true)
+{
+    setName("environment_capture");
+    // 相机都是绝对参考系，没有包围球
+    setCullingActive(false);
+
+    _radiance = createCubeMap(kRadianceSize, kRadianceLevels);
+    _prefiltered = createCubeMap(kPrefilteredSize, kPrefilteredLevels);
+    _irradiance = createCubeMap(kIrradianceSize, 1);
+
+    if (_skyStateSet.valid()) {
+        createCaptureCameras(skyRadius);
+        createFilterCameras();
+    }
+
+    // 捕获进度在更新遍历中推进；不能依赖子节点上天空StateSet的更新回调把本节点带进更新遍历
+    setNumChildrenRequiringUpdateTraversal(getNumChildrenRequiringUpdateTraversal() + 1);
+}
+
+void EnvironmentCapture::createCaptureCameras(float skyRadius)
+{
+    // 与天空节点共用StateSet（着色器变体和大气uniform），几何体单独创建，不影响天空节点的节点掩码
+    osg::ref_ptr<osg::Geode> sky = new osg::Geode;
+    sky->addDrawable(new osg::ShapeDrawable(new osg::Sphere(osg::Vec3(0.0f, 0.0f, 0.0f), skyRadius)));
+    sky->setCullingActive(false);
+    osg::ref_ptr<osg::Group> proxy = new osg::Group;
+    proxy->setStateSet(_skyStateSet.get());
+    proxy->addChild(sky);
+
+    for (unsigned int face = 0; face < kFaceCount; ++face) {
+        // 最后一个面画完后生成mip，供滤波时按pdf选级
+        osg::Camera* camera = createRenderToFaceCamera(_radiance.get(), face, 0, kRadianceSize, face,
+                                                       face == kFaceCount - 1);
+        camera->setViewMatrixAsLookAt(osg::Vec3(0.0f, 0.0f, 0.0f), kFaceDirections[face], kFaceUps[face]);
+        camera->setProjectionMatrixAsPerspective(90.0, 1.0, skyRadius * 0.01, skyRadius * 10.0);
+
+        // 天空着色器用osg_ViewMatrixInverse还原世界方向和相机位置，SceneView只按主相机设置，这里换成捕获相机的
+        osg::StateSet* stateSet = camera->getOrCreateStateSet();
+        stateSet->addUniform(new osg::Uniform("osg_ViewMatrixInverse", osg::Matrixf::inverse(camera->getViewMatrix())),
+                             osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+
+        camera->addChild(proxy);
+        addChild(camera);
+        _captureCameras.push_back(camera);
+    }
+}
+
+osg::Camera* EnvironmentCapture::createFilterPass(osg::Program* program, osg::TextureCubeMap* target, unsigned int face,
+                                                  unsigned int level, unsigned int size)
+{
+    osg::Camera* camera = createRenderToFaceCamera(target, face, level, size, kFaceCount);
+    camera->setViewMatrix(osg::Matrix::identity());
+    camera->setProjectionMatrix(osg::Matrix::identity());
+
+    // 覆盖整个视口的三角形
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    vertices->push_back(osg::Vec3(-1.0f, -1.0f, 0.0f));
+    vertices->push_back(osg::Vec3(3.0f, -1.0f, 0.0f));
+    vertices->push_back(osg::Vec3(-1.0f, 3.0f, 0.0f));
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    geometry->setVertexArray(vertices);
+    geometry->setVertexAttribArray(0, vertices, osg::Array::BIND_PER_VERTEX);
+    geometry->addPrimitiveSet(new osg::DrawArrays(GL_TRIANGLES, 0, 3));
+    geometry->setCullingActive(false);
+
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    geode->addDrawable(geometry);
+    geode->setCullingActive(false);
+
+    osg::StateSet* stateSet = geode->getOrCreateStateSet();
+    stateSet->setAttributeAndModes(program, osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    stateSet->setAttributeAndModes(new osg::Depth(osg::Depth::ALWAYS, 0.0, 1.0, false));
+    stateSet->setTextureAttributeAndModes(0, _radiance.get(), osg::StateAttribute::ON);
+    stateSet->setMode(GL_TEXTURE_CUBE_MAP_SEAMLESS, osg::StateAttribute::ON);
+    stateSet->addUniform(new osg::Uniform("environmentMap", 0));
+    stateSet->addUniform(new osg::Uniform("faceIndex", static_cast<int>(face)));
+    stateSet->addUniform(new osg::Uniform("sourceSize", static_cast<float>(kRadianceSize)));
+
+    camera->addChild(geode);
+    addChild(camera);
+    _filterCameras[face].push_back(camera);
+    return camera;
+}
+
+void EnvironmentCapture::createFilterCameras()
+{
+    ShaderProgramCache& programs = ShaderProgramCache::instance();
+    osg::Program* prefilter = programs.getProgram("EnvironmentPrefilter", kFilterVert,
+        std::string(kFilterCommon) + kPrefilterMain);
+    osg::Program* irradiance = programs.getProgram("EnvironmentIrradiance", kFilterVert,
+        std::string(kFilterCommon) + kIrradianceMain);
+
+    for (unsigned int face = 0; face < kFaceCount; ++face) {
+        // 第i级对应粗糙度 i / (级数 - 1)，与PBR着色器里 roughness * prefilteredMaxLod 的取法一致
+        for (unsigned int level = 0; level < kPrefilteredLevels; ++level) {
+            osg::Camera* camera = createFilterPass(prefilter, _prefiltered.get(), face, level,
+                                                   kPrefilteredSize >> level);
+            float roughness = static_cast<float>(level) / static_cast<float>(kPrefilteredLevels - 1);
+            camera->getChild(0)->getOrCreateStateSet()->addUniform(new osg::Uniform("roughness", roughness));
+        }
+        createFilterPass(irradiance, _irradiance.get(), face, 0, kIrradianceSize);
+    }
+}
+
+void EnvironmentCapture::setCaptureClouds(bool enabled)
+{
+    if (enabled == _captureClouds) return;
+    _captureClouds = enabled;
+    // 云层只出现在云层底部高度以上厚度范围内，厚度置0即不生成云
+    for (const osg::ref_ptr<osg::Camera>& camera : _captureCameras) {
+        osg::StateSet* stateSet = camera->getOrCreateStateSet();
+        if (enabled) {
+            stateSet->removeUniform("cloudHeight");
+        } else {
+            stateSet->addUniform(new osg::Uniform("cloudHeight", 0.0f),
+                                 osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+        }
+    }
+    _dirty = true;
+}
+
+unsigned int EnvironmentCapture::parameterSignature() const
+{
+    // uniform每次set()都会增加修改计数，参数界面直接改StateSet上的uniform也能察觉
+    unsigned int signature = static_cast<unsigned int>(
+        std::hash<const void*>()(_skyStateSet->getAttribute(osg::StateAttribute::PROGRAM)));
+    for (const char* name : kAtmosphereUniforms) {
+        const osg::Uniform* uniform = _skyStateSet->getUniform(name);
+        signature = signature * 31u + (uniform ? uniform->getModifiedCount() : 0u);
+    }
+    if (_captureClouds) {
+        for (const char* name : kCloudUniforms) {
+            const osg::Uniform* uniform = _skyStateSet->getUniform(name);
+            signature = signature * 31u + (uniform ? uniform->getModifiedCount() : 0u);
+        }
+    }
+    return signature;
+}
+
+void EnvironmentCapture::traverse(osg::NodeVisitor& nv)
+{
+    if (!_skyStateSet.valid()) return;
+
+    if (nv.getVisitorType() == osg::NodeVisitor::UPDATE_VISITOR) {
+        unsigned int signature = parameterSignature();
+        if (signature != _signature) {
+            _signature = signature;
+            _dirty = true;
+        }
+
+        // 一轮捕获进行中参数又变化时先走完这一轮，拖动滑块时也能持续出结果
+        int step = _step;
+        if (step >= 0 && ++step > static_cast<int>(kFaceCount)) {
+            step = -1;
+        }
+        if (step < 0 && _dirty) {
+            _dirty = false;
+            step = 0;
+        }
+        _step = step;
+        return;
+    }
+
+    if (nv.getVisitorType() == osg::NodeVisitor::CULL_VISITOR) {
+        int step = _step;
+        if (step == 0) {
+            for (const osg::ref_ptr<osg::Camera>& camera : _captureCameras) {
+                camera->accept(nv);
+            }
+        } else if (step > 0) {
+            for (const osg::ref_ptr<osg::Camera>& camera : _filterCameras[step - 1]) {
+                camera->accept(nv);
+            }
+        }
+        return;
+    }
+
+    osg::Group::traverse(nv);
+}
+
+void EnvironmentCapture::apply(osg::StateSet* stateSet) const
+{
+    if (!stateSet) return;
+
+    stateSet->setTextureAttributeAndModes(IBLBaker::kPrefilteredUnit, _prefiltered.get(), osg::StateAttribute::ON);
+    stateSet->setTextureAttributeAndModes(IBLBaker::kBrdfLutUnit, IBLBaker::instance().brdfLut(), osg::StateAttribute::ON);
+    stateSet->setTextureAttributeAndModes(kIrradianceUnit, _irradiance.get(), osg::StateAttribute::ON);
+    stateSet->addUniform(new osg::Uniform("prefilteredMap", static_cast<int>(IBLBaker::kPrefilteredUnit)));
+    stateSet->addUniform(new osg::Uniform("brdfLut", static_cast<int>(IBLBaker::kBrdfLutUnit)));
+    stateSet->addUniform(new osg::Uniform("irradianceMap", static_cast<int>(kIrradianceUnit)));
+    stateSet->addUniform(new osg::Uniform("prefilteredMaxLod", static_cast<float>(kPrefilteredLevels - 1)));
+    stateSet->setMode(GL_TEXTURE_CUBE_MAP_SEAMLESS, osg::StateAttribute::ON);
+}
@@ -0,0 +1,59 @@
+#ifndef ENVIRONMENTCAPTURE_H
+#define ENVIRONMENTCAPTURE_H
+
+#include <osg/Camera>
+#include <osg/Group>
+#include <osg/StateSet>
+#include <osg/TextureCubeMap>
+#include <osg/ref_ptr>
+#include <atomic>
+#include <vector>
+
+class SkyBoxThree;
+
+// 程序化大气的实时环境捕获
+// 天空的太阳角度、浑浊度等参数变化后，用6个预渲染相机把当前大气画进低分辨率立方体贴图，
+// 之后每帧只滤波一个面：GGX预滤波写入mip链，余弦卷积写入小尺寸辐照度贴图；
+// 参数不变时不做任何渲染。结果配合ShaderPBR::createPBRShaderCapturedIBL使用
+class EnvironmentCapture : public osg::Group
+{
+public:
+    // 捕获相机以天空节点的StateSet绘制自己的球体，skyRadius与场景中天空球的半径一致
+    EnvironmentCapture(SkyBoxThree* sky, float skyRadius);
+
+    // 渲染线程或更新遍历之前调用；关闭时捕获结果不含云层
+    void setCaptureClouds(bool enabled);
+    bool getCaptureClouds() const { return _captureClouds; }
+
+    // 把捕获结果和BRDF积分表绑定到StateSet
+    void apply(osg::StateSet* stateSet) const;
+
+    virtual void traverse(osg::NodeVisitor& nv) override;
+
+protected:
+    virtual ~EnvironmentCapture() {}
+
+private:
+    void createCaptureCameras(float skyRadius);
+    void createFilterCameras();
+    osg::Camera* createFilterPass(osg::Program* program, osg::TextureCubeMap* target, unsigned int face,
+                                  unsigned int level, unsigned int size);
+    unsigned int parameterSignature() const;
+
+    osg::ref_ptr<osg::StateSet> _skyStateSet;
+    bool _captureClouds;
+
+    osg::ref_ptr<osg::TextureCubeMap> _radiance;
+    osg::ref_ptr<osg::TextureCubeMap> _prefiltered;
+    osg::ref_ptr<osg::TextureCubeMap> _irradiance;
+
+    std::vector<osg::ref_ptr<osg::Camera> > _captureCameras;
+    std::vector<osg::ref_ptr<osg::Camera> > _filterCameras[6];
+
+    // 更新遍历推进、裁剪遍历读取：-1空闲，0捕获6个面，1..6滤波第(step - 1)个面
+    std::atomic<int> _step;
+    unsigned int _signature;
+    bool _dirty;
+};
+
+#endif // ENVIRONMENTCAPTURE_H
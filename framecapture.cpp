@@ -0,0 +1,275 @@
+#include "framecapture.h"
+#include "logger.h"
+#include <osg/Image>
+#include <osgDB/FileNameUtils>
+#include <osgDB/WriteFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
+#include <QString>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifndef GL_PIXEL_PACK_BUFFER_ARB
+#define GL_PIXEL_PACK_BUFFER_ARB 0x88EB
+#endif
+#ifndef GL_STREAM_READ_ARB
+#define GL_STREAM_READ_ARB 0x88E1
+#endif
+#ifndef GL_READ_ONLY_ARB
+#define GL_READ_ONLY_ARB 0x88B8
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_ALREADY_SIGNALED
+#define GL_ALREADY_SIGNALED 0x911A
+#endif
+#ifndef GL_CONDITION_SATISFIED
+#define GL_CONDITION_SATISFIED 0x911C
+#endif
+#ifndef GL_FRAMEBUFFER_EXT
+#define GL_FRAMEBUFFER_EXT 0x8D40
+#endif
+
+FrameCapture::FrameCapture()
+    : _frameStep(1), _sequenceIndex(0), _stepCounter(0), _recording(false), _dropped(0), _extensions(nullptr), _frame(0), _stopping(false)
+{
+}
+
+FrameCapture::~FrameCapture()
+{
+    // 已取回的帧全部写完再退出
+    {
+        std::lock_guard<std::mutex> lock(_jobMutex);
+        _stopping = true;
+    }
+    _jobReady.notify_all();
+    for (std::thread& worker : _workers) {
+        worker.join();
+    }
+}
+
+void FrameCapture::requestScreenshot(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(_requestMutex);
+    _screenshotPath = path;
+}
+
+void FrameCapture::startSequence(const std::string& directory, int frameStep)
+{
+    std::lock_guard<std::mutex> lock(_requestMutex);
+    _sequenceDirectory = directory;
+    _frameStep = std::max(1, frameStep);
+    _sequenceIndex = 0;
+    _stepCounter = 0;
+    _recording = true;
+}
+
+void FrameCapture::stopSequence()
+{
+    std::lock_guard<std::mutex> lock(_requestMutex);
+    _recording = false;
+}
+
+bool FrameCapture::isReady(const Slot& slot) const
+{
+    if (slot.fence) {
+        const GLenum status = _extensions->glClientWaitSync(slot.fence, 0, 0);
+        return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+    }
+    // 没有同步对象时按帧数估计，kSlots-1帧之前发出的读取一般已经完成
+    return _frame - slot.frame >= kSlots - 1;
+}
+
+void FrameCapture::readBack(Slot& slot)
+{
+    Job job;
+    job.width = slot.width;
+    job.height = slot.height;
+    job.path = slot.path;
+
+    _extensions->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, slot.pbo);
+    if (const void* data = _extensions->glMapBuffer(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB)) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        job.pixels.assign(bytes, bytes + static_cast<std::size_t>(slot.width) * slot.height * 4);
+        _extensions->glUnmapBuffer(GL_PIXEL_PACK_BUFFER_ARB);
+    }
+    _extensions->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+
+    if (slot.fence) {
+        _extensions->glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+    }
+    slot.pending = false;
+
+    if (job.pixels.empty()) {
+        ++_dropped;
+        LOG_WARNING("framecapture", "map failed path=%s", job.path.c_str());
+        return;
+    }
+    enqueue(std::move(job));
+}
+
+bool FrameCapture::capture(osg::State& state, GLuint fboId, int width, int height)
+{
+    if (!_extensions) {
+        _extensions = state.get<osg::GLExtensions>();
+    }
+    if (!_extensions->isPBOSupported) {
+        return false;
+    }
+
+    // 先取回已经完成的读取，空出槽位
+    for (Slot& slot : _slots) {
+        if (slot.pending && isReady(slot)) {
+            readBack(slot);
+        }
+    }
+
+    Slot* free = nullptr;
+    for (Slot& slot : _slots) {
+        if (!slot.pending) {
+            free = &slot;
+            break;
+        }
+    }
+
+    // 本帧是否需要捕获，以及写到哪里；截图优先于序列
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(_requestMutex);
+        const bool sequenceFrame = _recording && _stepCounter++ % static_cast<unsigned int>(_frameStep) == 0;
+        if (!free) {
+            // GPU还没追上，不为捕获等待：截图留到下一帧，序列的这一帧丢弃且不占编号
+            if (sequenceFrame) {
+                ++_dropped;
+                LOG_WARNING("framecapture", "no free pixel buffer, sequence frame dropped");
+            }
+        } else if (!_screenshotPath.empty()) {
+            path.swap(_screenshotPath);
+        } else if (sequenceFrame) {
+            char name[32];
+            std::snprintf(name, sizeof(name), "frame_%06u.png", _sequenceIndex++);
+            path = _sequenceDirectory + "/" + name;
+        }
+    }
+
+    if (!path.empty() && width > 0 && height > 0) {
+        if (!free->pbo) {
+            _extensions->glGenBuffers(1, &free->pbo);
+        }
+        _extensions->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, free->pbo);
+        if (free->width != width || free->height != height) {
+            _extensions->glBufferData(GL_PIXEL_PACK_BUFFER_ARB, static_cast<GLsizeiptr>(width) * height * 4, nullptr, GL_STREAM_READ_ARB);
+            free->width = width;
+            free->height = height;
+        }
+
+        // 读取Qt的FBO，数据直接进PBO，glReadPixels立即返回
+        _extensions->glBindFramebuffer(GL_FRAMEBUFFER_EXT, fboId);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        _extensions->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+
+        if (_extensions->glFenceSync) {
+            free->fence = _extensions->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+        free->pending = true;
+        free->frame = _frame;
+        free->path = path;
+    }
+    ++_frame;
+
+    // 截图请求还没发出读取时也要继续渲染
+    bool pending = false;
+    for (const Slot& slot : _slots) {
+        pending = pending || slot.pending;
+    }
+    std::lock_guard<std::mutex> lock(_requestMutex);
+    return pending || !_screenshotPath.empty();
+}
+
+void FrameCapture::releaseGLObjects()
+{
+    if (!_extensions) return;
+
+    for (Slot& slot : _slots) {
+        if (slot.fence) {
+            _extensions->glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+        }
+        if (slot.pbo) {
+            _extensions->glDeleteBuffers(1, &slot.pbo);
+            slot.pbo = 0;
+        }
+        slot.pending = false;
+        slot.width = slot.height = 0;
+    }
+}
+
+void FrameCapture::enqueue(Job&& job)
+{
+    {
+        std::lock_guard<std::mutex> lock(_jobMutex);
+        if (_jobs.size() >= kMaxQueuedFrames) {
+            // 编码跟不上时丢帧，不让内存无限增长
+            ++_dropped;
+            LOG_WARNING("framecapture", "encoder backlog, frame dropped path=%s", job.path.c_str());
+            return;
+        }
+        _jobs.push_back(std::move(job));
+
+        // 编码线程在第一次有任务时启动，最多4个
+        const std::size_t workers = std::min<std::size_t>(4, std::max(1u, std::thread::hardware_concurrency() / 2));
+        if (_workers.size() < workers) {
+            _workers.emplace_back(&FrameCapture::workerLoop, this);
+        }
+    }
+    _jobReady.notify_one();
+}
+
+void FrameCapture::workerLoop()
+{
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(_jobMutex);
+            _jobReady.wait(lock, [this]() { return _stopping || !_jobs.empty(); });
+            if (_jobs.empty()) return;
+            job = std::move(_jobs.front());
+            _jobs.pop_front();
+        }
+        encode(job);
+    }
+}
+
+void FrameCapture::encode(const Job& job)
+{
+    QDir().mkpath(QFileInfo(QString::fromStdString(job.path)).absolutePath());
+    const std::size_t rowBytes = static_cast<std::size_t>(job.width) * 4;
+
+    if (osgDB::getLowerCaseFileExtension(job.path) == "exr") {
+        // osg::Image与GL同为自下而上的行序，不用翻转
+        osg::ref_ptr<osg::Image> image = new osg::Image;
+        image->allocateImage(job.width, job.height, 1, GL_RGBA, GL_FLOAT);
+        float* destination = reinterpret_cast<float*>(image->data());
+        for (std::size_t i = 0; i < job.pixels.size(); ++i) {
+            destination[i] = job.pixels[i] / 255.0f;
+        }
+        if (!osgDB::writeImageFile(*image, job.path)) {
+            LOG_WARNING("framecapture", "cannot write path=%s", job.path.c_str());
+        }
+        return;
+    }
+
+    // GL的第一行在底部，写入QImage时上下翻转；不透明输出，忽略FBO中的alpha
+    QImage image(job.width, job.height, QImage::Format_RGBX8888);
+    for (int y = 0; y < job.height; ++y) {
+        std::memcpy(image.scanLine(job.height - 1 - y), job.pixels.data() + y * rowBytes, rowBytes);
+    }
+    if (!image.save(QString::fromStdString(job.path))) {
+        LOG_WARNING("framecapture", "cannot write path=%s", job.path.c_str());
+    }
+}
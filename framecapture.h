@@ -0,0 +1,95 @@
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <osg/GL>
+#include <osg/GLExtensions>
+#include <osg/Referenced>
+#include <osg/State>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 帧捕获（截图与编号图像序列）
+// 帧末把Qt的FBO读进轮换使用的像素缓冲对象（PBO），kSlots帧之后（有同步对象时在GPU完成后）再映射取回，渲染线程不等待GPU；
+// 取回的像素交给编码线程池写成PNG等（按扩展名，.exr走osgDB插件）。编码积压超过kMaxQueuedFrames或PBO都未完成时丢弃该帧并计数
+class FrameCapture : public osg::Referenced
+{
+public:
+    FrameCapture();
+
+    // 任意线程调用：下一帧写入path
+    void requestScreenshot(const std::string& path);
+    // 任意线程调用：每frameStep帧写一张，文件名为 directory/frame_000000.png，编号从0连续递增（丢弃的帧不占编号）
+    void startSequence(const std::string& directory, int frameStep);
+    void stopSequence();
+    bool isRecording() const { return _recording; }
+
+    // 因PBO未完成或编码积压丢弃的帧数
+    unsigned int getDroppedFrames() const { return _dropped; }
+
+    // 渲染线程，OSG绘制结束、状态交还Qt之后调用；返回true表示还有未取回的帧，需要继续渲染
+    bool capture(osg::State& state, GLuint fboId, int width, int height);
+
+    // 渲染线程，GL上下文有效时调用
+    void releaseGLObjects();
+
+protected:
+    virtual ~FrameCapture();
+
+private:
+    static const int kSlots = 3;
+    static const std::size_t kMaxQueuedFrames = 8;
+
+    struct Slot
+    {
+        GLuint pbo = 0;
+        GLsync fence = nullptr;
+        bool pending = false;
+        unsigned int frame = 0;
+        int width = 0;
+        int height = 0;
+        std::string path;
+    };
+
+    struct Job
+    {
+        int width;
+        int height;
+        std::string path;
+        std::vector<unsigned char> pixels;
+    };
+
+    bool isReady(const Slot& slot) const;
+    void readBack(Slot& slot);
+    void enqueue(Job&& job);
+    void workerLoop();
+    static void encode(const Job& job);
+
+    // 请求（任意线程）
+    std::mutex _requestMutex;
+    std::string _screenshotPath;
+    std::string _sequenceDirectory;
+    int _frameStep;
+    unsigned int _sequenceIndex;
+    unsigned int _stepCounter;
+    std::atomic<bool> _recording;
+    std::atomic<unsigned int> _dropped;
+
+    // 渲染线程
+    osg::GLExtensions* _extensions;
+    Slot _slots[kSlots];
+    unsigned int _frame;
+
+    // 编码线程池
+    std::mutex _jobMutex;
+    std::condition_variable _jobReady;
+    std::deque<Job> _jobs;
+    std::vector<std::thread> _workers;
+    bool _stopping;
+};
+
+#endif // FRAMECAPTURE_H
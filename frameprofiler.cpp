@@ -0,0 +1,360 @@
+#include "frameprofiler.h"
+#include "skybox.h"
+#include "SkyNode.h"
+#include "SkyCloud.h"
+#include "VolumeCloudSky.h"
+#include "CloudSeaAtmosphere.h"
+#include "pbrmaterialtable.h"
+#include <osg/GLExtensions>
+#include <osg/Drawable>
+#include <osg/NodeVisitor>
+#include <osg/Program>
+#include <osg/Stats>
+#include <algorithm>
+
+#ifndef GL_TIMESTAMP
+#define GL_TIMESTAMP 0x8E28
+#endif
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#endif
+#ifndef GL_QUERY_RESULT_AVAILABLE
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+
+namespace
+{
+    const char* const kPassNames[FrameProfiler::PASS_COUNT] = {
+        "Other", "Sky", "Clouds", "PBR", "Models"
+    };
+
+    // 本线程正在beginFrame/endFrame之间的profiler；多个视口共享场景时drawable上只有一个回调，按当前帧所属视口分发
+    thread_local FrameProfiler* s_activeProfiler = nullptr;
+
+    // 绘制前通知profiler当前drawable所属pass，再走默认绘制
+    class PassDrawCallback : public osg::Drawable::DrawCallback
+    {
+    public:
+        explicit PassDrawCallback(FrameProfiler::Pass pass) : _pass(pass) {}
+
+        void setPass(FrameProfiler::Pass pass) { _pass = pass; }
+
+        void drawImplementation(osg::RenderInfo& renderInfo, const osg::Drawable* drawable) const override
+        {
+            FrameProfiler* profiler = s_activeProfiler;
+            if (profiler && profiler->isEnabled()) {
+                profiler->markPass(*renderInfo.getState(), _pass);
+            }
+            drawable->drawImplementation(renderInfo);
+        }
+
+    private:
+        FrameProfiler::Pass _pass;
+    };
+
+    // 按节点类型给子树归类：天空/云层节点整棵子树归入对应pass，使用PBR着色器的子树归入PBR，其余为模型
+    class PassClassifier : public osg::NodeVisitor
+    {
+    public:
+        PassClassifier()
+            : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
+            , _pass(FrameProfiler::PASS_MODEL) {}
+
+        void apply(osg::Node& node) override
+        {
+            FrameProfiler::Pass saved = _pass;
+            _pass = classify(node);
+            traverse(node);
+            _pass = saved;
+        }
+
+        void apply(osg::Drawable& drawable) override
+        {
+            FrameProfiler::Pass pass = classify(drawable);
+            PassDrawCallback* callback = dynamic_cast<PassDrawCallback*>(drawable.getDrawCallback());
+            if (callback) {
+                callback->setPass(pass);
+            } else if (!drawable.getDrawCallback()) {
+                drawable.setDrawCallback(new PassDrawCallback(pass));
+            }
+        }
+
+    private:
+        FrameProfiler::Pass classify(osg::Node& node) const
+        {
+            if (dynamic_cast<SkyBox*>(&node) || dynamic_cast<SkyBoxThree*>(&node)) {
+                return FrameProfiler::PASS_SKY;
+            }
+            if (dynamic_cast<VolumeCloudSky*>(&node) || dynamic_cast<SkyCloud*>(&node) ||
+                dynamic_cast<CloudSeaAtmosphere*>(&node)) {
+                return FrameProfiler::PASS_CLOUD;
+            }
+            if (_pass == FrameProfiler::PASS_MODEL && node.getStateSet()) {
+                // 各种IBL来源的PBR程序都以PBRShader命名，材质表中有槽位的StateSet也是PBR物体
+                const osg::StateSet* stateSet = node.getStateSet();
+                const osg::Program* program = dynamic_cast<const osg::Program*>(
+                    stateSet->getAttribute(osg::StateAttribute::PROGRAM));
+                if ((program && program->getName().compare(0, 9, "PBRShader") == 0) ||
+                    PBRMaterialTable::hasMaterial(stateSet)) {
+                    return FrameProfiler::PASS_PBR;
+                }
+            }
+            return _pass;
+        }
+
+        FrameProfiler::Pass _pass;
+    };
+}
+
+void FrameProfiler::Rolling::add(double value)
+{
+    samples[next] = value;
+    next = (next + 1) % kWindowSize;
+    count = std::min(count + 1, static_cast<int>(kWindowSize));
+}
+
+double FrameProfiler::Rolling::average() const
+{
+    if (count == 0) return 0.0;
+    double sum = 0.0;
+    for (int i = 0; i < count; ++i) sum += samples[i];
+    return sum / count;
+}
+
+double FrameProfiler::Rolling::maximum() const
+{
+    double result = 0.0;
+    for (int i = 0; i < count; ++i) result = std::max(result, samples[i]);
+    return result;
+}
+
+FrameProfiler::FrameProfiler()
+    : _enabled(false)
+    , _statsCollecting(false)
+    , _timerQuerySupported(false)
+    , _extensions(nullptr)
+    , _currentSlot(nullptr)
+    , _frameNumber(0)
+    , _currentPass(PASS_OTHER)
+    , _lastEndTimestamp(0)
+    , _lastResolvedFrame(0)
+    , _hasLastEnd(false)
+    , _frameStartTick(0)
+{
+}
+
+bool FrameProfiler::sceneChanged(osg::Group* root) const
+{
+    if (root->getNumChildren() != _instrumentedChildren.size()) return true;
+    for (unsigned int i = 0; i < root->getNumChildren(); ++i) {
+        if (root->getChild(i) != _instrumentedChildren[i]) return true;
+    }
+    return false;
+}
+
+void FrameProfiler::instrumentScene(osg::Group* root)
+{
+    PassClassifier classifier;
+    root->accept(classifier);
+
+    _instrumentedChildren.clear();
+    for (unsigned int i = 0; i < root->getNumChildren(); ++i) {
+        _instrumentedChildren.push_back(root->getChild(i));
+    }
+}
+
+void FrameProfiler::updateStatsCollection(osgViewer::Viewer* viewer, bool enabled)
+{
+    // StatsHandler关闭时会一并关掉统计，开启期间每帧重新打开
+    if (!enabled && !_statsCollecting) return;
+    _statsCollecting = enabled;
+
+    viewer->getViewerStats()->collectStats("event", enabled);
+    viewer->getViewerStats()->collectStats("update", enabled);
+    if (viewer->getCamera()->getStats()) {
+        viewer->getCamera()->getStats()->collectStats("rendering", enabled);
+    }
+}
+
+void FrameProfiler::issueTimestamp(osg::State& state, int pass)
+{
+    FrameSlot& slot = *_currentSlot;
+    if (slot.used == slot.queries.size()) {
+        GLuint query = 0;
+        _extensions->glGenQueries(1, &query);
+        slot.queries.push_back(query);
+        slot.passes.push_back(pass);
+    }
+    _extensions->glQueryCounter(slot.queries[slot.used], GL_TIMESTAMP);
+    slot.passes[slot.used] = pass;
+    ++slot.used;
+    _currentPass = pass;
+}
+
+void FrameProfiler::markPass(osg::State& state, Pass pass)
+{
+    if (!_currentSlot || pass == _currentPass) return;
+    issueTimestamp(state, pass);
+}
+
+void FrameProfiler::resolveSlot(FrameSlot& slot)
+{
+    slot.pending = false;
+    if (slot.used < 2) return;
+
+    // 结果还没出来就丢掉这一帧，绝不阻塞等待
+    GLint available = 0;
+    _extensions->glGetQueryObjectiv(slot.queries[slot.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        _hasLastEnd = false;
+        return;
+    }
+
+    std::vector<GLuint64> timestamps(slot.used);
+    for (unsigned int i = 0; i < slot.used; ++i) {
+        _extensions->glGetQueryObjectui64v(slot.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+    }
+
+    double passMs[PASS_COUNT] = {};
+    for (unsigned int i = 0; i + 1 < slot.used; ++i) {
+        passMs[slot.passes[i]] += (timestamps[i + 1] - timestamps[i]) * 1e-6;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (int pass = 0; pass < PASS_COUNT; ++pass) {
+        _gpuPass[pass].add(passMs[pass]);
+    }
+    _gpuFrame.add((timestamps.back() - timestamps.front()) * 1e-6);
+
+    // 上一帧结束到本帧开始之间GPU在做Qt场景图合成或空闲
+    if (_hasLastEnd && _lastResolvedFrame + 1 == slot.frameNumber && timestamps.front() >= _lastEndTimestamp) {
+        _gpuGap.add((timestamps.front() - _lastEndTimestamp) * 1e-6);
+    }
+    _lastEndTimestamp = timestamps.back();
+    _lastResolvedFrame = slot.frameNumber;
+    _hasLastEnd = true;
+}
+
+void FrameProfiler::beginFrame(osgViewer::Viewer* viewer, osg::Group* root)
+{
+    _currentSlot = nullptr;
+    _frameStartTick = osg::Timer::instance()->tick();
+    s_activeProfiler = this;
+
+    bool enabled = _enabled;
+    updateStatsCollection(viewer, enabled);
+    if (!enabled) {
+        for (FrameSlot& slot : _slots) {
+            slot.pending = false;
+        }
+        _hasLastEnd = false;
+        return;
+    }
+
+    osg::State* state = viewer->getCamera()->getGraphicsContext()->getState();
+    if (!_extensions) {
+        _extensions = state->get<osg::GLExtensions>();
+        _timerQuerySupported = _extensions->isTimerQuerySupported || _extensions->isARBTimerQuerySupported;
+    }
+
+    if (root && sceneChanged(root)) {
+        instrumentScene(root);
+    }
+
+    if (!_timerQuerySupported) return;
+
+    ++_frameNumber;
+    FrameSlot& slot = _slots[_frameNumber % kFrameSlots];
+    if (slot.pending) {
+        resolveSlot(slot);
+    }
+    slot.used = 0;
+    slot.frameNumber = _frameNumber;
+
+    _currentSlot = &slot;
+    issueTimestamp(*state, PASS_OTHER);
+}
+
+void FrameProfiler::endFrame(osgViewer::Viewer* viewer)
+{
+    if (s_activeProfiler == this) {
+        s_activeProfiler = nullptr;
+    }
+    if (!_enabled) return;
+
+    if (_currentSlot) {
+        issueTimestamp(*viewer->getCamera()->getGraphicsContext()->getState(), PASS_OTHER);
+        _currentSlot->pending = true;
+        _currentSlot = nullptr;
+    }
+
+    // OSG统计以秒为单位
+    double value = 0.0;
+    std::lock_guard<std::mutex> lock(_mutex);
+    osg::Stats* viewerStats = viewer->getViewerStats();
+    unsigned int frameNumber = viewerStats->getLatestFrameNumber();
+    if (viewerStats->getAttribute(frameNumber, "Event traversal time taken", value)) {
+        _cpuEvent.add(value * 1000.0);
+    }
+    if (viewerStats->getAttribute(frameNumber, "Update traversal time taken", value)) {
+        _cpuUpdate.add(value * 1000.0);
+    }
+    osg::Stats* cameraStats = viewer->getCamera()->getStats();
+    if (cameraStats) {
+        frameNumber = cameraStats->getLatestFrameNumber();
+        if (cameraStats->getAttribute(frameNumber, "Cull traversal time taken", value)) {
+            _cpuCull.add(value * 1000.0);
+        }
+        if (cameraStats->getAttribute(frameNumber, "Draw traversal time taken", value)) {
+            _cpuDraw.add(value * 1000.0);
+        }
+    }
+    _cpuFrame.add(osg::Timer::instance()->delta_m(_frameStartTick, osg::Timer::instance()->tick()));
+}
+
+std::vector<FrameProfiler::Timing> FrameProfiler::snapshot() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<Timing> result;
+
+    auto append = [&result](const std::string& name, bool gpu, const Rolling& rolling) {
+        if (rolling.count == 0) return;
+        Timing timing;
+        timing.name = name;
+        timing.gpu = gpu;
+        timing.averageMs = rolling.average();
+        timing.maxMs = rolling.maximum();
+        result.push_back(timing);
+    };
+
+    for (int pass = PASS_SKY; pass < PASS_COUNT; ++pass) {
+        append(kPassNames[pass], true, _gpuPass[pass]);
+    }
+    append(kPassNames[PASS_OTHER], true, _gpuPass[PASS_OTHER]);
+    append("GPU frame", true, _gpuFrame);
+    append("Qt composite / idle", true, _gpuGap);
+
+    append("Event", false, _cpuEvent);
+    append("Update", false, _cpuUpdate);
+    append("Cull", false, _cpuCull);
+    append("Draw", false, _cpuDraw);
+    append("Render thread", false, _cpuFrame);
+    return result;
+}
+
+void FrameProfiler::releaseGLObjects()
+{
+    if (!_extensions) return;
+    for (FrameSlot& slot : _slots) {
+        if (!slot.queries.empty()) {
+            _extensions->glDeleteQueries(static_cast<GLsizei>(slot.queries.size()), slot.queries.data());
+        }
+        slot.queries.clear();
+        slot.passes.clear();
+        slot.used = 0;
+        slot.pending = false;
+    }
+    _currentSlot = nullptr;
+    _hasLastEnd = false;
+    _extensions = nullptr;
+}
@@ -0,0 +1,127 @@
+#ifndef FRAMEPROFILER_H
+#define FRAMEPROFILER_H
+
+#include <osg/Referenced>
+#include <osg/ref_ptr>
+#include <osg/GL>
+#include <osg/Group>
+#include <osg/State>
+#include <osg/Timer>
+#include <osgViewer/Viewer>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 逐pass帧耗时统计
+// GPU：给天空、云层、PBR、模型等子树的drawable挂绘制回调，pass切换时打一个GL时间戳，
+//      相邻时间戳之差计入前一个pass；查询按帧轮换使用，延迟一帧非阻塞读回，不会让CPU等GPU
+// CPU：读取OSG自带的事件/更新/裁剪/绘制统计
+// 所有结果做滑动平均，snapshot()可在任意线程调用
+class FrameProfiler : public osg::Referenced
+{
+public:
+    // GPU pass，PASS_OTHER为清屏、状态重置等未归属的部分
+    enum Pass
+    {
+        PASS_OTHER = 0,
+        PASS_SKY,
+        PASS_CLOUD,
+        PASS_PBR,
+        PASS_MODEL,
+        PASS_COUNT
+    };
+
+    struct Timing
+    {
+        std::string name;
+        bool gpu;           // true为GPU耗时，false为CPU耗时
+        double averageMs;
+        double maxMs;
+    };
+
+    FrameProfiler();
+
+    void setEnabled(bool enabled) { _enabled = enabled; }
+    bool isEnabled() const { return _enabled; }
+
+    // 渲染线程，viewer->frame()之前调用：场景变化时重新给drawable归类，读回之前帧的查询并打帧起始时间戳
+    void beginFrame(osgViewer::Viewer* viewer, osg::Group* root);
+    // 渲染线程，viewer->frame()之后调用：打帧结束时间戳并收集OSG统计
+    void endFrame(osgViewer::Viewer* viewer);
+
+    // 由drawable绘制回调调用
+    void markPass(osg::State& state, Pass pass);
+
+    // 当前滑动平均结果，线程安全
+    std::vector<Timing> snapshot() const;
+
+    // 渲染线程，GL上下文有效时调用
+    void releaseGLObjects();
+
+protected:
+    virtual ~FrameProfiler() {}
+
+private:
+    // 两帧轮换：本帧写一组查询时，读回上一组
+    static const int kFrameSlots = 2;
+    // 滑动平均窗口（帧）
+    static const int kWindowSize = 60;
+
+    struct FrameSlot
+    {
+        std::vector<GLuint> queries;    // 时间戳查询池
+        std::vector<int> passes;        // 第i个时间戳开始的区间所属pass
+        unsigned int used = 0;
+        unsigned int frameNumber = 0;
+        bool pending = false;
+    };
+
+    struct Rolling
+    {
+        double samples[kWindowSize] = {};
+        int count = 0;
+        int next = 0;
+
+        void add(double value);
+        double average() const;
+        double maximum() const;
+    };
+
+    void instrumentScene(osg::Group* root);
+    bool sceneChanged(osg::Group* root) const;
+    void issueTimestamp(osg::State& state, int pass);
+    void resolveSlot(FrameSlot& slot);
+    void updateStatsCollection(osgViewer::Viewer* viewer, bool enabled);
+
+    std::atomic<bool> _enabled;
+    bool _statsCollecting;
+    bool _timerQuerySupported;
+    const osg::GLExtensions* _extensions;
+
+    FrameSlot _slots[kFrameSlots];
+    FrameSlot* _currentSlot;
+    unsigned int _frameNumber;
+    int _currentPass;
+
+    // 上一个已读回帧的结束时间戳，用于求帧间隙（Qt合成与空闲）
+    GLuint64 _lastEndTimestamp;
+    unsigned int _lastResolvedFrame;
+    bool _hasLastEnd;
+
+    std::vector<const osg::Node*> _instrumentedChildren;
+
+    osg::Timer_t _frameStartTick;
+
+    mutable std::mutex _mutex;
+    Rolling _gpuPass[PASS_COUNT];
+    Rolling _gpuFrame;
+    Rolling _gpuGap;
+    Rolling _cpuEvent;
+    Rolling _cpuUpdate;
+    Rolling _cpuCull;
+    Rolling _cpuDraw;
+    Rolling _cpuFrame;
+};
+
+#endif // FRAMEPROFILER_H
@@ -0,0 +1,210 @@
+#include "geometrycompaction.h"
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/MatrixTransform>
+#include <osg/NodeVisitor>
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <vector>
+
+namespace
+{
+    // 顶点数少于该值的Geode不值得多插一层变换
+    const unsigned int kMinVertices = 256;
+    // 16位有符号量化的取值范围，留出-32768使正负对称
+    const float kPositionRange = 32767.0f;
+
+    short quantize(float value, float range)
+    {
+        return static_cast<short>(std::max(-range, std::min(range, std::round(value))));
+    }
+
+    // 顶点位置是Vec3Array、不带通用顶点属性（着色器按location读取的几何体不能换成整数位置）的Geometry才压缩
+    bool isCompactable(osg::Drawable* drawable)
+    {
+        const osg::Geometry* geometry = drawable->asGeometry();
+        if (!geometry) return false;
+
+        const osg::Vec3Array* vertices = dynamic_cast<const osg::Vec3Array*>(geometry->getVertexArray());
+        if (!vertices || vertices->empty()) return false;
+        for (unsigned int i = 0; i < geometry->getNumVertexAttribArrays(); ++i) {
+            if (geometry->getVertexAttribArray(i)) return false;
+        }
+        const osg::Array* normals = geometry->getNormalArray();
+        return !normals || dynamic_cast<const osg::Vec3Array*>(normals);
+    }
+
+    std::size_t dataSize(const osg::Geometry* geometry)
+    {
+        std::size_t total = 0;
+        osg::Geometry::ArrayList arrays;
+        geometry->getArrayList(arrays);
+        for (const osg::ref_ptr<osg::Array>& array : arrays) {
+            total += array->getTotalDataSize();
+        }
+        for (unsigned int i = 0; i < geometry->getNumPrimitiveSets(); ++i) {
+            if (const osg::DrawElements* elements = geometry->getPrimitiveSet(i)->getDrawElements()) {
+                total += elements->getTotalDataSize();
+            }
+        }
+        return total;
+    }
+
+    osg::ref_ptr<osg::DrawElementsUShort> toUShort(const osg::DrawElements* elements)
+    {
+        osg::ref_ptr<osg::DrawElementsUShort> packed = new osg::DrawElementsUShort(elements->getMode());
+        packed->reserve(elements->getNumIndices());
+        for (unsigned int i = 0; i < elements->getNumIndices(); ++i) {
+            packed->push_back(static_cast<GLushort>(elements->index(i)));
+        }
+        packed->setNumInstances(elements->getNumInstances());
+        return packed;
+    }
+
+    // 把geometry的位置换成以center为原点、step为单位的16位整数，法线、颜色换成8位，索引尽量换成16位
+    void compactGeometry(osg::Geometry& geometry, const osg::Vec3& center, float step)
+    {
+        const osg::Vec3Array* vertices = static_cast<const osg::Vec3Array*>(geometry.getVertexArray());
+        osg::ref_ptr<osg::Vec3sArray> positions = new osg::Vec3sArray;
+        positions->reserve(vertices->size());
+        osg::BoundingBox bound;
+        for (const osg::Vec3& vertex : *vertices) {
+            const osg::Vec3 scaled = (vertex - center) / step;
+            const osg::Vec3s packed(quantize(scaled.x(), kPositionRange), quantize(scaled.y(), kPositionRange),
+                                    quantize(scaled.z(), kPositionRange));
+            positions->push_back(packed);
+            bound.expandBy(packed.x(), packed.y(), packed.z());
+        }
+        const unsigned int vertexCount = vertices->size();
+        geometry.setVertexArray(positions.get());
+        // 整数位置不参与包围盒计算，用量化坐标下的包围盒代替
+        geometry.setInitialBound(bound);
+
+        if (const osg::Vec3Array* normals = dynamic_cast<const osg::Vec3Array*>(geometry.getNormalArray())) {
+            osg::ref_ptr<osg::Vec3bArray> packed = new osg::Vec3bArray;
+            packed->setBinding(normals->getBinding());
+            packed->setNormalize(true);
+            packed->reserve(normals->size());
+            for (osg::Vec3 normal : *normals) {
+                normal.normalize();
+                packed->push_back(osg::Vec3b(quantize(normal.x() * 127.0f, 127.0f), quantize(normal.y() * 127.0f, 127.0f),
+                                             quantize(normal.z() * 127.0f, 127.0f)));
+            }
+            geometry.setNormalArray(packed.get());
+        }
+
+        if (const osg::Vec4Array* colors = dynamic_cast<const osg::Vec4Array*>(geometry.getColorArray())) {
+            bool inRange = true;
+            for (const osg::Vec4& color : *colors) {
+                for (int c = 0; c < 4 && inRange; ++c) {
+                    inRange = color[c] >= 0.0f && color[c] <= 1.0f;
+                }
+            }
+            if (inRange) {
+                osg::ref_ptr<osg::Vec4ubArray> packed = new osg::Vec4ubArray;
+                packed->setBinding(colors->getBinding());
+                packed->setNormalize(true);
+                packed->reserve(colors->size());
+                for (const osg::Vec4& color : *colors) {
+                    packed->push_back(osg::Vec4ub(static_cast<unsigned char>(std::round(color.r() * 255.0f)),
+                                                  static_cast<unsigned char>(std::round(color.g() * 255.0f)),
+                                                  static_cast<unsigned char>(std::round(color.b() * 255.0f)),
+                                                  static_cast<unsigned char>(std::round(color.a() * 255.0f))));
+                }
+                geometry.setColorArray(packed.get());
+            }
+        }
+
+        if (vertexCount <= 65536) {
+            for (unsigned int i = 0; i < geometry.getNumPrimitiveSets(); ++i) {
+                const osg::PrimitiveSet* primitives = geometry.getPrimitiveSet(i);
+                if (primitives->getType() == osg::PrimitiveSet::DrawElementsUIntPrimitiveType) {
+                    geometry.setPrimitiveSet(i, toUShort(primitives->getDrawElements()).get());
+                }
+            }
+        }
+
+        // 各数组共用同一个顶点缓冲，索引共用同一个索引缓冲
+        geometry.setUseDisplayList(false);
+        geometry.setUseVertexBufferObjects(true);
+    }
+
+    class GeodeCollector : public osg::NodeVisitor
+    {
+    public:
+        GeodeCollector() : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN) {}
+
+        void apply(osg::Geode& geode) override
+        {
+            if (_visited.insert(&geode).second) {
+                geodes.push_back(&geode);
+            }
+        }
+
+        std::vector<osg::ref_ptr<osg::Geode> > geodes;
+
+    private:
+        std::set<const osg::Geode*> _visited;
+    };
+}
+
+GeometryCompaction::Stats GeometryCompaction::compact(osg::ref_ptr<osg::Node>& model)
+{
+    Stats stats;
+    if (!model.valid()) return stats;
+
+    GeodeCollector collector;
+    model->accept(collector);
+
+    for (const osg::ref_ptr<osg::Geode>& geode : collector.geodes) {
+        // 反量化变换作用于整个Geode，其中有任何不能压缩的可绘制对象时整个跳过
+        bool compactable = geode->getNumDrawables() > 0;
+        unsigned int vertexCount = 0;
+        osg::BoundingBox box;
+        for (unsigned int i = 0; i < geode->getNumDrawables() && compactable; ++i) {
+            compactable = isCompactable(geode->getDrawable(i));
+            if (!compactable) break;
+            const osg::Vec3Array* vertices = static_cast<const osg::Vec3Array*>(geode->getDrawable(i)->asGeometry()->getVertexArray());
+            vertexCount += vertices->size();
+            for (const osg::Vec3& vertex : *vertices) {
+                box.expandBy(vertex);
+            }
+        }
+        if (!compactable || vertexCount < kMinVertices || !box.valid()) continue;
+
+        // 三个轴用同一个步长，变换只有均匀缩放，法线方向不受影响
+        const osg::Vec3 center = box.center();
+        const float halfExtent = std::max(box.xMax() - box.xMin(), std::max(box.yMax() - box.yMin(), box.zMax() - box.zMin())) * 0.5f;
+        const float step = halfExtent > 0.0f ? halfExtent / kPositionRange : 1.0f;
+
+        for (unsigned int i = 0; i < geode->getNumDrawables(); ++i) {
+            osg::ref_ptr<osg::Geometry> geometry = geode->getDrawable(i)->asGeometry();
+            if (geometry->getNumParents() > 1) {
+                // 与其他Geode共用的几何体（如各级LOD共用的小几何体）换成浅拷贝，压缩时只替换拷贝上的数组
+                geometry = new osg::Geometry(*geometry);
+                geode->setDrawable(i, geometry.get());
+            }
+            stats.bytesBefore += dataSize(geometry.get());
+            compactGeometry(*geometry, center, step);
+            stats.bytesAfter += dataSize(geometry.get());
+        }
+
+        osg::ref_ptr<osg::MatrixTransform> dequantize =
+            new osg::MatrixTransform(osg::Matrix::scale(step, step, step) * osg::Matrix::translate(center));
+        dequantize->setName(geode->getName());
+        // 8位法线不是严格的单位长度，交给固定管线重新归一化
+        dequantize->getOrCreateStateSet()->setMode(GL_NORMALIZE, osg::StateAttribute::ON);
+
+        const osg::Node::ParentList parents = geode->getParents();
+        dequantize->addChild(geode.get());
+        for (osg::Group* parent : parents) {
+            parent->replaceChild(geode.get(), dequantize.get());
+        }
+        if (model.get() == geode.get()) {
+            model = dequantize;
+        }
+        ++stats.geodes;
+    }
+    return stats;
+}
@@ -0,0 +1,27 @@
+#ifndef GEOMETRYCOMPACTION_H
+#define GEOMETRYCOMPACTION_H
+
+#include <osg/Node>
+#include <osg/ref_ptr>
+#include <cstddef>
+
+// 几何体压缩
+// 每个Geode的顶点位置按其包围盒量化为16位整数，反量化（缩放和平移）放进插在Geode上方的MatrixTransform，
+// 在顶点变换中完成，固定管线和使用gl_Vertex的着色器都不用改；逐顶点法线压为8位、颜色压为8位，
+// 顶点数不超过65536时索引改为16位，各属性共用一个顶点缓冲。
+// 压缩后的几何体不再参与CPU侧的求交（拾取），包围盒由量化时记录的初始包围盒提供
+class GeometryCompaction
+{
+public:
+    struct Stats
+    {
+        unsigned int geodes = 0;
+        std::size_t bytesBefore = 0;
+        std::size_t bytesAfter = 0;
+    };
+
+    // 加载线程调用，模型加入场景之前；model本身就是Geode时换成插入的MatrixTransform
+    static Stats compact(osg::ref_ptr<osg::Node>& model);
+};
+
+#endif // GEOMETRYCOMPACTION_H
@@ -0,0 +1,87 @@
+#include "glstatehandoff.h"
+#include <osg/GLExtensions>
+#include <osg/StateAttribute>
+
+namespace
+{
+    // Qt Quick场景图绘制时会改动的开关
+    const GLenum kQtModes[] = {
+        GL_BLEND,
+        GL_DEPTH_TEST,
+        GL_CULL_FACE,
+        GL_SCISSOR_TEST,
+        GL_STENCIL_TEST
+    };
+
+    // Qt Quick场景图绘制时会改动的状态属性
+    const osg::StateAttribute::Type kQtAttributes[] = {
+        osg::StateAttribute::BLENDFUNC,
+        osg::StateAttribute::BLENDEQUATION,
+        osg::StateAttribute::BLENDCOLOR,
+        osg::StateAttribute::DEPTH,
+        osg::StateAttribute::COLORMASK,
+        osg::StateAttribute::STENCIL,
+        osg::StateAttribute::SCISSOR,
+        osg::StateAttribute::VIEWPORT,
+        osg::StateAttribute::CULLFACE,
+        osg::StateAttribute::FRONTFACE,
+        osg::StateAttribute::PROGRAM
+    };
+
+    // Qt材质使用的纹理单元
+    const unsigned int kQtTextureUnits = 8;
+}
+
+GLStateHandoff::GLStateHandoff()
+    : _fboId(0), _width(0), _height(0)
+{
+}
+
+void GLStateHandoff::setFramebuffer(GLuint fboId, int width, int height)
+{
+    _fboId = fboId;
+    _width = width;
+    _height = height;
+}
+
+void GLStateHandoff::beginFrame(osg::GraphicsContext* gc, bool fullResync)
+{
+    // 渲染到纹理的相机结束后绑回Qt的FBO，而不是窗口的默认帧缓冲
+    gc->setDefaultFboId(_fboId);
+
+    osg::State* state = gc->getState();
+    const osg::GLExtensions* extensions = state->get<osg::GLExtensions>();
+
+    // 活动纹理单元和缓冲绑定没有“未知”状态可标，直接设回上一帧endFrame()后osg::State记录的值
+    extensions->glActiveTexture(GL_TEXTURE0);
+    if (extensions->isVAOSupported) {
+        extensions->glBindVertexArray(0);
+    }
+    extensions->glBindBuffer(GL_ARRAY_BUFFER_ARB, 0);
+    extensions->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+
+    if (fullResync) {
+        state->dirtyAllModes();
+        state->dirtyAllAttributes();
+    } else {
+        for (GLenum mode : kQtModes) {
+            state->haveAppliedMode(mode);
+        }
+        for (osg::StateAttribute::Type type : kQtAttributes) {
+            state->haveAppliedAttribute(type);
+        }
+        for (unsigned int unit = 0; unit < kQtTextureUnits; ++unit) {
+            state->haveAppliedTextureAttribute(unit, osg::StateAttribute::TEXTURE);
+        }
+    }
+    state->dirtyAllVertexArrays();
+    state->setLastAppliedProgramObject(0);
+}
+
+void GLStateHandoff::endFrame(osg::State& state)
+{
+    state.setActiveTextureUnit(0);
+    state.unbindVertexArrayObject();
+    state.unbindVertexBufferObject();
+    state.unbindElementBufferObject();
+}
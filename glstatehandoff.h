@@ -0,0 +1,35 @@
+#ifndef GLSTATEHANDOFF_H
+#define GLSTATEHANDOFF_H
+
+#include <osg/GL>
+#include <osg/GraphicsContext>
+#include <osg/State>
+
+// Qt Quick与OSG之间的GL状态交接
+// FBO的句柄和尺寸在createFramebufferObject()中记录，render()不再向驱动查询视口；
+// 每帧开始时只把Qt场景图会改动的状态在osg::State里标记为未知，由OSG按需重新设置，不手工重置固定管线状态、不额外清屏；
+// 帧结束时把活动纹理单元等OSG缓存但Qt不会恢复的状态归位，保证下一帧osg::State与GL一致
+class GLStateHandoff
+{
+public:
+    GLStateHandoff();
+
+    // 渲染线程，createFramebufferObject()中调用
+    void setFramebuffer(GLuint fboId, int width, int height);
+
+    int width() const { return _width; }
+    int height() const { return _height; }
+    GLuint framebufferId() const { return _fboId; }
+
+    // 渲染线程，OSG绘制之前调用；fullResync为true时（同一上下文里还有其他osg::State绘制过）所有状态都标记为未知
+    void beginFrame(osg::GraphicsContext* gc, bool fullResync);
+    // 渲染线程，OSG绘制之后调用
+    void endFrame(osg::State& state);
+
+private:
+    GLuint _fboId;
+    int _width;
+    int _height;
+};
+
+#endif // GLSTATEHANDOFF_H
@@ -0,0 +1,700 @@
+#include "iblbaker.h"
+#include "logger.h"
+#include <osg/Image>
+#include <osg/Vec2f>
+#include <osg/Vec3f>
+#include <QDir>
+#include <QStandardPaths>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <thread>
+#include <vector>
+
+#ifndef GL_TEXTURE_CUBE_MAP_SEAMLESS
+#define GL_TEXTURE_CUBE_MAP_SEAMLESS 0x884F
+#endif
+#ifndef GL_RG
+#define GL_RG 0x8227
+#endif
+#ifndef GL_RG16F
+#define GL_RG16F 0x822F
+#endif
+#ifndef GL_RGB16F_ARB
+#define GL_RGB16F_ARB 0x881B
+#endif
+
+namespace
+{
+    const float kPi = 3.14159265358979323846f;
+
+    // 烘焙参数，全部参与缓存键，修改后旧缓存自然失效
+    const int kMaxBaseSize = 256;           // 源贴图先按面积平均降到不超过该尺寸
+    const int kMaxPrefilteredSize = 128;    // 预滤波mip链第0级的尺寸
+    const int kMinPrefilteredSize = 4;      // 最粗糙一级的尺寸
+    const int kPrefilterSamples = 128;
+    const int kMaxShSize = 32;              // 投影球谐时使用的mip尺寸上限
+    const int kBrdfLutSize = 128;
+    const int kBrdfSamples = 512;
+
+    // 磁盘缓存文件头
+    const char kMapsMagic[8] = { 'O', 'S', 'G', 'I', 'B', 'L', '0', '1' };
+    const char kBrdfMagic[8] = { 'O', 'S', 'G', 'B', 'R', 'D', 'F', '1' };
+
+    // FNV-1a 64位哈希，跨进程稳定，可作为磁盘文件名
+    uint64_t fnv1a(const void* data, std::size_t size, uint64_t hash = 14695981039346656037ULL)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    std::string toHex(uint64_t value)
+    {
+        char buffer[17];
+        std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(value));
+        return std::string(buffer);
+    }
+
+    std::string bakeParameters()
+    {
+        char buffer[128];
+        std::snprintf(buffer, sizeof(buffer), "%d|%d|%d|%d|%d", kMaxBaseSize, kMaxPrefilteredSize, kMinPrefilteredSize,
+                      kPrefilterSamples, kMaxShSize);
+        return buffer;
+    }
+
+    // 在所有硬件线程上执行fn(0) ~ fn(count - 1)
+    void parallelFor(int count, const std::function<void(int)>& fn)
+    {
+        int threads = std::max(1, std::min(count, static_cast<int>(std::thread::hardware_concurrency())));
+        std::atomic<int> next(0);
+        std::vector<std::future<void>> workers;
+        for (int i = 0; i < threads; ++i) {
+            workers.push_back(std::async(std::launch::async, [&next, &fn, count]() {
+                for (int index = next++; index < count; index = next++) {
+                    fn(index);
+                }
+            }));
+        }
+        for (std::future<void>& worker : workers) {
+            worker.get();
+        }
+    }
+
+    // 立方体贴图的面编号与GL一致：+X, -X, +Y, -Y, +Z, -Z；(u, v)为GL纹理坐标
+    osg::Vec3f faceDirection(int face, float u, float v)
+    {
+        float sc = 2.0f * u - 1.0f;
+        float tc = 2.0f * v - 1.0f;
+        osg::Vec3f dir;
+        switch (face) {
+        case 0: dir.set(1.0f, -tc, -sc); break;
+        case 1: dir.set(-1.0f, -tc, sc); break;
+        case 2: dir.set(sc, 1.0f, tc); break;
+        case 3: dir.set(sc, -1.0f, -tc); break;
+        case 4: dir.set(sc, -tc, 1.0f); break;
+        default: dir.set(-sc, -tc, -1.0f); break;
+        }
+        dir.normalize();
+        return dir;
+    }
+
+    void directionToFace(const osg::Vec3f& dir, int& face, float& u, float& v)
+    {
+        float ax = std::fabs(dir.x());
+        float ay = std::fabs(dir.y());
+        float az = std::fabs(dir.z());
+        float sc, tc, ma;
+        if (ax >= ay && ax >= az) {
+            ma = ax;
+            face = dir.x() > 0.0f ? 0 : 1;
+            sc = dir.x() > 0.0f ? -dir.z() : dir.z();
+            tc = -dir.y();
+        } else if (ay >= az) {
+            ma = ay;
+            face = dir.y() > 0.0f ? 2 : 3;
+            sc = dir.x();
+            tc = dir.y() > 0.0f ? dir.z() : -dir.z();
+        } else {
+            ma = az;
+            face = dir.z() > 0.0f ? 4 : 5;
+            sc = dir.z() > 0.0f ? dir.x() : -dir.x();
+            tc = -dir.y();
+        }
+        u = 0.5f * (sc / ma + 1.0f);
+        v = 0.5f * (tc / ma + 1.0f);
+    }
+
+    // 线性空间的浮点立方体贴图的一级
+    struct CubeLevel
+    {
+        int size = 0;
+        std::vector<osg::Vec3f> faces[6];
+
+        // 面内双线性，边缘夹紧（不跨面过滤）
+        osg::Vec3f sample(const osg::Vec3f& dir) const
+        {
+            int face;
+            float u, v;
+            directionToFace(dir, face, u, v);
+            float x = u * size - 0.5f;
+            float y = v * size - 0.5f;
+            int x0 = static_cast<int>(std::floor(x));
+            int y0 = static_cast<int>(std::floor(y));
+            float fx = x - x0;
+            float fy = y - y0;
+            int x1 = std::min(std::max(x0 + 1, 0), size - 1);
+            int y1 = std::min(std::max(y0 + 1, 0), size - 1);
+            x0 = std::min(std::max(x0, 0), size - 1);
+            y0 = std::min(std::max(y0, 0), size - 1);
+
+            const std::vector<osg::Vec3f>& texels = faces[face];
+            osg::Vec3f bottom = texels[y0 * size + x0] * (1.0f - fx) + texels[y0 * size + x1] * fx;
+            osg::Vec3f top = texels[y1 * size + x0] * (1.0f - fx) + texels[y1 * size + x1] * fx;
+            return bottom * (1.0f - fy) + top * fy;
+        }
+    };
+
+    // 在mip链上三线性采样
+    osg::Vec3f sampleLod(const std::vector<CubeLevel>& mips, const osg::Vec3f& dir, float lod)
+    {
+        float maxLod = static_cast<float>(mips.size() - 1);
+        lod = std::min(std::max(lod, 0.0f), maxLod);
+        int level = static_cast<int>(lod);
+        float t = lod - level;
+        osg::Vec3f color = mips[level].sample(dir);
+        if (t > 0.0f && level + 1 < static_cast<int>(mips.size())) {
+            color = color * (1.0f - t) + mips[level + 1].sample(dir) * t;
+        }
+        return color;
+    }
+
+    void loadBase(osg::TextureCubeMap* source, CubeLevel& base)
+    {
+        const osg::Image* first = source->getImage(0);
+        int sourceSize = first->s();
+        int size = 1;
+        while (size * 2 <= std::min(sourceSize, kMaxBaseSize)) {
+            size *= 2;
+        }
+        base.size = size;
+
+        // 8位图像按sRGB解码到线性空间，浮点图像视为已经是线性的
+        float srgbTable[256];
+        for (int i = 0; i < 256; ++i) {
+            float c = i / 255.0f;
+            srgbTable[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+
+        parallelFor(6, [&](int face) {
+            const osg::Image* image = source->getImage(face);
+            bool srgb = image->getDataType() == GL_UNSIGNED_BYTE;
+            std::vector<osg::Vec3f>& texels = base.faces[face];
+            texels.resize(size * size);
+            for (int y = 0; y < size; ++y) {
+                int t0 = y * sourceSize / size;
+                int t1 = std::max(t0 + 1, (y + 1) * sourceSize / size);
+                for (int x = 0; x < size; ++x) {
+                    int s0 = x * sourceSize / size;
+                    int s1 = std::max(s0 + 1, (x + 1) * sourceSize / size);
+                    osg::Vec3f sum;
+                    for (int t = t0; t < t1; ++t) {
+                        for (int s = s0; s < s1; ++s) {
+                            osg::Vec4 color = image->getColor(s, t);
+                            if (srgb) {
+                                sum += osg::Vec3f(srgbTable[static_cast<int>(color.r() * 255.0f + 0.5f)],
+                                                  srgbTable[static_cast<int>(color.g() * 255.0f + 0.5f)],
+                                                  srgbTable[static_cast<int>(color.b() * 255.0f + 0.5f)]);
+                            } else {
+                                sum += osg::Vec3f(color.r(), color.g(), color.b());
+                            }
+                        }
+                    }
+                    texels[y * size + x] = sum / static_cast<float>((t1 - t0) * (s1 - s0));
+                }
+            }
+        });
+    }
+
+    CubeLevel downsample(const CubeLevel& level)
+    {
+        CubeLevel result;
+        result.size = std::max(1, level.size / 2);
+        for (int face = 0; face < 6; ++face) {
+            const std::vector<osg::Vec3f>& source = level.faces[face];
+            std::vector<osg::Vec3f>& texels = result.faces[face];
+            texels.resize(result.size * result.size);
+            for (int y = 0; y < result.size; ++y) {
+                for (int x = 0; x < result.size; ++x) {
+                    int sx = x * 2;
+                    int sy = y * 2;
+                    texels[y * result.size + x] = (source[sy * level.size + sx] + source[sy * level.size + sx + 1] +
+                                                   source[(sy + 1) * level.size + sx] +
+                                                   source[(sy + 1) * level.size + sx + 1]) * 0.25f;
+                }
+            }
+        }
+        return result;
+    }
+
+    // 实数球谐前3阶的9个基函数
+    void shBasis(const osg::Vec3f& n, float basis[9])
+    {
+        basis[0] = 0.282095f;
+        basis[1] = 0.488603f * n.y();
+        basis[2] = 0.488603f * n.z();
+        basis[3] = 0.488603f * n.x();
+        basis[4] = 1.092548f * n.x() * n.y();
+        basis[5] = 1.092548f * n.y() * n.z();
+        basis[6] = 0.315392f * (3.0f * n.z() * n.z() - 1.0f);
+        basis[7] = 1.092548f * n.x() * n.z();
+        basis[8] = 0.546274f * (n.x() * n.x() - n.y() * n.y());
+    }
+
+    // 按纹素立体角加权投影到球谐，再与余弦核卷积得到辐照度，最后除以π
+    void projectSH(const CubeLevel& level, osg::Vec3f sh[9])
+    {
+        std::vector<osg::Vec3f> partial(6 * 9);
+        float weights[6] = {};
+        parallelFor(6, [&](int face) {
+            float texelArea = 4.0f / (level.size * level.size);
+            float basis[9];
+            for (int y = 0; y < level.size; ++y) {
+                for (int x = 0; x < level.size; ++x) {
+                    float u = (x + 0.5f) / level.size;
+                    float v = (y + 0.5f) / level.size;
+                    float sc = 2.0f * u - 1.0f;
+                    float tc = 2.0f * v - 1.0f;
+                    float r2 = 1.0f + sc * sc + tc * tc;
+                    float solidAngle = texelArea / (r2 * std::sqrt(r2));
+
+                    shBasis(faceDirection(face, u, v), basis);
+                    const osg::Vec3f& color = level.faces[face][y * level.size + x];
+                    for (int i = 0; i < 9; ++i) {
+                        partial[face * 9 + i] += color * (basis[i] * solidAngle);
+                    }
+                    weights[face] += solidAngle;
+                }
+            }
+        });
+
+        float totalWeight = 0.0f;
+        for (float weight : weights) {
+            totalWeight += weight;
+        }
+        const float normalize = 4.0f * kPi / totalWeight;
+        const float band[9] = { kPi, 2.0f * kPi / 3.0f, 2.0f * kPi / 3.0f, 2.0f * kPi / 3.0f,
+                                kPi / 4.0f, kPi / 4.0f, kPi / 4.0f, kPi / 4.0f, kPi / 4.0f };
+        for (int i = 0; i < 9; ++i) {
+            sh[i] = osg::Vec3f();
+            for (int face = 0; face < 6; ++face) {
+                sh[i] += partial[face * 9 + i];
+            }
+            sh[i] *= normalize * band[i] / kPi;
+        }
+    }
+
+    osg::Vec2f hammersley(unsigned int i, unsigned int count)
+    {
+        unsigned int bits = i;
+        bits = (bits << 16u) | (bits >> 16u);
+        bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+        bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+        bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+        bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+        return osg::Vec2f(static_cast<float>(i) / count, bits * 2.3283064365386963e-10f);
+    }
+
+    // 切线空间（法线为+Z）中按GGX分布重要性采样半角向量，a为roughness的平方
+    osg::Vec3f importanceSampleGGX(const osg::Vec2f& xi, float a)
+    {
+        float phi = 2.0f * kPi * xi.x();
+        float cosTheta = std::sqrt((1.0f - xi.y()) / (1.0f + (a * a - 1.0f) * xi.y()));
+        float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+        return osg::Vec3f(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta);
+    }
+
+    // 预滤波的采样方向与法线无关（假设视线=法线），每级粗糙度只算一次
+    struct PrefilterSample
+    {
+        osg::Vec3f direction;   // 切线空间
+        float weight;           // NdotL
+        float lod;              // 按采样立体角选择的源mip级别
+    };
+
+    std::vector<PrefilterSample> prefilterSamples(float roughness, int baseSize)
+    {
+        float a = roughness * roughness;
+        float a2 = a * a;
+        float texelSolidAngle = 4.0f * kPi / (6.0f * baseSize * baseSize);
+
+        std::vector<PrefilterSample> samples;
+        for (int i = 0; i < kPrefilterSamples; ++i) {
+            osg::Vec3f h = importanceSampleGGX(hammersley(i, kPrefilterSamples), a);
+            float NdotH = h.z();
+            osg::Vec3f l = h * (2.0f * NdotH) - osg::Vec3f(0.0f, 0.0f, 1.0f);
+            if (l.z() <= 0.0f) continue;
+
+            // 视线等于法线时pdf = D / 4
+            float d = NdotH * NdotH * (a2 - 1.0f) + 1.0f;
+            float pdf = a2 / (kPi * d * d) * 0.25f;
+            float sampleSolidAngle = 1.0f / (kPrefilterSamples * pdf + 1e-4f);
+            float lod = std::max(0.0f, 0.5f * std::log2(sampleSolidAngle / texelSolidAngle) + 1.0f);
+            samples.push_back({ l, l.z(), lod });
+        }
+        return samples;
+    }
+
+    void prefilterFace(const std::vector<CubeLevel>& mips, const std::vector<PrefilterSample>& samples,
+                       int face, CubeLevel& output)
+    {
+        std::vector<osg::Vec3f>& texels = output.faces[face];
+        texels.resize(output.size * output.size);
+        for (int y = 0; y < output.size; ++y) {
+            for (int x = 0; x < output.size; ++x) {
+                osg::Vec3f n = faceDirection(face, (x + 0.5f) / output.size, (y + 0.5f) / output.size);
+                osg::Vec3f up = std::fabs(n.z()) < 0.999f ? osg::Vec3f(0.0f, 0.0f, 1.0f) : osg::Vec3f(1.0f, 0.0f, 0.0f);
+                osg::Vec3f tangent = up ^ n;
+                tangent.normalize();
+                osg::Vec3f bitangent = n ^ tangent;
+
+                osg::Vec3f sum;
+                float weight = 0.0f;
+                for (const PrefilterSample& sample : samples) {
+                    osg::Vec3f l = tangent * sample.direction.x() + bitangent * sample.direction.y() +
+                                   n * sample.direction.z();
+                    sum += sampleLod(mips, l, sample.lod) * sample.weight;
+                    weight += sample.weight;
+                }
+                texels[y * output.size + x] = weight > 0.0f ? sum / weight : mips[0].sample(n);
+            }
+        }
+    }
+
+    // split-sum的第二项：对(NdotV, roughness)积分得到F0的缩放和偏移
+    std::vector<osg::Vec2f> integrateBrdf()
+    {
+        std::vector<osg::Vec2f> lut(kBrdfLutSize * kBrdfLutSize);
+        parallelFor(kBrdfLutSize, [&lut](int y) {
+            float roughness = (y + 0.5f) / kBrdfLutSize;
+            float a = roughness * roughness;
+            float k = a / 2.0f;
+            for (int x = 0; x < kBrdfLutSize; ++x) {
+                float NdotV = (x + 0.5f) / kBrdfLutSize;
+                osg::Vec3f v(std::sqrt(1.0f - NdotV * NdotV), 0.0f, NdotV);
+                float scale = 0.0f;
+                float bias = 0.0f;
+                for (int i = 0; i < kBrdfSamples; ++i) {
+                    osg::Vec3f h = importanceSampleGGX(hammersley(i, kBrdfSamples), a);
+                    float VdotH = v * h;
+                    osg::Vec3f l = h * (2.0f * VdotH) - v;
+                    float NdotL = l.z();
+                    float NdotH = h.z();
+                    if (NdotL <= 0.0f) continue;
+
+                    float g = (NdotV / (NdotV * (1.0f - k) + k)) * (NdotL / (NdotL * (1.0f - k) + k));
+                    float gVis = g * std::max(VdotH, 0.0f) / (NdotH * NdotV);
+                    float fc = std::pow(1.0f - std::max(VdotH, 0.0f), 5.0f);
+                    scale += (1.0f - fc) * gVis;
+                    bias += fc * gVis;
+                }
+                lut[y * kBrdfLutSize + x] = osg::Vec2f(scale, bias) / static_cast<float>(kBrdfSamples);
+            }
+        });
+        return lut;
+    }
+
+    bool readMaps(const std::string& path, std::vector<CubeLevel>& levels, osg::Vec3f sh[9])
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return false;
+
+        char magic[sizeof(kMapsMagic)];
+        uint32_t size = 0;
+        uint32_t count = 0;
+        file.read(magic, sizeof(magic));
+        file.read(reinterpret_cast<char*>(&size), sizeof(size));
+        file.read(reinterpret_cast<char*>(&count), sizeof(count));
+        if (!file || !std::equal(magic, magic + sizeof(magic), kMapsMagic) || size == 0 || size > 4096 ||
+            count == 0 || (size >> (count - 1)) == 0) {
+            return false;
+        }
+        file.read(reinterpret_cast<char*>(sh), sizeof(osg::Vec3f) * 9);
+
+        levels.assign(count, CubeLevel());
+        for (uint32_t i = 0; i < count; ++i) {
+            levels[i].size = static_cast<int>(size >> i);
+            for (int face = 0; face < 6; ++face) {
+                levels[i].faces[face].resize(levels[i].size * levels[i].size);
+                file.read(reinterpret_cast<char*>(levels[i].faces[face].data()),
+                          levels[i].faces[face].size() * sizeof(osg::Vec3f));
+            }
+        }
+        return static_cast<bool>(file);
+    }
+
+    void writeMaps(const std::string& path, const std::vector<CubeLevel>& levels, const osg::Vec3f sh[9])
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            LOG_WARNING("iblbaker", "cannot write path=%s", path.c_str());
+            return;
+        }
+        uint32_t size = static_cast<uint32_t>(levels[0].size);
+        uint32_t count = static_cast<uint32_t>(levels.size());
+        file.write(kMapsMagic, sizeof(kMapsMagic));
+        file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        file.write(reinterpret_cast<const char*>(sh), sizeof(osg::Vec3f) * 9);
+        for (const CubeLevel& level : levels) {
+            for (int face = 0; face < 6; ++face) {
+                file.write(reinterpret_cast<const char*>(level.faces[face].data()),
+                           level.faces[face].size() * sizeof(osg::Vec3f));
+            }
+        }
+    }
+
+    // 一个面的所有mip级别放进同一个Image，OSG上传时逐级提交
+    osg::Image* createFaceImage(const std::vector<CubeLevel>& levels, int face)
+    {
+        std::size_t total = 0;
+        for (const CubeLevel& level : levels) {
+            total += level.faces[face].size();
+        }
+        unsigned char* data = new unsigned char[total * sizeof(osg::Vec3f)];
+
+        osg::Image::MipmapDataType offsets;
+        std::size_t offset = 0;
+        for (std::size_t i = 0; i < levels.size(); ++i) {
+            if (i > 0) {
+                offsets.push_back(static_cast<unsigned int>(offset));
+            }
+            std::size_t bytes = levels[i].faces[face].size() * sizeof(osg::Vec3f);
+            std::copy(reinterpret_cast<const unsigned char*>(levels[i].faces[face].data()),
+                      reinterpret_cast<const unsigned char*>(levels[i].faces[face].data()) + bytes, data + offset);
+            offset += bytes;
+        }
+
+        osg::Image* image = new osg::Image;
+        image->setImage(levels[0].size, levels[0].size, 1, GL_RGB16F_ARB, GL_RGB, GL_FLOAT, data,
+                        osg::Image::USE_NEW_DELETE);
+        image->setMipmapLevels(offsets);
+        return image;
+    }
+
+    osg::TextureCubeMap* createPrefilteredTexture(const std::vector<CubeLevel>& levels)
+    {
+        osg::TextureCubeMap* texture = new osg::TextureCubeMap;
+        for (int face = 0; face < 6; ++face) {
+            texture->setImage(face, createFaceImage(levels, face));
+        }
+        texture->setInternalFormat(GL_RGB16F_ARB);
+        texture->setResizeNonPowerOfTwoHint(false);
+        texture->setUseHardwareMipMapGeneration(false);
+        texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+        texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+        texture->setWrap(osg::Texture::WRAP_R, osg::Texture::CLAMP_TO_EDGE);
+        texture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::LINEAR_MIPMAP_LINEAR);
+        texture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::LINEAR);
+        return texture;
+    }
+}
+
+IBLBaker& IBLBaker::instance()
+{
+    static IBLBaker baker;
+    return baker;
+}
+
+IBLBaker::IBLBaker()
+{
+    QString baseDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (baseDir.isEmpty()) {
+        baseDir = QDir::currentPath();
+    }
+    QString dir = baseDir + "/ibl_cache";
+    if (QDir().mkpath(dir)) {
+        _cacheDirectory = dir.toStdString();
+    } else {
+        LOG_WARNING("iblbaker", "cannot create cache directory dir=%s", qPrintable(dir));
+    }
+}
+
+std::string IBLBaker::cachePath(const std::string& name) const
+{
+    return _cacheDirectory.empty() ? std::string() : _cacheDirectory + "/" + name;
+}
+
+osg::Texture2D* IBLBaker::brdfLut()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return getBrdfLut();
+}
+
+osg::Texture2D* IBLBaker::getBrdfLut()
+{
+    if (_brdfLut.valid()) return _brdfLut.get();
+
+    char parameters[64];
+    std::snprintf(parameters, sizeof(parameters), "%d|%d", kBrdfLutSize, kBrdfSamples);
+    const std::string path = cachePath("brdf_" + toHex(fnv1a(parameters, std::strlen(parameters))) + ".bin");
+
+    std::vector<osg::Vec2f> lut;
+    if (!path.empty()) {
+        std::ifstream file(path, std::ios::binary);
+        char magic[sizeof(kBrdfMagic)];
+        file.read(magic, sizeof(magic));
+        if (file && std::equal(magic, magic + sizeof(magic), kBrdfMagic)) {
+            lut.resize(kBrdfLutSize * kBrdfLutSize);
+            file.read(reinterpret_cast<char*>(lut.data()), lut.size() * sizeof(osg::Vec2f));
+            if (!file) {
+                lut.clear();
+            }
+        }
+    }
+    if (lut.empty()) {
+        lut = integrateBrdf();
+        if (!path.empty()) {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(kBrdfMagic, sizeof(kBrdfMagic));
+            file.write(reinterpret_cast<const char*>(lut.data()), lut.size() * sizeof(osg::Vec2f));
+        }
+    }
+
+    unsigned char* data = new unsigned char[lut.size() * sizeof(osg::Vec2f)];
+    std::copy(reinterpret_cast<const unsigned char*>(lut.data()),
+              reinterpret_cast<const unsigned char*>(lut.data()) + lut.size() * sizeof(osg::Vec2f), data);
+    osg::ref_ptr<osg::Image> image = new osg::Image;
+    image->setImage(kBrdfLutSize, kBrdfLutSize, 1, GL_RG16F, GL_RG, GL_FLOAT, data, osg::Image::USE_NEW_DELETE);
+
+    _brdfLut = new osg::Texture2D(image.get());
+    _brdfLut->setInternalFormat(GL_RG16F);
+    _brdfLut->setResizeNonPowerOfTwoHint(false);
+    _brdfLut->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+    _brdfLut->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+    _brdfLut->setFilter(osg::Texture::MIN_FILTER, osg::Texture::LINEAR);
+    _brdfLut->setFilter(osg::Texture::MAG_FILTER, osg::Texture::LINEAR);
+    return _brdfLut.get();
+}
+
+IBLBaker::Maps IBLBaker::bake(osg::TextureCubeMap* source)
+{
+    Maps maps;
+    if (!source) return maps;
+
+    // 6个面必须都在内存中且为同样大小的正方形
+    const osg::Image* first = source->getImage(0);
+    for (int face = 0; face < 6; ++face) {
+        const osg::Image* image = source->getImage(face);
+        if (!image || !image->data() || image->s() != image->t() || !first || image->s() != first->s()) {
+            LOG_WARNING("iblbaker", "cubemap faces are missing or not square");
+            return maps;
+        }
+    }
+
+    const std::string parameters = bakeParameters();
+    uint64_t hash = fnv1a(parameters.data(), parameters.size());
+    for (int face = 0; face < 6; ++face) {
+        const osg::Image* image = source->getImage(face);
+        const int header[4] = { image->s(), image->t(), static_cast<int>(image->getPixelFormat()),
+                                static_cast<int>(image->getDataType()) };
+        hash = fnv1a(header, sizeof(header), hash);
+        hash = fnv1a(image->data(), image->getTotalSizeInBytes(), hash);
+    }
+    const std::string key = toHex(hash);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _maps.find(key);
+    if (it != _maps.end()) {
+        return it->second;
+    }
+
+    std::vector<CubeLevel> prefiltered;
+    osg::Vec3f sh[9];
+    const std::string path = cachePath(key + ".ibl");
+    if (path.empty() || !readMaps(path, prefiltered, sh)) {
+        auto start = std::chrono::steady_clock::now();
+
+        // 源贴图的mip链，预滤波时按采样立体角选级别
+        std::vector<CubeLevel> mips(1);
+        loadBase(source, mips[0]);
+        while (mips.back().size > 1) {
+            mips.push_back(downsample(mips.back()));
+        }
+
+        const CubeLevel* shLevel = &mips[0];
+        for (const CubeLevel& level : mips) {
+            if (level.size <= kMaxShSize) {
+                shLevel = &level;
+                break;
+            }
+        }
+        projectSH(*shLevel, sh);
+
+        // 第0级粗糙度为0，直接取同尺寸的源mip；其余各级每个面一个任务
+        int size = std::min(mips[0].size, kMaxPrefilteredSize);
+        int levelCount = 1;
+        while ((size >> levelCount) >= kMinPrefilteredSize) {
+            ++levelCount;
+        }
+        prefiltered.assign(levelCount, CubeLevel());
+        for (const CubeLevel& level : mips) {
+            if (level.size == size) {
+                prefiltered[0] = level;
+                break;
+            }
+        }
+
+        std::vector<std::vector<PrefilterSample>> samples(levelCount);
+        for (int i = 1; i < levelCount; ++i) {
+            prefiltered[i].size = size >> i;
+            samples[i] = prefilterSamples(static_cast<float>(i) / (levelCount - 1), mips[0].size);
+        }
+        parallelFor((levelCount - 1) * 6, [&](int task) {
+            int level = task / 6 + 1;
+            prefilterFace(mips, samples[level], task % 6, prefiltered[level]);
+        });
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        LOG_INFO("iblbaker", "baked key=%s ms=%lld", key.c_str(), static_cast<long long>(elapsed.count()));
+        if (!path.empty()) {
+            writeMaps(path, prefiltered, sh);
+        }
+    }
+
+    maps.irradianceSH = new osg::Uniform(osg::Uniform::FLOAT_VEC3, "irradianceSH", 9);
+    for (int i = 0; i < 9; ++i) {
+        maps.irradianceSH->setElement(i, sh[i]);
+    }
+    maps.prefiltered = createPrefilteredTexture(prefiltered);
+    maps.maxLod = static_cast<float>(prefiltered.size() - 1);
+    maps.brdfLut = getBrdfLut();
+
+    _maps[key] = maps;
+    return maps;
+}
+
+void IBLBaker::apply(osg::StateSet* stateSet, const Maps& maps)
+{
+    if (!stateSet || !maps.valid()) return;
+
+    stateSet->setTextureAttributeAndModes(kPrefilteredUnit, maps.prefiltered.get(), osg::StateAttribute::ON);
+    stateSet->setTextureAttributeAndModes(kBrdfLutUnit, maps.brdfLut.get(), osg::StateAttribute::ON);
+    stateSet->addUniform(new osg::Uniform("prefilteredMap", static_cast<int>(kPrefilteredUnit)));
+    stateSet->addUniform(new osg::Uniform("brdfLut", static_cast<int>(kBrdfLutUnit)));
+    stateSet->addUniform(new osg::Uniform("prefilteredMaxLod", maps.maxLod));
+    stateSet->addUniform(maps.irradianceSH.get());
+    // 粗糙的mip只有几个纹素，需要跨面过滤
+    stateSet->setMode(GL_TEXTURE_CUBE_MAP_SEAMLESS, osg::StateAttribute::ON);
+}
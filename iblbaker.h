@@ -0,0 +1,62 @@
+#ifndef IBLBAKER_H
+#define IBLBAKER_H
+
+#include <osg/StateSet>
+#include <osg/Texture2D>
+#include <osg/TextureCubeMap>
+#include <osg/Uniform>
+#include <osg/ref_ptr>
+#include <map>
+#include <mutex>
+#include <string>
+
+// 基于图像的光照（IBL）预计算
+// 在CPU上多线程烘焙三样东西：
+//   漫反射：9个系数的球谐辐照度，系数已含余弦卷积和1/π，着色器里乘基础色即可
+//   镜面反射：GGX预滤波的立方体贴图mip链，第i级对应粗糙度 i / maxLod
+//   BRDF积分表：split-sum近似中与环境无关的(F0缩放, 偏移)，所有环境共用
+// 结果按立方体贴图内容的哈希写入磁盘缓存，相同的天空盒下次启动直接读取
+class IBLBaker
+{
+public:
+    struct Maps
+    {
+        osg::ref_ptr<osg::Uniform> irradianceSH;
+        osg::ref_ptr<osg::TextureCubeMap> prefiltered;
+        osg::ref_ptr<osg::Texture2D> brdfLut;
+        float maxLod = 0.0f;
+
+        bool valid() const { return irradianceSH.valid() && prefiltered.valid() && brdfLut.valid(); }
+    };
+
+    // 预滤波贴图和BRDF表使用的纹理单元
+    static const unsigned int kPrefilteredUnit = 1;
+    static const unsigned int kBrdfLutUnit = 2;
+
+    static IBLBaker& instance();
+
+    // 任意线程调用（通常在场景构建线程上），阻塞到烘焙完成；立方体贴图6个面的图像必须还在内存中
+    Maps bake(osg::TextureCubeMap* source);
+
+    // 把烘焙结果绑定到StateSet，配合ShaderPBR::createPBRShaderBakedIBL使用
+    static void apply(osg::StateSet* stateSet, const Maps& maps);
+
+    // 任意线程调用，BRDF积分表与环境无关，实时捕获的环境（见EnvironmentCapture）也共用这一张
+    osg::Texture2D* brdfLut();
+
+private:
+    IBLBaker();
+    IBLBaker(const IBLBaker&) = delete;
+    IBLBaker& operator=(const IBLBaker&) = delete;
+
+    osg::Texture2D* getBrdfLut();
+    std::string cachePath(const std::string& name) const;
+
+    // 同一时间只烘焙一个环境，烘焙内部按硬件线程数并行
+    std::mutex _mutex;
+    std::map<std::string, Maps> _maps;
+    osg::ref_ptr<osg::Texture2D> _brdfLut;
+    std::string _cacheDirectory;
+};
+
+#endif // IBLBAKER_H
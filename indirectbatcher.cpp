@@ -0,0 +1,495 @@
+#include "indirectbatcher.h"
+#include <osg/buffered_value>
+#include <osg/Camera>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/GLExtensions>
+#include <osg/MatrixTransform>
+#include <osg/observer_ptr>
+#include <osg/Polytope>
+#include <osg/PrimitiveSetIndirect>
+#include <osg/State>
+#include <osg/TriangleIndexFunctor>
+#include <osg/VertexArrayState>
+#include <map>
+#include <mutex>
+#include <typeinfo>
+#include <vector>
+
+namespace
+{
+    // 合批需要的顶点格式：位置必有，法线、颜色、0号纹理坐标可选
+    struct Layout
+    {
+        bool normals = false;
+        bool colors = false;
+        bool texCoords = false;
+
+        bool operator<(const Layout& other) const
+        {
+            if (normals != other.normals) return normals < other.normals;
+            if (colors != other.colors) return colors < other.colors;
+            return texCoords < other.texCoords;
+        }
+    };
+
+    // 命令数组在共享的场景里只读；每个视图（上下文 + 相机）绘制时改用自己的命令缓冲，
+    // 由CullingDrawCallback在调用drawImplementation前放进当前上下文的槽位
+    class PerViewDrawElementsIndirect : public osg::MultiDrawElementsIndirectUInt
+    {
+    public:
+        PerViewDrawElementsIndirect() : osg::MultiDrawElementsIndirectUInt(GL_TRIANGLES) {}
+
+        void setViewCommands(unsigned int contextID, const osg::IndirectCommandDrawElements* commands) const
+        {
+            _viewCommands[contextID] = commands;
+        }
+
+        void draw(osg::State& state, bool useVertexBufferObjects) const override
+        {
+            const unsigned int contextID = state.getContextID();
+            const osg::IndirectCommandDrawElements* commands = _viewCommands[contextID];
+            if (!commands) {
+                osg::MultiDrawElementsIndirectUInt::draw(state, useVertexBufferObjects);
+                return;
+            }
+
+            osg::GLBufferObject* dibo = commands->getBufferObject()->getOrCreateGLBufferObject(contextID);
+            state.bindDrawIndirectBufferObject(dibo);
+            osg::GLBufferObject* ebo = getOrCreateGLBufferObject(contextID);
+            state.getCurrentVertexArrayState()->bindElementBufferObject(ebo);
+            state.get<osg::GLExtensions>()->glMultiDrawElementsIndirect(_mode, GL_UNSIGNED_INT,
+                (const GLvoid*)(dibo->getOffset(commands->getBufferIndex())),
+                commands->getNumElements(), sizeof(osg::DrawElementsIndirectCommand));
+        }
+
+    private:
+        // 按contextID预分配，各上下文只写自己的槽位
+        mutable osg::buffered_value<const osg::IndirectCommandDrawElements*> _viewCommands;
+    };
+
+    // 批次中每条命令的来源，挂在合并后几何体的UserData上；拆出的命令不再绘制，也不再参与求交
+    class BatchSources : public osg::Referenced
+    {
+    public:
+        struct Source
+        {
+            osg::ref_ptr<osg::Geometry> geometry;
+            osg::ref_ptr<osg::Geode> geode;
+            unsigned int firstVertex = 0;
+            unsigned int numVertices = 0;
+        };
+
+        BatchSources(const std::vector<Source>& sources, osg::DefaultIndirectCommandDrawElements* commands)
+            : _sources(sources), _detached(sources.size()), _commands(commands)
+        {
+            for (std::atomic<bool>& detached : _detached) {
+                detached = false;
+            }
+        }
+
+        bool isDetached(std::size_t i) const { return _detached[i]; }
+
+        // 合并后的顶点下标所属的命令，没有时返回-1
+        int find(unsigned int vertex) const
+        {
+            for (std::size_t i = 0; i < _sources.size(); ++i) {
+                if (vertex >= _sources[i].firstVertex && vertex < _sources[i].firstVertex + _sources[i].numVertices) {
+                    return static_cast<int>(i);
+                }
+            }
+            return -1;
+        }
+
+        osg::Geometry* detach(std::size_t i)
+        {
+            const Source& source = _sources[i];
+            if (!_detached[i].exchange(true)) {
+                // 共享命令数组只供CPU求交和没有视图副本时的绘制使用，清零后不会再命中这部分三角形
+                (*_commands)[i].count = 0;
+                _commands->dirty();
+                source.geode->addDrawable(source.geometry.get());
+            }
+            return source.geometry.get();
+        }
+
+    private:
+        std::vector<Source> _sources;
+        std::vector<std::atomic<bool> > _detached;
+        osg::ref_ptr<osg::DefaultIndirectCommandDrawElements> _commands;
+    };
+
+    // 每条命令对应一个原几何体，绘制前用各自在模型坐标下的包围球做视锥测试；
+    // 结果写进该视图自己的命令副本，只在该视图的可见集合变化时重新上传。
+    // 视图随相机销毁而清除（作为相机的Observer）
+    class CullingDrawCallback : public osg::Drawable::DrawCallback, public osg::Observer
+    {
+    public:
+        CullingDrawCallback(PerViewDrawElementsIndirect* elements, const osg::DefaultIndirectCommandDrawElements* commands,
+                            const std::vector<osg::BoundingSphere>& bounds, const BatchSources* sources)
+            : _elements(elements), _commands(commands), _bounds(bounds), _sources(sources) {}
+
+        void objectDeleted(void* object) override
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (auto it = _views.begin(); it != _views.end();) {
+                // object是相机的Referenced子对象地址
+                if (static_cast<const osg::Referenced*>(it->first.second) == object) {
+                    it = _views.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        void drawImplementation(osg::RenderInfo& renderInfo, const osg::Drawable* drawable) const override
+        {
+            const osg::State& state = *renderInfo.getState();
+            osg::Polytope frustum;
+            frustum.setToUnitFrustum();
+            frustum.transformProvidingInverse(state.getModelViewMatrix() * state.getProjectionMatrix());
+
+            osg::DefaultIndirectCommandDrawElements* commands = viewCommands(state.getContextID(), renderInfo.getCurrentCamera());
+            bool changed = false;
+            bool anyVisible = false;
+            for (std::size_t i = 0; i < _bounds.size(); ++i) {
+                const unsigned int instances = !_sources->isDetached(i) && frustum.contains(_bounds[i]) ? 1u : 0u;
+                osg::DrawElementsIndirectCommand& command = (*commands)[i];
+                if (command.instanceCount != instances) {
+                    command.instanceCount = instances;
+                    changed = true;
+                }
+                anyVisible = anyVisible || instances != 0;
+            }
+            if (!anyVisible) return;
+            if (changed) {
+                commands->dirty();
+            }
+
+            _elements->setViewCommands(state.getContextID(), commands);
+            drawable->drawImplementation(renderInfo);
+            _elements->setViewCommands(state.getContextID(), nullptr);
+        }
+
+    protected:
+        ~CullingDrawCallback()
+        {
+            for (auto& entry : _views) {
+                osg::ref_ptr<const osg::Camera> camera;
+                if (entry.second.camera.lock(camera)) {
+                    camera->removeObserver(this);
+                }
+            }
+        }
+
+    private:
+        typedef std::pair<unsigned int, const osg::Camera*> ViewKey;
+        struct View
+        {
+            osg::observer_ptr<const osg::Camera> camera;
+            osg::ref_ptr<osg::DefaultIndirectCommandDrawElements> commands;
+        };
+
+        // 各上下文的绘制线程可能同时查找，表本身加锁；命令副本只被所属视图的绘制线程修改
+        osg::DefaultIndirectCommandDrawElements* viewCommands(unsigned int contextID, const osg::Camera* camera) const
+        {
+            osg::DefaultIndirectCommandDrawElements* commands = nullptr;
+            bool created = false;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                View& view = _views[ViewKey(contextID, camera)];
+                if (!view.commands.valid()) {
+                    // 首次出现的视图从共享命令复制一份
+                    view.camera = camera;
+                    view.commands = new osg::DefaultIndirectCommandDrawElements;
+                    view.commands->setBufferObject(new osg::DrawIndirectBufferObject);
+                    for (const osg::DrawElementsIndirectCommand& command : *_commands) {
+                        view.commands->push_back(command);
+                    }
+                    created = true;
+                }
+                commands = view.commands.get();
+            }
+            // 相机删除时先锁它的观察者集合再回调objectDeleted，这里在_mutex之外注册以免反序加锁
+            if (created && camera) {
+                camera->addObserver(this);
+            }
+            return commands;
+        }
+
+        osg::ref_ptr<PerViewDrawElementsIndirect> _elements;
+        osg::ref_ptr<const osg::DefaultIndirectCommandDrawElements> _commands;
+        std::vector<osg::BoundingSphere> _bounds;
+        osg::ref_ptr<const BatchSources> _sources;
+        mutable std::mutex _mutex;
+        mutable std::map<ViewKey, View> _views;
+    };
+
+    struct IndexCollector
+    {
+        std::vector<GLuint>* indices = nullptr;
+        GLuint base = 0;
+
+        void operator()(unsigned int p1, unsigned int p2, unsigned int p3)
+        {
+            indices->push_back(base + p1);
+            indices->push_back(base + p2);
+            indices->push_back(base + p3);
+        }
+    };
+
+    bool isPerVertexOrOverall(const osg::Array* array)
+    {
+        return array->getBinding() == osg::Array::BIND_PER_VERTEX || array->getBinding() == osg::Array::BIND_OVERALL;
+    }
+
+    // 只合并普通的静态三角形几何体，layout返回其顶点格式
+    bool isBatchable(const osg::Drawable* drawable, Layout& layout)
+    {
+        if (typeid(*drawable) != typeid(osg::Geometry)) return false;
+        const osg::Geometry* geometry = static_cast<const osg::Geometry*>(drawable);
+        if (geometry->getDataVariance() == osg::Object::DYNAMIC || geometry->getNumParents() != 1 ||
+            geometry->getDrawCallback() || geometry->getCullCallback() || geometry->getUpdateCallback() || geometry->getEventCallback()) {
+            return false;
+        }
+
+        const osg::Vec3Array* vertices = dynamic_cast<const osg::Vec3Array*>(geometry->getVertexArray());
+        if (!vertices || vertices->empty() || geometry->getSecondaryColorArray() || geometry->getFogCoordArray()) return false;
+        for (unsigned int i = 0; i < geometry->getNumVertexAttribArrays(); ++i) {
+            if (geometry->getVertexAttribArray(i)) return false;
+        }
+        for (unsigned int unit = 1; unit < geometry->getNumTexCoordArrays(); ++unit) {
+            if (geometry->getTexCoordArray(unit)) return false;
+        }
+
+        const osg::Array* normals = geometry->getNormalArray();
+        if (normals && (!dynamic_cast<const osg::Vec3Array*>(normals) || !isPerVertexOrOverall(normals))) return false;
+        const osg::Array* colors = geometry->getColorArray();
+        if (colors && (!dynamic_cast<const osg::Vec4Array*>(colors) || !isPerVertexOrOverall(colors))) return false;
+        const osg::Array* texCoords = geometry->getTexCoordArray(0);
+        if (texCoords && (!dynamic_cast<const osg::Vec2Array*>(texCoords) || texCoords->getBinding() != osg::Array::BIND_PER_VERTEX)) return false;
+
+        if (geometry->getNumPrimitiveSets() == 0) return false;
+        for (unsigned int i = 0; i < geometry->getNumPrimitiveSets(); ++i) {
+            if (geometry->getPrimitiveSet(i)->getMode() < GL_TRIANGLES) return false;
+        }
+
+        layout.normals = normals != nullptr;
+        layout.colors = colors != nullptr;
+        layout.texCoords = texCoords != nullptr;
+        return true;
+    }
+
+    struct Piece
+    {
+        osg::ref_ptr<osg::Geometry> geometry;
+        osg::ref_ptr<osg::Geode> geode;
+        osg::Matrix matrix;
+    };
+
+    // 渲染状态按从根到几何体路径上的StateSet序列区分，顶点格式不同的不能放进同一组缓冲
+    typedef std::pair<std::vector<const osg::StateSet*>, Layout> BatchKey;
+    typedef std::map<BatchKey, std::vector<Piece> > BatchMap;
+
+    void collect(osg::Node* node, const osg::Matrix& matrix, std::vector<const osg::StateSet*>& states, BatchMap& batches, bool root)
+    {
+        if ((!root && node->getNumParents() != 1) || node->getNodeMask() != ~0u || node->getUpdateCallback() ||
+            node->getEventCallback() || node->getCullCallback()) {
+            return;
+        }
+
+        // LOD、Switch、遮挡查询等会在裁剪时选择子节点，其下的几何体不能合并
+        const std::type_info& type = typeid(*node);
+        osg::Matrix childMatrix = matrix;
+        if (type == typeid(osg::MatrixTransform)) {
+            const osg::MatrixTransform* transform = static_cast<const osg::MatrixTransform*>(node);
+            if (transform->getReferenceFrame() != osg::Transform::RELATIVE_RF) return;
+            childMatrix = transform->getMatrix() * matrix;
+        } else if (type != typeid(osg::Group) && type != typeid(osg::Geode)) {
+            return;
+        }
+
+        if (node->getStateSet()) {
+            states.push_back(node->getStateSet());
+        }
+
+        if (type == typeid(osg::Geode)) {
+            osg::Geode* geode = static_cast<osg::Geode*>(node);
+            for (unsigned int i = 0; i < geode->getNumDrawables(); ++i) {
+                osg::Drawable* drawable = geode->getDrawable(i);
+                Layout layout;
+                if (!isBatchable(drawable, layout)) continue;
+
+                std::vector<const osg::StateSet*> drawableStates = states;
+                if (drawable->getStateSet()) {
+                    drawableStates.push_back(drawable->getStateSet());
+                }
+                Piece piece;
+                piece.geometry = drawable->asGeometry();
+                piece.geode = geode;
+                piece.matrix = childMatrix;
+                batches[BatchKey(drawableStates, layout)].push_back(piece);
+            }
+        } else {
+            osg::Group* group = node->asGroup();
+            for (unsigned int i = 0; i < group->getNumChildren(); ++i) {
+                collect(group->getChild(i), childMatrix, states, batches, false);
+            }
+        }
+
+        if (node->getStateSet()) {
+            states.pop_back();
+        }
+    }
+
+    // 把pieces合并成一个几何体，顶点、索引和命令各放在一个缓冲里
+    osg::ref_ptr<osg::Geode> buildBatch(const std::vector<const osg::StateSet*>& states, const Layout& layout,
+                                        const std::vector<Piece>& pieces)
+    {
+        osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+        osg::ref_ptr<osg::Vec3Array> normals = layout.normals ? new osg::Vec3Array(osg::Array::BIND_PER_VERTEX) : nullptr;
+        osg::ref_ptr<osg::Vec4Array> colors = layout.colors ? new osg::Vec4Array(osg::Array::BIND_PER_VERTEX) : nullptr;
+        osg::ref_ptr<osg::Vec2Array> texCoords = layout.texCoords ? new osg::Vec2Array(osg::Array::BIND_PER_VERTEX) : nullptr;
+        osg::ref_ptr<PerViewDrawElementsIndirect> elements = new PerViewDrawElementsIndirect;
+        osg::ref_ptr<osg::DefaultIndirectCommandDrawElements> commands = new osg::DefaultIndirectCommandDrawElements;
+        std::vector<osg::BoundingSphere> bounds;
+        std::vector<BatchSources::Source> sources;
+
+        for (const Piece& piece : pieces) {
+            const osg::Geometry* geometry = piece.geometry.get();
+            const osg::Vec3Array* sourceVertices = static_cast<const osg::Vec3Array*>(geometry->getVertexArray());
+            const GLuint base = static_cast<GLuint>(vertices->size());
+            const osg::Matrix inverse = osg::Matrix::inverse(piece.matrix);
+
+            // 变换烘焙进顶点；法线按逆转置变换
+            osg::BoundingSphere bound;
+            for (const osg::Vec3& vertex : *sourceVertices) {
+                vertices->push_back(vertex * piece.matrix);
+            }
+            for (std::size_t i = base; i < vertices->size(); ++i) {
+                bound.expandBy((*vertices)[i]);
+            }
+            if (normals.valid()) {
+                const osg::Vec3Array* sourceNormals = static_cast<const osg::Vec3Array*>(geometry->getNormalArray());
+                for (std::size_t i = 0; i < sourceVertices->size(); ++i) {
+                    const osg::Vec3& normal = sourceNormals->getBinding() == osg::Array::BIND_OVERALL ? sourceNormals->front() : (*sourceNormals)[i];
+                    osg::Vec3 transformed = osg::Matrix::transform3x3(inverse, normal);
+                    transformed.normalize();
+                    normals->push_back(transformed);
+                }
+            }
+            if (colors.valid()) {
+                const osg::Vec4Array* sourceColors = static_cast<const osg::Vec4Array*>(geometry->getColorArray());
+                for (std::size_t i = 0; i < sourceVertices->size(); ++i) {
+                    colors->push_back(sourceColors->getBinding() == osg::Array::BIND_OVERALL ? sourceColors->front() : (*sourceColors)[i]);
+                }
+            }
+            if (texCoords.valid()) {
+                const osg::Vec2Array* sourceTexCoords = static_cast<const osg::Vec2Array*>(geometry->getTexCoordArray(0));
+                texCoords->insert(texCoords->end(), sourceTexCoords->begin(), sourceTexCoords->end());
+            }
+
+            // 索引直接写成合并后的全局下标（baseVertex为0），CPU侧求交不处理baseVertex也能得到正确的三角形
+            const unsigned int firstIndex = static_cast<unsigned int>(elements->size());
+            osg::TriangleIndexFunctor<IndexCollector> triangles;
+            std::vector<GLuint> indices;
+            triangles.indices = &indices;
+            triangles.base = base;
+            geometry->accept(triangles);
+            elements->insert(elements->end(), indices.begin(), indices.end());
+
+            commands->push_back(osg::DrawElementsIndirectCommand(static_cast<unsigned int>(indices.size()), 1, firstIndex, 0, 0));
+            bounds.push_back(bound);
+
+            BatchSources::Source source;
+            source.geometry = piece.geometry;
+            source.geode = piece.geode;
+            source.firstVertex = base;
+            source.numVertices = static_cast<unsigned int>(sourceVertices->size());
+            sources.push_back(source);
+        }
+
+        osg::ref_ptr<osg::Geometry> merged = new osg::Geometry;
+        merged->setName("indirect_batch");
+        merged->setUseDisplayList(false);
+        merged->setUseVertexBufferObjects(true);
+        merged->setVertexArray(vertices.get());
+        if (normals.valid()) merged->setNormalArray(normals.get());
+        if (colors.valid()) merged->setColorArray(colors.get());
+        if (texCoords.valid()) merged->setTexCoordArray(0, texCoords.get());
+        elements->setIndirectCommandArray(commands.get());
+        merged->addPrimitiveSet(elements.get());
+        osg::ref_ptr<BatchSources> batchSources = new BatchSources(sources, commands.get());
+        merged->setUserData(batchSources.get());
+        merged->setDrawCallback(new CullingDrawCallback(elements.get(), commands.get(), bounds, batchSources.get()));
+
+        // 路径上的StateSet自上而下合并，与逐层继承的结果一致
+        osg::ref_ptr<osg::StateSet> stateSet = new osg::StateSet;
+        for (const osg::StateSet* state : states) {
+            stateSet->merge(*state);
+        }
+
+        osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+        geode->setName("indirect_batch");
+        geode->setStateSet(stateSet.get());
+        geode->addDrawable(merged.get());
+        return geode;
+    }
+}
+
+IndirectBatcher::Stats IndirectBatcher::batch(osg::ref_ptr<osg::Node>& model)
+{
+    Stats stats;
+    if (!model.valid() || !isSupported()) return stats;
+
+    BatchMap batches;
+    std::vector<const osg::StateSet*> states;
+    collect(model.get(), osg::Matrix::identity(), states, batches, true);
+
+    osg::ref_ptr<osg::Group> result;
+    for (BatchMap::const_iterator it = batches.begin(); it != batches.end(); ++it) {
+        const std::vector<Piece>& pieces = it->second;
+        // 只有一个几何体的组合批没有收益
+        if (pieces.size() < 2) continue;
+
+        if (!result.valid()) {
+            result = new osg::Group;
+            result->setName(model->getName());
+            result->addChild(model.get());
+        }
+
+        std::size_t begin = 0;
+        while (begin < pieces.size()) {
+            std::size_t end = begin;
+            unsigned int vertexCount = 0;
+            while (end < pieces.size() && (end == begin || vertexCount + pieces[end].geometry->getVertexArray()->getNumElements() <= kMaxBatchVertices)) {
+                vertexCount += pieces[end].geometry->getVertexArray()->getNumElements();
+                ++end;
+            }
+
+            const std::vector<Piece> chunk(pieces.begin() + begin, pieces.begin() + end);
+            result->addChild(buildBatch(it->first.first, it->first.second, chunk).get());
+            for (const Piece& piece : chunk) {
+                piece.geode->removeDrawable(piece.geometry.get());
+            }
+            ++stats.batches;
+            stats.geometries += static_cast<unsigned int>(chunk.size());
+            begin = end;
+        }
+    }
+
+    if (result.valid()) {
+        model = result;
+    }
+    return stats;
+}
+
+osg::Geometry* IndirectBatcher::resolvePick(osg::Geometry* geometry, const std::vector<unsigned int>& indexList)
+{
+    BatchSources* sources = geometry ? dynamic_cast<BatchSources*>(geometry->getUserData()) : nullptr;
+    if (!sources || indexList.empty()) return geometry;
+
+    const int source = sources->find(indexList.front());
+    if (source < 0) return geometry;
+    return sources->detach(static_cast<std::size_t>(source));
+}
@@ -0,0 +1,48 @@
+#ifndef INDIRECTBATCHER_H
+#define INDIRECTBATCHER_H
+
+#include <osg/Geometry>
+#include <osg/Node>
+#include <osg/ref_ptr>
+#include <atomic>
+#include <vector>
+
+// 间接绘制合批
+// 模型中静态的几何体（路径上只有Group/Geode/MatrixTransform、没有回调、不被共用）按最终渲染状态和顶点格式分组，
+// 变换烘焙进顶点后合并到共享的大缓冲，每组用一次glMultiDrawElementsIndirect绘制，原几何体一个对应一条命令。
+// 绘制前按当前相机的视锥逐条测试包围球，在该视图自己的命令缓冲里把被剔除的命令实例数写为0，
+// 共享的命令数组不被修改，多视口、多相机同时绘制互不干扰；提交次数不再随物体数量增长。
+// 需要GL 4.3或GL_ARB_multi_draw_indirect，不支持时不合批，模型按原样绘制
+// 批次记录每条命令来自哪个原几何体；拾取命中批次时把该几何体拆回原处，高亮、改色等逐几何体的编辑照常生效
+class IndirectBatcher
+{
+public:
+    // 单个批次的顶点数上限，超出时另起一批
+    static const unsigned int kMaxBatchVertices = 1u << 20;
+
+    struct Stats
+    {
+        unsigned int batches = 0;
+        unsigned int geometries = 0;
+    };
+
+    // 渲染线程在GL上下文创建后调用
+    static void setSupported(bool supported) { supportedFlag() = supported; }
+    static bool isSupported() { return supportedFlag(); }
+
+    // 加载线程调用，模型加入场景之前；合批后model换成包含原模型和各批次的Group
+    static Stats batch(osg::ref_ptr<osg::Node>& model);
+
+    // 渲染线程，帧边界调用：geometry是拾取命中的合批几何体时，按命中三角形的顶点下标找到原几何体，
+    // 把它放回原来的Geode并从批次中去掉，返回原几何体；其他几何体原样返回
+    static osg::Geometry* resolvePick(osg::Geometry* geometry, const std::vector<unsigned int>& indexList);
+
+private:
+    static std::atomic<bool>& supportedFlag()
+    {
+        static std::atomic<bool> supported(false);
+        return supported;
+    }
+};
+
+#endif // INDIRECTBATCHER_H
@@ -0,0 +1,144 @@
+#include "logger.h"
+#include "mpscring.h"
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    // 单条记录的消息长度，超出部分截断
+    const std::size_t kMessageSize = 224;
+    // 后台线程空闲时的轮询间隔
+    const int kDrainIntervalMs = 20;
+
+    struct Record
+    {
+        long long timeMs;
+        int level;
+        const char* category;
+        unsigned int suppressed;
+        unsigned int dropped;
+        char message[kMessageSize];
+    };
+
+    MpscRing<Record, 1024>& ring()
+    {
+        static MpscRing<Record, 1024> queue;
+        return queue;
+    }
+
+    long long steadyMs()
+    {
+        using namespace std::chrono;
+        return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    // 输出中的时间从第一次使用日志时算起
+    long long startMs()
+    {
+        static const long long start = steadyMs();
+        return start;
+    }
+
+    const char* levelName(int level)
+    {
+        static const char* const kNames[] = { "TRACE", "DEBUG", "INFO", "WARN", "ERROR" };
+        return level >= 0 && level < LOG_LEVEL_OFF ? kNames[level] : "?";
+    }
+
+    int levelFromEnvironment()
+    {
+        const char* value = std::getenv("QMLOSG_LOG_LEVEL");
+        if (!value) return LOG_LEVEL_INFO;
+
+        static const char* const kNames[] = { "trace", "debug", "info", "warning", "error", "off" };
+        for (int level = LOG_LEVEL_TRACE; level <= LOG_LEVEL_OFF; ++level) {
+            if (std::strcmp(value, kNames[level]) == 0) return level;
+        }
+        return LOG_LEVEL_INFO;
+    }
+}
+
+bool Logger::RateLimit::allow(unsigned int& suppressed)
+{
+    const long long now = steadyMs();
+    long long start = _windowStart.load(std::memory_order_relaxed);
+    if (now - start >= 1000 && _windowStart.compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+        _count.store(0, std::memory_order_relaxed);
+    }
+    if (_count.fetch_add(1, std::memory_order_relaxed) < kMaxPerSecond) {
+        suppressed = _suppressed.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+    _suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+Logger& Logger::instance()
+{
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+    : _level(levelFromEnvironment()), _dropped(0), _running(true)
+{
+    startMs();
+    _thread = std::thread([this]() {
+        while (_running.load(std::memory_order_acquire)) {
+            drain();
+            std::this_thread::sleep_for(std::chrono::milliseconds(kDrainIntervalMs));
+        }
+        drain();
+    });
+}
+
+Logger::~Logger()
+{
+    _running.store(false, std::memory_order_release);
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+void Logger::write(LogLevel level, const char* category, unsigned int suppressed, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    const bool queued = ring().push([&](Record& record) {
+        record.timeMs = steadyMs();
+        record.level = level;
+        record.category = category;
+        record.suppressed = suppressed;
+        record.dropped = _dropped.exchange(0, std::memory_order_relaxed);
+        std::vsnprintf(record.message, kMessageSize, format, args);
+    });
+    va_end(args);
+
+    if (!queued) {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Logger::drain()
+{
+    Record record;
+    bool wrote = false;
+    while (ring().pop(record)) {
+        std::fprintf(stderr, "[%9.3f] %-5s %s: %s", (record.timeMs - startMs()) / 1000.0, levelName(record.level),
+                     record.category, record.message);
+        if (record.suppressed > 0) {
+            std::fprintf(stderr, " (suppressed=%u)", record.suppressed);
+        }
+        if (record.dropped > 0) {
+            std::fprintf(stderr, " (dropped=%u)", record.dropped);
+        }
+        std::fputc('\n', stderr);
+        wrote = true;
+    }
+    if (wrote) {
+        std::fflush(stderr);
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <thread>
+
+// 日志级别，数值与LOG_COMPILE_LEVEL一致
+enum LogLevel
+{
+    LOG_LEVEL_TRACE = 0,
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARNING,
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_OFF
+};
+
+// 编译期最低级别（由CMake的LOG_COMPILE_LEVEL设置），低于它的日志语句连参数都不会求值
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 2
+#endif
+
+// 日志
+// 调用线程只做级别判断、每个调用点的限流和一次格式化，记录写入无锁环形队列；
+// 后台线程批量取出写到stderr，每批只刷新一次。队列满时丢弃并计数，在下一条输出中报告。
+// 运行期级别取自环境变量QMLOSG_LOG_LEVEL（trace/debug/info/warning/error/off），默认info
+class Logger
+{
+public:
+    // 每个调用点一个：每秒最多放行kMaxPerSecond条，其余丢弃并计数，随下一条放行的日志报告
+    class RateLimit
+    {
+    public:
+        static const unsigned int kMaxPerSecond = 10;
+
+        RateLimit() : _windowStart(0), _count(0), _suppressed(0) {}
+
+        // 放行时suppressed为上次放行以来被丢弃的条数
+        bool allow(unsigned int& suppressed);
+
+    private:
+        std::atomic<long long> _windowStart;
+        std::atomic<unsigned int> _count;
+        std::atomic<unsigned int> _suppressed;
+    };
+
+    static Logger& instance();
+
+    bool isEnabled(LogLevel level) const { return level >= _level.load(std::memory_order_relaxed); }
+    void setLevel(LogLevel level) { _level.store(level, std::memory_order_relaxed); }
+
+    // category须为字符串字面量；format为printf格式，字段约定写成 key=value
+    void write(LogLevel level, const char* category, unsigned int suppressed, const char* format, ...)
+#if defined(__GNUC__)
+        __attribute__((format(printf, 5, 6)))
+#endif
+        ;
+
+private:
+    Logger();
+    ~Logger();
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    void drain();
+
+    std::atomic<int> _level;
+    std::atomic<unsigned int> _dropped;
+    std::atomic<bool> _running;
+    std::thread _thread;
+};
+
+#define LOG_WRITE(level, category, ...)                                                    \
+    do {                                                                                   \
+        if (Logger::instance().isEnabled(level)) {                                         \
+            static Logger::RateLimit logRateLimit;                                         \
+            unsigned int logSuppressed = 0;                                                \
+            if (logRateLimit.allow(logSuppressed)) {                                       \
+                Logger::instance().write(level, category, logSuppressed, __VA_ARGS__);     \
+            }                                                                              \
+        }                                                                                  \
+    } while (0)
+
+#if LOG_COMPILE_LEVEL <= 0
+#define LOG_TRACE(category, ...) LOG_WRITE(LOG_LEVEL_TRACE, category, __VA_ARGS__)
+#else
+#define LOG_TRACE(category, ...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= 1
+#define LOG_DEBUG(category, ...) LOG_WRITE(LOG_LEVEL_DEBUG, category, __VA_ARGS__)
+#else
+#define LOG_DEBUG(category, ...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= 2
+#define LOG_INFO(category, ...) LOG_WRITE(LOG_LEVEL_INFO, category, __VA_ARGS__)
+#else
+#define LOG_INFO(category, ...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= 3
+#define LOG_WARNING(category, ...) LOG_WRITE(LOG_LEVEL_WARNING, category, __VA_ARGS__)
+#else
+#define LOG_WARNING(category, ...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= 4
+#define LOG_ERROR(category, ...) LOG_WRITE(LOG_LEVEL_ERROR, category, __VA_ARGS__)
+#else
+#define LOG_ERROR(category, ...) ((void)0)
+#endif
+
+#endif // LOGGER_H
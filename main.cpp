@@ -7,21 +7,41 @@
 #include <QQuickStyle>
 #include "simpleosgviewer.h"
 
+namespace
+{
+    // 请求GL 4.5兼容上下文，驱动给出的实际版本在渲染器初始化时检查，低于4.3时不启用间接绘制；
+    // 设置了环境变量QMLOSG_GL=legacy时请求原来的2.1兼容上下文。
+    // 默认格式要在QGuiApplication之前设置，此时还不能创建上下文试探，所以不在这里探测版本。
+    // 场景仍依赖固定管线（加载的模型、空气透视的ftransform），所以不用核心模式
+    QSurfaceFormat chooseSurfaceFormat()
+    {
+        QSurfaceFormat format;
+        format.setProfile(QSurfaceFormat::CompatibilityProfile);
+#ifndef QT_NO_DEBUG
+        // 调试上下文有额外开销，只在调试构建中开启
+        format.setOption(QSurfaceFormat::DebugContext);
+#endif
+
+        if (qgetenv("QMLOSG_GL") == "legacy") {
+            format.setVersion(2, 1);  // 使用较低版本以提高兼容性
+        } else {
+            format.setVersion(4, 5);
+        }
+        return format;
+    }
+}
+
 int main(int argc, char *argv[])
 {
     // 设置OpenGL图形API - 这对于OSG集成至关重要
     QQuickWindow::setGraphicsApi(QSGRendererInterface::OpenGL);
     
+    // 设置OpenGL格式，须在构造QGuiApplication之前
+    QSurfaceFormat::setDefaultFormat(chooseSurfaceFormat());
+    
     // 设置支持自定义的样式
     QQuickStyle::setStyle("Basic");
     
-    // 设置OpenGL格式 - 使用兼容性更好的设置
-    QSurfaceFormat format;
-    format.setVersion(2, 1);  // 使用较低版本以提高兼容性
-    format.setProfile(QSurfaceFormat::CompatibilityProfile);
-    format.setOption(QSurfaceFormat::DebugContext);
-    QSurfaceFormat::setDefaultFormat(format);
-
     QGuiApplication app(argc, argv);
 
     // 注册自定义QML类型
@@ -0,0 +1,379 @@
+#include "modelloader.h"
+#include "geometrycompaction.h"
+#include "indirectbatcher.h"
+#include "logger.h"
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/LOD>
+#include <osg/NodeVisitor>
+#include <osg/Timer>
+#include <osgDB/FileNameUtils>
+#include <osgDB/FileUtils>
+#include <osgDB/Options>
+#include <osgDB/ReadFile>
+#include <osgDB/WriteFile>
+#include <osgUtil/Simplifier>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QDebug>
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <map>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // 简化参数有改动时递增，旧缓存自然失效
+    const int kSimplifierVersion = 1;
+
+    // 各级的目标三角形比例、允许的最大折叠误差（相对Geode包围球半径），以及切换到该级的包围球屏幕直径（像素）
+    const float kLevelRatios[ModelLoader::kLevels] = { 1.0f, 0.5f, 0.2f, 0.05f };
+    const float kLevelErrors[ModelLoader::kLevels] = { 0.0f, 0.005f, 0.02f, 0.08f };
+    const float kLevelPixels[ModelLoader::kLevels] = { 300.0f, 120.0f, 40.0f, 0.0f };
+
+    // 误差上限先于比例达到时简化得不够多，与上一级差别不大的级别不保留
+    const float kMinReduction = 0.8f;
+    // 单个几何体的三角形数低于该值时各级共用原几何体
+    const unsigned int kMinGeometryTriangles = 100;
+
+    uint64_t fnv1a(const void* data, std::size_t size, uint64_t hash = 14695981039346656037ULL)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    unsigned int triangleCount(const osg::PrimitiveSet* primitives)
+    {
+        const unsigned int indices = primitives->getNumIndices();
+        switch (primitives->getMode()) {
+        case GL_TRIANGLES: return indices / 3;
+        case GL_QUADS: return indices / 4 * 2;
+        case GL_TRIANGLE_STRIP:
+        case GL_TRIANGLE_FAN:
+        case GL_QUAD_STRIP:
+        case GL_POLYGON:
+            if (const osg::DrawArrayLengths* lengths = dynamic_cast<const osg::DrawArrayLengths*>(primitives)) {
+                unsigned int total = 0;
+                for (GLsizei length : *lengths) {
+                    total += length > 2 ? length - 2 : 0;
+                }
+                return total;
+            }
+            return indices > 2 ? indices - 2 : 0;
+        default: return 0;
+        }
+    }
+
+    unsigned int triangleCount(const osg::Geometry* geometry)
+    {
+        unsigned int total = 0;
+        for (unsigned int i = 0; i < geometry->getNumPrimitiveSets(); ++i) {
+            total += triangleCount(geometry->getPrimitiveSet(i));
+        }
+        return total;
+    }
+
+    // 简化器把所有图元当作三角形处理，含点、线的几何体不能交给它
+    bool isTriangleMesh(const osg::Geometry* geometry)
+    {
+        if (!dynamic_cast<const osg::Vec3Array*>(geometry->getVertexArray()) || geometry->getNumPrimitiveSets() == 0) {
+            return false;
+        }
+        for (unsigned int i = 0; i < geometry->getNumPrimitiveSets(); ++i) {
+            if (geometry->getPrimitiveSet(i)->getMode() < GL_TRIANGLES) return false;
+        }
+        return true;
+    }
+
+    // 一个几何体的各级简化结果，levels[0]为原几何体，简化不下去时后面的级别为空
+    struct SimplifyTask
+    {
+        osg::ref_ptr<osg::Geometry> levels[ModelLoader::kLevels];
+        unsigned int triangles[ModelLoader::kLevels] = {};
+        float radius = 0.0f;
+    };
+
+    // 逐级在上一级的基础上简化，比每级都从原模型开始快
+    void simplify(SimplifyTask& task)
+    {
+        const unsigned int original = task.triangles[0];
+        for (int level = 1; level < ModelLoader::kLevels; ++level) {
+            const osg::Geometry* previous = task.levels[level - 1].get();
+            const unsigned int previousTriangles = task.triangles[level - 1];
+            const double target = original * kLevelRatios[level];
+
+            osg::ref_ptr<osg::Geometry> geometry =
+                new osg::Geometry(*previous, osg::CopyOp::DEEP_COPY_ARRAYS | osg::CopyOp::DEEP_COPY_PRIMITIVES);
+            osgUtil::Simplifier simplifier(std::min(1.0, target / previousTriangles), task.radius * kLevelErrors[level]);
+            simplifier.setSmoothing(false);
+            simplifier.setDoTriStrip(false);
+            simplifier.simplify(*geometry);
+
+            const unsigned int triangles = triangleCount(geometry.get());
+            if (triangles == 0 || triangles > previousTriangles * kMinReduction) {
+                break;
+            }
+            task.levels[level] = geometry;
+            task.triangles[level] = triangles;
+        }
+    }
+
+    // 收集三角形足够多的Geode，已有LOD的子树不动
+    class LodCandidateVisitor : public osg::NodeVisitor
+    {
+    public:
+        LodCandidateVisitor() : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN) {}
+
+        void apply(osg::LOD&) override {}
+
+        void apply(osg::Geode& geode) override
+        {
+            if (!_visited.insert(&geode).second) return;
+
+            unsigned int triangles = 0;
+            for (unsigned int i = 0; i < geode.getNumDrawables(); ++i) {
+                osg::Geometry* geometry = geode.getDrawable(i)->asGeometry();
+                if (geometry && isTriangleMesh(geometry)) {
+                    triangles += triangleCount(geometry);
+                }
+            }
+            if (triangles >= ModelLoader::kMinTriangles) {
+                geodes.push_back(&geode);
+            }
+        }
+
+        std::vector<osg::ref_ptr<osg::Geode> > geodes;
+
+    private:
+        std::set<const osg::Geode*> _visited;
+    };
+
+    struct LodStats
+    {
+        unsigned int geodes = 0;
+        unsigned int triangles = 0;
+        unsigned int coarsestTriangles = 0;
+    };
+
+    // model本身就是候选Geode时换成生成的LOD
+    LodStats generateLods(osg::ref_ptr<osg::Node>& model)
+    {
+        LodStats stats;
+        LodCandidateVisitor candidates;
+        model->accept(candidates);
+        if (candidates.geodes.empty()) return stats;
+
+        // 同一几何体被多个Geode共用时只简化一次，误差按其中最大的Geode计算
+        std::vector<SimplifyTask> tasks;
+        std::map<const osg::Geometry*, std::size_t> taskIndex;
+        for (const osg::ref_ptr<osg::Geode>& geode : candidates.geodes) {
+            const float radius = geode->getBound().radius();
+            for (unsigned int i = 0; i < geode->getNumDrawables(); ++i) {
+                osg::Geometry* geometry = geode->getDrawable(i)->asGeometry();
+                if (!geometry || !isTriangleMesh(geometry)) continue;
+                const unsigned int triangles = triangleCount(geometry);
+                if (triangles < kMinGeometryTriangles) continue;
+
+                auto it = taskIndex.find(geometry);
+                if (it == taskIndex.end()) {
+                    taskIndex[geometry] = tasks.size();
+                    tasks.emplace_back();
+                    tasks.back().levels[0] = geometry;
+                    tasks.back().triangles[0] = triangles;
+                    tasks.back().radius = radius;
+                } else {
+                    tasks[it->second].radius = std::max(tasks[it->second].radius, radius);
+                }
+            }
+        }
+
+        // 按几何体分给工作线程，各自取下一个未处理的任务
+        std::atomic<std::size_t> next(0);
+        const std::size_t workers = std::min<std::size_t>(tasks.size(), std::max(1u, std::thread::hardware_concurrency()));
+        std::vector<std::future<void> > futures;
+        for (std::size_t worker = 0; worker < workers; ++worker) {
+            futures.push_back(std::async(std::launch::async, [&tasks, &next]() {
+                for (std::size_t i = next++; i < tasks.size(); i = next++) {
+                    simplify(tasks[i]);
+                }
+            }));
+        }
+        for (std::future<void>& future : futures) {
+            future.get();
+        }
+
+        for (const osg::ref_ptr<osg::Geode>& geode : candidates.geodes) {
+            // 每个几何体取不超过自己最粗一级的结果；没有任何几何体能简化时不换成LOD
+            int levels = 1;
+            for (unsigned int i = 0; i < geode->getNumDrawables(); ++i) {
+                auto it = taskIndex.find(geode->getDrawable(i)->asGeometry());
+                if (it == taskIndex.end()) continue;
+                const SimplifyTask& task = tasks[it->second];
+                while (levels < ModelLoader::kLevels && task.levels[levels].valid()) ++levels;
+            }
+            if (levels == 1) continue;
+
+            osg::ref_ptr<osg::LOD> lod = new osg::LOD;
+            lod->setName(geode->getName());
+            lod->setRangeMode(osg::LOD::PIXEL_SIZE_ON_SCREEN);
+            const osg::Node::ParentList parents = geode->getParents();
+
+            for (int level = 0; level < levels; ++level) {
+                osg::ref_ptr<osg::Geode> variant = geode;
+                if (level > 0) {
+                    variant = new osg::Geode;
+                    variant->setName(geode->getName());
+                    variant->setStateSet(geode->getStateSet());
+                    variant->setNodeMask(geode->getNodeMask());
+                    for (unsigned int i = 0; i < geode->getNumDrawables(); ++i) {
+                        osg::Drawable* drawable = geode->getDrawable(i);
+                        auto it = taskIndex.find(drawable->asGeometry());
+                        if (it == taskIndex.end()) {
+                            variant->addDrawable(drawable);
+                            continue;
+                        }
+                        const SimplifyTask& task = tasks[it->second];
+                        int available = level;
+                        while (!task.levels[available].valid()) --available;
+                        variant->addDrawable(task.levels[available].get());
+                    }
+                }
+
+                const float minPixels = level == levels - 1 ? 0.0f : kLevelPixels[level];
+                const float maxPixels = level == 0 ? FLT_MAX : kLevelPixels[level - 1];
+                lod->addChild(variant.get(), minPixels, maxPixels);
+            }
+
+            for (osg::Group* parent : parents) {
+                parent->replaceChild(geode.get(), lod.get());
+            }
+            if (model.get() == geode.get()) {
+                model = lod;
+            }
+
+            ++stats.geodes;
+            for (unsigned int i = 0; i < geode->getNumDrawables(); ++i) {
+                auto it = taskIndex.find(geode->getDrawable(i)->asGeometry());
+                if (it == taskIndex.end()) continue;
+                const SimplifyTask& task = tasks[it->second];
+                int coarsest = levels - 1;
+                while (!task.levels[coarsest].valid()) --coarsest;
+                stats.triangles += task.triangles[0];
+                stats.coarsestTriangles += task.triangles[coarsest];
+            }
+        }
+        return stats;
+    }
+}
+
+ModelLoader& ModelLoader::instance()
+{
+    static ModelLoader loader;
+    return loader;
+}
+
+ModelLoader::ModelLoader()
+    : _compaction(false)
+{
+    QString baseDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (baseDir.isEmpty()) {
+        baseDir = QDir::currentPath();
+    }
+    QString dir = baseDir + "/model_cache";
+    if (QDir().mkpath(dir)) {
+        _cacheDirectory = dir.toStdString();
+    } else {
+        qWarning() << "ModelLoader: cannot create cache directory" << dir;
+    }
+}
+
+std::string ModelLoader::cachePath(const std::string& path) const
+{
+    if (_cacheDirectory.empty()) return std::string();
+
+    QFileInfo info(QString::fromStdString(path));
+    char key[64];
+    std::snprintf(key, sizeof(key), "%lld|%lld|%d", static_cast<long long>(info.size()),
+                  static_cast<long long>(info.lastModified().toMSecsSinceEpoch()), kSimplifierVersion);
+    const std::string absolute = info.absoluteFilePath().toStdString();
+    uint64_t hash = fnv1a(absolute.data(), absolute.size());
+    hash = fnv1a(key, std::strlen(key), hash);
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+    return _cacheDirectory + "/" + name;
+}
+
+osg::ref_ptr<osg::Node> ModelLoader::loadModel(const std::string& path)
+{
+    osg::ref_ptr<osg::Node> model = readModel(path);
+    if (model.valid() && _compaction) {
+        const GeometryCompaction::Stats stats = GeometryCompaction::compact(model);
+        if (stats.geodes > 0) {
+            LOG_INFO("modelloader", "path=%s compacted_geodes=%u bytes=%zu->%zu", path.c_str(), stats.geodes,
+                     stats.bytesBefore, stats.bytesAfter);
+        }
+    }
+    if (model.valid() && IndirectBatcher::isSupported()) {
+        // 压缩过的几何体位置不是浮点数组，不会被合批
+        const IndirectBatcher::Stats stats = IndirectBatcher::batch(model);
+        if (stats.batches > 0) {
+            LOG_INFO("modelloader", "path=%s indirect_batches=%u geometries=%u", path.c_str(), stats.batches, stats.geometries);
+        }
+    }
+    return model;
+}
+
+osg::ref_ptr<osg::Node> ModelLoader::readModel(const std::string& path)
+{
+    const std::string cached = cachePath(path);
+    if (!cached.empty() && osgDB::fileExists(cached + ".osgb")) {
+        // 模型引用的其他外部文件按源文件的相对路径记录，从源文件所在目录查找
+        osg::ref_ptr<osgDB::Options> options = new osgDB::Options;
+        options->getDatabasePathList().push_back(osgDB::getFilePath(osgDB::getRealPath(path)));
+        osg::ref_ptr<osg::Node> node = osgDB::readRefNodeFile(cached + ".osgb", options.get());
+        if (node.valid()) {
+            return node;
+        }
+    }
+
+    osg::ref_ptr<osg::Node> model = osgDB::readRefNodeFile(path);
+    if (!model.valid()) {
+        return nullptr;
+    }
+
+    const osg::Timer_t start = osg::Timer::instance()->tick();
+    const LodStats stats = generateLods(model);
+    if (stats.geodes == 0) {
+        // 没有需要简化的几何体，直接读源文件一样快，不写缓存
+        return model;
+    }
+    LOG_INFO("modelloader", "path=%s geodes=%u triangles=%u coarsest=%u ms=%.1f", path.c_str(), stats.geodes,
+             stats.triangles, stats.coarsestTriangles, osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick()));
+
+    if (!cached.empty()) {
+        // 先写临时文件再改名，其他线程同时加载同一个模型时不会读到写了一半的缓存；纹理数据一并写入
+        const std::string temporary = cached + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp.osgb";
+        osg::ref_ptr<osgDB::Options> options = new osgDB::Options("WriteImageHint=IncludeData");
+        const std::string target = cached + ".osgb";
+        if (!osgDB::writeNodeFile(*model, temporary, options.get()) || std::rename(temporary.c_str(), target.c_str()) != 0) {
+            std::remove(temporary.c_str());
+            LOG_WARNING("modelloader", "cannot write cache path=%s", target.c_str());
+        }
+    }
+    return model;
+}
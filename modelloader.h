@@ -0,0 +1,43 @@
+#ifndef MODELLOADER_H
+#define MODELLOADER_H
+
+#include <osg/Node>
+#include <osg/ref_ptr>
+#include <atomic>
+#include <string>
+
+// 模型导入
+// 三角形足够多的Geode在导入时生成逐级简化的版本（边折叠，误差按包围球半径限定），换成按屏幕像素切换的osg::LOD，
+// 各几何体的简化并行进行；结果按源文件路径、大小和修改时间写入磁盘缓存（.osgb），下次直接读取。
+// 模型中已有的LOD/PagedLOD子树原样保留；开启几何体压缩时读出后再压缩顶点数据（见GeometryCompaction），
+// 支持间接绘制时再把静态几何体合批（见IndirectBatcher），缓存中保存的是这两步之前的版本
+class ModelLoader
+{
+public:
+    // 各级相对原模型的三角形比例，加上原模型共kLevels级
+    static const int kLevels = 4;
+    // Geode的三角形数低于该值时不生成LOD
+    static const unsigned int kMinTriangles = 2000;
+
+    static ModelLoader& instance();
+
+    // 任意线程调用；读取失败时返回空
+    osg::ref_ptr<osg::Node> loadModel(const std::string& path);
+
+    // 任意线程调用，对之后加载的模型生效
+    void setCompactionEnabled(bool enabled) { _compaction = enabled; }
+    bool isCompactionEnabled() const { return _compaction; }
+
+private:
+    ModelLoader();
+    ModelLoader(const ModelLoader&) = delete;
+    ModelLoader& operator=(const ModelLoader&) = delete;
+
+    osg::ref_ptr<osg::Node> readModel(const std::string& path);
+    std::string cachePath(const std::string& path) const;
+
+    std::string _cacheDirectory;
+    std::atomic<bool> _compaction;
+};
+
+#endif // MODELLOADER_H
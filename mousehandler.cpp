@@ -4,8 +4,16 @@
 #include <osgGA/GUIEventAdapter>
 #include <osgViewer/ViewerEventHandlers>
 #include <QDebug>
+#include <cstdlib>
+
+namespace
+{
+    // Qt滚轮一格对应的angleDelta
+    const int kWheelStep = 120;
+}
 
 MouseHandler::MouseHandler()
+    : m_droppedEvents(0), m_wheelRemainder(0)
 {
 }
 
@@ -13,8 +21,7 @@ MouseHandler::~MouseHandler()
 {
 }
 
-bool MouseHandler::processEvent(const QEvent* event, osgViewer::Viewer* viewer, 
-                               SimpleOSGViewer::ViewType viewType, ViewManager* viewManager)
+bool MouseHandler::processEvent(const QEvent* event, osgViewer::Viewer* viewer)
 {
     if (!event || !viewer) {
         return false;
@@ -22,171 +29,140 @@ bool MouseHandler::processEvent(const QEvent* event, osgViewer::Viewer* viewer,
 
     switch (event->type()) {
     case QEvent::MouseMove:
-        return handleMouseMove(static_cast<const QMouseEvent*>(event), viewer, viewType, viewManager);
+        return handleMouseMove(static_cast<const QMouseEvent*>(event));
     case QEvent::MouseButtonPress:
-        return handleMousePress(static_cast<const QMouseEvent*>(event), viewer, viewType, viewManager);
+        return handleMousePress(static_cast<const QMouseEvent*>(event));
     case QEvent::MouseButtonRelease:
-        return handleMouseRelease(static_cast<const QMouseEvent*>(event), viewer, viewType, viewManager);
+        return handleMouseRelease(static_cast<const QMouseEvent*>(event));
     case QEvent::Wheel:
-        return handleWheelEvent(static_cast<const QWheelEvent*>(event), viewer, viewType, viewManager);
+        return handleWheelEvent(event);
     default:
         return false;
     }
 }
 
-bool MouseHandler::handleMouseMove(const QMouseEvent* event, osgViewer::Viewer* viewer, 
-                                  SimpleOSGViewer::ViewType viewType, ViewManager* viewManager)
+bool MouseHandler::enqueue(const InputEvent& inputEvent)
 {
-    if (!event || !viewer) {
+    if (!m_ring.push(inputEvent)) {
+        // 渲染线程长时间没有取事件，丢弃并计数
+        m_droppedEvents.fetch_add(1, std::memory_order_relaxed);
         return false;
     }
+    return true;
+}
 
-    // 获取viewer的事件队列
-    osgViewer::Viewer::Contexts contexts;
-    viewer->getContexts(contexts);
-    
-    if (contexts.empty()) {
-        return false;
-    }
-    
-    osgViewer::GraphicsWindow* gw = dynamic_cast<osgViewer::GraphicsWindow*>(contexts[0]);
-    if (!gw) {
-        return false;
-    }
-    
-    osgGA::EventQueue* queue = gw->getEventQueue();
-    if (!queue) {
-        return false;
-    }
-    
-    // 处理鼠标移动事件
-    float x = static_cast<float>(event->x());
-    float y = static_cast<float>(event->y());
-    queue->mouseMotion(x, y);
-
-    // 更新视图管理器中的相机参数
-    if (viewManager) {
-        viewManager->updateViewParametersFromManipulator(viewer);
-    }
+bool MouseHandler::handleMouseMove(const QMouseEvent* event)
+{
+    InputEvent inputEvent = { InputEvent::MOTION, static_cast<float>(event->x()), static_cast<float>(event->y()), 0, 0 };
+    return enqueue(inputEvent);
+}
 
-    return true;
+bool MouseHandler::handleMousePress(const QMouseEvent* event)
+{
+    InputEvent inputEvent = { InputEvent::PRESS, static_cast<float>(event->x()), static_cast<float>(event->y()),
+                              static_cast<int>(event->button()), 0 };
+    return enqueue(inputEvent);
 }
 
-bool MouseHandler::handleMousePress(const QMouseEvent* event, osgViewer::Viewer* viewer, 
-                                   SimpleOSGViewer::ViewType viewType, ViewManager* viewManager)
+bool MouseHandler::handleMouseRelease(const QMouseEvent* event)
 {
-    if (!event || !viewer) {
-        return false;
-    }
+    InputEvent inputEvent = { InputEvent::RELEASE, static_cast<float>(event->x()), static_cast<float>(event->y()),
+                              static_cast<int>(event->button()), 0 };
+    return enqueue(inputEvent);
+}
 
-    // 获取viewer的事件队列
-    osgViewer::Viewer::Contexts contexts;
-    viewer->getContexts(contexts);
-    
-    if (contexts.empty()) {
-        return false;
-    }
-    
-    osgViewer::GraphicsWindow* gw = dynamic_cast<osgViewer::GraphicsWindow*>(contexts[0]);
-    if (!gw) {
-        return false;
-    }
-    
-    osgGA::EventQueue* queue = gw->getEventQueue();
-    if (!queue) {
-        return false;
-    }
-    
-    // 处理鼠标按下事件
-    float x = static_cast<float>(event->x());
-    float y = static_cast<float>(event->y());
-    queue->mouseButtonPress(x, y, event->button());
-
-    // 更新视图管理器中的相机参数
-    if (viewManager) {
-        viewManager->updateViewParametersFromManipulator(viewer);
-    }
+bool MouseHandler::handleWheelEvent(const QEvent* event)
+{
+    // 将QEvent转换为QWheelEvent
+    const QWheelEvent* wheelEvent = static_cast<const QWheelEvent*>(event);
 
-    return true;
+    // Qt6中使用angleDelta
+    InputEvent inputEvent = { InputEvent::SCROLL, static_cast<float>(wheelEvent->position().x()),
+                              static_cast<float>(wheelEvent->position().y()), 0, wheelEvent->angleDelta().y() };
+    return enqueue(inputEvent);
 }
 
-bool MouseHandler::handleMouseRelease(const QMouseEvent* event, osgViewer::Viewer* viewer, 
-                                     SimpleOSGViewer::ViewType viewType, ViewManager* viewManager)
+osgGA::EventQueue* MouseHandler::eventQueue(osgViewer::Viewer* viewer)
 {
-    if (!event || !viewer) {
-        return false;
+    if (m_eventQueue.valid()) {
+        return m_eventQueue.get();
     }
 
-    // 获取viewer的事件队列
+    // 只在第一次或图形窗口重建后查找一次
     osgViewer::Viewer::Contexts contexts;
     viewer->getContexts(contexts);
-    
     if (contexts.empty()) {
-        return false;
+        return nullptr;
     }
-    
+
     osgViewer::GraphicsWindow* gw = dynamic_cast<osgViewer::GraphicsWindow*>(contexts[0]);
     if (!gw) {
-        return false;
-    }
-    
-    osgGA::EventQueue* queue = gw->getEventQueue();
-    if (!queue) {
-        return false;
-    }
-    
-    // 处理鼠标释放事件
-    float x = static_cast<float>(event->x());
-    float y = static_cast<float>(event->y());
-    queue->mouseButtonRelease(x, y, event->button());
-
-    // 更新视图管理器中的相机参数
-    if (viewManager) {
-        viewManager->updateViewParametersFromManipulator(viewer);
+        return nullptr;
     }
 
-    return true;
+    m_eventQueue = gw->getEventQueue();
+    return m_eventQueue.get();
 }
 
-bool MouseHandler::handleWheelEvent(const QEvent* event, osgViewer::Viewer* viewer, 
-                                   SimpleOSGViewer::ViewType viewType, ViewManager* viewManager)
+void MouseHandler::dispatch(osgGA::EventQueue* queue, const InputEvent& inputEvent)
 {
-    if (!event || !viewer) {
-        return false;
+    switch (inputEvent.type) {
+    case InputEvent::MOTION:
+        queue->mouseMotion(inputEvent.x, inputEvent.y);
+        break;
+    case InputEvent::PRESS:
+        queue->mouseButtonPress(inputEvent.x, inputEvent.y, inputEvent.button);
+        break;
+    case InputEvent::RELEASE:
+        queue->mouseButtonRelease(inputEvent.x, inputEvent.y, inputEvent.button);
+        break;
+    case InputEvent::SCROLL: {
+        // 累计增量按整格送入，不足一格的部分（高精度滚轮、触控板）留到下一帧
+        int delta = m_wheelRemainder + inputEvent.wheelDelta;
+        int steps = delta / kWheelStep;
+        m_wheelRemainder = delta - steps * kWheelStep;
+        for (int i = 0; i < std::abs(steps); ++i) {
+            queue->mouseScroll(steps > 0 ? osgGA::GUIEventAdapter::SCROLL_UP : osgGA::GUIEventAdapter::SCROLL_DOWN);
+        }
+        break;
     }
+    }
+}
 
-    // 将QEvent转换为QWheelEvent
-    const QWheelEvent* wheelEvent = static_cast<const QWheelEvent*>(event);
+void MouseHandler::drainEvents(osgViewer::Viewer* viewer)
+{
+    if (!viewer) return;
 
-    // 获取viewer的事件队列
-    osgViewer::Viewer::Contexts contexts;
-    viewer->getContexts(contexts);
-    
-    if (contexts.empty()) {
-        return false;
-    }
-    
-    osgViewer::GraphicsWindow* gw = dynamic_cast<osgViewer::GraphicsWindow*>(contexts[0]);
-    if (!gw) {
-        return false;
-    }
-    
-    osgGA::EventQueue* queue = gw->getEventQueue();
-    if (!queue) {
-        return false;
-    }
-    
-    // 处理滚轮事件
-    // Qt6中使用angleDelta
-    int delta = wheelEvent->angleDelta().y();
-    
-    if (delta > 0) {
-        queue->mouseScroll(osgGA::GUIEventAdapter::SCROLL_UP);
-    } else {
-        queue->mouseScroll(osgGA::GUIEventAdapter::SCROLL_DOWN);
+    unsigned int dropped = m_droppedEvents.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+        qWarning() << "MouseHandler: input ring full," << dropped << "events dropped";
     }
 
-    
+    osgGA::EventQueue* queue = eventQueue(viewer);
 
-    return true;
-}
\ No newline at end of file
+    // 连续的移动事件只保留最后一个，连续的滚轮事件合并增量；按下/释放保持原顺序
+    InputEvent pending;
+    bool hasPending = false;
+    InputEvent inputEvent;
+    while (m_ring.pop(inputEvent)) {
+        if (!queue) continue;
+
+        if (hasPending && pending.type == inputEvent.type &&
+            (inputEvent.type == InputEvent::MOTION || inputEvent.type == InputEvent::SCROLL)) {
+            int wheelDelta = pending.wheelDelta + inputEvent.wheelDelta;
+            pending = inputEvent;
+            pending.wheelDelta = wheelDelta;
+            continue;
+        }
+
+        if (hasPending) {
+            dispatch(queue, pending);
+        }
+        pending = inputEvent;
+        hasPending = true;
+    }
+
+    if (hasPending && queue) {
+        dispatch(queue, pending);
+    }
+}
@@ -2,29 +2,64 @@
 #define MOUSEHANDLER_H
 
 #include <QEvent>
+#include <QMouseEvent>
+#include <osg/observer_ptr>
+#include <osgGA/EventQueue>
 #include <osgViewer/Viewer>
-#include "simpleosgviewer.h"
-#include "viewmanager.h"
+#include <atomic>
+#include "spscring.h"
 
+// 鼠标输入管线
+// GUI线程的processEvent只把事件写入无锁环形队列，渲染线程在帧开始时调用drainEvents取出，
+// 合并连续的移动事件（只保留最后一个）和滚轮增量后再送入OSG事件队列
 class MouseHandler
 {
 public:
     MouseHandler();
     ~MouseHandler();
 
-    bool processEvent(const QEvent* event, osgViewer::Viewer* viewer, 
-                     SimpleOSGViewer::ViewType viewType, ViewManager* viewManager);
+    // GUI线程调用
+    bool processEvent(const QEvent* event, osgViewer::Viewer* viewer);
+
+    // 渲染线程，viewer->frame()之前调用
+    void drainEvents(osgViewer::Viewer* viewer);
 
 private:
-    bool handleMouseMove(const QMouseEvent* event, osgViewer::Viewer* viewer, 
-                        SimpleOSGViewer::ViewType viewType, ViewManager* viewManager);
-    bool handleMousePress(const QMouseEvent* event, osgViewer::Viewer* viewer, 
-                         SimpleOSGViewer::ViewType viewType, ViewManager* viewManager);
-    bool handleMouseRelease(const QMouseEvent* event, osgViewer::Viewer* viewer, 
-                           SimpleOSGViewer::ViewType viewType, ViewManager* viewManager);
-    
-    bool handleWheelEvent(const QEvent* event, osgViewer::Viewer* viewer, 
-                           SimpleOSGViewer::ViewType viewType, ViewManager* viewManager);
+    struct InputEvent
+    {
+        enum Type
+        {
+            MOTION,
+            PRESS,
+            RELEASE,
+            SCROLL
+        };
+
+        Type type;
+        float x;
+        float y;
+        int button;
+        int wheelDelta;
+    };
+
+    // 1kHz鼠标在渲染卡顿一秒时也放得下
+    typedef SpscRing<InputEvent, 1024> InputRing;
+
+    bool handleMouseMove(const QMouseEvent* event);
+    bool handleMousePress(const QMouseEvent* event);
+    bool handleMouseRelease(const QMouseEvent* event);
+    bool handleWheelEvent(const QEvent* event);
+    bool enqueue(const InputEvent& inputEvent);
+
+    osgGA::EventQueue* eventQueue(osgViewer::Viewer* viewer);
+    void dispatch(osgGA::EventQueue* queue, const InputEvent& inputEvent);
+
+    InputRing m_ring;
+    std::atomic<unsigned int> m_droppedEvents;  // 队列满时丢弃的事件数
+
+    // 以下只在渲染线程访问
+    osg::observer_ptr<osgGA::EventQueue> m_eventQueue;  // 缓存的OSG事件队列
+    int m_wheelRemainder;  // 不足一格的滚轮增量，留到下一帧
 };
 
-#endif // MOUSEHANDLER_H
\ No newline at end of file
+#endif // MOUSEHANDLER_H
@@ -0,0 +1,77 @@
+#ifndef MPSCRING_H
+#define MPSCRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// 多生产者单消费者无锁环形队列（有界）
+// 每个槽位带一个序号：生产者用CAS抢占写位置，写完后把序号推进一格交给消费者；
+// 消费者读完后把序号推进一圈交还给生产者。容量为Capacity
+template <typename T, std::size_t Capacity>
+class MpscRing
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    MpscRing() : _enqueue(0), _dequeue(0)
+    {
+        for (std::size_t i = 0; i < Capacity; ++i) {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // 任意线程调用，队列满时返回false；fill(T&)在抢到的槽位上原地写入
+    template <typename Fill>
+    bool push(Fill fill)
+    {
+        std::size_t position = _enqueue.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = _cells[position & (Capacity - 1)];
+            std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            std::intptr_t difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+            if (difference == 0) {
+                if (_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    fill(cell.value);
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = _enqueue.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // 消费者线程调用，队列空时返回false
+    bool pop(T& value)
+    {
+        Cell& cell = _cells[_dequeue & (Capacity - 1)];
+        std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if (static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(_dequeue + 1) < 0) {
+            return false;
+        }
+        value = cell.value;
+        cell.sequence.store(_dequeue + Capacity, std::memory_order_release);
+        ++_dequeue;
+        return true;
+    }
+
+private:
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    Cell _cells[Capacity];
+    // 生产者共享的写位置与消费者独占的读位置分开放在不同缓存行
+    alignas(64) std::atomic<std::size_t> _enqueue;
+    alignas(64) std::size_t _dequeue;
+};
+
+#endif // MPSCRING_H
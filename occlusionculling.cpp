@@ -0,0 +1,123 @@
+#include "occlusionculling.h"
+#include <osg/Geometry>
+#include <osg/NodeVisitor>
+#include <osg/OcclusionQueryNode>
+#include <map>
+#include <set>
+
+namespace
+{
+    // 统计子树顶点数，共享的子树只计算一次
+    class VertexCounter
+    {
+    public:
+        unsigned int count(osg::Node* node)
+        {
+            auto it = _cache.find(node);
+            if (it != _cache.end()) return it->second;
+
+            unsigned int total = 0;
+            if (osg::Geometry* geometry = node->asGeometry()) {
+                total = geometry->getVertexArray() ? geometry->getVertexArray()->getNumElements() : 0;
+            } else if (osg::Group* group = node->asGroup()) {
+                for (unsigned int i = 0; i < group->getNumChildren(); ++i) {
+                    total += count(group->getChild(i));
+                }
+            }
+            _cache[node] = total;
+            return total;
+        }
+
+    private:
+        std::map<const osg::Node*, unsigned int> _cache;
+    };
+
+    osg::ref_ptr<osg::Node> wrapSubtree(osg::Node* node, unsigned int depth, VertexCounter& counter,
+                                        std::set<const osg::Node*>& visited)
+    {
+        if (dynamic_cast<osg::OcclusionQueryNode*>(node) || counter.count(node) < OcclusionCulling::kMinVertices) {
+            return node;
+        }
+
+        // 先包内层；共享的子树只处理一次，其他父节点沿用已包好的子节点
+        osg::Group* group = node->asGroup();
+        if (group && depth + 1 < OcclusionCulling::kMaxDepth && visited.insert(node).second) {
+            for (unsigned int i = 0; i < group->getNumChildren(); ++i) {
+                osg::ref_ptr<osg::Node> child = group->getChild(i);
+                osg::ref_ptr<osg::Node> wrapped = wrapSubtree(child.get(), depth + 1, counter, visited);
+                if (wrapped != child) {
+                    // setChild保留LOD/Switch等的逐子节点设置
+                    group->setChild(i, wrapped.get());
+                }
+            }
+        }
+
+        osg::ref_ptr<osg::OcclusionQueryNode> query = new osg::OcclusionQueryNode;
+        query->setName(node->getName().empty() ? "occlusion_query" : node->getName() + "_occlusion_query");
+        query->setVisibilityThreshold(OcclusionCulling::kVisibilityThreshold);
+        query->setQueryFrameCount(OcclusionCulling::kQueryFrameCount);
+        query->setQueriesEnabled(false);
+        query->addChild(node);
+        return query;
+    }
+
+    // 打开或关闭子树中所有查询节点
+    class QueryToggleVisitor : public osg::NodeVisitor
+    {
+    public:
+        explicit QueryToggleVisitor(bool enabled)
+            : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN), _enabled(enabled)
+        {
+            setNodeMaskOverride(0xffffffff);
+        }
+
+        void apply(osg::OcclusionQueryNode& node) override
+        {
+            node.setQueriesEnabled(_enabled);
+            traverse(node);
+        }
+
+    private:
+        bool _enabled;
+    };
+}
+
+OcclusionCulling::OcclusionCulling()
+    : _enabled(false), _applied(false)
+{
+}
+
+osg::ref_ptr<osg::Node> OcclusionCulling::wrap(osg::Node* model)
+{
+    if (!model) return model;
+
+    VertexCounter counter;
+    std::set<const osg::Node*> visited;
+    return wrapSubtree(model, 0, counter, visited);
+}
+
+bool OcclusionCulling::sceneChanged(osg::Group* root) const
+{
+    if (root->getNumChildren() != _appliedChildren.size()) return true;
+    for (unsigned int i = 0; i < root->getNumChildren(); ++i) {
+        if (root->getChild(i) != _appliedChildren[i]) return true;
+    }
+    return false;
+}
+
+void OcclusionCulling::update(osg::Group* root)
+{
+    if (!root) return;
+
+    const bool enabled = _enabled;
+    if (enabled == _applied && !sceneChanged(root)) return;
+
+    QueryToggleVisitor visitor(enabled);
+    root->accept(visitor);
+
+    _applied = enabled;
+    _appliedChildren.clear();
+    for (unsigned int i = 0; i < root->getNumChildren(); ++i) {
+        _appliedChildren.push_back(root->getChild(i));
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef OCCLUSIONCULLING_H
+#define OCCLUSIONCULLING_H
+
+#include <osg/Group>
+#include <osg/Node>
+#include <osg/Referenced>
+#include <osg/ref_ptr>
+#include <atomic>
+#include <vector>
+
+// 硬件遮挡剔除
+// 加载的模型按层级包进osg::OcclusionQueryNode：整个模型一层，其下顶点数足够多的子树各一层，最多kMaxDepth层。
+// 查询结果沿用前几帧的（每kQueryFrameCount帧重新查询一次），不等待当帧结果，CPU不会因此停顿；
+// 外层被判为遮挡时整棵子树连同内层的查询一并跳过。
+// 模型总是按此结构包装，开关只切换各节点是否发出查询，关闭时与普通Group相同；
+// 共享场景时各视口的开关作用于同一份场景
+class OcclusionCulling : public osg::Referenced
+{
+public:
+    // 子树顶点数低于该值时不再单独查询：查询本身要画一个包围盒，小物体不划算
+    static const unsigned int kMinVertices = 2000;
+    static const unsigned int kMaxDepth = 3;
+    // 包围盒可见像素数不超过该值时视为被遮挡
+    static const unsigned int kVisibilityThreshold = 16;
+    static const unsigned int kQueryFrameCount = 3;
+
+    OcclusionCulling();
+
+    // 渲染线程，加载模型后调用；返回加入场景的节点（可能就是model本身）
+    static osg::ref_ptr<osg::Node> wrap(osg::Node* model);
+
+    // 任意线程调用，下一帧生效
+    void setEnabled(bool enabled) { _enabled = enabled; }
+    bool isEnabled() const { return _enabled; }
+
+    // 渲染线程，viewer->frame()之前调用：开关变化或场景变化时更新场景中所有查询节点
+    void update(osg::Group* root);
+
+protected:
+    virtual ~OcclusionCulling() {}
+
+private:
+    bool sceneChanged(osg::Group* root) const;
+
+    std::atomic<bool> _enabled;
+    bool _applied;
+    std::vector<const osg::Node*> _appliedChildren;
+};
+
+#endif // OCCLUSIONCULLING_H
@@ -0,0 +1,210 @@
+#include "pbrmaterialtable.h"
+#include "shaderprogramcache.h"
+#include "logger.h"
+#include <osg/BufferObject>
+#include <osg/NodeVisitor>
+#include <osg/Drawable>
+#include <osg/Uniform>
+#include <algorithm>
+
+namespace
+{
+    // 每项两个vec4：albedo，(metallic, roughness, ao, specular)
+    const int kFloatsPerMaterial = 8;
+
+    // 表满时的退路：材质直接写在StateSet上，着色器在materialIndex为-1时读取
+    void writeUniforms(osg::StateSet* stateSet, const PBRMaterialTable::Material& material)
+    {
+        stateSet->getOrCreateUniform("materialAlbedo", osg::Uniform::FLOAT_VEC4)->set(material.albedo);
+        stateSet->getOrCreateUniform("materialParams", osg::Uniform::FLOAT_VEC4)->set(
+            osg::Vec4(material.metallic, material.roughness, material.ao, material.specular));
+    }
+
+    // 收集子图中节点和drawable上带PBR材质的StateSet
+    class MaterialCollector : public osg::NodeVisitor
+    {
+    public:
+        MaterialCollector() : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN) {}
+
+        void apply(osg::Node& node) override
+        {
+            collect(node.getStateSet());
+            traverse(node);
+        }
+
+        void apply(osg::Drawable& drawable) override
+        {
+            collect(drawable.getStateSet());
+        }
+
+        std::vector<osg::StateSet*> stateSets;
+
+    private:
+        void collect(osg::StateSet* stateSet)
+        {
+            if (PBRMaterialTable::hasMaterial(stateSet) &&
+                std::find(stateSets.begin(), stateSets.end(), stateSet) == stateSets.end()) {
+                stateSets.push_back(stateSet);
+            }
+        }
+    };
+}
+
+// 挂在StateSet的UserData上，StateSet释放时归还槽位；index为-1表示材质在StateSet的独立uniform上
+class PBRMaterialSlot : public osg::Referenced
+{
+public:
+    explicit PBRMaterialSlot(int index) : _index(index) {}
+
+    int index() const { return _index; }
+
+protected:
+    virtual ~PBRMaterialSlot() { PBRMaterialTable::instance().release(_index); }
+
+private:
+    int _index;
+};
+
+PBRMaterialTable& PBRMaterialTable::instance()
+{
+    // 不析构：退出时仍可能有StateSet在归还槽位
+    static PBRMaterialTable* table = new PBRMaterialTable;
+    return *table;
+}
+
+PBRMaterialTable::PBRMaterialTable()
+    : _staging(kCapacity * kFloatsPerMaterial, 0.0f)
+    , _stagingDirty(false)
+    , _used(kCapacity, false)
+{
+    _data = new osg::FloatArray(kCapacity * kFloatsPerMaterial);
+    std::fill(_data->begin(), _data->end(), 0.0f);
+
+    osg::ref_ptr<osg::UniformBufferObject> ubo = new osg::UniformBufferObject;
+    _data->setBufferObject(ubo.get());
+    _binding = new osg::UniformBufferBinding(kBindingIndex, _data.get(), 0, _data->getTotalDataSize());
+
+    // 从小到大分配
+    for (int i = kCapacity - 1; i >= 0; --i) {
+        _freeSlots.push_back(i);
+    }
+}
+
+std::string PBRMaterialTable::shaderDefines()
+{
+    ShaderProgramCache::Defines defines;
+    defines["PBR_MAX_MATERIALS"] = std::to_string(kCapacity);
+    return ShaderProgramCache::formatDefines(defines);
+}
+
+void PBRMaterialTable::bindProgram(osg::Program* program)
+{
+    if (program) {
+        program->addBindUniformBlock("PBRMaterials", kBindingIndex);
+    }
+}
+
+void PBRMaterialTable::writeSlot(int index, const Material& material)
+{
+    float* slot = &_staging[index * kFloatsPerMaterial];
+    slot[0] = material.albedo.r();
+    slot[1] = material.albedo.g();
+    slot[2] = material.albedo.b();
+    slot[3] = material.albedo.a();
+    slot[4] = material.metallic;
+    slot[5] = material.roughness;
+    slot[6] = material.ao;
+    slot[7] = material.specular;
+}
+
+int PBRMaterialTable::assign(osg::StateSet* stateSet, const Material& material)
+{
+    if (!stateSet) return -1;
+
+    int index = -1;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_freeSlots.empty()) {
+            index = _freeSlots.back();
+            _freeSlots.pop_back();
+            _used[index] = true;
+            writeSlot(index, material);
+            _stagingDirty = true;
+        }
+    }
+
+    if (index < 0) {
+        // materialIndex保持0会读到别的物体的材质
+        LOG_WARNING("pbrmaterialtable", "material table full capacity=%d, using per-StateSet uniforms", kCapacity);
+        writeUniforms(stateSet, material);
+    }
+
+    osg::Uniform* indexUniform = stateSet->getOrCreateUniform("materialIndex", osg::Uniform::INT);
+    indexUniform->set(index);
+    stateSet->setAttribute(_binding.get());
+    stateSet->setUserData(new PBRMaterialSlot(index));
+    return index;
+}
+
+void PBRMaterialTable::setMaterial(osg::StateSet* stateSet, const Material& material)
+{
+    if (!hasMaterial(stateSet)) return;
+
+    int index = materialIndexOf(stateSet);
+    if (index < 0) {
+        writeUniforms(stateSet, material);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_used[index]) return;
+    writeSlot(index, material);
+    _stagingDirty = true;
+}
+
+void PBRMaterialTable::setAllMaterials(osg::Node* root, const Material& material)
+{
+    if (!root) return;
+
+    MaterialCollector collector;
+    root->accept(collector);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (osg::StateSet* stateSet : collector.stateSets) {
+        int index = materialIndexOf(stateSet);
+        if (index < 0) {
+            writeUniforms(stateSet, material);
+        } else if (_used[index]) {
+            writeSlot(index, material);
+            _stagingDirty = true;
+        }
+    }
+}
+
+void PBRMaterialTable::flush()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_stagingDirty) return;
+    std::copy(_staging.begin(), _staging.end(), _data->begin());
+    _data->dirty();
+    _stagingDirty = false;
+}
+
+void PBRMaterialTable::release(int index)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (index < 0 || index >= kCapacity || !_used[index]) return;
+    _used[index] = false;
+    _freeSlots.push_back(index);
+}
+
+bool PBRMaterialTable::hasMaterial(const osg::StateSet* stateSet)
+{
+    return stateSet && dynamic_cast<const PBRMaterialSlot*>(stateSet->getUserData());
+}
+
+int PBRMaterialTable::materialIndexOf(const osg::StateSet* stateSet)
+{
+    if (!hasMaterial(stateSet)) return -1;
+    return static_cast<const PBRMaterialSlot*>(stateSet->getUserData())->index();
+}
@@ -0,0 +1,82 @@
+#ifndef PBRMATERIALTABLE_H
+#define PBRMATERIALTABLE_H
+
+#include <osg/Array>
+#include <osg/BufferIndexBinding>
+#include <osg/Program>
+#include <osg/StateSet>
+#include <osg/Node>
+#include <osg/Vec4>
+#include <osg/ref_ptr>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 进程级PBR材质表
+// 所有PBR材质参数连续存放在一块uniform buffer中，每个drawable的StateSet只带一个materialIndex，
+// 修改材质时只改表中对应槽位并重新上传这块缓冲
+// 任意线程的修改先写入暂存表，渲染线程在帧边界调用flush()拷入上传用的数组，绘制时不会读到写了一半的槽位
+class PBRMaterialTable
+{
+public:
+    static PBRMaterialTable& instance();
+
+    // std140下每项32字节，256项共8KB，低于GL_MAX_UNIFORM_BLOCK_SIZE的最小保证16KB
+    static const int kCapacity = 256;
+    // uniform块绑定点
+    static const unsigned int kBindingIndex = 0;
+
+    struct Material
+    {
+        osg::Vec4 albedo;   // rgb为基础色，a为透明度
+        float metallic;
+        float roughness;
+        float ao;
+        float specular;
+
+        Material(const osg::Vec4& albedo = osg::Vec4(1.0f, 1.0f, 1.0f, 1.0f),
+                 float metallic = 0.0f, float roughness = 0.5f, float ao = 1.0f, float specular = 0.5f)
+            : albedo(albedo), metallic(metallic), roughness(roughness), ao(ao), specular(specular) {}
+    };
+
+    // 分配槽位并挂到stateSet上（materialIndex uniform + uniform buffer绑定），
+    // 槽位随stateSet释放而回收；表满时materialIndex为-1，材质改存在stateSet自己的uniform上，返回-1
+    int assign(osg::StateSet* stateSet, const Material& material);
+
+    // 只修改stateSet的材质（表中槽位或表满时的独立uniform）
+    void setMaterial(osg::StateSet* stateSet, const Material& material);
+    // 修改root子图中所有带PBR材质的StateSet，其他视口场景中的材质不受影响
+    void setAllMaterials(osg::Node* root, const Material& material);
+
+    // 渲染线程，帧边界调用：暂存表有修改时拷入上传用的数组并标记重新上传
+    void flush();
+
+    // stateSet是否经assign()带有PBR材质（包括表满时的独立uniform）
+    static bool hasMaterial(const osg::StateSet* stateSet);
+    // stateSet上的材质槽位，没有或使用独立uniform时返回-1
+    static int materialIndexOf(const osg::StateSet* stateSet);
+
+    // 着色器中声明材质表的#define，配合ShaderProgramCache使用
+    static std::string shaderDefines();
+    // 让程序的PBRMaterials块使用kBindingIndex
+    static void bindProgram(osg::Program* program);
+
+private:
+    PBRMaterialTable();
+    PBRMaterialTable(const PBRMaterialTable&) = delete;
+    PBRMaterialTable& operator=(const PBRMaterialTable&) = delete;
+
+    friend class PBRMaterialSlot;
+    void release(int index);
+    void writeSlot(int index, const Material& material);
+
+    std::mutex _mutex;
+    std::vector<float> _staging;
+    bool _stagingDirty;
+    osg::ref_ptr<osg::FloatArray> _data;
+    osg::ref_ptr<osg::UniformBufferBinding> _binding;
+    std::vector<bool> _used;
+    std::vector<int> _freeSlots;
+};
+
+#endif // PBRMATERIALTABLE_H
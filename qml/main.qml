@@ -385,6 +385,7 @@ ApplicationWindow {
                             case "model": return "模型管理";
                             case "light": return "光照控制";
                             case "particle": return "云海大气控制";
+                            case "physics": return "体积云控制";
                             default: return "功能面板";
                             }
                         }
@@ -409,7 +410,7 @@ ApplicationWindow {
                             case "light": return lightControls;
                             case "particle": return cloudSeaAtmosphereControls;
                             case "skynode": return skyNodeAtmosphereControls;
-                            case "physics": return physicsControls;  // 添加物理控制组件
+                            case "physics": return volumeCloudControls;  // 体积云场景的步进参数
                             default: return defaultControls;
                             }
                         }
@@ -1796,6 +1797,173 @@ ApplicationWindow {
                 y: 10
                 z: 100  // 确保在最上层显示
             }
+
+            // 帧耗时统计开关（左下角）
+            CheckBox {
+                id: profilingToggle
+                text: "帧耗时"
+                checked: osgViewer.profilingEnabled
+                onToggled: osgViewer.profilingEnabled = checked
+                x: 10
+                y: parent.height - height - 10
+                z: 100
+            }
+
+            // 异步裁剪开关（帧耗时开关右侧）
+            CheckBox {
+                id: threadedCullToggle
+                text: "异步裁剪"
+                checked: osgViewer.threadedCull
+                onToggled: osgViewer.threadedCull = checked
+                x: profilingToggle.x + profilingToggle.width + 10
+                y: parent.height - height - 10
+                z: 100
+            }
+
+            // 抗锯齿模式选择（异步裁剪开关右侧），顺序与SimpleOSGViewer.AntiAliasingMode一致
+            ComboBox {
+                id: antiAliasingSelector
+                model: ["无抗锯齿", "MSAA 2x", "MSAA 4x", "MSAA 8x", "FXAA", "TAA"]
+                currentIndex: osgViewer.antiAliasing
+                onActivated: function(index) { osgViewer.antiAliasing = index }
+                width: 110
+                x: threadedCullToggle.x + threadedCullToggle.width + 10
+                y: parent.height - height - 10
+                z: 100
+            }
+
+            // 动态分辨率开关（抗锯齿选择右侧），开启时显示当前渲染比例
+            CheckBox {
+                id: dynamicResolutionToggle
+                text: osgViewer.dynamicResolution
+                      ? "动态分辨率 " + Math.round(osgViewer.renderScale * 100) + "%"
+                      : "动态分辨率"
+                checked: osgViewer.dynamicResolution
+                onToggled: osgViewer.dynamicResolution = checked
+                x: antiAliasingSelector.x + antiAliasingSelector.width + 10
+                y: parent.height - height - 10
+                z: 100
+            }
+
+            // 遮挡剔除开关（动态分辨率右侧），只作用于加载的模型
+            CheckBox {
+                id: occlusionCullingToggle
+                text: "遮挡剔除"
+                checked: osgViewer.occlusionCulling
+                onToggled: osgViewer.occlusionCulling = checked
+                x: dynamicResolutionToggle.x + dynamicResolutionToggle.width + 10
+                y: parent.height - height - 10
+                z: 100
+            }
+
+            // 几何体压缩开关（遮挡剔除右侧），对之后加载的模型生效
+            CheckBox {
+                id: geometryCompactionToggle
+                text: "顶点压缩"
+                checked: osgViewer.geometryCompaction
+                onToggled: osgViewer.geometryCompaction = checked
+                x: occlusionCullingToggle.x + occlusionCullingToggle.width + 10
+                y: parent.height - height - 10
+                z: 100
+            }
+
+            // 截图与图像序列，写到图片目录下的qml-osg中
+            Button {
+                id: screenshotButton
+                text: "截图"
+                onClicked: osgViewer.captureScreenshot()
+                x: geometryCompactionToggle.x + geometryCompactionToggle.width + 10
+                y: parent.height - height - 10
+                z: 100
+            }
+
+            CheckBox {
+                id: recordingToggle
+                text: "录制"
+                checked: osgViewer.recording
+                onToggled: checked ? osgViewer.startRecording() : osgViewer.stopRecording()
+                x: screenshotButton.x + screenshotButton.width + 10
+                y: parent.height - height - 10
+                z: 100
+            }
+
+            // 天空质量（录制右侧），所有视口共用
+            ComboBox {
+                id: skyQualitySelector
+                model: ["天空: 低", "天空: 中", "天空: 高"]
+                currentIndex: osgViewer.skyQuality
+                onActivated: function(index) { osgViewer.skyQuality = index }
+                width: 100
+                x: recordingToggle.x + recordingToggle.width + 10
+                y: parent.height - height - 10
+                z: 100
+            }
+
+            // 纹理与几何内存统计（鼠标位置上方），淘汰数为已释放显存、等待再次绘制时回载的纹理
+            Text {
+                id: memoryUsageText
+                text: osgViewer.memoryUsage.gpuMB === undefined ? ""
+                      : "显存 " + osgViewer.memoryUsage.gpuMB.toFixed(1) + " / " + osgViewer.memoryUsage.budgetMB.toFixed(0) + " MB"
+                        + "  内存 " + osgViewer.memoryUsage.cpuMB.toFixed(1) + " MB"
+                        + "  纹理 " + osgViewer.memoryUsage.textures
+                        + "  缓冲 " + osgViewer.memoryUsage.buffers
+                        + (osgViewer.memoryUsage.evicted > 0 ? "  已淘汰 " + osgViewer.memoryUsage.evicted : "")
+                color: "white"
+                font.pixelSize: 12
+                x: parent.width - width - 10
+                y: mousePosition.y - height - 4
+                z: 100
+            }
+
+            // 帧耗时统计面板（相机位置下方），GPU为各pass的时间戳差，CPU为OSG各遍历耗时
+            Rectangle {
+                id: frameTimingOverlay
+                visible: osgViewer.profilingEnabled
+                x: 10
+                y: cameraPosition.y + cameraPosition.height + 10
+                z: 100
+                width: 260
+                height: frameTimingColumn.height + 16
+                color: "#99000000"
+                radius: 4
+
+                Column {
+                    id: frameTimingColumn
+                    x: 8
+                    y: 8
+                    width: parent.width - 16
+                    spacing: 2
+
+                    Text {
+                        text: "帧耗时 (ms, 平均 / 最大)"
+                        color: "white"
+                        font.pixelSize: 12
+                        font.bold: true
+                    }
+
+                    Repeater {
+                        model: osgViewer.frameTimings
+
+                        Row {
+                            width: frameTimingColumn.width
+
+                            Text {
+                                width: parent.width * 0.6
+                                text: (modelData.gpu ? "GPU  " : "CPU  ") + modelData.name
+                                color: modelData.gpu ? "#8fd3ff" : "#ffd27f"
+                                font.pixelSize: 12
+                            }
+                            Text {
+                                width: parent.width * 0.4
+                                horizontalAlignment: Text.AlignRight
+                                text: modelData.averageMs.toFixed(2) + " / " + modelData.maxMs.toFixed(2)
+                                color: "white"
+                                font.pixelSize: 12
+                            }
+                        }
+                    }
+                }
+            }
         }
     }
     
@@ -0,0 +1,429 @@
+#include "resourcetracker.h"
+#include "textureloader.h"
+#include <osg/DisplaySettings>
+#include <osg/Geometry>
+#include <osg/NodeCallback>
+#include <osg/NodeVisitor>
+#include <osg/Texture2D>
+#include <osg/TextureCubeMap>
+#include <osg/Timer>
+#include <osg/ValueObject>
+#include <osgDB/FileUtils>
+#include <osgDB/ReadFile>
+#include <QDebug>
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <string>
+
+namespace
+{
+    // 默认GPU预算
+    const std::size_t kDefaultBudget = 1024u * 1024u * 1024u;
+    // 未绘制超过该时长的纹理才会被淘汰，避免视锥边缘反复淘汰和回载
+    const unsigned int kMinIdleMs = 2000;
+    // 根节点的子节点不变时，隔这么久重新扫描一次，覆盖场景内部新增的节点
+    const unsigned int kRescanIntervalMs = 5000;
+
+    unsigned int nowMs()
+    {
+        return static_cast<unsigned int>(osg::Timer::instance()->time_m());
+    }
+
+    // 淘汰后替换原图的1x1中灰占位图，所有纹理共用
+    osg::Image* placeholder()
+    {
+        static osg::ref_ptr<osg::Image> image = []() {
+            osg::ref_ptr<osg::Image> result = new osg::Image;
+            result->allocateImage(1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+            std::fill_n(result->data(), 4, static_cast<unsigned char>(128));
+            return result;
+        }();
+        return image.get();
+    }
+
+    // 收集子树中的纹理和缓冲，以及持有它们的节点；drawable上的资源归到其父节点
+    class ScanVisitor : public osg::NodeVisitor
+    {
+    public:
+        ScanVisitor() : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
+        {
+            // 暂时隐藏的节点同样占用内存
+            setNodeMaskOverride(0xffffffff);
+        }
+
+        void apply(osg::Node& node) override
+        {
+            addStateSet(&node, node.getStateSet());
+            traverse(node);
+        }
+
+        void apply(osg::Drawable& drawable) override
+        {
+            const osg::NodePath& path = getNodePath();
+            if (path.size() < 2) return;
+            osg::Node* owner = path[path.size() - 2];
+
+            addStateSet(owner, drawable.getStateSet());
+
+            osg::Geometry* geometry = drawable.asGeometry();
+            if (!geometry || !geometry->getUseVertexBufferObjects()) return;
+
+            osg::Geometry::ArrayList arrays;
+            geometry->getArrayList(arrays);
+            for (const auto& array : arrays) {
+                if (array->getBufferObject()) buffers.emplace_back(owner, array.get());
+            }
+            osg::Geometry::DrawElementsList elements;
+            geometry->getDrawElementsList(elements);
+            for (osg::DrawElements* element : elements) {
+                if (element->getBufferObject()) buffers.emplace_back(owner, element);
+            }
+        }
+
+        std::vector<std::pair<osg::Node*, osg::Texture*> > textures;
+        std::vector<std::pair<osg::Node*, osg::BufferData*> > buffers;
+
+    private:
+        void addStateSet(osg::Node* owner, osg::StateSet* stateSet)
+        {
+            if (!stateSet) return;
+            for (const auto& unit : stateSet->getTextureAttributeList()) {
+                for (const auto& attribute : unit) {
+                    osg::Texture* texture = dynamic_cast<osg::Texture*>(attribute.second.first.get());
+                    if (texture) textures.emplace_back(owner, texture);
+                }
+            }
+        }
+    };
+}
+
+struct ResourceTracker::Resource
+{
+    osg::observer_ptr<osg::Texture> texture;
+    osg::observer_ptr<osg::BufferData> buffer;
+
+    // 纹理各面的源文件，以及是否经TextureLoader加载；为空表示不能回载，也就不会被淘汰
+    std::vector<std::string> sources;
+    std::vector<bool> viaLoader;
+
+    std::size_t cpuBytes = 0;
+    std::size_t gpuBytes = 0;
+
+    // 裁剪线程写入
+    std::atomic<unsigned int> lastDrawn{ 0 };
+
+    bool evicted = false;
+    unsigned int evictedAt = 0;
+    std::future<std::vector<osg::ref_ptr<osg::Image> > > reload;
+};
+
+// 节点被裁剪遍历访问时刷新其资源的最近绘制时间；可能在多个裁剪线程上同时执行
+class ResourceTracker::TouchCallback : public osg::NodeCallback
+{
+public:
+    explicit TouchCallback(const std::atomic<unsigned int>& now) : _now(now) {}
+
+    void add(const std::shared_ptr<Resource>& resource)
+    {
+        if (std::find(_resources.begin(), _resources.end(), resource) == _resources.end()) {
+            _resources.push_back(resource);
+        }
+    }
+
+    void operator()(osg::Node* node, osg::NodeVisitor* nv) override
+    {
+        const unsigned int now = _now.load(std::memory_order_relaxed);
+        for (const auto& resource : _resources) {
+            resource->lastDrawn.store(now, std::memory_order_relaxed);
+        }
+        traverse(node, nv);
+    }
+
+private:
+    const std::atomic<unsigned int>& _now;
+    // 只在渲染线程的帧边界、持有ResourceTracker::_mutex时修改，此时没有裁剪在进行
+    std::vector<std::shared_ptr<Resource> > _resources;
+};
+
+ResourceTracker& ResourceTracker::instance()
+{
+    // 不析构：退出时节点上的回调仍引用时钟
+    static ResourceTracker* tracker = new ResourceTracker;
+    return *tracker;
+}
+
+ResourceTracker::ResourceTracker()
+    : _budget(kDefaultBudget), _now(nowMs())
+{
+    _totals.budget = kDefaultBudget;
+}
+
+void ResourceTracker::attach(osg::Node* owner, const std::shared_ptr<Resource>& resource)
+{
+    // 节点上已有本类回调时复用，重复扫描不会叠加回调
+    TouchCallback* touch = nullptr;
+    for (osg::Callback* callback = owner->getCullCallback(); callback && !touch; callback = callback->getNestedCallback()) {
+        touch = dynamic_cast<TouchCallback*>(callback);
+    }
+    if (!touch) {
+        touch = new TouchCallback(_now);
+        owner->addCullCallback(touch);
+    }
+    touch->add(resource);
+}
+
+std::shared_ptr<ResourceTracker::Resource> ResourceTracker::registerTexture(osg::Texture* texture)
+{
+    std::shared_ptr<Resource>& resource = _resources[texture];
+    if (resource && resource->texture.valid()) return resource;
+
+    resource = std::make_shared<Resource>();
+    resource->texture = texture;
+    resource->lastDrawn = _now.load();
+
+    // 渲染目标没有图像；内容会被改写的图像（DYNAMIC）保留CPU数据
+    bool isStatic = texture->getNumImages() > 0 && texture->getDataVariance() != osg::Object::DYNAMIC;
+    for (unsigned int i = 0; i < texture->getNumImages() && isStatic; ++i) {
+        const osg::Image* image = texture->getImage(i);
+        isStatic = image && image->data() && image->getDataVariance() != osg::Object::DYNAMIC;
+    }
+    if (!isStatic) return resource;
+
+    texture->setUnRefImageDataAfterApply(true);
+
+    // 只有2D和立方体纹理、且每个面都来自磁盘上的文件时才能回载
+    bool reloadable = dynamic_cast<osg::Texture2D*>(texture) || dynamic_cast<osg::TextureCubeMap*>(texture);
+    for (unsigned int i = 0; i < texture->getNumImages() && reloadable; ++i) {
+        const osg::Image* image = texture->getImage(i);
+        bool viaLoader = false;
+        image->getUserValue(TextureLoader::kSourceTag, viaLoader);
+        reloadable = !image->getFileName().empty() && (viaLoader || osgDB::fileExists(image->getFileName()));
+        resource->sources.push_back(image->getFileName());
+        resource->viaLoader.push_back(viaLoader);
+    }
+    if (!reloadable) {
+        resource->sources.clear();
+        resource->viaLoader.clear();
+    }
+    return resource;
+}
+
+std::shared_ptr<ResourceTracker::Resource> ResourceTracker::registerBuffer(osg::BufferData* data)
+{
+    std::shared_ptr<Resource>& resource = _resources[data];
+    if (!resource || !resource->buffer.valid()) {
+        resource = std::make_shared<Resource>();
+        resource->buffer = data;
+        resource->lastDrawn = _now.load();
+    }
+    return resource;
+}
+
+void ResourceTracker::track(osg::Node* node)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    scan(node);
+}
+
+void ResourceTracker::scan(osg::Node* node)
+{
+    if (!node) return;
+
+    ScanVisitor visitor;
+    node->accept(visitor);
+    for (const auto& item : visitor.textures) {
+        attach(item.first, registerTexture(item.second));
+    }
+    for (const auto& item : visitor.buffers) {
+        attach(item.first, registerBuffer(item.second));
+    }
+}
+
+bool ResourceTracker::rootChanged(osg::Group* root)
+{
+    auto it = std::find_if(_roots.begin(), _roots.end(), [root](const Root& item) { return item.root == root; });
+    if (it == _roots.end()) {
+        _roots.push_back(Root());
+        it = _roots.end() - 1;
+        it->root = root;
+    }
+
+    std::vector<const osg::Node*> children;
+    for (unsigned int i = 0; i < root->getNumChildren(); ++i) {
+        children.push_back(root->getChild(i));
+    }
+
+    const unsigned int now = _now.load();
+    if (children == it->children && now - it->scannedAt < kRescanIntervalMs) return false;
+    it->children.swap(children);
+    it->scannedAt = now;
+    return true;
+}
+
+void ResourceTracker::refresh()
+{
+    // _resources是进程级的，各上下文（共享GL对象的上下文使用同一contextID）里的GL对象都要计入
+    const unsigned int numContexts = osg::DisplaySettings::instance()->getMaxNumberOfGraphicsContexts();
+    for (auto it = _resources.begin(); it != _resources.end();) {
+        Resource& resource = *it->second;
+        osg::ref_ptr<osg::Texture> texture;
+        osg::ref_ptr<osg::BufferData> buffer;
+        if (!resource.texture.lock(texture) && !resource.buffer.lock(buffer)) {
+            it = _resources.erase(it);
+            continue;
+        }
+
+        resource.cpuBytes = 0;
+        resource.gpuBytes = 0;
+        if (texture.valid()) {
+            for (unsigned int i = 0; i < texture->getNumImages(); ++i) {
+                const osg::Image* image = texture->getImage(i);
+                if (image && image->data() && image != placeholder()) {
+                    resource.cpuBytes += image->getTotalDataSize();
+                }
+            }
+            for (unsigned int contextID = 0; contextID < numContexts; ++contextID) {
+                osg::Texture::TextureObject* textureObject = texture->getTextureObject(contextID);
+                if (textureObject) {
+                    resource.gpuBytes += textureObject->size();
+                }
+            }
+        } else {
+            resource.cpuBytes = buffer->getTotalDataSize();
+            osg::BufferObject* bufferObject = buffer->getBufferObject();
+            for (unsigned int contextID = 0; bufferObject && contextID < numContexts; ++contextID) {
+                if (bufferObject->getGLBufferObject(contextID)) {
+                    resource.gpuBytes += buffer->getTotalDataSize();
+                }
+            }
+        }
+        ++it;
+    }
+}
+
+void ResourceTracker::pollReloads()
+{
+    for (auto& item : _resources) {
+        Resource& resource = *item.second;
+        if (!resource.evicted) continue;
+
+        osg::ref_ptr<osg::Texture> texture;
+        if (!resource.texture.lock(texture)) continue;
+
+        // 淘汰后又被绘制：开始回载
+        if (!resource.reload.valid() && resource.lastDrawn.load() > resource.evictedAt) {
+            std::vector<std::string> sources = resource.sources;
+            std::vector<bool> viaLoader = resource.viaLoader;
+            resource.reload = std::async(std::launch::async, [sources, viaLoader]() {
+                std::vector<osg::ref_ptr<osg::Image> > images;
+                for (std::size_t i = 0; i < sources.size(); ++i) {
+                    images.push_back(viaLoader[i] ? TextureLoader::instance().loadImage(sources[i])
+                                                  : osgDB::readRefImageFile(sources[i]));
+                }
+                return images;
+            });
+            continue;
+        }
+
+        if (!resource.reload.valid() || resource.reload.wait_for(std::chrono::seconds(0)) != std::future_status::ready) continue;
+
+        std::vector<osg::ref_ptr<osg::Image> > images = resource.reload.get();
+        bool complete = true;
+        for (const auto& image : images) {
+            complete = complete && image.valid();
+        }
+        if (!complete) {
+            // 源文件已不可读，保持占位图，不再淘汰也不再回载
+            qWarning() << "ResourceTracker: cannot reload" << QString::fromStdString(resource.sources.front());
+            resource.sources.clear();
+            resource.viaLoader.clear();
+            resource.evicted = false;
+            continue;
+        }
+        for (unsigned int i = 0; i < images.size(); ++i) {
+            texture->setImage(i, images[i].get());
+        }
+        resource.evicted = false;
+    }
+}
+
+void ResourceTracker::evict(std::size_t gpuBytes)
+{
+    const std::size_t budget = _budget.load();
+    if (gpuBytes <= budget) return;
+
+    const unsigned int now = _now.load();
+    std::vector<Resource*> candidates;
+    for (const auto& item : _resources) {
+        Resource& resource = *item.second;
+        if (resource.evicted || resource.sources.empty() || resource.gpuBytes == 0) continue;
+        if (now - resource.lastDrawn.load() < kMinIdleMs) continue;
+        candidates.push_back(&resource);
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Resource* a, const Resource* b) {
+        return a->lastDrawn.load() < b->lastDrawn.load();
+    });
+
+    for (Resource* resource : candidates) {
+        if (gpuBytes <= budget) break;
+
+        osg::ref_ptr<osg::Texture> texture;
+        if (!resource->texture.lock(texture)) continue;
+
+        // 所有上下文的纹理对象进入待删除列表，在各自下一次绘制时删除
+        texture->releaseGLObjects();
+        for (unsigned int i = 0; i < texture->getNumImages(); ++i) {
+            texture->setImage(i, placeholder());
+        }
+        resource->evicted = true;
+        resource->evictedAt = now;
+        gpuBytes -= std::min(gpuBytes, resource->gpuBytes);
+        resource->gpuBytes = 0;
+    }
+}
+
+void ResourceTracker::update(osg::Group* root, osg::State& /*state*/)
+{
+    // 多个视口的渲染线程各自调用，登记表和根节点列表整体加锁
+    std::lock_guard<std::mutex> lock(_mutex);
+    _now = nowMs();
+
+    if (root && rootChanged(root)) {
+        scan(root);
+    }
+    _roots.erase(std::remove_if(_roots.begin(), _roots.end(), [](const Root& item) { return !item.root.valid(); }),
+                 _roots.end());
+
+    pollReloads();
+    refresh();
+
+    std::size_t gpuBytes = 0;
+    for (const auto& item : _resources) {
+        gpuBytes += item.second->gpuBytes;
+    }
+    evict(gpuBytes);
+
+    Totals totals;
+    totals.budget = _budget.load();
+    for (const auto& item : _resources) {
+        const Resource& resource = *item.second;
+        totals.cpuBytes += resource.cpuBytes;
+        totals.gpuBytes += resource.gpuBytes;
+        if (resource.texture.valid()) {
+            ++totals.textures;
+        } else {
+            ++totals.buffers;
+        }
+        if (resource.evicted) ++totals.evicted;
+    }
+
+    std::lock_guard<std::mutex> totalsLock(_totalsMutex);
+    _totals = totals;
+}
+
+ResourceTracker::Totals ResourceTracker::totals() const
+{
+    std::lock_guard<std::mutex> lock(_totalsMutex);
+    return _totals;
+}
@@ -0,0 +1,91 @@
+#ifndef RESOURCETRACKER_H
+#define RESOURCETRACKER_H
+
+#include <osg/BufferObject>
+#include <osg/Group>
+#include <osg/Node>
+#include <osg/State>
+#include <osg/Texture>
+#include <osg/observer_ptr>
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// 纹理与几何内存统计（进程级，所有视口共用）
+// 登记场景中的纹理（连同其图像）和顶点/索引缓冲，记录CPU和GPU两侧的字节数；
+// 静态纹理上传后释放CPU侧图像数据（setUnRefImageDataAfterApply）。
+// 每个持有资源的节点挂一个裁剪回调，节点被裁剪遍历访问时记为“绘制过”；
+// GPU总量超出预算时，按最近绘制时间淘汰可以从文件回载的纹理：释放GL对象并换成1x1占位图，
+// 再次被绘制时在后台线程回载，完成后的帧边界换回原图
+class ResourceTracker
+{
+public:
+    struct Totals
+    {
+        std::size_t cpuBytes = 0;
+        std::size_t gpuBytes = 0;
+        std::size_t budget = 0;
+        unsigned int textures = 0;
+        unsigned int buffers = 0;
+        unsigned int evicted = 0;
+    };
+
+    static ResourceTracker& instance();
+
+    // 渲染线程（任一视口），在子树第一次上传之前调用；已登记的资源跳过
+    void track(osg::Node* node);
+
+    // 渲染线程，每帧场景切换之后、viewer->frame()之前调用：
+    // 根节点的子节点变化或距上次扫描过久时重新登记，刷新统计，完成回载并按预算淘汰
+    void update(osg::Group* root, osg::State& state);
+
+    // GPU预算（字节），任意线程设置，下一帧生效
+    void setBudget(std::size_t bytes) { _budget = bytes; }
+    std::size_t getBudget() const { return _budget; }
+
+    // 最近一次update()后的统计，线程安全
+    Totals totals() const;
+
+private:
+    ResourceTracker();
+    ResourceTracker(const ResourceTracker&) = delete;
+    ResourceTracker& operator=(const ResourceTracker&) = delete;
+
+    struct Resource;
+    class TouchCallback;
+
+    // 已扫描过的根节点及其子节点
+    struct Root
+    {
+        osg::observer_ptr<osg::Group> root;
+        std::vector<const osg::Node*> children;
+        unsigned int scannedAt = 0;
+    };
+
+    void attach(osg::Node* owner, const std::shared_ptr<Resource>& resource);
+    std::shared_ptr<Resource> registerTexture(osg::Texture* texture);
+    std::shared_ptr<Resource> registerBuffer(osg::BufferData* data);
+    void scan(osg::Node* node);
+    bool rootChanged(osg::Group* root);
+    // GPU字节数为所有上下文中GL对象之和
+    void refresh();
+    void pollReloads();
+    void evict(std::size_t gpuBytes);
+
+    std::atomic<std::size_t> _budget;
+    // 毫秒时钟，裁剪回调读取后写入资源的最近绘制时间
+    std::atomic<unsigned int> _now;
+
+    // 以下在各视口的渲染线程访问，由_mutex保护
+    std::mutex _mutex;
+    std::map<const osg::Referenced*, std::shared_ptr<Resource> > _resources;
+    std::vector<Root> _roots;
+
+    mutable std::mutex _totalsMutex;
+    Totals _totals;
+};
+
+#endif // RESOURCETRACKER_H
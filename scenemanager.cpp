@@ -0,0 +1,331 @@
+#include "scenemanager.h"
+#include "antialiasing.h"
+#include "logger.h"
+#include "resourcetracker.h"
+#include <osg/Geometry>
+#include <osg/NodeVisitor>
+#include <osg/Texture>
+#include <osgUtil/GLObjectsVisitor>
+#include <chrono>
+#include <set>
+
+namespace
+{
+    // 默认常驻预算
+    const std::size_t kDefaultMemoryBudget = 512u * 1024u * 1024u;
+
+    // 统计场景中纹理图像和几何数据的字节数，共享的数据只计一次
+    class SceneSizeVisitor : public osg::NodeVisitor
+    {
+    public:
+        SceneSizeVisitor() : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN), bytes(0) {}
+
+        void apply(osg::Node& node) override
+        {
+            addStateSet(node.getStateSet());
+            traverse(node);
+        }
+
+        void apply(osg::Drawable& drawable) override
+        {
+            addStateSet(drawable.getStateSet());
+
+            osg::Geometry* geometry = drawable.asGeometry();
+            if (!geometry) return;
+
+            osg::Geometry::ArrayList arrays;
+            geometry->getArrayList(arrays);
+            for (const auto& array : arrays) {
+                addBufferData(array.get());
+            }
+            osg::Geometry::DrawElementsList elements;
+            geometry->getDrawElementsList(elements);
+            for (osg::DrawElements* element : elements) {
+                addBufferData(element);
+            }
+        }
+
+        std::size_t bytes;
+
+    private:
+        void addStateSet(osg::StateSet* stateSet)
+        {
+            if (!stateSet || !_visited.insert(stateSet).second) return;
+
+            for (const auto& unit : stateSet->getTextureAttributeList()) {
+                for (const auto& attribute : unit) {
+                    osg::Texture* texture = dynamic_cast<osg::Texture*>(attribute.second.first.get());
+                    if (!texture) continue;
+                    for (unsigned int i = 0; i < texture->getNumImages(); ++i) {
+                        addBufferData(texture->getImage(i));
+                    }
+                }
+            }
+        }
+
+        void addBufferData(osg::BufferData* data)
+        {
+            if (data && _visited.insert(data).second) {
+                bytes += data->getTotalDataSize();
+            }
+        }
+
+        std::set<const osg::Referenced*> _visited;
+    };
+}
+
+SceneManager::SceneManager()
+    : _memoryBudget(kDefaultMemoryBudget), _useCounter(0)
+{
+}
+
+SceneManager::~SceneManager()
+{
+    // std::future析构时会等待仍在进行的构建结束
+}
+
+std::future<osg::ref_ptr<osg::Node>> SceneManager::launchBuild(const std::string& name, const Builder& builder)
+{
+    return std::async(std::launch::async, [builder, name]() -> osg::ref_ptr<osg::Node> {
+        try {
+            osg::ref_ptr<osg::Node> node = builder();
+            // 节点还没加入场景图，在这里一次性标记天空掩码位，渲染线程不再改写共享的节点掩码
+            AntiAliasing::markSkyNodes(node.get());
+            return node;
+        }
+        catch (const std::exception& e) {
+            LOG_WARNING("scenemanager", "failed to build name=%s error=%s", name.c_str(), e.what());
+        }
+        catch (...) {
+            LOG_WARNING("scenemanager", "failed to build name=%s", name.c_str());
+        }
+        return osg::ref_ptr<osg::Node>();
+    });
+}
+
+void SceneManager::startBuild(const std::string& key, const Builder& builder)
+{
+    Entry& entry = _entries[key];
+    if (entry.building || entry.node.valid()) return;
+
+    entry.building = true;
+    entry.compiled = false;
+    entry.pending = launchBuild(key, builder);
+}
+
+void SceneManager::attach(const Builder& builder, const Activator& attacher, const void* owner)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    Attachment attachment;
+    attachment.pending = launchBuild("attachment", builder);
+    attachment.attacher = attacher;
+    attachment.owner = owner;
+    _attachments.push_back(std::move(attachment));
+}
+
+void SceneManager::prewarm(const std::string& key, const Builder& builder)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    startBuild(key, builder);
+}
+
+void SceneManager::request(const std::string& key, const Builder& builder, const Activator& activator,
+                           const void* owner)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    startBuild(key, builder);
+    Request& pending = _requests[owner];
+    pending.key = key;
+    pending.activator = activator;
+}
+
+void SceneManager::cancelRequest(const void* owner)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _requests.erase(owner);
+    // 销毁future会等待构建结束，这里只丢掉回调，结果由其他视口的applyPending取走后丢弃
+    for (Attachment& attachment : _attachments) {
+        if (attachment.owner == owner) {
+            attachment.attacher = nullptr;
+            attachment.owner = nullptr;
+        }
+    }
+}
+
+void SceneManager::pollBuilds()
+{
+    for (auto it = _entries.begin(); it != _entries.end();) {
+        Entry& entry = it->second;
+        if (entry.building && entry.pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            entry.building = false;
+            entry.node = entry.pending.get();
+            if (!entry.node.valid()) {
+                for (auto request = _requests.begin(); request != _requests.end();) {
+                    if (request->second.key == it->first) {
+                        LOG_INFO("scenemanager", "scene is empty, switch cancelled key=%s", it->first.c_str());
+                        request = _requests.erase(request);
+                    } else {
+                        ++request;
+                    }
+                }
+                it = _entries.erase(it);
+                continue;
+            }
+            entry.bytes = estimateBytes(entry.node.get());
+        }
+        ++it;
+    }
+}
+
+bool SceneManager::isRequested(const std::string& key) const
+{
+    for (const auto& request : _requests) {
+        if (request.second.key == key) return true;
+    }
+    return false;
+}
+
+void SceneManager::compileOne(osg::State& state, const void* owner)
+{
+    // 优先编译本视口待切换的场景，其次是其他视口待切换的场景，最后是预热完成的场景
+    Entry* target = nullptr;
+    auto own = _requests.find(owner);
+    if (own != _requests.end()) {
+        auto requested = _entries.find(own->second.key);
+        if (requested != _entries.end() && requested->second.node.valid() && !requested->second.compiled) {
+            target = &requested->second;
+        }
+    }
+    for (auto it = _entries.begin(); !target && it != _entries.end(); ++it) {
+        if (it->second.node.valid() && !it->second.compiled && isRequested(it->first)) {
+            target = &it->second;
+        }
+    }
+    for (auto it = _entries.begin(); !target && it != _entries.end(); ++it) {
+        if (it->second.node.valid() && !it->second.compiled) {
+            target = &it->second;
+        }
+    }
+    if (!target) return;
+
+    compile(target->node.get(), state);
+    target->compiled = true;
+}
+
+void SceneManager::compile(osg::Node* node, osg::State& state)
+{
+    // 在第一次上传之前登记，静态纹理上传后即释放CPU侧图像
+    ResourceTracker::instance().track(node);
+
+    osgUtil::GLObjectsVisitor visitor(osgUtil::GLObjectsVisitor::COMPILE_DISPLAY_LISTS |
+                                      osgUtil::GLObjectsVisitor::COMPILE_STATE_ATTRIBUTES |
+                                      osgUtil::GLObjectsVisitor::CHECK_BLACK_LISTED_MODES);
+    visitor.setState(&state);
+    node->accept(visitor);
+}
+
+void SceneManager::evict()
+{
+    std::size_t total = 0;
+    for (const auto& item : _entries) {
+        total += item.second.bytes;
+    }
+
+    // 当前场景和待切换场景不淘汰
+    while (total > _memoryBudget) {
+        auto victim = _entries.end();
+        for (auto it = _entries.begin(); it != _entries.end(); ++it) {
+            if (it->first == _active || isRequested(it->first) || it->second.building) continue;
+            if (victim == _entries.end() || it->second.lastUsed < victim->second.lastUsed) {
+                victim = it;
+            }
+        }
+        if (victim == _entries.end()) break;
+
+        total -= victim->second.bytes;
+        _entries.erase(victim);
+    }
+}
+
+bool SceneManager::applyPending(osg::Group* rootNode, osg::State& state, const void* owner)
+{
+    if (!rootNode) return false;
+
+    // 构建完成的待加入节点：本视口的编译后加入，已撤销的直接丢弃
+    std::vector<std::pair<Activator, osg::ref_ptr<osg::Node>>> attached;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (auto it = _attachments.begin(); it != _attachments.end();) {
+            bool cancelled = !it->attacher;
+            if ((!cancelled && it->owner != owner) ||
+                it->pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                ++it;
+                continue;
+            }
+            osg::ref_ptr<osg::Node> node = it->pending.get();
+            if (!cancelled && node.valid()) {
+                compile(node.get(), state);
+                attached.push_back(std::make_pair(it->attacher, node));
+            }
+            it = _attachments.erase(it);
+        }
+    }
+    for (const auto& item : attached) {
+        item.first(item.second.get());
+    }
+
+    Activator activator;
+    osg::ref_ptr<osg::Node> scene;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        pollBuilds();
+        compileOne(state, owner);
+
+        // 只执行本视口的请求，切换回调引用的是发起请求的视口
+        auto request = _requests.find(owner);
+        auto it = request != _requests.end() ? _entries.find(request->second.key) : _entries.end();
+        if (it == _entries.end() || !it->second.node.valid() || !it->second.compiled) {
+            evict();
+            return false;
+        }
+
+        // 帧边界上整体替换根节点的子节点
+        rootNode->removeChildren(0, rootNode->getNumChildren());
+        rootNode->addChild(it->second.node.get());
+        scene = it->second.node;
+        it->second.lastUsed = ++_useCounter;
+
+        _active = request->second.key;
+        activator.swap(request->second.activator);
+        _requests.erase(request);
+        evict();
+    }
+
+    if (activator) {
+        activator(scene.get());
+    }
+    return true;
+}
+
+void SceneManager::setMemoryBudget(std::size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _memoryBudget = bytes;
+}
+
+std::size_t SceneManager::getResidentBytes() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::size_t total = 0;
+    for (const auto& item : _entries) {
+        total += item.second.bytes;
+    }
+    return total;
+}
+
+std::size_t SceneManager::estimateBytes(osg::Node* node)
+{
+    SceneSizeVisitor visitor;
+    node->accept(visitor);
+    return visitor.bytes;
+}
@@ -0,0 +1,98 @@
+#ifndef SCENEMANAGER_H
+#define SCENEMANAGER_H
+
+#include <osg/Group>
+#include <osg/Node>
+#include <osg/State>
+#include <osg/ref_ptr>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 场景管理器
+// 场景在后台线程构建（读纹理、组装节点、生成着色器程序），构建完成后在渲染线程每帧最多编译一个场景的GL对象；
+// 切换时在帧边界把根节点的子节点换成目标场景，最近用过的场景连同GL对象常驻，超出内存预算时按LRU淘汰
+class SceneManager
+{
+public:
+    // 在后台线程调用，只能创建节点，不能修改viewer
+    typedef std::function<osg::Node*()> Builder;
+    // 在渲染线程切换场景后调用，参数为切换上的场景，用于设置操作器、清屏色、视图参数等
+    typedef std::function<void(osg::Node*)> Activator;
+
+    SceneManager();
+    ~SceneManager();
+
+    // 预热：场景不在缓存中时开始后台构建
+    void prewarm(const std::string& key, const Builder& builder);
+    // 请求切换到场景，场景就绪后owner视口的第一帧生效；同一owner后一次请求覆盖前一次，
+    // 不同owner（共享场景的各视口）的请求互不覆盖，视口销毁前用cancelRequest撤销
+    void request(const std::string& key, const Builder& builder, const Activator& activator,
+                 const void* owner = nullptr);
+    // 后台构建一个节点（如导入的模型），完成后由owner视口在帧边界编译GL对象并调用attacher加入当前场景；
+    // 不替换根节点的子节点，也不进缓存
+    void attach(const Builder& builder, const Activator& attacher, const void* owner = nullptr);
+    // 撤销owner尚未生效的切换请求和待加入的节点，后台构建继续进行，切换请求的结果留在缓存中
+    void cancelRequest(const void* owner);
+
+    // 渲染线程，viewer->frame()之前调用，owner为调用的视口，只执行该视口的请求；发生切换时返回true
+    bool applyPending(osg::Group* rootNode, osg::State& state, const void* owner = nullptr);
+
+    // 常驻场景的内存预算（字节），只统计纹理图像和顶点/索引数据
+    void setMemoryBudget(std::size_t bytes);
+    std::size_t getMemoryBudget() const { return _memoryBudget; }
+    std::size_t getResidentBytes() const;
+
+private:
+    SceneManager(const SceneManager&) = delete;
+    SceneManager& operator=(const SceneManager&) = delete;
+
+    struct Entry
+    {
+        std::future<osg::ref_ptr<osg::Node>> pending;
+        osg::ref_ptr<osg::Node> node;
+        bool building = false;
+        bool compiled = false;
+        std::size_t bytes = 0;
+        unsigned int lastUsed = 0;
+    };
+
+    struct Attachment
+    {
+        std::future<osg::ref_ptr<osg::Node>> pending;
+        Activator attacher;
+        const void* owner = nullptr;
+    };
+
+    static std::future<osg::ref_ptr<osg::Node>> launchBuild(const std::string& name, const Builder& builder);
+    void startBuild(const std::string& key, const Builder& builder);
+    void pollBuilds();
+    struct Request
+    {
+        std::string key;
+        Activator activator;
+    };
+
+    bool isRequested(const std::string& key) const;
+    void compileOne(osg::State& state, const void* owner);
+    static void compile(osg::Node* node, osg::State& state);
+    void evict();
+    static std::size_t estimateBytes(osg::Node* node);
+
+    mutable std::mutex _mutex;
+    std::map<std::string, Entry> _entries;
+    std::vector<Attachment> _attachments;
+
+    // 按发起请求的视口分开保存
+    std::map<const void*, Request> _requests;
+    std::string _active;
+
+    std::size_t _memoryBudget;
+    unsigned int _useCounter;
+};
+
+#endif // SCENEMANAGER_H
@@ -10,7 +10,7 @@ out vec4 color;
 
 uniform float mieDirectionalG;
 uniform vec3 up;
-uniform vec3 cameraPosition;
+uniform mat4 osg_ViewMatrixInverse;  // 各视口的SceneView按自身相机设置
 uniform float sunZenithAngle;
 uniform float sunAzimuthAngle;
 uniform float cloudDensity;
@@ -40,6 +40,14 @@ const vec3 skycolour2 = vec3(0.4, 0.7, 1.0);
 
 const mat2 m = mat2(1.6, 1.2, -1.2, 1.6);
 
+// 质量档位（由SkyQuality注入#define，未注入时为最高质量）
+#ifndef FBM_OCTAVES
+#define FBM_OCTAVES 7
+#endif
+#ifndef FBM_SHAPE_OCTAVES
+#define FBM_SHAPE_OCTAVES 8
+#endif
+
 // 哈希函数
 vec2 hash(vec2 p) {
     p = vec2(dot(p, vec2(127.1, 311.7)), dot(p, vec2(269.5, 183.3)));
@@ -66,7 +74,7 @@ float noise(in vec2 p) {
 // 分形布朗运动
 float fbm(vec2 n) {
     float total = 0.0, amplitude = 0.1;
-    for (int i = 0; i < 7; i++) {
+    for (int i = 0; i < FBM_OCTAVES; i++) {
         total += noise(n) * amplitude;
         n = m * n;
         amplitude *= 0.4;
@@ -121,7 +129,7 @@ vec3 calculateAtmosphericLight(vec3 direction)
 void main() 
 {
     vec3 worldPos = vWorldPosition;
-    vec3 direction = normalize(worldPos - cameraPosition);
+    vec3 direction = normalize(worldPos - osg_ViewMatrixInverse[3].xyz);
     vec3 sunDir = vSunDirection;
 
     // 计算大气天空盒颜色
@@ -144,7 +152,7 @@ void main()
     uv *= cloudscale;
     uv -= q - time;
     float weight = 0.8;
-    for (int i = 0; i < 8; i++) {
+    for (int i = 0; i < FBM_SHAPE_OCTAVES; i++) {
         r += abs(weight * noise(uv));
         uv = m * uv + time;
         weight *= 0.7;
@@ -156,7 +164,7 @@ void main()
     uv *= cloudscale;
     uv -= q - time;
     weight = 0.7;
-    for (int i = 0; i < 8; i++) {
+    for (int i = 0; i < FBM_SHAPE_OCTAVES; i++) {
         f += weight * noise(uv);
         uv = m * uv + time;
         weight *= 0.6;
@@ -171,7 +179,7 @@ void main()
     uv *= cloudscale * 2.0;
     uv -= q - time;
     weight = 0.4;
-    for (int i = 0; i < 7; i++) {
+    for (int i = 0; i < FBM_OCTAVES; i++) {
         c += weight * noise(uv);
         uv = m * uv + time;
         weight *= 0.6;
@@ -184,7 +192,7 @@ void main()
     uv *= cloudscale * 3.0;
     uv -= q - time;
     weight = 0.4;
-    for (int i = 0; i < 7; i++) {
+    for (int i = 0; i < FBM_OCTAVES; i++) {
         c1 += abs(weight * noise(uv));
         uv = m * uv + time;
         weight *= 0.6;
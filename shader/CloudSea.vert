@@ -22,7 +22,7 @@ uniform float cloudHeight;   // 云高度
 uniform sampler2D iChannel0;
 uniform float iTime;
 
-uniform mat4 viewInverse;
+uniform mat4 osg_ViewMatrixInverse;  // 各视口的SceneView按自身相机设置
 uniform mat4 osg_ProjectionMatrix;
 uniform mat4 osg_ModelViewMatrix;
 
@@ -52,7 +52,7 @@ vec3 totalMie(float T){
 
 void main() 
 {
-    mat4 modelMatrix = viewInverse * osg_ModelViewMatrix;
+    mat4 modelMatrix = osg_ViewMatrixInverse * osg_ModelViewMatrix;
     vec4 worldPosition = modelMatrix * vec4(aPos, 1.0);
     vWorldPosition = worldPosition.xyz;
 
@@ -17,6 +17,15 @@ uniform float densityThreshold;
 uniform float contrast;
 uniform float densityFactor;
 uniform float stepSize;
+uniform int maxSteps;
+
+// 空域跳跃距离场（CloudOccupancyMap在CPU上生成）
+uniform sampler2D cloudSkipMap;
+uniform float skipCellSize;
+
+// 光照空间透射率图（CloudShadowMap在CPU上生成）：r=前表面深度，g=平均消光系数，b=最大光学厚度
+uniform sampler2D cloudShadowMap;
+uniform mat4 cloudShadowMatrix;
 
 // 光照参数
 const vec3 lightColor = vec3(1.2, 1.2, 1.2);
@@ -56,6 +65,14 @@ const float ONE_OVER_FOURPI = 0.07957747154594767;
 #define top 200
 #define width 400
 
+// 步进上限与空域跳跃开关（由VolumeCloudSky注入#define，循环上界为编译期常量便于驱动展开）
+#ifndef MAX_STEPS
+#define MAX_STEPS 200
+#endif
+#ifndef CLOUD_SKIP_EMPTY
+#define CLOUD_SKIP_EMPTY 1
+#endif
+
 // 光线与包围盒相交函数
 vec2 rayBoxDst(vec3 boundsMin, vec3 boundsMax, vec3 rayOrigin, vec3 invRaydir) {
     vec3 t0 = (boundsMin - rayOrigin) * invRaydir;
@@ -81,6 +98,12 @@ float sampleCloudMap(vec2 coord) {
     return texture2D(cloudMap, clampedCoord).x;
 }
 
+// pos所在格子到最近可能有云格子的切比雪夫距离（格子数），0表示当前格子可能有云
+float sampleSkipDistance(vec3 pos) {
+    vec2 uv = (pos.xz + vec2(width)) / (2.0 * width);
+    return texture2D(cloudSkipMap, uv).r * 255.0;
+}
+
 // 计算 pos 点的云密度 - 调整为更自然的云朵效果
 float getDensity(vec3 pos) {
     // 高度衰减 - 云层中部密度最大，模拟真实云朵分布
@@ -227,35 +250,14 @@ vec3 calculateAtmosphericLight(vec3 direction) {
     return retColor;
 }
 
-// 计算太阳可见度 (从当前点向太阳方向的透射率)
-float calculateSunVisibility(vec3 point, vec3 sunDir) {
-    float sunVisibility = 1.0;
-    vec3 sunVisStep = point;
+// 计算太阳可见度 (从当前点向太阳方向的透射率)，查透射率图一次得到
+float calculateSunVisibility(vec3 point) {
+    vec3 lightSpace = (cloudShadowMatrix * vec4(point, 1.0)).xyz;
+    vec3 beer = texture2D(cloudShadowMap, lightSpace.xy).rgb;
     
-    // 计算光线与云盒的相交点
-    vec3 boundsMin = vec3(-width, bottom, -width);
-    vec3 boundsMax = vec3(width, top, width);
-    vec3 invRayDir = 1.0 / sunDir;
-    vec2 rayDist = rayBoxDst(boundsMin, boundsMax, point, invRayDir);
-    
-    // 如果没有相交，返回完全可见
-    if(rayDist.y <= 0.0) {
-        return 1.0;
-    }
-    
-    // 向太阳方向的步进次数和步长
-    const int lightSteps = 8;
-    float stepLength = rayDist.y / float(lightSteps);
-    vec3 step = sunDir * stepLength;
-    
-    for(int j = 0; j < lightSteps; j++) {
-        float lightDensity = getDensity(sunVisStep);
-        // 使用Beer定律计算透射率
-        sunVisibility *= exp(-lightDensity * stepLength * 1.5);
-        sunVisStep += step;
-    }
-    
-    return sunVisibility;
+    // 前表面之后按平均消光系数累积，不超过整条光线的光学厚度
+    float opticalDepth = min(beer.b, beer.g * max(0.0, lightSpace.z - beer.r));
+    return exp(-opticalDepth);
 }
 
 // 计算环境光
@@ -301,8 +303,8 @@ vec4 getCloudWithFullLighting(vec3 worldPos, vec3 cameraPos, vec3 lightPos) {
     vec3 step = rayDir * stepLength;
     int maxStepCount = int(rayDist.y / stepLength);
     
-    // 限制最大步数
-    maxStepCount = min(maxStepCount, 200);
+    // 限制最大步数，maxSteps在当前变体的MAX_STEPS以内取值
+    maxStepCount = min(maxStepCount, min(maxSteps, MAX_STEPS));
     
     // 初始化累积值
     float transmittance = 1.0;  // 透射率
@@ -329,12 +331,28 @@ vec4 getCloudWithFullLighting(vec3 worldPos, vec3 cameraPos, vec3 lightPos) {
     point += step * worldNoiseOffset * 0.1;
 
     // ray marching
-    for(int i = 0; i < maxStepCount; i++) {
+    for(int i = 0; i < MAX_STEPS; i++) {
+        if (i >= maxStepCount) {
+            break;
+        }
+        
         // 检查是否超出云盒范围
         if(any(lessThan(point, boundsMin)) || any(greaterThan(point, boundsMax))) {
             break;
         }
         
+#if CLOUD_SKIP_EMPTY
+        // 空域跳跃：当前格子为空时按距离场整段越过，靠近云边界时恢复逐步步进
+        float skipCells = sampleSkipDistance(point);
+        if (skipCells >= 1.0) {
+            // 水平方向的安全距离换算成沿光线的整数步
+            float horizontal = max(max(abs(rayDir.x), abs(rayDir.z)), 1e-4);
+            float safeDist = (skipCells - 1.0) * skipCellSize / horizontal;
+            point += step * max(1.0, floor(safeDist / stepLength));
+            continue;
+        }
+#endif
+        
         // 采样密度
         float density = getDensity(point);
         
@@ -357,7 +375,7 @@ vec4 getCloudWithFullLighting(vec3 worldPos, vec3 cameraPos, vec3 lightPos) {
         }
         
         // 计算太阳可见度
-        float sunVisibility = calculateSunVisibility(point, sunDirection);
+        float sunVisibility = calculateSunVisibility(point);
         
         // 计算相位函数
         float cosTheta = dot(rayDir, sunDirection);
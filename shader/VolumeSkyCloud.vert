@@ -6,9 +6,8 @@ uniform float rayleigh;
 uniform float turbidity;
 uniform float mieCoefficient;
 uniform vec3 up;
-uniform vec3 cameraPosition;
 
-uniform mat4 viewInverse;
+uniform mat4 osg_ViewMatrixInverse;  // 各视口的SceneView按自身相机设置
 uniform mat4 osg_ProjectionMatrix;
 uniform mat4 osg_ModelViewMatrix;
 
@@ -70,7 +69,7 @@ vec3 totalMie(float T){
 
 void main() 
 {
-    mat4 modelMatrix = viewInverse * osg_ModelViewMatrix;
+    mat4 modelMatrix = osg_ViewMatrixInverse * osg_ModelViewMatrix;
 
     vec4 worldPosition = modelMatrix * vec4(aPos, 1.0);
     vWorldPosition = worldPosition.xyz;
@@ -94,7 +93,7 @@ void main()
     vBetaM = totalMie(turbidity) * mieCoefficient;
     
     // 云朵相关参数传递
-    vDirection = normalize(vWorldPosition - cameraPosition);
+    vDirection = normalize(vWorldPosition - osg_ViewMatrixInverse[3].xyz);
     vCloudSpeed = cloudSpeed;
     vCloudDensity = cloudDensity;
     vTime = time;
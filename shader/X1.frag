@@ -10,7 +10,7 @@ out vec4 color;
 
 uniform float mieDirectionalG;
 uniform vec3 up;
-uniform vec3 cameraPosition;
+uniform mat4 osg_ViewMatrixInverse;  // 各视口的SceneView按自身相机设置
 uniform float sunZenithAngle;  // 新增：太阳天顶角度
 uniform float sunAzimuthAngle;  // 新增：太阳方位角度
 // uniform sampler2D iChannel0;   // 新增：噪声纹理
@@ -57,6 +57,14 @@ const vec3 cloudcolourBase = vec3(1.3, 1.3, 1.2);  // 更亮的云颜色
 
 const mat2 m = mat2(1.6, 1.2, -1.2, 1.6);
 
+// 质量档位（由SkyQuality注入#define，未注入时为最高质量）
+#ifndef FBM_OCTAVES
+#define FBM_OCTAVES 7
+#endif
+#ifndef FBM_SHAPE_OCTAVES
+#define FBM_SHAPE_OCTAVES 8
+#endif
+
 // 哈希函数
 vec2 hash(vec2 p) {
     p = vec2(dot(p, vec2(127.1, 311.7)), dot(p, vec2(269.5, 183.3)));
@@ -83,7 +91,7 @@ float noise(in vec2 p) {
 // 分形布朗运动
 float fbm(vec2 n) {
     float total = 0.0, amplitude = 0.1;
-    for (int i = 0; i < 7; i++) {
+    for (int i = 0; i < FBM_OCTAVES; i++) {
         total += noise(n) * amplitude;
         n = m * n;
         amplitude *= 0.4;
@@ -106,7 +114,7 @@ float hgPhase(float cosTheta, float g)
 void main() 
 {
     vec3 worldPos = vWorldPosition;
-    vec3 direction = normalize(worldPos - cameraPosition);
+    vec3 direction = normalize(worldPos - osg_ViewMatrixInverse[3].xyz);
   
     vec3 sunDir = vSunDirection;
 
@@ -171,7 +179,7 @@ void main()
         uv_cloud *= 1.1;
         uv_cloud -= q - time;
         float weight = 0.8;
-        for (int i = 0; i < 8; i++) {
+        for (int i = 0; i < FBM_SHAPE_OCTAVES; i++) {
             r += abs(weight * noise(uv_cloud));
             uv_cloud = m * uv_cloud + time;
             weight *= 0.7;
@@ -183,7 +191,7 @@ void main()
         uv_cloud *= 1.1;
         uv_cloud -= q - time;
         weight = 0.7;
-        for (int i = 0; i < 8; i++) {
+        for (int i = 0; i < FBM_SHAPE_OCTAVES; i++) {
             f += weight * noise(uv_cloud);
             uv_cloud = m * uv_cloud + time;
             weight *= 0.6;
@@ -198,7 +206,7 @@ void main()
         uv_cloud *= 1.1 * 2.0;
         uv_cloud -= q - time;
         weight = 0.4;
-        for (int i = 0; i < 7; i++) {
+        for (int i = 0; i < FBM_OCTAVES; i++) {
             c += weight * noise(uv_cloud);
             uv_cloud = m * uv_cloud + time;
             weight *= 0.6;
@@ -211,7 +219,7 @@ void main()
         uv_cloud *= 1.1 * 3.0;
         uv_cloud -= q - time;
         weight = 0.4;
-        for (int i = 0; i < 7; i++) {
+        for (int i = 0; i < FBM_OCTAVES; i++) {
             c1 += abs(weight * noise(uv_cloud));
             uv_cloud = m * uv_cloud + time;
             weight *= 0.6;
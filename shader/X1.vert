@@ -9,7 +9,7 @@ uniform vec3 up;
 uniform float sunZenithAngle;  // 添加太阳天顶角度uniform
 uniform float sunAzimuthAngle;  // 添加太阳方位角度uniform
 
-uniform mat4 viewInverse;
+uniform mat4 osg_ViewMatrixInverse;  // 各视口的SceneView按自身相机设置
 uniform mat4 osg_ProjectionMatrix;
 uniform mat4 osg_ModelViewMatrix;
 
@@ -58,7 +58,7 @@ vec3 totalMie(float T){
 
 void main() 
 {
-    mat4 modelMatrix = viewInverse * osg_ModelViewMatrix;
+    mat4 modelMatrix = osg_ViewMatrixInverse * osg_ModelViewMatrix;
 
     vec4 worldPosition = modelMatrix * vec4(aPos, 1.0);
     vWorldPosition = worldPosition.xyz;
@@ -5,6 +5,8 @@
 #include <osg/Uniform>
 #include <osg/StateSet>
 #include <osg/Program>
+#include "shaderprogramcache.h"
+#include "textureloader.h"
 #include <osg/Shader>
 #include <osg/StateAttribute>
 #include <osg/MatrixTransform>
@@ -184,21 +186,8 @@ osg::Program* ShaderCube::createShaderProgram()
         }
     )";
     
-    // 创建着色器程序
-    osg::ref_ptr<osg::Program> program = new osg::Program;
-    
-    // 创建并添加顶点着色器
-    osg::ref_ptr<osg::Shader> vertexShader = new osg::Shader(osg::Shader::VERTEX, vertexShaderSource);
-    program->addShader(vertexShader);
-    
-    // 创建并添加片元着色器
-    osg::ref_ptr<osg::Shader> fragmentShader = new osg::Shader(osg::Shader::FRAGMENT, fragmentShaderSource);
-    program->addShader(fragmentShader);
-    
-    // 添加程序名称，便于调试
-    program->setName("BlinnPhongShaderCubeProgram");
-    
-    return program.release();
+    // 从进程级缓存获取着色器程序，程序名称便于调试
+    return ShaderProgramCache::instance().getProgram("BlinnPhongShaderCubeProgram", vertexShaderSource, fragmentShaderSource);
 }
 
 // 创建天空盒着色器程序
@@ -241,18 +230,8 @@ osg::Program* ShaderCube::createSkyBoxShaderProgram()
         }
     )";
     
-    // 创建着色器程序
-    osg::ref_ptr<osg::Program> program = new osg::Program;
-    
-    // 创建并添加顶点着色器
-    osg::ref_ptr<osg::Shader> vertexShader = new osg::Shader(osg::Shader::VERTEX, vertexShaderSource);
-    program->addShader(vertexShader);
-    
-    // 创建并添加片元着色器
-    osg::ref_ptr<osg::Shader> fragmentShader = new osg::Shader(osg::Shader::FRAGMENT, fragmentShaderSource);
-    program->addShader(fragmentShader);
-    
-    return program.release();
+    // 从进程级缓存获取着色器程序
+    return ShaderProgramCache::instance().getProgram("SkyBoxShaderProgram", vertexShaderSource, fragmentShaderSource);
 }
 
 
@@ -566,47 +545,13 @@ osg::Node* ShaderCube::createSkyBox(const std::string& resourcePath)
     // 创建状态集
     osg::ref_ptr<osg::StateSet> stateset = new osg::StateSet();
 
-    // 加载立方体贴图
-    osg::ref_ptr<osg::TextureCubeMap> cubemap = new osg::TextureCubeMap;
-
-    std::string faces[6] = {
-        resourcePath + "/px.png",
-        resourcePath + "/nx.png",
-        resourcePath + "/py.png",
-        resourcePath + "/ny.png",
-        resourcePath + "/pz.png",
-        resourcePath + "/nz.png"
-    };
-
-    osg::ref_ptr<osg::Image> imagePosX = osgDB::readImageFile(faces[0]);
-    osg::ref_ptr<osg::Image> imageNegX = osgDB::readImageFile(faces[1]);
-    osg::ref_ptr<osg::Image> imagePosY = osgDB::readImageFile(faces[2]);
-    osg::ref_ptr<osg::Image> imageNegY = osgDB::readImageFile(faces[3]);
-    osg::ref_ptr<osg::Image> imagePosZ = osgDB::readImageFile(faces[4]);
-    osg::ref_ptr<osg::Image> imageNegZ = osgDB::readImageFile(faces[5]);
-
-    bool allImagesLoaded = imagePosX.valid() && imageNegX.valid() && 
-                          imagePosY.valid() && imageNegY.valid() && 
-                          imagePosZ.valid() && imageNegZ.valid();
-
-    if (!allImagesLoaded) {
+    // 加载立方体贴图（6个面并行解码，优先使用压缩格式）
+    osg::ref_ptr<osg::TextureCubeMap> cubemap = TextureLoader::instance().loadCubeMap(resourcePath);
+    if (!cubemap.valid()) {
         std::cout << "Failed to load skybox textures" << std::endl;
         return new osg::Group;
     }
 
-    cubemap->setImage(osg::TextureCubeMap::POSITIVE_X, imagePosX);
-    cubemap->setImage(osg::TextureCubeMap::NEGATIVE_X, imageNegX);
-    cubemap->setImage(osg::TextureCubeMap::POSITIVE_Y, imagePosY);
-    cubemap->setImage(osg::TextureCubeMap::NEGATIVE_Y, imageNegY);
-    cubemap->setImage(osg::TextureCubeMap::POSITIVE_Z, imagePosZ);
-    cubemap->setImage(osg::TextureCubeMap::NEGATIVE_Z, imageNegZ);
-
-    cubemap->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
-    cubemap->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
-    cubemap->setWrap(osg::Texture::WRAP_R, osg::Texture::CLAMP_TO_EDGE);
-    cubemap->setFilter(osg::Texture::MIN_FILTER, osg::Texture::LINEAR);
-    cubemap->setFilter(osg::Texture::MAG_FILTER, osg::Texture::LINEAR);
-
     // ⚠️ 确保纹理设置在Geode的StateSet上（纹理单元0）
     stateset->setTextureAttributeAndModes(0, cubemap, osg::StateAttribute::ON);
 
@@ -709,22 +654,15 @@ osg::Node* ShaderCube::createSkyBoxWithNewClass(const std::string& resourcePath)
     // 创建新的SkyBox实例
     osg::ref_ptr<SkyBox> skybox = new SkyBox;
     
-    // 加载立方体贴图
-    osg::ref_ptr<osg::Image> posX = osgDB::readImageFile(resourcePath + "/px.png");
-    osg::ref_ptr<osg::Image> negX = osgDB::readImageFile(resourcePath + "/nx.png");
-    osg::ref_ptr<osg::Image> posY = osgDB::readImageFile(resourcePath + "/py.png");
-    osg::ref_ptr<osg::Image> negY = osgDB::readImageFile(resourcePath + "/ny.png");
-    osg::ref_ptr<osg::Image> posZ = osgDB::readImageFile(resourcePath + "/pz.png");
-    osg::ref_ptr<osg::Image> negZ = osgDB::readImageFile(resourcePath + "/nz.png");
-    
-    // 检查所有图像是否加载成功
-    if (!posX || !negX || !posY || !negY || !posZ || !negZ) {
+    // 加载立方体贴图（6个面并行解码，优先使用压缩格式）
+    osg::ref_ptr<osg::TextureCubeMap> cubemap = TextureLoader::instance().loadCubeMap(resourcePath);
+    if (!cubemap.valid()) {
         std::cout << "Failed to load one or more skybox textures" << std::endl;
         return new osg::Group;
     }
     
     // 设置环境贴图
-    skybox->setEnvironmentMap(0, posX, negX, posY, negY, posZ, negZ);
+    skybox->setEnvironmentMap(0, cubemap.get());
     
     // 添加几何体到天空盒
     skybox->addChild(geode);
@@ -7,6 +7,9 @@
 #include <osg/Uniform>
 #include <osg/StateSet>
 #include <osg/Program>
+#include "shaderprogramcache.h"
+#include "pbrmaterialtable.h"
+#include "iblbaker.h"
 #include <osg/Shader>
 #include <osg/StateAttribute>
 #include <osg/MatrixTransform>
@@ -21,6 +24,233 @@
 #include <osg/TextureCubeMap>
 #include <QDir>
 
+namespace
+{
+    // PBR着色器，定义PBR_BAKED_IBL时环境光使用预计算的球谐辐照度、预滤波贴图和BRDF积分表；
+    // 再定义PBR_IRRADIANCE_MAP时漫反射改用辐照度立方体贴图
+    const char* const kPBRVert = R"(#version 330 core
+        layout(location = 0) in vec3 aPos;
+        layout(location = 1) in vec3 aNormal;
+        
+        uniform mat4 osg_ModelViewProjectionMatrix;
+        uniform mat4 osg_ModelViewMatrix;
+        uniform mat3 osg_NormalMatrix;
+        
+        out vec3 WorldPos;
+        out vec3 Normal;
+        
+        void main()
+        {
+            WorldPos = vec3(osg_ModelViewMatrix * vec4(aPos, 1.0));
+            Normal = normalize(osg_NormalMatrix * aNormal);
+            gl_Position = osg_ModelViewProjectionMatrix * vec4(aPos, 1.0);
+        }
+    )";
+    
+    const char* const kPBRFrag = R"(#version 330 core
+        out vec4 FragColor;
+        in vec3 WorldPos;
+        in vec3 Normal;
+        
+        // 材质表，见PBRMaterialTable
+        struct PBRMaterial
+        {
+            vec4 albedo;    // rgb基础色，a透明度
+            vec4 params;    // metallic, roughness, ao, specular
+        };
+        layout(std140) uniform PBRMaterials
+        {
+            PBRMaterial materials[PBR_MAX_MATERIALS];
+        };
+        uniform int materialIndex;
+        // 材质表满时materialIndex为-1，材质在StateSet的独立uniform上
+        uniform vec4 materialAlbedo;
+        uniform vec4 materialParams;
+        
+        uniform vec3 lightPositions[4];
+        uniform vec3 lightColors[4];
+        uniform vec3 camPos;
+        
+#ifdef PBR_BAKED_IBL
+        // 预计算的IBL，见IBLBaker
+        uniform mat4 osg_ViewMatrixInverse;
+        uniform samplerCube prefilteredMap;
+        uniform sampler2D brdfLut;
+        uniform float prefilteredMaxLod;
+        
+#ifdef PBR_IRRADIANCE_MAP
+        // 实时捕获的环境用辐照度立方体贴图代替球谐，见EnvironmentCapture
+        uniform samplerCube irradianceMap;  // 已含余弦卷积和1/π
+        
+        vec3 evaluateIrradiance(vec3 n)
+        {
+            return texture(irradianceMap, n).rgb;
+        }
+#else
+        uniform vec3 irradianceSH[9];       // 已含余弦卷积和1/π
+        
+        vec3 evaluateIrradiance(vec3 n)
+        {
+            return irradianceSH[0] * 0.282095
+                 + irradianceSH[1] * (0.488603 * n.y)
+                 + irradianceSH[2] * (0.488603 * n.z)
+                 + irradianceSH[3] * (0.488603 * n.x)
+                 + irradianceSH[4] * (1.092548 * n.x * n.y)
+                 + irradianceSH[5] * (1.092548 * n.y * n.z)
+                 + irradianceSH[6] * (0.315392 * (3.0 * n.z * n.z - 1.0))
+                 + irradianceSH[7] * (1.092548 * n.x * n.z)
+                 + irradianceSH[8] * (0.546274 * (n.x * n.x - n.y * n.y));
+        }
+#endif
+#else
+        // 天空盒纹理采样器
+        uniform samplerCube skybox;
+#endif
+        
+        const float PI = 3.14159265359;
+        
+        // PBR函数
+        float DistributionGGX(vec3 N, vec3 H, float roughness)
+        {
+            float a = roughness*roughness;
+            float a2 = a*a;
+            float NdotH = max(dot(N, H), 0.0);
+            float NdotH2 = NdotH*NdotH;
+            float nom = a2;
+            float denom = (NdotH2 * (a2 - 1.0) + 1.0);
+            denom = PI * denom * denom;
+            return nom / max(denom, 0.0001);
+        }
+        
+        float GeometrySchlickGGX(float NdotV, float roughness)
+        {
+            float r = (roughness + 1.0);
+            float k = (r*r) / 8.0;
+            float nom = NdotV;
+            float denom = NdotV * (1.0 - k) + k;
+            return nom / max(denom, 0.0001);
+        }
+        
+        float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness)
+        {
+            float NdotV = max(dot(N, V), 0.0);
+            float NdotL = max(dot(N, L), 0.0);
+            float ggx2 = GeometrySchlickGGX(NdotV, roughness);
+            float ggx1 = GeometrySchlickGGX(NdotL, roughness);
+            return ggx1 * ggx2;
+        }
+        
+        vec3 fresnelSchlick(float cosTheta, vec3 F0)
+        {
+            return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+        }
+        
+        vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness)
+        {
+            return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+        }
+        
+#ifndef PBR_BAKED_IBL
+        // 从天空盒采样环境颜色
+        vec3 sampleEnvironment(vec3 dir)
+        {
+            return texture(skybox, dir).rgb;
+        }
+#endif
+        
+        void main()
+        {
+            PBRMaterial material = materialIndex >= 0 ? materials[materialIndex]
+                                                      : PBRMaterial(materialAlbedo, materialParams);
+            vec3 albedo = material.albedo.rgb;
+            float metallic = material.params.x;
+            float roughness = material.params.y;
+            float ao = material.params.z;
+            
+            vec3 N = normalize(Normal);
+            vec3 V = normalize(camPos - WorldPos);
+            vec3 R = reflect(-V, N);
+            
+            vec3 F0 = vec3(0.04);
+            F0 = mix(F0, albedo, metallic);
+            
+            // ============ 直接光照 ============
+            vec3 Lo = vec3(0.0);
+            for(int i = 0; i < 4; ++i)
+            {
+                vec3 L = normalize(lightPositions[i] - WorldPos);
+                vec3 H = normalize(V + L);
+                float distance = length(lightPositions[i] - WorldPos);
+                float attenuation = 1.0 / (distance * distance);
+                vec3 radiance = lightColors[i] * attenuation;
+                
+                float NDF = DistributionGGX(N, H, roughness);
+                float G = GeometrySmith(N, V, L, roughness);
+                vec3 F = fresnelSchlick(max(dot(H, V), 0.0), F0);
+                
+                vec3 kS = F;
+                vec3 kD = vec3(1.0) - kS;
+                kD *= 1.0 - metallic;
+                
+                vec3 numerator = NDF * G * F;
+                float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001;
+                vec3 specular = numerator / denominator;
+                
+                float NdotL = max(dot(N, L), 0.0);
+                Lo += (kD * albedo / PI + specular) * radiance * NdotL;
+            }
+            
+            // ============ IBL环境光 ============
+#ifdef PBR_BAKED_IBL
+            // 位置和法线在视图空间，环境按世界空间方向查询：漫反射一次球谐求值，镜面反射一次mip采样加一次查表
+            vec3 viewDir = normalize(-WorldPos);
+            float NdotV = max(dot(N, viewDir), 0.0);
+            mat3 viewToWorld = mat3(osg_ViewMatrixInverse);
+            vec3 worldN = normalize(viewToWorld * N);
+            vec3 worldR = normalize(viewToWorld * reflect(-viewDir, N));
+            
+            vec3 F = fresnelSchlickRoughness(NdotV, F0, roughness);
+            vec3 kD = (1.0 - F) * (1.0 - metallic);
+            vec3 diffuse = max(evaluateIrradiance(worldN), vec3(0.0)) * albedo;
+            vec3 prefilteredColor = textureLod(prefilteredMap, worldR, roughness * prefilteredMaxLod).rgb;
+            vec2 envBRDF = texture(brdfLut, vec2(NdotV, roughness)).rg;
+            vec3 specular = prefilteredColor * (F * envBRDF.x + envBRDF.y);
+#else
+            vec3 F = fresnelSchlickRoughness(max(dot(N, V), 0.0), F0, roughness);
+            vec3 kS = F;
+            vec3 kD = 1.0 - kS;
+            kD *= 1.0 - metallic;
+            
+            // 漫反射IBL（采样法线方向）
+            vec3 irradiance = sampleEnvironment(N);
+            vec3 diffuse = irradiance * albedo;
+            
+            // 镜面反射IBL（采样反射方向）
+            vec3 prefilteredColor = sampleEnvironment(R);
+            
+            // 简化的BRDF积分
+            float NdotV = max(dot(N, V), 0.0);
+            vec2 envBRDF = vec2(
+                mix(1.0, 0.0, roughness),  // x: 菲涅尔比例
+                roughness * 0.5             // y: 粗糙度贡献
+            );
+            vec3 specular = prefilteredColor * (F * envBRDF.x + envBRDF.y);
+#endif
+            
+            vec3 ambient = (kD * diffuse + specular) * ao;
+            
+            // ============ 最终颜色 ============  
+            vec3 color = ambient + Lo;
+            
+            // 增强对比度，但避免过度饱和
+            color = color / (color + vec3(1.0));
+            color = pow(color, vec3(1.0/2.2));
+            
+            FragColor = vec4(color, 1.0);
+        }
+    )";
+}
+
 // 创建带PBR效果的球体阵列
 osg::Node* ShaderPBR::createPBRSphere(float radius)
 {
@@ -53,11 +283,9 @@ osg::Node* ShaderPBR::createPBRSphere(float radius)
             // 获取状态集
             osg::StateSet* stateset = sphere->getOrCreateStateSet();
             
-            // 设置uniform变量
-            stateset->addUniform(new osg::Uniform("albedo", baseColor));
-            stateset->addUniform(new osg::Uniform("metallic", metallic));
-            stateset->addUniform(new osg::Uniform("roughness", roughness));
-            stateset->addUniform(new osg::Uniform("ao", 1.0f));  // 完全环境光遮蔽
+            // 写入材质表（完全环境光遮蔽）
+            PBRMaterialTable::instance().assign(stateset,
+                PBRMaterialTable::Material(osg::Vec4(baseColor, 1.0f), metallic, roughness, 1.0f));
             
             // 设置多个光源位置 - 适中的光源
             osg::ref_ptr<osg::Uniform> lightPositions = new osg::Uniform(osg::Uniform::FLOAT_VEC3, "lightPositions", 4);
@@ -161,6 +389,16 @@ osg::Node* ShaderPBR::createPBRSphereWithSkyboxTexture(float radius, osg::Textur
 {
     osg::ref_ptr<osg::Group> root = new osg::Group;
     
+    // 由天空盒烘焙IBL（有磁盘缓存），绑定在整个球体阵列上；失败时退回直接采样天空盒
+    IBLBaker::Maps iblMaps = IBLBaker::instance().bake(skyboxTexture);
+    osg::ref_ptr<osg::Program> program;
+    if (iblMaps.valid()) {
+        IBLBaker::apply(root->getOrCreateStateSet(), iblMaps);
+        program = ShaderPBR::createPBRShaderBakedIBL();
+    } else {
+        program = ShaderPBR::createPBRShaderSimpleIBL();
+    }
+    
     int rows = 5;
     int cols = 5;
     
@@ -181,11 +419,9 @@ osg::Node* ShaderPBR::createPBRSphereWithSkyboxTexture(float radius, osg::Textur
             osg::ref_ptr<osg::Node> sphere = ShaderPBR::createSingleSphere(radius);
             osg::StateSet* stateset = sphere->getOrCreateStateSet();
             
-            // 材质参数
-            stateset->addUniform(new osg::Uniform("albedo", baseColor));
-            stateset->addUniform(new osg::Uniform("metallic", metallic));
-            stateset->addUniform(new osg::Uniform("roughness", roughness));
-            stateset->addUniform(new osg::Uniform("ao", 1.0f));
+            // 材质参数写入材质表
+            PBRMaterialTable::instance().assign(stateset,
+                PBRMaterialTable::Material(osg::Vec4(baseColor, 1.0f), metallic, roughness, 1.0f));
             
             // 调整点光源位置，使其更容易观察到光照效果
             osg::ref_ptr<osg::Uniform> lightPositions = new osg::Uniform(osg::Uniform::FLOAT_VEC3, "lightPositions", 4);
@@ -206,14 +442,13 @@ osg::Node* ShaderPBR::createPBRSphereWithSkyboxTexture(float radius, osg::Textur
             // 调整相机位置，使其更适合观察球体阵列
             stateset->addUniform(new osg::Uniform("camPos", osg::Vec3(0.0f, -10.0f, 2.0f)));
             
-            // ⚠️ 关键：设置天空盒纹理到纹理单元1
-            if (skyboxTexture) {
+            // ⚠️ 关键：没有预计算IBL时设置天空盒纹理到纹理单元1
+            if (!iblMaps.valid() && skyboxTexture) {
                 stateset->setTextureAttributeAndModes(1, skyboxTexture, osg::StateAttribute::ON);
                 stateset->addUniform(new osg::Uniform("skybox", 1));
             }
             
             // 应用PBR着色器
-            osg::ref_ptr<osg::Program> program = ShaderPBR::createPBRShaderSimpleIBL();
             stateset->setAttributeAndModes(program, osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
             
             // 设置位置
@@ -245,7 +480,9 @@ osg::Node* ShaderPBR::createSingleSphere(float radius)
     
     // 创建顶点
     osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
-    osg::ref_ptr<osg::Vec3Array> normals = new osg::Vec3Array;
+    // 法线用归一化的16位整数，着色器读到的仍是[-1,1]的vec3
+    osg::ref_ptr<osg::Vec3sArray> normals = new osg::Vec3sArray;
+    normals->setNormalize(true);
     
     // 球体参数 - 适中的细分度
     int segments = 30;
@@ -269,23 +506,21 @@ osg::Node* ShaderPBR::createSingleSphere(float radius)
             vertices->push_back(osg::Vec3(x * radius, y * radius, z * radius));
             // 法线方向（单位向量）
             float length = sqrt(x*x + y*y + z*z);
-            if (length > 0) {
-                normals->push_back(osg::Vec3(x/length, y/length, z/length));
-            } else {
-                normals->push_back(osg::Vec3(0, 1, 0));  // 默认法线
-            }
+            osg::Vec3 normal = length > 0 ? osg::Vec3(x/length, y/length, z/length) : osg::Vec3(0, 1, 0);  // 默认法线
+            normals->push_back(osg::Vec3s(static_cast<short>(std::round(normal.x() * 32767.0f)),
+                                          static_cast<short>(std::round(normal.y() * 32767.0f)),
+                                          static_cast<short>(std::round(normal.z() * 32767.0f))));
         }
     }
     
+    // 位置数组同时用于包围盒和拾取，与属性0是同一个数组，只上传一份；
+    // 法线只有着色器读取，不再作为固定管线法线重复绑定
     geometry->setVertexArray(vertices);
-    geometry->setNormalArray(normals, osg::Array::BIND_PER_VERTEX);
-    
-    // 设置顶点属性数组
     geometry->setVertexAttribArray(0, vertices, osg::Array::BIND_PER_VERTEX);  // 位置属性
     geometry->setVertexAttribArray(1, normals, osg::Array::BIND_PER_VERTEX);   // 法线属性
     
-    // 创建索引
-    osg::ref_ptr<osg::DrawElementsUInt> indices = new osg::DrawElementsUInt(GL_TRIANGLES);
+    // 创建索引，顶点数远小于65536，用16位索引
+    osg::ref_ptr<osg::DrawElementsUShort> indices = new osg::DrawElementsUShort(GL_TRIANGLES);
     for (int r = 0; r < rings; ++r) {
         for (int s = 0; s < segments; ++s) {
             int first = (r * (segments + 1)) + s;
@@ -313,169 +548,34 @@ osg::Node* ShaderPBR::createSingleSphere(float radius)
 // 简化版PBR着色器（带增强IBL）
 osg::Program* ShaderPBR::createPBRShaderSimpleIBL()
 {
-    // 顶点着色器
-    static const char* vertCode = R"(#version 330 core
-        layout(location = 0) in vec3 aPos;
-        layout(location = 1) in vec3 aNormal;
-        
-        uniform mat4 osg_ModelViewProjectionMatrix;
-        uniform mat4 osg_ModelViewMatrix;
-        uniform mat3 osg_NormalMatrix;
-        
-        out vec3 WorldPos;
-        out vec3 Normal;
-        
-        void main()
-        {
-            WorldPos = vec3(osg_ModelViewMatrix * vec4(aPos, 1.0));
-            Normal = normalize(osg_NormalMatrix * aNormal);
-            gl_Position = osg_ModelViewProjectionMatrix * vec4(aPos, 1.0);
-        }
-    )";
-    
-    // 片段着色器 - 简化版IBL
-    static const char* fragCode = R"(#version 330 core
-        out vec4 FragColor;
-        in vec3 WorldPos;
-        in vec3 Normal;
-        
-        uniform vec3 albedo;
-        uniform float metallic;
-        uniform float roughness;
-        uniform float ao;
-        uniform vec3 lightPositions[4];
-        uniform vec3 lightColors[4];
-        uniform vec3 camPos;
-        
-        // 天空盒纹理采样器
-        uniform samplerCube skybox;
-        
-        const float PI = 3.14159265359;
-        
-        // PBR函数
-        float DistributionGGX(vec3 N, vec3 H, float roughness)
-        {
-            float a = roughness*roughness;
-            float a2 = a*a;
-            float NdotH = max(dot(N, H), 0.0);
-            float NdotH2 = NdotH*NdotH;
-            float nom = a2;
-            float denom = (NdotH2 * (a2 - 1.0) + 1.0);
-            denom = PI * denom * denom;
-            return nom / max(denom, 0.0001);
-        }
-        
-        float GeometrySchlickGGX(float NdotV, float roughness)
-        {
-            float r = (roughness + 1.0);
-            float k = (r*r) / 8.0;
-            float nom = NdotV;
-            float denom = NdotV * (1.0 - k) + k;
-            return nom / max(denom, 0.0001);
-        }
-        
-        float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness)
-        {
-            float NdotV = max(dot(N, V), 0.0);
-            float NdotL = max(dot(N, L), 0.0);
-            float ggx2 = GeometrySchlickGGX(NdotV, roughness);
-            float ggx1 = GeometrySchlickGGX(NdotL, roughness);
-            return ggx1 * ggx2;
-        }
-        
-        vec3 fresnelSchlick(float cosTheta, vec3 F0)
-        {
-            return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
-        }
-        
-        vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness)
-        {
-            return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
-        }
-        
-        // 从天空盒采样环境颜色
-        vec3 sampleEnvironment(vec3 dir)
-        {
-            return texture(skybox, dir).rgb;
-        }
-        
-        void main()
-        {
-            vec3 N = normalize(Normal);
-            vec3 V = normalize(camPos - WorldPos);
-            vec3 R = reflect(-V, N);
-            
-            vec3 F0 = vec3(0.04);
-            F0 = mix(F0, albedo, metallic);
-            
-            // ============ 直接光照 ============
-            vec3 Lo = vec3(0.0);
-            for(int i = 0; i < 4; ++i)
-            {
-                vec3 L = normalize(lightPositions[i] - WorldPos);
-                vec3 H = normalize(V + L);
-                float distance = length(lightPositions[i] - WorldPos);
-                float attenuation = 1.0 / (distance * distance);
-                vec3 radiance = lightColors[i] * attenuation;
-                
-                float NDF = DistributionGGX(N, H, roughness);
-                float G = GeometrySmith(N, V, L, roughness);
-                vec3 F = fresnelSchlick(max(dot(H, V), 0.0), F0);
-                
-                vec3 kS = F;
-                vec3 kD = vec3(1.0) - kS;
-                kD *= 1.0 - metallic;
-                
-                vec3 numerator = NDF * G * F;
-                float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001;
-                vec3 specular = numerator / denominator;
-                
-                float NdotL = max(dot(N, L), 0.0);
-                Lo += (kD * albedo / PI + specular) * radiance * NdotL;
-            }
-            
-            // ============ IBL环境光 ============
-            vec3 F = fresnelSchlickRoughness(max(dot(N, V), 0.0), F0, roughness);
-            vec3 kS = F;
-            vec3 kD = 1.0 - kS;
-            kD *= 1.0 - metallic;
-            
-            // 漫反射IBL（采样法线方向）
-            vec3 irradiance = sampleEnvironment(N);
-            vec3 diffuse = irradiance * albedo;
-            
-            // 镜面反射IBL（采样反射方向）
-            vec3 prefilteredColor = sampleEnvironment(R);
-            
-            // 简化的BRDF积分
-            float NdotV = max(dot(N, V), 0.0);
-            vec2 envBRDF = vec2(
-                mix(1.0, 0.0, roughness),  // x: 菲涅尔比例
-                roughness * 0.5             // y: 粗糙度贡献
-            );
-            vec3 specular = prefilteredColor * (F * envBRDF.x + envBRDF.y);
-            
-            vec3 ambient = (kD * diffuse + specular) * ao;
-            
-            // ============ 最终颜色 ============  
-            vec3 color = ambient + Lo;
-            
-            // 增强对比度，但避免过度饱和
-            color = color / (color + vec3(1.0));
-            color = pow(color, vec3(1.0/2.2));
-            
-            FragColor = vec4(color, 1.0);
-        }
-    )";
-    
-    // 编译shader
-    osg::ref_ptr<osg::Shader> vertShader = new osg::Shader(osg::Shader::VERTEX, vertCode);
-    osg::ref_ptr<osg::Shader> fragShader = new osg::Shader(osg::Shader::FRAGMENT, fragCode);
-    osg::ref_ptr<osg::Program> program = new osg::Program;
-    program->addShader(vertShader);
-    program->addShader(fragShader);
-    
-    return program.release();
+    // 从进程级缓存获取，25个球体共用同一个程序
+    osg::Program* program = ShaderProgramCache::instance().getProgram("PBRShaderSimpleIBL", kPBRVert, kPBRFrag,
+                                                                      PBRMaterialTable::shaderDefines());
+    PBRMaterialTable::bindProgram(program);
+    return program;
+}
+
+// 使用预计算IBL的PBR着色器，贴图和uniform由IBLBaker::apply绑定
+osg::Program* ShaderPBR::createPBRShaderBakedIBL()
+{
+    ShaderProgramCache::Defines defines;
+    defines["PBR_BAKED_IBL"] = "1";
+    osg::Program* program = ShaderProgramCache::instance().getProgram("PBRShaderBakedIBL", kPBRVert, kPBRFrag,
+        PBRMaterialTable::shaderDefines() + ShaderProgramCache::formatDefines(defines));
+    PBRMaterialTable::bindProgram(program);
+    return program;
+}
+
+// 使用实时捕获环境的PBR着色器，贴图和uniform由EnvironmentCapture::apply绑定
+osg::Program* ShaderPBR::createPBRShaderCapturedIBL()
+{
+    ShaderProgramCache::Defines defines;
+    defines["PBR_BAKED_IBL"] = "1";
+    defines["PBR_IRRADIANCE_MAP"] = "1";
+    osg::Program* program = ShaderProgramCache::instance().getProgram("PBRShaderCapturedIBL", kPBRVert, kPBRFrag,
+        PBRMaterialTable::shaderDefines() + ShaderProgramCache::formatDefines(defines));
+    PBRMaterialTable::bindProgram(program);
+    return program;
 }
 
 // 改进版PBR着色器 - 添加简化的IBL支持
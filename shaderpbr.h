@@ -31,6 +31,12 @@ public:
     // 创建简化版PBR着色器（带增强IBL）
     static osg::Program* createPBRShaderSimpleIBL();
     
+    // 创建使用预计算IBL（球谐辐照度、预滤波贴图、BRDF积分表）的PBR着色器，配合IBLBaker使用
+    static osg::Program* createPBRShaderBakedIBL();
+    
+    // 创建使用实时捕获环境（预滤波贴图、辐照度贴图、BRDF积分表）的PBR着色器，配合EnvironmentCapture使用
+    static osg::Program* createPBRShaderCapturedIBL();
+    
     // 创建带天空盒的PBR场景
     static osg::Node* createPBRSceneWithSkybox(float sphereRadius = 1.0f);
     
@@ -0,0 +1,277 @@
+#include "shaderprogramcache.h"
+#include "logger.h"
+#include <osg/GL>
+#include <osg/GLExtensions>
+#include <osg/Shader>
+#include <osgDB/ReadFile>
+#include <osgDB/FileNameUtils>
+#include <QDir>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+    // 二进制缓存文件头
+    const char kBinaryMagic[8] = { 'O', 'S', 'G', 'P', 'B', 'I', 'N', '1' };
+
+    // FNV-1a 64位哈希，跨进程稳定，可作为磁盘文件名
+    uint64_t fnv1a(const std::string& data, uint64_t hash = 14695981039346656037ULL)
+    {
+        for (unsigned char c : data) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    std::string toHex(uint64_t value)
+    {
+        char buffer[17];
+        std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(value));
+        return std::string(buffer);
+    }
+
+    std::string glString(GLenum name)
+    {
+        const GLubyte* str = glGetString(name);
+        return str ? std::string(reinterpret_cast<const char*>(str)) : std::string();
+    }
+}
+
+ShaderProgramCache& ShaderProgramCache::instance()
+{
+    static ShaderProgramCache cache;
+    return cache;
+}
+
+ShaderProgramCache::ShaderProgramCache()
+    : _driverQueried(false), _binarySupported(false)
+{
+}
+
+std::string ShaderProgramCache::formatDefines(const Defines& defines)
+{
+    std::string result;
+    for (const auto& define : defines) {
+        result += "#define " + define.first + " " + define.second + "\n";
+    }
+    return result;
+}
+
+std::string ShaderProgramCache::injectDefines(const std::string& source, const std::string& defines)
+{
+    if (defines.empty()) return source;
+
+    // #version必须是第一条语句，defines放在它的下一行
+    std::string::size_type versionPos = source.find("#version");
+    if (versionPos == std::string::npos) {
+        return defines + "\n" + source;
+    }
+    std::string::size_type lineEnd = source.find('\n', versionPos);
+    if (lineEnd == std::string::npos) {
+        return source + "\n" + defines + "\n";
+    }
+    return source.substr(0, lineEnd + 1) + defines + "\n" + source.substr(lineEnd + 1);
+}
+
+osg::Program* ShaderProgramCache::getProgram(const std::string& name,
+                                             const std::string& vertSource,
+                                             const std::string& fragSource,
+                                             const std::string& defines)
+{
+    std::string key = toHex(fnv1a(defines, fnv1a(std::string(1, '\0'), fnv1a(fragSource, fnv1a(std::string(1, '\0'), fnv1a(vertSource))))));
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _entries.find(key);
+    if (it != _entries.end()) {
+        return it->second.program.get();
+    }
+
+    osg::ref_ptr<osg::Shader> vertShader = new osg::Shader(osg::Shader::VERTEX, injectDefines(vertSource, defines));
+    osg::ref_ptr<osg::Shader> fragShader = new osg::Shader(osg::Shader::FRAGMENT, injectDefines(fragSource, defines));
+    vertShader->setName(name + ".vert");
+    fragShader->setName(name + ".frag");
+
+    osg::ref_ptr<osg::Program> program = new osg::Program;
+    program->setName(name);
+    program->addShader(vertShader.get());
+    program->addShader(fragShader.get());
+
+    Entry& entry = _entries[key];
+    entry.program = program;
+    _unresolved.push_back(key);
+
+    return program.get();
+}
+
+osg::Program* ShaderProgramCache::getProgramFromFiles(const std::string& vertFile,
+                                                      const std::string& fragFile,
+                                                      const std::string& defines)
+{
+    osg::ref_ptr<osg::Shader> vert = osgDB::readShaderFile(osg::Shader::VERTEX, vertFile);
+    osg::ref_ptr<osg::Shader> frag = osgDB::readShaderFile(osg::Shader::FRAGMENT, fragFile);
+    if (!vert.valid() || !frag.valid()) {
+        LOG_WARNING("shaderprogramcache", "failed to read vert=%s frag=%s", vertFile.c_str(), fragFile.c_str());
+        return nullptr;
+    }
+
+    std::string name = osgDB::getNameLessExtension(osgDB::getSimpleFileName(fragFile));
+    return getProgram(name, vert->getShaderSource(), frag->getShaderSource(), defines);
+}
+
+osg::Program* ShaderProgramCache::getProgramFromFiles(const std::string& vertFile,
+                                                      const std::string& fragFile,
+                                                      const Defines& defines)
+{
+    return getProgramFromFiles(vertFile, fragFile, formatDefines(defines));
+}
+
+void ShaderProgramCache::queryDriver(osg::State& state)
+{
+    _driverQueried = true;
+
+    // GL 4.1起为核心功能，兼容上下文下依赖扩展
+    _binarySupported = osg::getGLVersionNumber() >= 4.1f ||
+                       osg::isGLExtensionSupported(state.getContextID(), "GL_ARB_get_program_binary");
+    if (!_binarySupported) {
+        LOG_INFO("shaderprogramcache", "program binaries not supported, in-memory cache only");
+        return;
+    }
+
+    // 二进制只在同一驱动下有效，按厂商/渲染器/版本分目录
+    std::string driver = glString(GL_VENDOR) + "|" + glString(GL_RENDERER) + "|" + glString(GL_VERSION);
+    QString baseDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (baseDir.isEmpty()) {
+        baseDir = QDir::currentPath();
+    }
+    QString dir = baseDir + "/shader_cache/" + QString::fromStdString(toHex(fnv1a(driver)));
+    if (!QDir().mkpath(dir)) {
+        LOG_WARNING("shaderprogramcache", "cannot create cache directory dir=%s", qPrintable(dir));
+        _binarySupported = false;
+        return;
+    }
+    _cacheDirectory = dir.toStdString();
+}
+
+std::string ShaderProgramCache::binaryPath(const std::string& key) const
+{
+    return _cacheDirectory + "/" + key + ".bin";
+}
+
+osg::Program::ProgramBinary* ShaderProgramCache::readBinary(const std::string& key) const
+{
+    std::ifstream file(binaryPath(key), std::ios::binary);
+    if (!file) return nullptr;
+
+    char magic[sizeof(kBinaryMagic)];
+    uint32_t format = 0;
+    uint32_t size = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&format), sizeof(format));
+    file.read(reinterpret_cast<char*>(&size), sizeof(size));
+    if (!file || !std::equal(magic, magic + sizeof(magic), kBinaryMagic) || size == 0) {
+        return nullptr;
+    }
+
+    osg::ref_ptr<osg::Program::ProgramBinary> binary = new osg::Program::ProgramBinary;
+    binary->allocate(size);
+    file.read(reinterpret_cast<char*>(binary->getData()), size);
+    if (!file) return nullptr;
+
+    binary->setFormat(format);
+    return binary.release();
+}
+
+void ShaderProgramCache::writeBinary(const std::string& key, const osg::Program::ProgramBinary* binary) const
+{
+    if (!binary || binary->getSize() == 0) return;
+
+    std::ofstream file(binaryPath(key), std::ios::binary | std::ios::trunc);
+    if (!file) {
+        LOG_WARNING("shaderprogramcache", "cannot write path=%s", binaryPath(key).c_str());
+        return;
+    }
+
+    uint32_t format = binary->getFormat();
+    uint32_t size = binary->getSize();
+    file.write(kBinaryMagic, sizeof(kBinaryMagic));
+    file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+    file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    file.write(reinterpret_cast<const char*>(binary->getData()), size);
+}
+
+void ShaderProgramCache::prepare(osg::State& state)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_unresolved.empty()) return;
+
+    if (!_driverQueried) {
+        queryDriver(state);
+    }
+
+    for (const std::string& key : _unresolved) {
+        Entry& entry = _entries[key];
+        if (entry.binaryState != BINARY_PENDING) continue;
+
+        if (!_binarySupported) {
+            entry.binaryState = BINARY_DONE;
+            continue;
+        }
+
+        osg::ref_ptr<osg::Program::ProgramBinary> binary = readBinary(key);
+        if (binary.valid()) {
+            entry.program->setProgramBinary(binary.get());
+            entry.binaryState = BINARY_LOADED;
+        } else {
+            // 空二进制通知OSG链接时设置GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+            entry.program->setProgramBinary(new osg::Program::ProgramBinary);
+            entry.binaryState = BINARY_REQUESTED;
+        }
+    }
+
+    _unresolved.erase(std::remove_if(_unresolved.begin(), _unresolved.end(),
+                                     [this](const std::string& key) { return _entries[key].binaryState == BINARY_DONE; }),
+                      _unresolved.end());
+}
+
+void ShaderProgramCache::collect(osg::State& state)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_unresolved.empty() || !_binarySupported) return;
+
+    for (const std::string& key : _unresolved) {
+        Entry& entry = _entries[key];
+        if (entry.binaryState != BINARY_LOADED && entry.binaryState != BINARY_REQUESTED) continue;
+
+        // 程序尚未被绘制过，下一帧再看
+        osg::Program::PerContextProgram* pcp = entry.program->getPCP(state);
+        if (!pcp || pcp->needsLink()) continue;
+
+        if (entry.binaryState == BINARY_LOADED) {
+            if (pcp->isLinked()) {
+                entry.binaryState = BINARY_DONE;
+            } else {
+                // 驱动更新等原因导致二进制失效，删除缓存并从源码重新链接
+                LOG_WARNING("shaderprogramcache", "binary rejected program=%s", entry.program->getName().c_str());
+                std::remove(binaryPath(key).c_str());
+                entry.program->setProgramBinary(new osg::Program::ProgramBinary);
+                entry.program->dirtyProgram();
+                entry.binaryState = BINARY_REQUESTED;
+            }
+            continue;
+        }
+
+        if (pcp->isLinked()) {
+            osg::ref_ptr<osg::Program::ProgramBinary> binary = entry.program->compileProgramBinary(state);
+            writeBinary(key, binary.get());
+        }
+        entry.binaryState = BINARY_DONE;
+    }
+
+    _unresolved.erase(std::remove_if(_unresolved.begin(), _unresolved.end(),
+                                     [this](const std::string& key) { return _entries[key].binaryState == BINARY_DONE; }),
+                      _unresolved.end());
+}
@@ -0,0 +1,79 @@
+#ifndef SHADERPROGRAMCACHE_H
+#define SHADERPROGRAMCACHE_H
+
+#include <osg/Program>
+#include <osg/State>
+#include <osg/ref_ptr>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 进程级着色器程序缓存
+// 以着色器源码和#define的哈希为键，同一程序只创建一次，切换场景时直接复用已链接的GL程序；
+// 同时把glGetProgramBinary的结果按驱动分目录写盘，下次启动直接glProgramBinary跳过编译链接
+class ShaderProgramCache
+{
+public:
+    static ShaderProgramCache& instance();
+
+    // 着色器变体的#define集合，按名称排序保证同一组合得到同一个键
+    typedef std::map<std::string, std::string> Defines;
+    static std::string formatDefines(const Defines& defines);
+
+    // 从源码获取程序，defines会插入到#version行之后
+    osg::Program* getProgram(const std::string& name,
+                             const std::string& vertSource,
+                             const std::string& fragSource,
+                             const std::string& defines = std::string());
+
+    // 从着色器文件获取程序，任一文件读取失败返回nullptr
+    osg::Program* getProgramFromFiles(const std::string& vertFile,
+                                      const std::string& fragFile,
+                                      const std::string& defines = std::string());
+    osg::Program* getProgramFromFiles(const std::string& vertFile,
+                                      const std::string& fragFile,
+                                      const Defines& defines);
+
+    // 渲染线程，frame()之前调用：为新程序挂上磁盘中的二进制
+    void prepare(osg::State& state);
+    // 渲染线程，frame()之后调用：取回新链接程序的二进制写盘，二进制被驱动拒绝时回退到源码重新链接
+    void collect(osg::State& state);
+
+    // 在#version行之后插入defines
+    static std::string injectDefines(const std::string& source, const std::string& defines);
+
+private:
+    ShaderProgramCache();
+    ShaderProgramCache(const ShaderProgramCache&) = delete;
+    ShaderProgramCache& operator=(const ShaderProgramCache&) = delete;
+
+    enum BinaryState
+    {
+        BINARY_PENDING,     // 尚未查找磁盘缓存
+        BINARY_LOADED,      // 已挂上磁盘中的二进制，等待确认链接成功
+        BINARY_REQUESTED,   // 从源码链接，链接后取回二进制
+        BINARY_DONE
+    };
+
+    struct Entry
+    {
+        osg::ref_ptr<osg::Program> program;
+        BinaryState binaryState = BINARY_PENDING;
+    };
+
+    void queryDriver(osg::State& state);
+    std::string binaryPath(const std::string& key) const;
+    osg::Program::ProgramBinary* readBinary(const std::string& key) const;
+    void writeBinary(const std::string& key, const osg::Program::ProgramBinary* binary) const;
+
+    std::mutex _mutex;
+    std::map<std::string, Entry> _entries;
+    std::vector<std::string> _unresolved;   // binaryState不为BINARY_DONE的键
+
+    bool _driverQueried;
+    bool _binarySupported;
+    std::string _cacheDirectory;
+};
+
+#endif // SHADERPROGRAMCACHE_H
@@ -0,0 +1,108 @@
+#include "sharedscene.h"
+#include <QOpenGLContext>
+#include <algorithm>
+#include <map>
+
+namespace
+{
+    // 每个GL上下文一份，只持有弱引用，场景的生命周期由视口决定
+    std::mutex s_registryMutex;
+    std::map<QOpenGLContext*, osg::observer_ptr<SharedScene>> s_registry;
+}
+
+osg::ref_ptr<SharedScene> SharedScene::acquire(QOpenGLContext* context)
+{
+    std::lock_guard<std::mutex> lock(s_registryMutex);
+
+    osg::ref_ptr<SharedScene> scene;
+    auto it = s_registry.find(context);
+    if (it != s_registry.end() && it->second.lock(scene)) {
+        return scene;
+    }
+
+    scene = new SharedScene(context);
+    s_registry[context] = scene.get();
+    return scene;
+}
+
+SharedScene::SharedScene(QOpenGLContext* context)
+    : _context(context)
+    , _rootNode(new osg::Group)
+    , _sceneManager(std::make_shared<SceneManager>())
+    , _demoShader(new DemoShader)
+    , _cullsInFlight(0)
+{
+}
+
+SharedScene::~SharedScene()
+{
+    std::lock_guard<std::mutex> lock(s_registryMutex);
+    auto it = s_registry.find(_context);
+    if (it != s_registry.end() && it->second.get() == this) {
+        s_registry.erase(it);
+    }
+}
+
+osgViewer::GraphicsWindowEmbedded* SharedScene::createGraphicsWindow(int width, int height)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    osg::ref_ptr<osg::GraphicsContext::Traits> traits = new osg::GraphicsContext::Traits;
+    traits->x = 0;
+    traits->y = 0;
+    traits->width = width;
+    traits->height = height;
+
+    // 有仍存在的窗口时共用它的contextID，GL对象按contextID缓存，所有视口都能直接使用
+    _graphicsWindows.erase(std::remove_if(_graphicsWindows.begin(), _graphicsWindows.end(),
+                                          [](const osg::observer_ptr<osg::GraphicsContext>& gc) { return !gc.valid(); }),
+                           _graphicsWindows.end());
+    if (!_graphicsWindows.empty()) {
+        traits->sharedContext = _graphicsWindows.front().get();
+    }
+
+    osgViewer::GraphicsWindowEmbedded* window = new osgViewer::GraphicsWindowEmbedded(traits.get());
+    _graphicsWindows.push_back(window);
+    return window;
+}
+
+void SharedScene::attach(const void* view)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (std::find(_views.begin(), _views.end(), view) == _views.end()) {
+        _views.push_back(view);
+    }
+}
+
+void SharedScene::detach(const void* view)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _views.erase(std::remove(_views.begin(), _views.end(), view), _views.end());
+}
+
+bool SharedScene::isUpdateOwner(const void* view) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return !_views.empty() && _views.front() == view;
+}
+
+void SharedScene::beginCull()
+{
+    std::lock_guard<std::mutex> lock(_cullMutex);
+    ++_cullsInFlight;
+}
+
+void SharedScene::endCull()
+{
+    {
+        std::lock_guard<std::mutex> lock(_cullMutex);
+        --_cullsInFlight;
+    }
+    _cullFinished.notify_all();
+}
+
+void SharedScene::waitForCulls()
+{
+    std::unique_lock<std::mutex> lock(_cullMutex);
+    _cullFinished.wait(lock, [this]() { return _cullsInFlight == 0; });
+}
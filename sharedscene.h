@@ -0,0 +1,65 @@
+#ifndef SHAREDSCENE_H
+#define SHAREDSCENE_H
+
+#include <osg/Group>
+#include <osg/Referenced>
+#include <osg/observer_ptr>
+#include <osg/ref_ptr>
+#include <osgViewer/GraphicsWindow>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "scenemanager.h"
+#include "demoshader.h"
+
+class QOpenGLContext;
+
+// 多视口共享场景
+// 同一窗口里的所有QQuickFramebufferObject在同一个QOpenGLContext中渲染，这些视口共用一棵场景树、
+// 一个SceneManager和DemoShader，各自的嵌入式窗口共用OSG contextID，纹理和着色器程序只编译一次；
+// 每个视口只保留自己的viewer、相机和ViewManager
+class SharedScene : public osg::Referenced
+{
+public:
+    // 渲染线程调用：取该GL上下文上的共享场景，没有时创建；最后一个视口释放后销毁
+    static osg::ref_ptr<SharedScene> acquire(QOpenGLContext* context);
+
+    osg::Group* getRootNode() const { return _rootNode.get(); }
+    const std::shared_ptr<SceneManager>& getSceneManager() const { return _sceneManager; }
+    DemoShader* getDemoShader() const { return _demoShader.get(); }
+
+    // 为视口创建嵌入式窗口，与已有视口的窗口共用contextID
+    osgViewer::GraphicsWindowEmbedded* createGraphicsWindow(int width, int height);
+
+    // 场景的更新遍历每帧只由一个视口执行：最早注册且仍存在的视口
+    void attach(const void* view);
+    void detach(const void* view);
+    bool isUpdateOwner(const void* view) const;
+
+    // 异步裁剪计数：修改共享场景（更新遍历、场景切换）之前要等所有视口的裁剪结束
+    void beginCull();
+    void endCull();
+    void waitForCulls();
+
+protected:
+    virtual ~SharedScene();
+
+private:
+    explicit SharedScene(QOpenGLContext* context);
+
+    QOpenGLContext* _context;
+    osg::ref_ptr<osg::Group> _rootNode;
+    std::shared_ptr<SceneManager> _sceneManager;
+    osg::ref_ptr<DemoShader> _demoShader;
+
+    mutable std::mutex _mutex;
+    std::vector<osg::observer_ptr<osg::GraphicsContext>> _graphicsWindows;
+    std::vector<const void*> _views;
+
+    std::mutex _cullMutex;
+    std::condition_variable _cullFinished;
+    int _cullsInFlight;
+};
+
+#endif // SHAREDSCENE_H
@@ -14,6 +14,7 @@
 #include <osg/ref_ptr>
 #include <osgViewer/Viewer>
 #include <osgViewer/GraphicsWindow>
+#include <osgViewer/Renderer>
 #include <osg/Camera>
 #include <osg/Group>
 #include <osg/Geode>
@@ -39,16 +40,36 @@
 #include <osg/Program>
 #include <osg/Shader>
 #include <QDebug>
+#include <algorithm>
 #include "shadercube.h"
+#include "shaderprogramcache.h"
+#include "pbrmaterialtable.h"
+#include "sharedscene.h"
+#include "resourcetracker.h"
+#include "indirectbatcher.h"
+#include "antialiasing.h"
 
 SimpleOSGRenderer::SimpleOSGRenderer(SimpleOSGViewer::ViewType viewType)
-    : m_initialized(false), m_viewType(viewType), m_mouseHandler(new MouseHandler()), m_uiHandler(new UIHandler())
+    : m_initialized(false), m_viewType(viewType), m_mouseHandler(new MouseHandler()), m_uiHandler(new UIHandler()), m_frameProfiler(new FrameProfiler()), m_useSharedScene(false), m_threadedCull(false), m_antiAliasing(new AntiAliasing()), m_dynamicResolution(new DynamicResolution()), m_publishedRenderScale(1.0f), m_occlusionCulling(new OcclusionCulling()), m_frameCapture(new FrameCapture()), m_cameraSnapshotDirty(false)
 {
     
 }
 
 SimpleOSGRenderer::~SimpleOSGRenderer()
 {
+    // 裁剪线程还在使用viewer和场景
+    finishCull();
+    
+    if (QOpenGLContext::currentContext()) {
+        m_frameProfiler->releaseGLObjects();
+        m_dynamicResolution->releaseGLObjects();
+        m_frameCapture->releaseGLObjects();
+    }
+    if (m_sharedScene.valid()) {
+        // 切换回调引用了本视口，共享的场景管理器不能在本视口销毁后再执行它
+        m_sharedScene->getSceneManager()->cancelRequest(m_uiHandler);
+        m_sharedScene->detach(this);
+    }
     delete m_mouseHandler;
     delete m_uiHandler;
 }
@@ -64,15 +85,26 @@ void SimpleOSGRenderer::initializeOSG(int width, int height)
     }
     
     try {
+        // 上下文支持多重间接绘制时，之后加载的模型合批绘制
+        QOpenGLContext* context = QOpenGLContext::currentContext();
+        IndirectBatcher::setSupported(context->format().version() >= qMakePair(4, 3) ||
+                                      context->hasExtension("GL_ARB_multi_draw_indirect"));
+        
         // 创建Viewer
         m_viewer = new osgViewer::Viewer();
         
-        // 创建根节点
-        m_rootNode = new osg::Group();
-        
-        // 创建图形环境
-        osg::ref_ptr<osgViewer::GraphicsWindowEmbedded> graphicsWindow = 
-            new osgViewer::GraphicsWindowEmbedded(0, 0, width, height);
+        // 创建根节点和图形环境；共享模式下根节点、场景管理器和GL对象与同一窗口的其他视口共用
+        osg::ref_ptr<osgViewer::GraphicsWindowEmbedded> graphicsWindow;
+        if (m_useSharedScene) {
+            m_sharedScene = SharedScene::acquire(QOpenGLContext::currentContext());
+            m_sharedScene->attach(this);
+            m_rootNode = m_sharedScene->getRootNode();
+            m_uiHandler->setSharedResources(m_sharedScene->getSceneManager(), m_sharedScene->getDemoShader());
+            graphicsWindow = m_sharedScene->createGraphicsWindow(width, height);
+        } else {
+            m_rootNode = new osg::Group();
+            graphicsWindow = new osgViewer::GraphicsWindowEmbedded(0, 0, width, height);
+        }
         
         // 设置相机
         osg::Camera* camera = m_viewer->getCamera();
@@ -91,8 +123,10 @@ void SimpleOSGRenderer::initializeOSG(int width, int height)
         // 设置视图场景
         m_viewer->setSceneData(m_rootNode.get());
         
-        // 添加简单场景
-        createSimpleScene();
+        // 添加简单场景，共享场景已有内容时不再添加
+        if (m_rootNode->getNumChildren() == 0) {
+            createSimpleScene();
+        }
         
         // 启用轨迹球操作器，允许鼠标旋转 (所有视图类型)
         osg::ref_ptr<osgGA::TrackballManipulator> manipulator = new osgGA::TrackballManipulator;
@@ -136,6 +170,9 @@ void SimpleOSGRenderer::initializeOSG(int width, int height)
         // 初始化viewer
         m_viewer->realize();
         
+        // 后台预热常用场景
+        m_uiHandler->prewarmScenes(m_viewer.get());
+        
         // checkGLError("After initializeOSG");
     }
     catch (const std::exception& e) {
@@ -152,9 +189,10 @@ void SimpleOSGRenderer::initializeOSG(int width, int height)
 void SimpleOSGRenderer::createShape()
 {
     if (m_viewer && m_rootNode) {
-        m_uiHandler->createShape(m_viewer, m_rootNode, m_shapeNode);
-        // 重置视图以适应新创建的立方体
-        resetView(m_viewType);
+        // 场景切换上来后重置视图以适应新创建的立方体
+        m_uiHandler->createShape(m_viewer, m_rootNode, m_shapeNode, [this](osg::Node*) {
+            resetView(m_viewType);
+        });
     }
 }
 
@@ -162,22 +200,23 @@ void SimpleOSGRenderer::createShape()
 void SimpleOSGRenderer::createPBRScene()
 {
     if (m_viewer && m_rootNode) {
-        m_uiHandler->createPBRScene(m_viewer, m_rootNode, m_shapeNode);
-        // 重置视图以适应新创建的场景
-        resetView(m_viewType);
-        
-        // 确保相机操作器正确设置
-        osgGA::TrackballManipulator* manipulator = dynamic_cast<osgGA::TrackballManipulator*>(m_viewer->getCameraManipulator());
-        if (manipulator) {
-            // 设置操作器的home位置
-            osg::Vec3d eye(0.0, -5.0, 0.0);
-            osg::Vec3d center(0.0, 0.0, 0.0);
-            osg::Vec3d up(0.0, 0.0, 1.0);
-            manipulator->setHomePosition(eye, center, up);
+        m_uiHandler->createPBRScene(m_viewer, m_rootNode, m_shapeNode, [this](osg::Node*) {
+            // 重置视图以适应新创建的场景
+            resetView(m_viewType);
             
-            // 设置缩放限制，允许更近的缩放距离
-            manipulator->setMinimumDistance(0.0001, true);  // 设置最小距离为0.0001，true表示相对值
-        }
+            // 确保相机操作器正确设置
+            osgGA::TrackballManipulator* manipulator = dynamic_cast<osgGA::TrackballManipulator*>(m_viewer->getCameraManipulator());
+            if (manipulator) {
+                // 设置操作器的home位置
+                osg::Vec3d eye(0.0, -5.0, 0.0);
+                osg::Vec3d center(0.0, 0.0, 0.0);
+                osg::Vec3d up(0.0, 0.0, 1.0);
+                manipulator->setHomePosition(eye, center, up);
+                
+                // 设置缩放限制，允许更近的缩放距离
+                manipulator->setMinimumDistance(0.0001, true);  // 设置最小距离为0.0001，true表示相对值
+            }
+        });
     }
 }
 
@@ -319,9 +358,10 @@ void SimpleOSGRenderer::changeGeometryColor(osg::Geometry* geom)
 void SimpleOSGRenderer::createShapeWithNewSkybox()
 {
     if (m_viewer && m_rootNode) {
-        m_uiHandler->createShapeWithNewSkybox(m_viewer, m_rootNode, m_shapeNode);
-        // 重置视图以适应新创建的立方体
-        resetView(m_viewType);
+        // 场景切换上来后重置视图以适应新创建的立方体
+        m_uiHandler->createShapeWithNewSkybox(m_viewer, m_rootNode, m_shapeNode, [this](osg::Node*) {
+            resetView(m_viewType);
+        });
     }
 }
 
@@ -401,7 +441,8 @@ void SimpleOSGRenderer::createSimpleScene()
         geode->addDrawable(geometry);
     }
     
-    // 添加到根节点
+    // 添加到根节点，天空掩码位在加入之前标记
+    AntiAliasing::markSkyNodes(geode.get());
     m_rootNode->addChild(geode);
 }
 
@@ -412,11 +453,9 @@ void SimpleOSGRenderer::render()
         return;
     }
     
-    // 获取当前FBO的尺寸
-    GLint viewport[4];
-    glGetIntegerv(GL_VIEWPORT, viewport);
-    int width = viewport[2];
-    int height = viewport[3];
+    // FBO的尺寸在createFramebufferObject()中记录，不向驱动查询
+    int width = m_stateHandoff.width();
+    int height = m_stateHandoff.height();
     
     // 初始化OSG（如果尚未初始化）
     if (!m_viewer) {
@@ -425,6 +464,9 @@ void SimpleOSGRenderer::render()
     
     // 更新viewer尺寸并渲染
     if (m_viewer && m_viewer->isRealized()) {
+        // 上一帧末尾启动的异步裁剪要先结束，之后才能修改相机和场景
+        bool culledAhead = finishCull();
+        
         // 检查视口尺寸是否改变
         osg::Viewport* currentViewport = m_viewer->getCamera()->getViewport();
         bool viewportChanged = !currentViewport || 
@@ -436,32 +478,96 @@ void SimpleOSGRenderer::render()
             
         }
         
-        // 关键：设置正确的FBO ID
-        if (QOpenGLContext::currentContext()) {
-            GLuint fboId = QOpenGLContext::currentContext()->defaultFramebufferObject();
-            if (m_viewer->getCamera()->getGraphicsContext()) {
-                m_viewer->getCamera()->getGraphicsContext()->setDefaultFboId(fboId);
-            }
+        // 取出GUI线程写入的鼠标事件，合并后送入OSG事件队列
+        m_mouseHandler->drainEvents(m_viewer.get());
+        
+        // 打帧起始时间戳，清屏计入Other
+        m_frameProfiler->beginFrame(m_viewer.get(), m_rootNode.get());
+        
+        // 从Qt接手GL状态：绑定Qt的FBO，Qt改过的状态在osg::State中标记为未知；
+        // 共享场景时同一上下文里其他视口的osg::State刚画过，全部标记。清屏只由OSG相机的清屏掩码完成
+        osg::GraphicsContext* gc = m_viewer->getCamera()->getGraphicsContext();
+        osg::State* state = gc->getState();
+        m_stateHandoff.beginFrame(gc, m_sharedScene.valid());
+        
+        // 为新创建的着色器程序挂上磁盘缓存的二进制
+        ShaderProgramCache::instance().prepare(*state);
+        
+        // 帧边界：编译后台构建好的场景，加入导入完成的模型，并完成待执行的场景切换；共享场景要等其他视口的裁剪结束
+        if (m_sharedScene.valid()) {
+            m_sharedScene->waitForCulls();
         }
+        m_uiHandler->getSceneManager()->applyPending(m_rootNode.get(), *state, m_uiHandler);
         
-        // 重置关键状态 - 确保颜色能正确显示
-        glDisable(GL_LIGHTING);  // 禁用固定功能管线光照
-        glDisable(GL_TEXTURE_2D);
-        glDisable(GL_BLEND);
-        glEnable(GL_DEPTH_TEST);
-        glDepthFunc(GL_LESS);
-        glDisable(GL_CULL_FACE);
+        // 界面线程排队的拾取、高亮和参数修改
+        runPostedTasks();
         
-        // 清除缓冲区 - 使用蓝色背景
-        glClearColor(0.2f, 0.3f, 0.8f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // 登记新加入的模型，刷新内存统计，超出预算时淘汰久未绘制的纹理
+        ResourceTracker::instance().update(m_rootNode.get(), *state);
+        
+        // 界面改过的PBR材质在这里拷入上传缓冲，绘制期间不再写入
+        PBRMaterialTable::instance().flush();
         
-        // 使用OSG进行渲染
-        m_viewer->frame();
+        // 遮挡查询的开关和新加入的模型在裁剪之前生效
+        m_occlusionCulling->update(m_rootNode.get());
+        
+        if (m_sharedScene.valid()) {
+            // 共享场景的更新回调每帧只执行一次，其余视口的更新遍历只更新自己的相机
+            m_viewer->getUpdateVisitor()->setTraversalMask(m_sharedScene->isUpdateOwner(this) ? ~0u : 0u);
+        }
+        
+        // 动态分辨率的比例在下一次AntiAliasing::update时生效
+        m_antiAliasing->setDynamicResolution(m_dynamicResolution->isEnabled());
+        m_antiAliasing->setRenderScale(m_dynamicResolution->getScale());
+        
+        // 使用OSG进行渲染：已提前裁剪时按渲染顺序只绘制各相机，否则走完整的一帧
+        m_dynamicResolution->beginFrame(*state);
+        if (culledAhead) {
+            gc->runOperations();
+        } else {
+            // 抗锯齿从相机的增删和TAA抖动要在更新遍历之前完成
+            m_antiAliasing->update(m_viewer.get(), width, height);
+            m_viewer->frame();
+        }
+        m_dynamicResolution->endFrame(*state);
         
-        // 更新ViewManager中的相机参数，确保UI能获取到最新的相机位置
+        // 取回本帧新链接程序的二进制写入磁盘缓存
+        ShaderProgramCache::instance().collect(*state);
+        
+        // 把OSG缓存而Qt不会恢复的绑定归位，交还给Qt
+        m_stateHandoff.endFrame(*state);
+        
+        // 本帧画面已在Qt的FBO中，发起异步读取并取回几帧前完成的读取；还有未取回的帧时继续请求渲染
+        if (m_frameCapture->capture(*state, m_stateHandoff.framebufferId(), width, height)) {
+            update();
+        }
+        
+        m_frameProfiler->endFrame(m_viewer.get());
+        
+        // 异步裁剪：绘制完成后马上做下一帧的事件和更新遍历，裁剪交给工作线程，
+        // 与Qt合成以及GUI线程的工作重叠，下一次render()只剩绘制；输入到画面多一帧延迟
+        bool cullAhead = m_threadedCull;
+        if (cullAhead) {
+            if (m_sharedScene.valid()) {
+                m_sharedScene->waitForCulls();
+            }
+            m_antiAliasing->update(m_viewer.get(), width, height);
+            m_viewer->advance();
+            m_viewer->eventTraversal();
+            m_viewer->updateTraversal();
+        } else {
+            // 关闭异步裁剪后恢复在绘制时裁剪
+            setCullOnDraw(true);
+        }
+        
+        // 更新ViewManager中的相机参数，相机有变化时发布快照给界面
         if (m_uiHandler && m_uiHandler->getViewManager()) {
             m_uiHandler->getViewManager()->updateViewParametersFromManipulator(m_viewer);
+            captureCameraSnapshot();
+        }
+        
+        if (cullAhead) {
+            startCull();
         }
     } else {
         // 如果OSG未正确初始化，则显示蓝色背景
@@ -471,12 +577,130 @@ void SimpleOSGRenderer::render()
     }
 }
 
+std::vector<osgViewer::Renderer*> SimpleOSGRenderer::getOSGRenderers() const
+{
+    std::vector<osgViewer::Renderer*> renderers;
+    osgViewer::ViewerBase::Cameras cameras;
+    m_viewer->getCameras(cameras);
+    for (osg::Camera* camera : cameras) {
+        osgViewer::Renderer* renderer = dynamic_cast<osgViewer::Renderer*>(camera->getRenderer());
+        if (renderer) {
+            renderers.push_back(renderer);
+        }
+    }
+    return renderers;
+}
+
+void SimpleOSGRenderer::setCullOnDraw(bool cullOnDraw)
+{
+    // 切换后两个SceneView重新排队，只能在没有已裁剪待绘制的帧时调用
+    for (osgViewer::Renderer* renderer : getOSGRenderers()) {
+        if (renderer->getGraphicsThreadDoesCull() != cullOnDraw) {
+            renderer->setGraphicsThreadDoesCull(cullOnDraw);
+            renderer->reset();
+        }
+    }
+}
+
+void SimpleOSGRenderer::startCull()
+{
+    // 裁剪与绘制分离，每个相机的两个SceneView轮换使用
+    setCullOnDraw(false);
+    std::vector<osgViewer::Renderer*> renderers = getOSGRenderers();
+    
+    osg::ref_ptr<SharedScene> sharedScene = m_sharedScene;
+    if (sharedScene.valid()) {
+        sharedScene->beginCull();
+    }
+    // 裁剪只读场景图和相机，不发出GL调用，可以在没有GL上下文的线程上执行
+    m_cullFuture = std::async(std::launch::async, [renderers, sharedScene]() {
+        for (osgViewer::Renderer* renderer : renderers) {
+            renderer->cull();
+        }
+        if (sharedScene.valid()) {
+            sharedScene->endCull();
+        }
+    });
+}
+
+void SimpleOSGRenderer::post(std::function<void()> task)
+{
+    std::lock_guard<std::mutex> lock(m_postedTasksMutex);
+    m_postedTasks.push_back(std::move(task));
+}
+
+void SimpleOSGRenderer::runPostedTasks()
+{
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(m_postedTasksMutex);
+        tasks.swap(m_postedTasks);
+    }
+    for (const std::function<void()>& task : tasks) {
+        task();
+    }
+}
+
+bool SimpleOSGRenderer::finishCull()
+{
+    if (!m_cullFuture.valid()) {
+        return false;
+    }
+    m_cullFuture.get();
+    return true;
+}
+
+void SimpleOSGRenderer::captureCameraSnapshot()
+{
+    ViewManager* viewManager = m_uiHandler->getViewManager();
+    const osg::Vec3d eye = viewManager->getEye();
+    const osg::Vec3d center = viewManager->getCenter();
+    const osg::Vec3d up = viewManager->getUp();
+    
+    // 阈值按观察距离缩放，云海场景的相机离原点很远
+    if (m_cameraSnapshot) {
+        const double distance = (eye - center).length();
+        const double epsilon = 1e-5 * std::max(distance, 1.0);
+        const double epsilon2 = epsilon * epsilon;
+        if ((eye - m_cameraSnapshot->eye).length2() <= epsilon2 &&
+            (center - m_cameraSnapshot->center).length2() <= epsilon2 &&
+            (up - m_cameraSnapshot->up).length2() <= 1e-10) {
+            return;
+        }
+    }
+    
+    // 快照发布后不再修改，新参数总是整体替换
+    std::shared_ptr<CameraSnapshot> snapshot = std::make_shared<CameraSnapshot>();
+    snapshot->eye = eye;
+    snapshot->center = center;
+    snapshot->up = up;
+    m_cameraSnapshot = snapshot;
+    m_cameraSnapshotDirty = true;
+}
+
+void SimpleOSGRenderer::synchronize(QQuickFramebufferObject* item)
+{
+    if (m_cameraSnapshotDirty) {
+        m_cameraSnapshotDirty = false;
+        static_cast<SimpleOSGViewer*>(item)->publishCameraSnapshot(m_cameraSnapshot);
+    }
+    
+    const float renderScale = m_dynamicResolution->getScale();
+    if (renderScale != m_publishedRenderScale) {
+        m_publishedRenderScale = renderScale;
+        static_cast<SimpleOSGViewer*>(item)->publishRenderScale(renderScale);
+    }
+}
+
 QOpenGLFramebufferObject *SimpleOSGRenderer::createFramebufferObject(const QSize &size)
 {
+    // 单采样：多重采样由AntiAliasing在OSG内部完成，Qt不必逐帧解析
     QOpenGLFramebufferObjectFormat format;
     format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
-    format.setSamples(4);
-    return new QOpenGLFramebufferObject(size, format);
+    QOpenGLFramebufferObject* fbo = new QOpenGLFramebufferObject(size, format);
+    // 尺寸变化时Qt重新创建FBO，render()据此更新视口
+    m_stateHandoff.setFramebuffer(fbo->handle(), size.width(), size.height());
+    return fbo;
 }
 
 bool SimpleOSGRenderer::processEvent(const QEvent* event)
@@ -493,13 +717,14 @@ bool SimpleOSGRenderer::processEvent(const QEvent* event)
         if (mouseEvent->button() == Qt::LeftButton && (mouseEvent->modifiers() & Qt::ControlModifier)) {
             float x = static_cast<float>(mouseEvent->x());
             float y = static_cast<float>(mouseEvent->y());
-            selectModel(static_cast<int>(x), static_cast<int>(y));
+            // 拾取会改高亮uniform和颜色，在帧边界执行
+            post([this, x, y]() { selectModel(static_cast<int>(x), static_cast<int>(y)); });
             return true;
         }
     }
     
     // 使用鼠标处理器处理其他事件，并传递ViewManager
-    return m_mouseHandler->processEvent(event, m_viewer, m_viewType, m_uiHandler->getViewManager());
+    return m_mouseHandler->processEvent(event, m_viewer);
 }
 
 // 添加模型选择相关方法
@@ -509,6 +734,21 @@ void SimpleOSGRenderer::selectModel(int x, int y)
     
     // 选择新的模型
     osg::Geometry* geom = pickGeometry(x, y);
+    
+    // 记录选中几何体的PBR材质，PBR面板之后只修改这一个材质；点空白处取消选择
+    m_selectedMaterial = nullptr;
+    if (geom) {
+        if (PBRMaterialTable::hasMaterial(geom->getStateSet())) {
+            m_selectedMaterial = geom->getStateSet();
+        }
+        for (unsigned int i = 0; i < geom->getNumParents() && !m_selectedMaterial.valid(); ++i) {
+            osg::StateSet* parentStateSet = geom->getParent(i)->getStateSet();
+            if (PBRMaterialTable::hasMaterial(parentStateSet)) {
+                m_selectedMaterial = parentStateSet;
+            }
+        }
+    }
+    
     if (geom) {
         // 检查几何体是否支持颜色变化（通过检查是否有Shader相关的uniform）
         osg::StateSet* stateSet = geom->getStateSet();
@@ -566,9 +806,9 @@ osg::Geometry* SimpleOSGRenderer::pickGeometry(int x, int y)
         osgUtil::LineSegmentIntersector::Intersection intersection = 
             intersector->getFirstIntersection();
         
-        // 尝试将相交的可绘制对象转换为几何体
+        // 尝试将相交的可绘制对象转换为几何体；命中合批几何体时换回原几何体，之后的高亮和改色作用在它上面
         osg::Geometry* geom = dynamic_cast<osg::Geometry*>(intersection.drawable.get());
-        return geom;
+        return IndirectBatcher::resolvePick(geom, intersection.indexList);
     }
     
     return nullptr;
@@ -634,95 +874,20 @@ void SimpleOSGRenderer::updatePBRMaterial(float albedoR, float albedoG, float al
                                         float metallic, float roughness, 
                                         float specular, float ao)
 {
-    if (m_rootNode.valid()) {
-        // 创建访问器来遍历场景图并更新所有PBR球体的材质
-        class PBRMaterialUpdater : public osg::NodeVisitor {
-        public:
-            osg::Vec4 albedo;  // 包含Alpha通道
-            float metallic;
-            float roughness;
-            float specular;
-            float ao;
-            
-            PBRMaterialUpdater(float albedoR, float albedoG, float albedoB, float albedoA,
-                              float metallic, float roughness, 
-                              float specular, float ao)
-                : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
-                  albedo(albedoR, albedoG, albedoB, albedoA),
-                  metallic(metallic),
-                  roughness(roughness),
-                  specular(specular),
-                  ao(ao)
-            {
-            }
-            
-            virtual void apply(osg::Geode& geode) {
-                // 检查这个Geode是否包含PBR球体
-                osg::StateSet* stateSet = geode.getStateSet();
-                if (stateSet) {
-                    // 检查是否存在PBR相关的uniform
-                    if (stateSet->getUniform("albedo") || 
-                        stateSet->getUniform("metallic") || 
-                        stateSet->getUniform("roughness")) {
-                        
-                        // 更新基础颜色uniform（包含Alpha）
-                        osg::Uniform* albedoUniform = stateSet->getUniform("albedo");
-                        if (albedoUniform) {
-                            albedoUniform->set(osg::Vec3(albedo.x(), albedo.y(), albedo.z()));
-                        } else {
-                            stateSet->addUniform(new osg::Uniform("albedo", osg::Vec3(albedo.x(), albedo.y(), albedo.z())));
-                        }
-                        
-                        // 更新Alpha值（如果着色器支持）
-                        osg::Uniform* alphaUniform = stateSet->getUniform("alpha");
-                        if (alphaUniform) {
-                            alphaUniform->set(albedo.w());
-                        } else {
-                            stateSet->addUniform(new osg::Uniform("alpha", albedo.w()));
-                        }
-                        
-                        // 更新金属度uniform
-                        osg::Uniform* metallicUniform = stateSet->getUniform("metallic");
-                        if (metallicUniform) {
-                            metallicUniform->set(metallic);
-                        } else {
-                            stateSet->addUniform(new osg::Uniform("metallic", metallic));
-                        }
-                        
-                        // 更新粗糙度uniform
-                        osg::Uniform* roughnessUniform = stateSet->getUniform("roughness");
-                        if (roughnessUniform) {
-                            roughnessUniform->set(roughness);
-                        } else {
-                            stateSet->addUniform(new osg::Uniform("roughness", roughness));
-                        }
-                        
-                        // 更新环境光遮蔽uniform
-                        osg::Uniform* aoUniform = stateSet->getUniform("ao");
-                        if (aoUniform) {
-                            aoUniform->set(ao);
-                        } else {
-                            stateSet->addUniform(new osg::Uniform("ao", ao));
-                        }
-                        
-                        // 注意：specular在PBR中通常不作为uniform传递，因为它是在着色器中计算的
-                        // 如果需要，可以添加其他uniform更新
-                    }
-                }
-                
-                traverse(geode);
-            }
-        };
-        
-        // 创建并应用访问器
-        PBRMaterialUpdater updater(albedoR, albedoG, albedoB, albedoA, metallic, roughness, specular, ao);
-        m_rootNode->accept(updater);
-        
-        // 强制更新视图
-        if (m_viewer) {
-            m_viewer->advance();
-            m_viewer->requestRedraw();
-        }
+    // 直接改材质表中的槽位，不遍历场景图
+    PBRMaterialTable::Material material(osg::Vec4(albedoR, albedoG, albedoB, albedoA),
+                                        metallic, roughness, ao, specular);
+    if (PBRMaterialTable::hasMaterial(m_selectedMaterial.get())) {
+        // 只修改Ctrl+左键选中的材质
+        PBRMaterialTable::instance().setMaterial(m_selectedMaterial.get(), material);
+    } else {
+        // 未选中时修改本视口场景中的所有PBR材质
+        PBRMaterialTable::instance().setAllMaterials(m_rootNode.get(), material);
+    }
+    
+    // 强制更新视图
+    if (m_viewer) {
+        m_viewer->requestRedraw();
     }
 }
 
@@ -6,16 +6,30 @@
 #include <QEvent>
 #include <osg/ref_ptr>
 #include <osgViewer/Viewer>
+#include <osgViewer/Renderer>
 #include <osg/Group>
+#include <osg/observer_ptr>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <vector>
 
 // 包含视图类型枚举
 #include "simpleosgviewer.h"
 #include "viewmanager.h"
 #include "uihandler.h"
+#include "frameprofiler.h"
+#include "antialiasing.h"
+#include "dynamicresolution.h"
+#include "occlusionculling.h"
+#include "framecapture.h"
+#include "glstatehandoff.h"
 
 // 前向声明
 class MouseHandler;
 class DemoShader;
+class SharedScene;
 
 class SimpleOSGRenderer : public QQuickFramebufferObject::Renderer
 {
@@ -24,6 +38,8 @@ public:
     ~SimpleOSGRenderer() override;
 
     void render() override;
+    // GUI线程阻塞期间调用，把变化过的相机快照交给界面
+    void synchronize(QQuickFramebufferObject* item) override;
     // 去掉const修饰符
     QOpenGLFramebufferObject *createFramebufferObject(const QSize &size) override;
     bool processEvent(const QEvent* event);
@@ -31,6 +47,29 @@ public:
     // 添加获取viewer和viewManager的方法
     osgViewer::Viewer* getViewer() const { return m_viewer; }
     ViewManager* getViewManager() const { return m_uiHandler->getViewManager(); }
+    FrameProfiler* getFrameProfiler() const { return m_frameProfiler.get(); }
+    
+    // 是否与同一窗口的其他视口共享场景，需在第一次render()之前设置
+    void setUseSharedScene(bool shared) { m_useSharedScene = shared; }
+    
+    // 异步裁剪：下一帧的裁剪在工作线程上与本帧之后的工作重叠，可在任意线程设置，下一帧生效
+    void setThreadedCull(bool threaded) { m_threadedCull = threaded; }
+    
+    // 抗锯齿模式，可在任意线程设置，下一帧生效
+    AntiAliasing* getAntiAliasing() const { return m_antiAliasing.get(); }
+    
+    // 动态分辨率控制器，可在任意线程设置，下一帧生效
+    DynamicResolution* getDynamicResolution() const { return m_dynamicResolution.get(); }
+    
+    // 遮挡剔除开关，可在任意线程设置，下一帧生效
+    OcclusionCulling* getOcclusionCulling() const { return m_occlusionCulling.get(); }
+    
+    // 截图与图像序列，可在任意线程请求，读取在帧末进行
+    FrameCapture* getFrameCapture() const { return m_frameCapture.get(); }
+    
+    // 任意线程调用：修改场景图（StateSet、uniform、节点掩码）的操作排到下一帧的帧边界，
+    // 在渲染线程上、裁剪和绘制都不在进行时执行
+    void post(std::function<void()> task);
     
     // 添加实际调用渲染器的槽函数
     void createShape();
@@ -97,6 +136,18 @@ private:
     void initializeOSG(int width, int height);
     void createSimpleScene();
     void checkGLError(const char* location);
+    // 相机参数相对上次发布的变化超过阈值时生成新快照
+    void captureCameraSnapshot();
+    // viewer所有相机（主相机和从相机）的渲染器
+    std::vector<osgViewer::Renderer*> getOSGRenderers() const;
+    // true：绘制时裁剪（默认）；false：裁剪与绘制分离
+    void setCullOnDraw(bool cullOnDraw);
+    // 在工作线程上启动下一帧所有相机的裁剪
+    void startCull();
+    // 等待上一帧启动的裁剪结束，有已裁剪好待绘制的帧时返回true
+    bool finishCull();
+    // 帧边界执行post()排队的操作
+    void runPostedTasks();
 
     osg::ref_ptr<osgViewer::Viewer> m_viewer;
     osg::ref_ptr<osg::Group> m_rootNode;
@@ -105,6 +156,8 @@ private:
     
     // 添加选择相关成员变量
     osg::ref_ptr<osg::Geometry> _lastDrawable;
+    // Ctrl+左键选中的PBR材质所在的StateSet
+    osg::observer_ptr<osg::StateSet> m_selectedMaterial;
     
     // 保存对创建的图形节点的引用
     osg::ref_ptr<osg::Geode> m_shapeNode;
@@ -115,6 +168,41 @@ private:
     
     // 添加DemoShader成员变量
     osg::ref_ptr<DemoShader> m_demoShader;
+    
+    // 逐pass帧耗时统计
+    osg::ref_ptr<FrameProfiler> m_frameProfiler;
+    
+    // 多视口共享的场景，非共享模式下为空
+    bool m_useSharedScene;
+    osg::ref_ptr<SharedScene> m_sharedScene;
+    
+    // 异步裁剪
+    std::atomic<bool> m_threadedCull;
+    std::future<void> m_cullFuture;
+    
+    // 抗锯齿管线
+    osg::ref_ptr<AntiAliasing> m_antiAliasing;
+    
+    // 动态分辨率，以及上次交给界面的比例
+    osg::ref_ptr<DynamicResolution> m_dynamicResolution;
+    float m_publishedRenderScale;
+    
+    // 遮挡剔除
+    osg::ref_ptr<OcclusionCulling> m_occlusionCulling;
+    
+    // 帧捕获
+    osg::ref_ptr<FrameCapture> m_frameCapture;
+    
+    // 与Qt Quick之间的GL状态交接，记录Qt的FBO
+    GLStateHandoff m_stateHandoff;
+    
+    // 界面线程排队、等待帧边界执行的场景修改
+    std::mutex m_postedTasksMutex;
+    std::vector<std::function<void()>> m_postedTasks;
+    
+    // 最近一次发布的相机快照，以及是否还没交给界面
+    std::shared_ptr<const CameraSnapshot> m_cameraSnapshot;
+    bool m_cameraSnapshotDirty;
 };
 
 #endif // SIMPLEOSGRENDERER_H
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "simpleosgviewer.h"
 #include "simpleosgrenderer.h"
+#include "resourcetracker.h"
+#include "modelloader.h"
+#include "SkyQuality.h"
 #include <QQuickWindow>
 #include <QDebug>
 #include <QTimer>
@@ -9,9 +12,26 @@
 #include <QFileDialog>
 #include <QCoreApplication>
 #include <QMetaObject>
+#include <QVariantMap>
+#include <QDateTime>
+#include <QStandardPaths>
+
+namespace {
+
+QString captureDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::PicturesLocation) + "/qml-osg";
+}
+
+QString captureTimestamp()
+{
+    return QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss_zzz");
+}
+
+} // namespace
 
 SimpleOSGViewer::SimpleOSGViewer(QQuickItem *parent)
-    : QQuickFramebufferObject(parent), m_renderer(nullptr), m_viewType(MainView), m_mouseX(0), m_mouseY(0), m_cameraX(0.0), m_cameraY(0.0), m_cameraZ(0.0)
+    : QQuickFramebufferObject(parent), m_renderer(nullptr), m_viewType(MainView), m_mouseX(0), m_mouseY(0), m_cameraX(0.0), m_cameraY(0.0), m_cameraZ(0.0), m_cameraNotifyPending(false), m_profilingEnabled(false), m_sharedScene(true), m_threadedCull(false), m_antiAliasing(Msaa4x), m_dynamicResolution(false), m_targetFrameTime(16.6), m_renderScale(1.0), m_occlusionCulling(false), m_geometryCompaction(ModelLoader::instance().isCompactionEnabled()), m_skyQuality(static_cast<SkyQualityLevel>(currentSkyQuality())), m_recording(false), m_memoryBudget(ResourceTracker::instance().getBudget() / (1024.0 * 1024.0))
 {
     setTextureFollowsItemSize(true);
     setMirrorVertically(true);
@@ -21,13 +41,25 @@ SimpleOSGViewer::SimpleOSGViewer(QQuickItem *parent)
     // 使用定时器定期更新，避免线程问题
     QTimer *timer = new QTimer(this);
     connect(timer, &QTimer::timeout, this, &SimpleOSGViewer::update);
-    connect(timer, &QTimer::timeout, this, &SimpleOSGViewer::updateCameraPosition);
     timer->start(16); // 约60 FPS
+    
+    // 帧耗时统计本身是滑动平均，界面刷新不需要逐帧
+    QTimer *timingTimer = new QTimer(this);
+    connect(timingTimer, &QTimer::timeout, this, &SimpleOSGViewer::updateFrameTimings);
+    connect(timingTimer, &QTimer::timeout, this, &SimpleOSGViewer::updateMemoryUsage);
+    timingTimer->start(250);
 }
 
 QQuickFramebufferObject::Renderer *SimpleOSGViewer::createRenderer() const
 {
     m_renderer = new SimpleOSGRenderer(m_viewType);
+    m_renderer->getFrameProfiler()->setEnabled(m_profilingEnabled);
+    m_renderer->setUseSharedScene(m_sharedScene);
+    m_renderer->setThreadedCull(m_threadedCull);
+    m_renderer->getAntiAliasing()->setMode(static_cast<AntiAliasing::Mode>(m_antiAliasing));
+    m_renderer->getDynamicResolution()->setEnabled(m_dynamicResolution);
+    m_renderer->getDynamicResolution()->setTargetFrameTime(m_targetFrameTime);
+    m_renderer->getOcclusionCulling()->setEnabled(m_occlusionCulling);
     return m_renderer;
 }
 
@@ -47,6 +79,153 @@ void SimpleOSGViewer::setViewType(ViewType viewType)
     }
 }
 
+void SimpleOSGViewer::setProfilingEnabled(bool enabled)
+{
+    if (m_profilingEnabled != enabled) {
+        m_profilingEnabled = enabled;
+        if (m_renderer) {
+            m_renderer->getFrameProfiler()->setEnabled(enabled);
+        }
+        emit profilingEnabledChanged();
+    }
+}
+
+void SimpleOSGViewer::setSharedScene(bool shared)
+{
+    if (m_sharedScene != shared) {
+        if (m_renderer) {
+            qWarning() << "sharedScene must be set before the renderer is created";
+            return;
+        }
+        m_sharedScene = shared;
+        emit sharedSceneChanged();
+    }
+}
+
+void SimpleOSGViewer::setThreadedCull(bool threaded)
+{
+    if (m_threadedCull != threaded) {
+        m_threadedCull = threaded;
+        if (m_renderer) {
+            m_renderer->setThreadedCull(threaded);
+        }
+        emit threadedCullChanged();
+    }
+}
+
+void SimpleOSGViewer::setAntiAliasing(AntiAliasingMode mode)
+{
+    if (m_antiAliasing != mode) {
+        m_antiAliasing = mode;
+        if (m_renderer) {
+            m_renderer->getAntiAliasing()->setMode(static_cast<AntiAliasing::Mode>(mode));
+        }
+        emit antiAliasingChanged();
+        update();
+    }
+}
+
+void SimpleOSGViewer::setDynamicResolution(bool enabled)
+{
+    if (m_dynamicResolution != enabled) {
+        m_dynamicResolution = enabled;
+        if (m_renderer) {
+            m_renderer->getDynamicResolution()->setEnabled(enabled);
+        }
+        emit dynamicResolutionChanged();
+        update();
+    }
+}
+
+void SimpleOSGViewer::setTargetFrameTime(double ms)
+{
+    if (ms > 0.0 && m_targetFrameTime != ms) {
+        m_targetFrameTime = ms;
+        if (m_renderer) {
+            m_renderer->getDynamicResolution()->setTargetFrameTime(ms);
+        }
+        emit targetFrameTimeChanged();
+    }
+}
+
+void SimpleOSGViewer::setOcclusionCulling(bool enabled)
+{
+    if (m_occlusionCulling != enabled) {
+        m_occlusionCulling = enabled;
+        if (m_renderer) {
+            m_renderer->getOcclusionCulling()->setEnabled(enabled);
+        }
+        emit occlusionCullingChanged();
+        update();
+    }
+}
+
+void SimpleOSGViewer::setGeometryCompaction(bool enabled)
+{
+    if (m_geometryCompaction != enabled) {
+        m_geometryCompaction = enabled;
+        ModelLoader::instance().setCompactionEnabled(enabled);
+        emit geometryCompactionChanged();
+    }
+}
+
+void SimpleOSGViewer::setSkyQuality(SkyQualityLevel quality)
+{
+    if (m_skyQuality != quality) {
+        m_skyQuality = quality;
+        // 天空节点在下一次更新遍历中切换着色器变体
+        setCurrentSkyQuality(static_cast<SkyQuality>(quality));
+        emit skyQualityChanged();
+        update();
+    }
+}
+
+QString SimpleOSGViewer::captureScreenshot(const QString& path)
+{
+    if (!m_renderer) {
+        return QString();
+    }
+    const QString target = path.isEmpty() ? captureDirectory() + "/screenshot_" + captureTimestamp() + ".png" : path;
+    m_renderer->getFrameCapture()->requestScreenshot(target.toStdString());
+    update();
+    return target;
+}
+
+QString SimpleOSGViewer::startRecording(const QString& directory, int frameStep)
+{
+    if (!m_renderer) {
+        return QString();
+    }
+    const QString target = directory.isEmpty() ? captureDirectory() + "/sequence_" + captureTimestamp() : directory;
+    m_renderer->getFrameCapture()->startSequence(target.toStdString(), frameStep);
+    if (!m_recording) {
+        m_recording = true;
+        emit recordingChanged();
+    }
+    update();
+    return target;
+}
+
+void SimpleOSGViewer::stopRecording()
+{
+    if (m_renderer) {
+        m_renderer->getFrameCapture()->stopSequence();
+    }
+    if (m_recording) {
+        m_recording = false;
+        emit recordingChanged();
+    }
+}
+
+void SimpleOSGViewer::setMemoryBudget(double megabytes)
+{
+    if (megabytes > 0.0 && m_memoryBudget != megabytes) {
+        m_memoryBudget = megabytes;
+        ResourceTracker::instance().setBudget(static_cast<std::size_t>(megabytes * 1024.0 * 1024.0));
+        emit memoryBudgetChanged();
+    }
+}
+
 SimpleOSGViewer::ViewType SimpleOSGViewer::viewType() const
 {
     return m_viewType;
@@ -55,40 +234,49 @@ SimpleOSGViewer::ViewType SimpleOSGViewer::viewType() const
 // 添加获取相机Eye位置的方法
 QVector3D SimpleOSGViewer::getCameraEye() const
 {
-    if (m_renderer) {
-        ViewManager* viewManager = m_renderer->getViewManager();
-        if (viewManager) {
-            osg::Vec3d eye = viewManager->getEye();
-            return QVector3D(eye.x(), eye.y(), eye.z());
-        }
+    if (m_cameraSnapshot) {
+        const osg::Vec3d& eye = m_cameraSnapshot->eye;
+        return QVector3D(eye.x(), eye.y(), eye.z());
     }
     return QVector3D(0.0f, 0.0f, 0.0f);
 }
 
 QVector3D SimpleOSGViewer::getCameraCenter() const
 {
-    if (m_renderer) {
-        ViewManager* viewManager = m_renderer->getViewManager();
-        if (viewManager) {
-            osg::Vec3d center = viewManager->getCenter();
-            return QVector3D(center.x(), center.y(), center.z());
-        }
+    if (m_cameraSnapshot) {
+        const osg::Vec3d& center = m_cameraSnapshot->center;
+        return QVector3D(center.x(), center.y(), center.z());
     }
     return QVector3D(0.0f, 0.0f, 0.0f);
 }
 
 QVector3D SimpleOSGViewer::getCameraUp() const
 {
-    if (m_renderer) {
-        ViewManager* viewManager = m_renderer->getViewManager();
-        if (viewManager) {
-            osg::Vec3d up = viewManager->getUp();
-            return QVector3D(up.x(), up.y(), up.z());
-        }
+    if (m_cameraSnapshot) {
+        const osg::Vec3d& up = m_cameraSnapshot->up;
+        return QVector3D(up.x(), up.y(), up.z());
     }
     return QVector3D(0.0f, 0.0f, 1.0f);
 }
 
+void SimpleOSGViewer::publishCameraSnapshot(const std::shared_ptr<const CameraSnapshot>& snapshot)
+{
+    m_cameraSnapshot = snapshot;
+    // 界面还没处理上一次通知时不再排队，处理时读到的总是最新快照
+    if (!m_cameraNotifyPending) {
+        m_cameraNotifyPending = true;
+        QMetaObject::invokeMethod(this, "applyCameraSnapshot", Qt::QueuedConnection);
+    }
+}
+
+void SimpleOSGViewer::publishRenderScale(double scale)
+{
+    if (m_renderScale != scale) {
+        m_renderScale = scale;
+        QMetaObject::invokeMethod(this, "renderScaleChanged", Qt::QueuedConnection);
+    }
+}
+
 void SimpleOSGViewer::mousePressEvent(QMouseEvent *event)
 {
     // 更新鼠标位置
@@ -260,18 +448,20 @@ void SimpleOSGViewer::openFileSelector()
 // 实现选择模型功能
 void SimpleOSGViewer::selectModel(int x, int y)
 {
-    // 直接调用渲染器的方法
+    // 修改高亮和颜色，排到渲染线程的帧边界执行
     if (m_renderer) {
-        m_renderer->selectModel(x, y);
+        SimpleOSGRenderer* renderer = m_renderer;
+        renderer->post([=]() { renderer->selectModel(x, y); });
     }
 }
 
 // 实现设置图形颜色功能
 void SimpleOSGViewer::setShapeColor(float r, float g, float b, float a)
 {
-    // 直接调用渲染器的方法
+    // 修改高亮和颜色，排到渲染线程的帧边界执行
     if (m_renderer) {
-        m_renderer->setShapeColor(r, g, b, a);
+        SimpleOSGRenderer* renderer = m_renderer;
+        renderer->post([=]() { renderer->setShapeColor(r, g, b, a); });
     }
 }
 
@@ -359,20 +549,55 @@ void SimpleOSGViewer::invokeSetViewType(ViewType viewType)
     update();
 }
 
-// 添加获取摄像机位置的函数
-void SimpleOSGViewer::updateCameraPosition() {
-    if (m_renderer) {
-        ViewManager* viewManager = m_renderer->getViewManager();
-        if (viewManager) {
-            // 从操作器获取当前的相机参数
-            viewManager->updateViewParametersFromManipulator(m_renderer->getViewer());
-            
-            osg::Vec3d eye = viewManager->getEye();
-            m_cameraX = eye.x();
-            m_cameraY = eye.y();
-            m_cameraZ = eye.z();
-            emit cameraPositionChanged();
-        }
+// 相机快照变化后由渲染器排队调用，每次变化只通知一次
+void SimpleOSGViewer::applyCameraSnapshot()
+{
+    m_cameraNotifyPending = false;
+    if (!m_cameraSnapshot) {
+        return;
+    }
+    
+    const osg::Vec3d& eye = m_cameraSnapshot->eye;
+    m_cameraX = eye.x();
+    m_cameraY = eye.y();
+    m_cameraZ = eye.z();
+    emit cameraPositionChanged();
+}
+
+void SimpleOSGViewer::updateFrameTimings()
+{
+    if (!m_renderer || !m_profilingEnabled) {
+        return;
+    }
+    
+    QVariantList timings;
+    for (const FrameProfiler::Timing& timing : m_renderer->getFrameProfiler()->snapshot()) {
+        QVariantMap item;
+        item["name"] = QString::fromStdString(timing.name);
+        item["gpu"] = timing.gpu;
+        item["averageMs"] = timing.averageMs;
+        item["maxMs"] = timing.maxMs;
+        timings.append(item);
+    }
+    m_frameTimings = timings;
+    emit frameTimingsChanged();
+}
+
+void SimpleOSGViewer::updateMemoryUsage()
+{
+    const ResourceTracker::Totals totals = ResourceTracker::instance().totals();
+    const double megabyte = 1024.0 * 1024.0;
+    
+    QVariantMap usage;
+    usage["cpuMB"] = totals.cpuBytes / megabyte;
+    usage["gpuMB"] = totals.gpuBytes / megabyte;
+    usage["budgetMB"] = totals.budget / megabyte;
+    usage["textures"] = totals.textures;
+    usage["buffers"] = totals.buffers;
+    usage["evicted"] = totals.evicted;
+    if (usage != m_memoryUsage) {
+        m_memoryUsage = usage;
+        emit memoryUsageChanged();
     }
 }
 
@@ -396,7 +621,8 @@ void SimpleOSGViewer::invokeUpdatePBRMaterial(float albedoR, float albedoG, floa
                                              float specular, float ao)
 {
     if (m_renderer) {
-        m_renderer->updatePBRMaterial(albedoR, albedoG, albedoB, albedoA, metallic, roughness, specular, ao);
+        SimpleOSGRenderer* renderer = m_renderer;
+        renderer->post([=]() { renderer->updatePBRMaterial(albedoR, albedoG, albedoB, albedoA, metallic, roughness, specular, ao); });
     }
 }
 
@@ -414,7 +640,8 @@ void SimpleOSGViewer::updateAtmosphereParameters(float sunZenithAngle, float sun
 void SimpleOSGViewer::invokeUpdateAtmosphereParameters(float sunZenithAngle, float sunAzimuthAngle)
 {
     if (m_renderer) {
-        m_renderer->updateAtmosphereParameters(sunZenithAngle, sunAzimuthAngle);
+        SimpleOSGRenderer* renderer = m_renderer;
+        renderer->post([=]() { renderer->updateAtmosphereParameters(sunZenithAngle, sunAzimuthAngle); });
     }
 }
 
@@ -432,7 +659,8 @@ void SimpleOSGViewer::updateAtmosphereDensityAndIntensity(float density, float i
 void SimpleOSGViewer::invokeUpdateAtmosphereDensityAndIntensity(float density, float intensity)
 {
     if (m_renderer) {
-        m_renderer->updateAtmosphereDensityAndIntensity(density, intensity);
+        SimpleOSGRenderer* renderer = m_renderer;
+        renderer->post([=]() { renderer->updateAtmosphereDensityAndIntensity(density, intensity); });
     }
 }
 
@@ -450,7 +678,8 @@ void SimpleOSGViewer::updateAtmosphereScattering(float mie, float rayleigh)
 void SimpleOSGViewer::invokeUpdateAtmosphereScattering(float mie, float rayleigh)
 {
     if (m_renderer) {
-        m_renderer->updateAtmosphereScattering(mie, rayleigh);
+        SimpleOSGRenderer* renderer = m_renderer;
+        renderer->post([=]() { renderer->updateAtmosphereScattering(mie, rayleigh); });
     }
 }
 
@@ -470,7 +699,8 @@ void SimpleOSGViewer::updateSkyNodeAtmosphereParameters(float turbidity, float r
 void SimpleOSGViewer::invokeUpdateSkyNodeAtmosphereParameters(float turbidity, float rayleigh, float mieCoefficient, float mieDirectionalG, float sunZenithAngle, float sunAzimuthAngle)
 {
     if (m_renderer) {
-        m_renderer->updateSkyNodeAtmosphereParameters(turbidity, rayleigh, mieCoefficient, mieDirectionalG, sunZenithAngle, sunAzimuthAngle);
+        SimpleOSGRenderer* renderer = m_renderer;
+        renderer->post([=]() { renderer->updateSkyNodeAtmosphereParameters(turbidity, rayleigh, mieCoefficient, mieDirectionalG, sunZenithAngle, sunAzimuthAngle); });
     }
 }
 
@@ -495,9 +725,8 @@ void SimpleOSGViewer::invokeUpdateSkyNodeCloudParameters(float sunZenithAngle, f
                                                       float cloudBaseHeight, float cloudRangeMin, float cloudRangeMax)
 {
     if (m_renderer) {
-        m_renderer->updateSkyNodeCloudParameters(sunZenithAngle, sunAzimuthAngle,
-                                              cloudDensity, cloudHeight,
-                                              cloudBaseHeight, cloudRangeMin, cloudRangeMax);
+        SimpleOSGRenderer* renderer = m_renderer;
+        renderer->post([=]() { renderer->updateSkyNodeCloudParameters(sunZenithAngle, sunAzimuthAngle, cloudDensity, cloudHeight, cloudBaseHeight, cloudRangeMin, cloudRangeMax); });
     }
 }
 
@@ -522,9 +751,8 @@ void SimpleOSGViewer::invokeUpdateCloudSeaAtmosphereParameters(float sunZenithAn
                                                               float cloudBaseHeight, float cloudRangeMin, float cloudRangeMax)
 {
     if (m_renderer) {
-        m_renderer->updateCloudSeaAtmosphereParameters(sunZenithAngle, sunAzimuthAngle,
-                                                      cloudDensity, cloudHeight,
-                                                      cloudBaseHeight, cloudRangeMin, cloudRangeMax);
+        SimpleOSGRenderer* renderer = m_renderer;
+        renderer->post([=]() { renderer->updateCloudSeaAtmosphereParameters(sunZenithAngle, sunAzimuthAngle, cloudDensity, cloudHeight, cloudBaseHeight, cloudRangeMin, cloudRangeMax); });
     }
 }
 
@@ -552,10 +780,8 @@ void SimpleOSGViewer::invokeUpdateVolumeCloudParameters(float sunZenithAngle, fl
                                                        float stepSize, float maxSteps)
 {
     if (m_renderer) {
-        m_renderer->updateVolumeCloudParameters(sunZenithAngle, sunAzimuthAngle,
-                                               cloudDensity, cloudHeight,
-                                               densityThreshold, contrast, densityFactor,
-                                               stepSize, maxSteps);
+        SimpleOSGRenderer* renderer = m_renderer;
+        renderer->post([=]() { renderer->updateVolumeCloudParameters(sunZenithAngle, sunAzimuthAngle, cloudDensity, cloudHeight, densityThreshold, contrast, densityFactor, stepSize, maxSteps); });
     }
 }
 
@@ -577,8 +803,8 @@ void SimpleOSGViewer::invokeUpdateSkyCloudParameters(float cloudDensity, float c
                                                   float coverageThreshold, float densityThreshold, float edgeThreshold)
 {
     if (m_renderer) {
-        m_renderer->updateSkyCloudParameters(cloudDensity, cloudHeight,
-                                           coverageThreshold, densityThreshold, edgeThreshold);
+        SimpleOSGRenderer* renderer = m_renderer;
+        renderer->post([=]() { renderer->updateSkyCloudParameters(cloudDensity, cloudHeight, coverageThreshold, densityThreshold, edgeThreshold); });
     }
 }
 
@@ -596,7 +822,8 @@ void SimpleOSGViewer::toggleLighting(bool enabled)
 void SimpleOSGViewer::invokeToggleLighting(bool enabled)
 {
     if (m_renderer) {
-        m_renderer->toggleLighting(enabled);
+        SimpleOSGRenderer* renderer = m_renderer;
+        renderer->post([=]() { renderer->toggleLighting(enabled); });
     }
 }
 
@@ -2,12 +2,23 @@
 #define SIMPLEOSGVIEWER_H
 
 #include <QQuickFramebufferObject>
+#include <QVariantList>
+#include <QVariantMap>
 #include <osg/ref_ptr>
 #include <osgViewer/Viewer>
 #include <osgGA/GUIEventAdapter>
+#include <memory>
 
 class SimpleOSGRenderer;
 
+// 渲染线程发布的相机参数快照，发布后只读
+struct CameraSnapshot
+{
+    osg::Vec3d eye;
+    osg::Vec3d center;
+    osg::Vec3d up;
+};
+
 class SimpleOSGViewer : public QQuickFramebufferObject
 {
     Q_OBJECT
@@ -35,6 +46,25 @@ public:
     };
     Q_ENUM(ViewType)
     
+    // 抗锯齿模式，与AntiAliasing::Mode一一对应
+    enum AntiAliasingMode {
+        NoAntiAliasing,
+        Msaa2x,
+        Msaa4x,
+        Msaa8x,
+        Fxaa,
+        Taa
+    };
+    Q_ENUM(AntiAliasingMode)
+    
+    // 天空/云着色器质量档位，与SkyQuality一一对应
+    enum SkyQualityLevel {
+        SkyQualityLow,
+        SkyQualityMedium,
+        SkyQualityHigh
+    };
+    Q_ENUM(SkyQualityLevel)
+    
     // 添加鼠标位置属性
     Q_PROPERTY(int mouseX READ mouseX NOTIFY mousePositionChanged)
     Q_PROPERTY(int mouseY READ mouseY NOTIFY mousePositionChanged)
@@ -44,6 +74,40 @@ public:
     Q_PROPERTY(double cameraY READ cameraY NOTIFY cameraPositionChanged)
     Q_PROPERTY(double cameraZ READ cameraZ NOTIFY cameraPositionChanged)
     
+    // 逐pass帧耗时统计，每项为{name, gpu, averageMs, maxMs}
+    Q_PROPERTY(bool profilingEnabled READ profilingEnabled WRITE setProfilingEnabled NOTIFY profilingEnabledChanged)
+    Q_PROPERTY(QVariantList frameTimings READ frameTimings NOTIFY frameTimingsChanged)
+    
+    // 同一窗口的多个视口共用一份场景和GL资源，只有相机各自独立；渲染器创建后修改不再生效
+    Q_PROPERTY(bool sharedScene READ sharedScene WRITE setSharedScene NOTIFY sharedSceneChanged)
+    
+    // 异步裁剪：下一帧的OSG裁剪在工作线程上提前完成，多用一个核心，输入到画面多一帧延迟
+    Q_PROPERTY(bool threadedCull READ threadedCull WRITE setThreadedCull NOTIFY threadedCullChanged)
+    
+    // 抗锯齿模式，运行时可切换
+    Q_PROPERTY(AntiAliasingMode antiAliasing READ antiAliasing WRITE setAntiAliasing NOTIFY antiAliasingChanged)
+    
+    // 动态分辨率：按GPU帧耗时在50%~100%之间调整OSG的渲染比例，再放大到控件尺寸；renderScale为当前比例
+    Q_PROPERTY(bool dynamicResolution READ dynamicResolution WRITE setDynamicResolution NOTIFY dynamicResolutionChanged)
+    Q_PROPERTY(double targetFrameTime READ targetFrameTime WRITE setTargetFrameTime NOTIFY targetFrameTimeChanged)
+    Q_PROPERTY(double renderScale READ renderScale NOTIFY renderScaleChanged)
+    
+    // 遮挡剔除：加载的大模型按层级做硬件遮挡查询，沿用前几帧的结果跳过被遮挡的子树
+    Q_PROPERTY(bool occlusionCulling READ occlusionCulling WRITE setOcclusionCulling NOTIFY occlusionCullingChanged)
+    
+    // 几何体压缩（所有视口共用）：之后加载的模型用16位位置、8位法线和16位索引，不再能被拾取
+    Q_PROPERTY(bool geometryCompaction READ geometryCompaction WRITE setGeometryCompaction NOTIFY geometryCompactionChanged)
+    
+    // 天空质量（所有视口共用）：SkyBoxThree和云海的fbm层数，切换时取对应的已编译变体
+    Q_PROPERTY(SkyQualityLevel skyQuality READ skyQuality WRITE setSkyQuality NOTIFY skyQualityChanged)
+    
+    // 帧捕获：recording为是否正在写图像序列
+    Q_PROPERTY(bool recording READ recording NOTIFY recordingChanged)
+    
+    // 纹理与几何内存（所有视口共用一份统计和预算，单位MB），memoryUsage为{cpuMB, gpuMB, budgetMB, textures, buffers, evicted}
+    Q_PROPERTY(double memoryBudget READ memoryBudget WRITE setMemoryBudget NOTIFY memoryBudgetChanged)
+    Q_PROPERTY(QVariantMap memoryUsage READ memoryUsage NOTIFY memoryUsageChanged)
+    
     // 设置视图类型
     void setViewType(ViewType viewType);
     ViewType viewType() const;
@@ -57,15 +121,82 @@ public:
     double cameraY() const { return m_cameraY; }
     double cameraZ() const { return m_cameraZ; }
     
+    // 帧耗时统计
+    bool profilingEnabled() const { return m_profilingEnabled; }
+    void setProfilingEnabled(bool enabled);
+    QVariantList frameTimings() const { return m_frameTimings; }
+    
+    // 多视口共享场景
+    bool sharedScene() const { return m_sharedScene; }
+    void setSharedScene(bool shared);
+    
+    // 异步裁剪
+    bool threadedCull() const { return m_threadedCull; }
+    void setThreadedCull(bool threaded);
+    
+    // 抗锯齿模式
+    AntiAliasingMode antiAliasing() const { return m_antiAliasing; }
+    void setAntiAliasing(AntiAliasingMode mode);
+    
+    // 动态分辨率
+    bool dynamicResolution() const { return m_dynamicResolution; }
+    void setDynamicResolution(bool enabled);
+    double targetFrameTime() const { return m_targetFrameTime; }
+    void setTargetFrameTime(double ms);
+    double renderScale() const { return m_renderScale; }
+    
+    // 遮挡剔除
+    bool occlusionCulling() const { return m_occlusionCulling; }
+    void setOcclusionCulling(bool enabled);
+    
+    // 几何体压缩
+    bool geometryCompaction() const { return m_geometryCompaction; }
+    void setGeometryCompaction(bool enabled);
+    
+    // 天空质量
+    SkyQualityLevel skyQuality() const { return m_skyQuality; }
+    void setSkyQuality(SkyQualityLevel quality);
+    
+    // 帧捕获，路径为空时写到图片目录下的qml-osg中；按扩展名选择格式（.png/.jpg/.exr等），返回实际路径
+    bool recording() const { return m_recording; }
+    Q_INVOKABLE QString captureScreenshot(const QString& path = QString());
+    // 每frameStep帧写一张 directory/frame_000000.png，返回实际目录
+    Q_INVOKABLE QString startRecording(const QString& directory = QString(), int frameStep = 1);
+    Q_INVOKABLE void stopRecording();
+    
+    // 内存预算与统计
+    double memoryBudget() const { return m_memoryBudget; }
+    void setMemoryBudget(double megabytes);
+    QVariantMap memoryUsage() const { return m_memoryUsage; }
+    
     // 添加获取相机Eye位置的方法
     Q_INVOKABLE QVector3D getCameraEye() const;
     Q_INVOKABLE QVector3D getCameraCenter() const;
     Q_INVOKABLE QVector3D getCameraUp() const;
     
+    // 渲染器在synchronize()中调用（GUI线程此时阻塞），同一快照只排队一次通知
+    void publishCameraSnapshot(const std::shared_ptr<const CameraSnapshot>& snapshot);
+    // 渲染器在synchronize()中调用，比例变化时排队通知界面
+    void publishRenderScale(double scale);
+    
 signals:
     void viewTypeChanged();
     void mousePositionChanged();
     void cameraPositionChanged();
+    void profilingEnabledChanged();
+    void frameTimingsChanged();
+    void sharedSceneChanged();
+    void threadedCullChanged();
+    void antiAliasingChanged();
+    void dynamicResolutionChanged();
+    void targetFrameTimeChanged();
+    void renderScaleChanged();
+    void occlusionCullingChanged();
+    void geometryCompactionChanged();
+    void skyQualityChanged();
+    void recordingChanged();
+    void memoryBudgetChanged();
+    void memoryUsageChanged();
     void requestFileDialog();  // 通知QML打开文件对话框的信号
     void fileSelected(const QString& fileName);  // 文件选择完成信号
     
@@ -135,7 +266,9 @@ public slots:
     void invokeLoadOSGFile(const QString& fileName);
     void invokeSetViewType(ViewType viewType);  // 添加设置视图类型的槽函数
     void invokeResetToHomeView();  // 添加回归主视角的槽函数
-    void updateCameraPosition();  // 添加更新摄像机位置的槽函数
+    void applyCameraSnapshot();  // 取出最新的相机快照并通知界面
+    void updateFrameTimings();  // 从渲染器取回帧耗时统计
+    void updateMemoryUsage();  // 取回内存统计
     // 更新PBR材质的槽函数（包含Alpha参数）
     void invokeUpdatePBRMaterial(float albedoR, float albedoG, float albedoB, float albedoA,
                                 float metallic, float roughness, 
@@ -183,6 +316,22 @@ private:
     double m_cameraX;  // 摄像机X坐标
     double m_cameraY;  // 摄像机Y坐标
     double m_cameraZ;  // 摄像机Z坐标
+    std::shared_ptr<const CameraSnapshot> m_cameraSnapshot;  // 最近一次发布的相机快照
+    bool m_cameraNotifyPending;  // 已排队但尚未处理的相机变化通知
+    bool m_profilingEnabled;  // 是否开启帧耗时统计
+    QVariantList m_frameTimings;  // 帧耗时统计结果
+    bool m_sharedScene;  // 是否与其他视口共享场景
+    bool m_threadedCull;  // 是否异步裁剪
+    AntiAliasingMode m_antiAliasing;  // 抗锯齿模式
+    bool m_dynamicResolution;  // 是否开启动态分辨率
+    double m_targetFrameTime;  // 动态分辨率的目标GPU帧耗时（毫秒）
+    double m_renderScale;  // 当前渲染比例
+    bool m_occlusionCulling;  // 是否开启遮挡剔除
+    bool m_geometryCompaction;  // 加载模型时是否压缩顶点数据
+    SkyQualityLevel m_skyQuality;  // 天空着色器质量档位
+    bool m_recording;  // 是否正在写图像序列
+    double m_memoryBudget;  // GPU内存预算（MB）
+    QVariantMap m_memoryUsage;  // 内存统计结果
 };
 
 #endif // SIMPLEOSGVIEWER_H
\ No newline at end of file
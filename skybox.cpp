@@ -5,6 +5,7 @@
 #include <osg/Geode>
 #include <osg/Program>
 #include <osg/Shader>
+#include "shaderprogramcache.h"
 #include <osg/Geometry>
 #include <osgDB/ReadFile>
 #include <osgUtil/CullVisitor>
@@ -68,18 +69,8 @@ osg::Program* SkyBox::createSphereSkyBoxShaderProgram()
         }
     )";
     
-    // 创建着色器程序
-    osg::ref_ptr<osg::Program> program = new osg::Program;
-    
-    // 创建并添加顶点着色器
-    osg::ref_ptr<osg::Shader> vertexShader = new osg::Shader(osg::Shader::VERTEX, vertexShaderSource);
-    program->addShader(vertexShader);
-    
-    // 创建并添加片元着色器
-    osg::ref_ptr<osg::Shader> fragmentShader = new osg::Shader(osg::Shader::FRAGMENT, fragmentShaderSource);
-    program->addShader(fragmentShader);
-    
-    return program.release();
+    // 从进程级缓存获取着色器程序
+    return ShaderProgramCache::instance().getProgram("SphereSkyBoxShaderProgram", vertexShaderSource, fragmentShaderSource);
 }
 
 void SkyBox::setEnvironmentMap(unsigned int unit,
@@ -105,7 +96,12 @@ void SkyBox::setEnvironmentMap(unsigned int unit,
     
     cubemap->setResizeNonPowerOfTwoHint(false);
     
-    getOrCreateStateSet()->setTextureAttributeAndModes(unit, cubemap.get());
+    setEnvironmentMap(unit, cubemap.get());
+}
+
+void SkyBox::setEnvironmentMap(unsigned int unit, osg::TextureCubeMap* cubemap)
+{
+    getOrCreateStateSet()->setTextureAttributeAndModes(unit, cubemap);
     
     // 添加采样器uniform
     getOrCreateStateSet()->addUniform(new osg::Uniform("skybox", (int)unit));
@@ -18,6 +18,8 @@ public:
     void setEnvironmentMap(unsigned int unit, osg::Image* posX,
                           osg::Image* negX, osg::Image* posY, osg::Image* negY,
                           osg::Image* posZ, osg::Image* negZ);
+    // 直接使用已建好的立方体贴图（如TextureLoader加载的压缩贴图）
+    void setEnvironmentMap(unsigned int unit, osg::TextureCubeMap* cubemap);
     
     virtual bool computeLocalToWorldMatrix(osg::Matrix& matrix, osg::NodeVisitor* nv) const;
     virtual bool computeWorldToLocalMatrix(osg::Matrix& matrix, osg::NodeVisitor* nv) const;
@@ -0,0 +1,52 @@
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <atomic>
+#include <cstddef>
+
+// 单生产者单消费者无锁环形队列
+// 生产者只写_tail，消费者只写_head，容量为Capacity - 1（留一个空位区分满和空）
+template <typename T, std::size_t Capacity>
+class SpscRing
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SpscRing() : _head(0), _tail(0) {}
+
+    // 生产者线程调用，队列满时返回false
+    bool push(const T& value)
+    {
+        std::size_t tail = _tail.load(std::memory_order_relaxed);
+        std::size_t next = (tail + 1) & (Capacity - 1);
+        if (next == _head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        _buffer[tail] = value;
+        _tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // 消费者线程调用，队列空时返回false
+    bool pop(T& value)
+    {
+        std::size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = _buffer[head];
+        _head.store((head + 1) & (Capacity - 1), std::memory_order_release);
+        return true;
+    }
+
+private:
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    T _buffer[Capacity];
+    // 头尾分开放在不同缓存行，避免两个线程互相失效
+    alignas(64) std::atomic<std::size_t> _head;
+    alignas(64) std::atomic<std::size_t> _tail;
+};
+
+#endif // SPSCRING_H
@@ -0,0 +1,438 @@
+#include "textureloader.h"
+#include <osgDB/FileNameUtils>
+#include <osgDB/FileUtils>
+#include <osgDB/Options>
+#include <osgDB/ReadFile>
+#include <osg/ValueObject>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QDebug>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <thread>
+#include <vector>
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+namespace
+{
+    // 编码器有改动时递增，旧缓存自然失效
+    const int kEncoderVersion = 1;
+
+    // 同名容器的查找顺序；OSG 3.6没有自带ktx2插件，装了对应插件时才会用上
+    const char* const kCompressedExtensions[] = { "ktx2", "dds" };
+
+    const char* const kFaceNames[6] = { "px", "nx", "py", "ny", "pz", "nz" };
+
+    uint64_t fnv1a(const void* data, std::size_t size, uint64_t hash = 14695981039346656037ULL)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    struct Rgba
+    {
+        int r, g, b, a;
+    };
+
+    // 8位RGBA像素的一级mip
+    struct Level
+    {
+        int width = 0;
+        int height = 0;
+        std::vector<unsigned char> pixels;
+
+        Rgba at(int x, int y) const
+        {
+            const unsigned char* p = &pixels[(std::min(y, height - 1) * width + std::min(x, width - 1)) * 4];
+            return Rgba{ p[0], p[1], p[2], p[3] };
+        }
+    };
+
+    bool toLevel(const osg::Image* image, Level& level)
+    {
+        if (image->getDataType() != GL_UNSIGNED_BYTE || image->r() != 1) return false;
+        int channels = 0;
+        switch (image->getPixelFormat()) {
+        case GL_RGB: channels = 3; break;
+        case GL_RGBA: channels = 4; break;
+        case GL_LUMINANCE: channels = 1; break;
+        default: return false;
+        }
+
+        level.width = image->s();
+        level.height = image->t();
+        level.pixels.resize(level.width * level.height * 4);
+        for (int y = 0; y < level.height; ++y) {
+            const unsigned char* row = image->data(0, y);
+            for (int x = 0; x < level.width; ++x) {
+                const unsigned char* p = row + x * channels;
+                unsigned char* out = &level.pixels[(y * level.width + x) * 4];
+                out[0] = p[0];
+                out[1] = channels >= 3 ? p[1] : p[0];
+                out[2] = channels >= 3 ? p[2] : p[0];
+                out[3] = channels == 4 ? p[3] : 255;
+            }
+        }
+        return true;
+    }
+
+    Level downsample(const Level& level)
+    {
+        Level result;
+        result.width = std::max(1, level.width / 2);
+        result.height = std::max(1, level.height / 2);
+        result.pixels.resize(result.width * result.height * 4);
+        for (int y = 0; y < result.height; ++y) {
+            for (int x = 0; x < result.width; ++x) {
+                Rgba a = level.at(x * 2, y * 2), b = level.at(x * 2 + 1, y * 2);
+                Rgba c = level.at(x * 2, y * 2 + 1), d = level.at(x * 2 + 1, y * 2 + 1);
+                unsigned char* out = &result.pixels[(y * result.width + x) * 4];
+                out[0] = static_cast<unsigned char>((a.r + b.r + c.r + d.r + 2) / 4);
+                out[1] = static_cast<unsigned char>((a.g + b.g + c.g + d.g + 2) / 4);
+                out[2] = static_cast<unsigned char>((a.b + b.b + c.b + d.b + 2) / 4);
+                out[3] = static_cast<unsigned char>((a.a + b.a + c.a + d.a + 2) / 4);
+            }
+        }
+        return result;
+    }
+
+    uint16_t toRgb565(int r, int g, int b)
+    {
+        return static_cast<uint16_t>(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255));
+    }
+
+    Rgba fromRgb565(uint16_t c)
+    {
+        int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+        return Rgba{ (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 255 };
+    }
+
+    void put16(unsigned char* out, uint16_t value)
+    {
+        out[0] = static_cast<unsigned char>(value & 0xFF);
+        out[1] = static_cast<unsigned char>(value >> 8);
+    }
+
+    // BC1颜色块：包围盒对角线两端内缩1/16作端点，4色模式，逐像素取最近的调色板项
+    void encodeColorBlock(const Rgba block[16], unsigned char* out)
+    {
+        int lo[3] = { 255, 255, 255 }, hi[3] = { 0, 0, 0 };
+        for (int i = 0; i < 16; ++i) {
+            const int c[3] = { block[i].r, block[i].g, block[i].b };
+            for (int k = 0; k < 3; ++k) {
+                lo[k] = std::min(lo[k], c[k]);
+                hi[k] = std::max(hi[k], c[k]);
+            }
+        }
+        for (int k = 0; k < 3; ++k) {
+            int inset = (hi[k] - lo[k]) / 16;
+            lo[k] += inset;
+            hi[k] -= inset;
+        }
+
+        uint16_t c0 = toRgb565(hi[0], hi[1], hi[2]);
+        uint16_t c1 = toRgb565(lo[0], lo[1], lo[2]);
+        if (c0 < c1) std::swap(c0, c1);
+        put16(out, c0);
+        put16(out + 2, c1);
+
+        uint32_t indices = 0;
+        if (c0 != c1) {
+            Rgba p0 = fromRgb565(c0), p1 = fromRgb565(c1);
+            const Rgba palette[4] = {
+                p0, p1,
+                Rgba{ (2 * p0.r + p1.r) / 3, (2 * p0.g + p1.g) / 3, (2 * p0.b + p1.b) / 3, 255 },
+                Rgba{ (p0.r + 2 * p1.r) / 3, (p0.g + 2 * p1.g) / 3, (p0.b + 2 * p1.b) / 3, 255 }
+            };
+            for (int i = 0; i < 16; ++i) {
+                int best = 0, bestDistance = 1 << 30;
+                for (int j = 0; j < 4; ++j) {
+                    int dr = block[i].r - palette[j].r, dg = block[i].g - palette[j].g, db = block[i].b - palette[j].b;
+                    int distance = dr * dr + dg * dg + db * db;
+                    if (distance < bestDistance) {
+                        bestDistance = distance;
+                        best = j;
+                    }
+                }
+                indices |= static_cast<uint32_t>(best) << (2 * i);
+            }
+        }
+        for (int k = 0; k < 4; ++k) {
+            out[4 + k] = static_cast<unsigned char>(indices >> (8 * k));
+        }
+    }
+
+    // BC3的alpha块：最大最小值作端点，8级插值，3位索引
+    void encodeAlphaBlock(const Rgba block[16], unsigned char* out)
+    {
+        int a0 = 0, a1 = 255;
+        for (int i = 0; i < 16; ++i) {
+            a0 = std::max(a0, block[i].a);
+            a1 = std::min(a1, block[i].a);
+        }
+        out[0] = static_cast<unsigned char>(a0);
+        out[1] = static_cast<unsigned char>(a1);
+
+        uint64_t indices = 0;
+        if (a0 != a1) {
+            int palette[8] = { a0, a1 };
+            for (int j = 1; j < 7; ++j) {
+                palette[j + 1] = ((7 - j) * a0 + j * a1) / 7;
+            }
+            for (int i = 0; i < 16; ++i) {
+                int best = 0, bestDistance = 256;
+                for (int j = 0; j < 8; ++j) {
+                    int distance = std::abs(block[i].a - palette[j]);
+                    if (distance < bestDistance) {
+                        bestDistance = distance;
+                        best = j;
+                    }
+                }
+                indices |= static_cast<uint64_t>(best) << (3 * i);
+            }
+        }
+        for (int k = 0; k < 6; ++k) {
+            out[2 + k] = static_cast<unsigned char>(indices >> (8 * k));
+        }
+    }
+
+    unsigned int blockBytes(bool alpha) { return alpha ? 16u : 8u; }
+
+    unsigned int levelBytes(int width, int height, bool alpha)
+    {
+        return static_cast<unsigned int>(((width + 3) / 4) * ((height + 3) / 4)) * blockBytes(alpha);
+    }
+
+    void encodeLevel(const Level& level, bool alpha, unsigned char* out)
+    {
+        Rgba block[16];
+        for (int by = 0; by < level.height; by += 4) {
+            for (int bx = 0; bx < level.width; bx += 4) {
+                // 不足4x4的边缘块重复最后一行/列
+                for (int i = 0; i < 16; ++i) {
+                    block[i] = level.at(bx + (i & 3), by + (i >> 2));
+                }
+                if (alpha) {
+                    encodeAlphaBlock(block, out);
+                    out += 8;
+                }
+                encodeColorBlock(block, out);
+                out += 8;
+            }
+        }
+    }
+
+    // 源图解码后生成完整mip链并压缩；不支持的像素格式返回空
+    osg::ref_ptr<osg::Image> compress(const osg::Image* source)
+    {
+        std::vector<Level> levels(1);
+        if (!toLevel(source, levels[0])) return nullptr;
+        while (levels.back().width > 1 || levels.back().height > 1) {
+            levels.push_back(downsample(levels.back()));
+        }
+
+        bool alpha = false;
+        for (std::size_t i = 3; i < levels[0].pixels.size() && !alpha; i += 4) {
+            alpha = levels[0].pixels[i] != 255;
+        }
+
+        osg::Image::MipmapDataType offsets;
+        unsigned int total = 0;
+        for (std::size_t i = 0; i < levels.size(); ++i) {
+            if (i > 0) offsets.push_back(total);
+            total += levelBytes(levels[i].width, levels[i].height, alpha);
+        }
+        unsigned char* data = new unsigned char[total];
+        for (std::size_t i = 0; i < levels.size(); ++i) {
+            encodeLevel(levels[i], alpha, data + (i == 0 ? 0 : offsets[i - 1]));
+        }
+
+        GLenum format = alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        osg::ref_ptr<osg::Image> image = new osg::Image;
+        image->setImage(levels[0].width, levels[0].height, 1, format, format, GL_UNSIGNED_BYTE, data,
+                        osg::Image::USE_NEW_DELETE);
+        image->setMipmapLevels(offsets);
+        image->setFileName(source->getFileName());
+        return image;
+    }
+
+    void put32(std::ofstream& file, uint32_t value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    // 只写本模块生成的DXT1/DXT5图像；按osg::Image的行序原样写入，读回时不翻转
+    bool writeDds(const std::string& path, const osg::Image* image)
+    {
+        bool alpha = image->getPixelFormat() == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) return false;
+
+        file.write("DDS ", 4);
+        put32(file, 124);                                       // dwSize
+        put32(file, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000); // CAPS|HEIGHT|WIDTH|PIXELFORMAT|MIPMAPCOUNT|LINEARSIZE
+        put32(file, image->t());
+        put32(file, image->s());
+        put32(file, levelBytes(image->s(), image->t(), alpha));
+        put32(file, 0);                                         // dwDepth
+        put32(file, image->getNumMipmapLevels());
+        for (int i = 0; i < 11; ++i) put32(file, 0);
+        put32(file, 32);                                        // ddspf.dwSize
+        put32(file, 0x4);                                       // DDPF_FOURCC
+        file.write(alpha ? "DXT5" : "DXT1", 4);
+        for (int i = 0; i < 5; ++i) put32(file, 0);
+        put32(file, 0x1000 | 0x8 | 0x400000);                   // TEXTURE|COMPLEX|MIPMAP
+        for (int i = 0; i < 4; ++i) put32(file, 0);
+        file.write(reinterpret_cast<const char*>(image->data()), image->getTotalSizeInBytesIncludingMipmaps());
+        return static_cast<bool>(file);
+    }
+}
+
+TextureLoader& TextureLoader::instance()
+{
+    static TextureLoader loader;
+    return loader;
+}
+
+TextureLoader::TextureLoader()
+{
+    QString baseDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (baseDir.isEmpty()) {
+        baseDir = QDir::currentPath();
+    }
+    QString dir = baseDir + "/texture_cache";
+    if (QDir().mkpath(dir)) {
+        _cacheDirectory = dir.toStdString();
+    } else {
+        qWarning() << "TextureLoader: cannot create cache directory" << dir;
+    }
+}
+
+std::string TextureLoader::cachePath(const std::string& path) const
+{
+    if (_cacheDirectory.empty()) return std::string();
+
+    QFileInfo info(QString::fromStdString(path));
+    char key[64];
+    std::snprintf(key, sizeof(key), "%lld|%lld|%d", static_cast<long long>(info.size()),
+                  static_cast<long long>(info.lastModified().toMSecsSinceEpoch()), kEncoderVersion);
+    const std::string absolute = info.absoluteFilePath().toStdString();
+    uint64_t hash = fnv1a(absolute.data(), absolute.size());
+    hash = fnv1a(key, std::strlen(key), hash);
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.dds", static_cast<unsigned long long>(hash));
+    return _cacheDirectory + "/" + name;
+}
+
+osg::ref_ptr<osg::Image> TextureLoader::readCompressedSibling(const std::string& path) const
+{
+    // 工具导出的容器按DirectX习惯自上而下存储，翻转成与源图相同的行序
+    osg::ref_ptr<osgDB::Options> options = new osgDB::Options("dds_flip");
+    const std::string base = osgDB::getNameLessExtension(path);
+    for (const char* extension : kCompressedExtensions) {
+        const std::string candidate = base + "." + extension;
+        if (candidate == path || !osgDB::fileExists(candidate)) continue;
+        osg::ref_ptr<osg::Image> image = osgDB::readRefImageFile(candidate, options.get());
+        if (image.valid()) {
+            return image;
+        }
+    }
+    return nullptr;
+}
+
+const char* const TextureLoader::kSourceTag = "TextureLoader";
+
+osg::ref_ptr<osg::Image> TextureLoader::loadImage(const std::string& path)
+{
+    osg::ref_ptr<osg::Image> image = decodeImage(path);
+    if (image.valid()) {
+        // 无论实际读的是哪个文件，都记为源图路径，重新加载时走同样的查找顺序
+        image->setFileName(path);
+        image->setUserValue(kSourceTag, true);
+    }
+    return image;
+}
+
+osg::ref_ptr<osg::Image> TextureLoader::decodeImage(const std::string& path)
+{
+    osg::ref_ptr<osg::Image> image = readCompressedSibling(path);
+    if (image.valid() || !osgDB::fileExists(path)) {
+        return image;
+    }
+
+    const std::string cached = cachePath(path);
+    if (!cached.empty() && osgDB::fileExists(cached)) {
+        image = osgDB::readRefImageFile(cached);
+        if (image.valid()) {
+            return image;
+        }
+    }
+
+    osg::ref_ptr<osg::Image> source = osgDB::readRefImageFile(path);
+    if (!source.valid()) {
+        return nullptr;
+    }
+    image = compress(source.get());
+    if (!image.valid()) {
+        // 浮点等不压缩的格式按原样使用
+        return source;
+    }
+    if (!cached.empty()) {
+        // 先写临时文件再改名，其他线程同时加载同一张图时不会读到写了一半的缓存
+        const std::string temporary = cached + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+        if (!writeDds(temporary, image.get()) || std::rename(temporary.c_str(), cached.c_str()) != 0) {
+            std::remove(temporary.c_str());
+            qWarning() << "TextureLoader: cannot write cache" << QString::fromStdString(cached);
+        }
+    }
+    return image;
+}
+
+osg::ref_ptr<osg::TextureCubeMap> TextureLoader::loadCubeMap(const std::string& directory)
+{
+    std::future<osg::ref_ptr<osg::Image> > faces[6];
+    for (int face = 0; face < 6; ++face) {
+        const std::string path = directory + "/" + kFaceNames[face] + ".png";
+        faces[face] = std::async(std::launch::async, [this, path]() { return loadImage(path); });
+    }
+
+    osg::ref_ptr<osg::TextureCubeMap> cubemap = new osg::TextureCubeMap;
+    bool mipmapped = true;
+    for (int face = 0; face < 6; ++face) {
+        osg::ref_ptr<osg::Image> image = faces[face].get();
+        if (!image.valid()) {
+            qWarning() << "TextureLoader: missing cubemap face" << kFaceNames[face] << "in" << QString::fromStdString(directory);
+            return nullptr;
+        }
+        mipmapped = mipmapped && image->isMipmap();
+        cubemap->setImage(face, image.get());
+    }
+
+    cubemap->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+    cubemap->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+    cubemap->setWrap(osg::Texture::WRAP_R, osg::Texture::CLAMP_TO_EDGE);
+    // 预生成的mip链直接上传，不再由GPU生成
+    cubemap->setFilter(osg::Texture::MIN_FILTER, mipmapped ? osg::Texture::LINEAR_MIPMAP_LINEAR : osg::Texture::LINEAR);
+    cubemap->setFilter(osg::Texture::MAG_FILTER, osg::Texture::LINEAR);
+    cubemap->setResizeNonPowerOfTwoHint(false);
+    return cubemap;
+}
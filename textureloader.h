@@ -0,0 +1,39 @@
+#ifndef TEXTURELOADER_H
+#define TEXTURELOADER_H
+
+#include <osg/Image>
+#include <osg/TextureCubeMap>
+#include <osg/ref_ptr>
+#include <string>
+
+// 纹理导入
+// 同名的块压缩容器（.ktx2、.dds，可带预生成的mip链）优先于源图；只有源图时在CPU上生成mip链并压缩为BC1/BC3，
+// 结果按源文件路径、大小和修改时间写入磁盘缓存（DDS），下次启动直接读取压缩数据；
+// 立方体贴图的6个面并行解码和压缩
+class TextureLoader
+{
+public:
+    // 本类加载的图像带有此用户值（bool），文件名为源图路径，可再次交给loadImage重新加载
+    static const char* const kSourceTag;
+
+    static TextureLoader& instance();
+
+    // 任意线程调用（通常在场景构建线程上）；path为源图路径，找不到任何可用文件时返回空
+    osg::ref_ptr<osg::Image> loadImage(const std::string& path);
+
+    // 任意线程调用；读取directory下的 {p,n}{x,y,z}.png 六个面，任一面失败时返回空
+    osg::ref_ptr<osg::TextureCubeMap> loadCubeMap(const std::string& directory);
+
+private:
+    TextureLoader();
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    osg::ref_ptr<osg::Image> decodeImage(const std::string& path);
+    osg::ref_ptr<osg::Image> readCompressedSibling(const std::string& path) const;
+    std::string cachePath(const std::string& path) const;
+
+    std::string _cacheDirectory;
+};
+
+#endif // TEXTURELOADER_H
@@ -28,11 +28,16 @@
 #include <QDebug>
 #include "shadercube.h"
 #include "shaderpbr.h"  // 添加PBR头文件
+#include "aerialperspective.h"
+#include "occlusionculling.h"
+#include "modelloader.h"
 #include "skybox.h"
 #include "demoshader.h"  // 添加DemoShader头文件
 #include "SkyNode.h"
+#include "skyboxmanipulator.h"
 
 UIHandler::UIHandler()
+    : m_sceneManager(std::make_shared<SceneManager>())
 {
 }
 
@@ -40,134 +45,135 @@ UIHandler::~UIHandler()
 {
 }
 
-void UIHandler::createShape(osgViewer::Viewer* viewer, osg::Group* rootNode, osg::ref_ptr<osg::Geode>& shapeNode)
+void UIHandler::setSharedResources(const std::shared_ptr<SceneManager>& sceneManager, DemoShader* demoShader)
+{
+    if (sceneManager) {
+        m_sceneManager = sceneManager;
+    }
+    m_demoShader = demoShader;
+}
+
+void UIHandler::createShape(osgViewer::Viewer* viewer, osg::Group* rootNode, osg::ref_ptr<osg::Geode>& shapeNode,
+                            const SceneManager::Activator& onActivated)
 {
     if (viewer && rootNode) {
-        // 清除现有的场景
-        rootNode->removeChildren(0, rootNode->getNumChildren());
-        
-        // 创建天空盒，使用相对路径（基于应用程序目录）
-        std::string resourcePath = QDir::currentPath().toStdString() + "/../../resource";
-        osg::ref_ptr<osg::Node> skyBox = ShaderCube::createSkyBox(resourcePath);
-        if (skyBox.valid()) {
-            rootNode->addChild(skyBox);
-        }
-        
-        // 使用Shader创建立方体
-        osg::ref_ptr<osg::Node> shaderCube = ShaderCube::createCube(1.0f);
-        
-        // 更新节点引用
-        shapeNode = dynamic_cast<osg::Geode*>(shaderCube.get());
-        
-        // 将Shader立方体添加到根节点
-        if (shaderCube.valid()) {
-            rootNode->addChild(shaderCube);
-        }
-        
-        // 强制更新视图
-        viewer->advance();
-        viewer->requestRedraw();
+        // 后台构建天空盒和Shader立方体，第0个子节点为天空盒，第1个为立方体
+        m_sceneManager->request("shape", []() -> osg::Node* {
+            osg::ref_ptr<osg::Group> scene = new osg::Group;
+            
+            // 创建天空盒，使用相对路径（基于应用程序目录）
+            std::string resourcePath = QDir::currentPath().toStdString() + "/../../resource";
+            osg::ref_ptr<osg::Node> skyBox = ShaderCube::createSkyBox(resourcePath);
+            if (skyBox.valid()) {
+                scene->addChild(skyBox);
+            }
+            
+            // 使用Shader创建立方体
+            osg::ref_ptr<osg::Node> shaderCube = ShaderCube::createCube(1.0f);
+            if (shaderCube.valid()) {
+                scene->addChild(shaderCube);
+            }
+            return scene.release();
+        }, [viewer, &shapeNode, onActivated](osg::Node* scene) {
+            // 更新节点引用
+            osg::Group* group = scene->asGroup();
+            shapeNode = group && group->getNumChildren() > 0 ?
+                dynamic_cast<osg::Geode*>(group->getChild(group->getNumChildren() - 1)) : nullptr;
+            
+            if (onActivated) {
+                onActivated(scene);
+            }
+            viewer->requestRedraw();
+        }, this);
     }
 }
 
-void UIHandler::createShapeWithNewSkybox(osgViewer::Viewer* viewer, osg::Group* rootNode, osg::ref_ptr<osg::Geode>& shapeNode)
+void UIHandler::createShapeWithNewSkybox(osgViewer::Viewer* viewer, osg::Group* rootNode, osg::ref_ptr<osg::Geode>& shapeNode,
+                                         const SceneManager::Activator& onActivated)
 {
     if (viewer && rootNode) {
-        // 清除现有的场景
-        rootNode->removeChildren(0, rootNode->getNumChildren());
-        
-        // 创建使用新类的天空盒，使用相对路径（基于应用程序目录）
-        std::string resourcePath = QDir::currentPath().toStdString() + "/../../resource";
-        osg::ref_ptr<osg::Node> skyBox = ShaderCube::createSkyBoxWithNewClass(resourcePath);
-        if (skyBox.valid()) {
-            rootNode->addChild(skyBox);
-        }
-        
-        // 使用Shader创建立方体
-        osg::ref_ptr<osg::Node> shaderCube = ShaderCube::createCube(1.0f);
-        
-        // 更新节点引用
-        shapeNode = dynamic_cast<osg::Geode*>(shaderCube.get());
-        
-        // 将Shader立方体添加到根节点
-        if (shaderCube.valid()) {
-            rootNode->addChild(shaderCube);
-        }
-        
-        // 强制更新视图
-        viewer->advance();
-        viewer->requestRedraw();
+        m_sceneManager->request("shapeWithNewSkybox", []() -> osg::Node* {
+            osg::ref_ptr<osg::Group> scene = new osg::Group;
+            
+            // 创建使用新类的天空盒，使用相对路径（基于应用程序目录）
+            std::string resourcePath = QDir::currentPath().toStdString() + "/../../resource";
+            osg::ref_ptr<osg::Node> skyBox = ShaderCube::createSkyBoxWithNewClass(resourcePath);
+            if (skyBox.valid()) {
+                scene->addChild(skyBox);
+            }
+            
+            // 使用Shader创建立方体
+            osg::ref_ptr<osg::Node> shaderCube = ShaderCube::createCube(1.0f);
+            if (shaderCube.valid()) {
+                scene->addChild(shaderCube);
+            }
+            return scene.release();
+        }, [viewer, &shapeNode, onActivated](osg::Node* scene) {
+            // 更新节点引用
+            osg::Group* group = scene->asGroup();
+            shapeNode = group && group->getNumChildren() > 0 ?
+                dynamic_cast<osg::Geode*>(group->getChild(group->getNumChildren() - 1)) : nullptr;
+            
+            if (onActivated) {
+                onActivated(scene);
+            }
+            viewer->requestRedraw();
+        }, this);
     }
 }
 
-void UIHandler::createPBRScene(osgViewer::Viewer* viewer, osg::Group* rootNode, osg::ref_ptr<osg::Geode>& shapeNode)
+void UIHandler::createPBRScene(osgViewer::Viewer* viewer, osg::Group* rootNode, osg::ref_ptr<osg::Geode>& shapeNode,
+                               const SceneManager::Activator& onActivated)
 {
     if (viewer && rootNode) {
-        // 清除现有的场景
-        rootNode->removeChildren(0, rootNode->getNumChildren());
-        
         // 创建带PBR效果和天空盒的场景
-        osg::ref_ptr<osg::Node> pbrScene = ShaderPBR::createPBRSceneWithSkybox(1.0f);
-        
-        // 更新节点引用
-        shapeNode = nullptr; // PBR场景不使用单个Geode节点
-        
-        // 将PBR场景添加到根节点
-        if (pbrScene.valid()) {
-            rootNode->addChild(pbrScene);
-        }
-        
-        // 设置默认的视图参数
-        osg::Vec3d eye(0.0, -5.0, 0.0);
-        osg::Vec3d center(0.0, 0.0, 0.0);
-        osg::Vec3d up(0.0, 0.0, 1.0);
-        m_viewManager.setViewParameters(eye, center, up);
-        
-        // 强制更新视图
-        viewer->advance();
-        viewer->requestRedraw();
+        m_sceneManager->request("pbr", []() -> osg::Node* {
+            return ShaderPBR::createPBRSceneWithSkybox(1.0f);
+        }, [this, viewer, &shapeNode, onActivated](osg::Node* scene) {
+            // 更新节点引用
+            shapeNode = nullptr; // PBR场景不使用单个Geode节点
+            
+            // 设置默认的视图参数
+            osg::Vec3d eye(0.0, -5.0, 0.0);
+            osg::Vec3d center(0.0, 0.0, 0.0);
+            osg::Vec3d up(0.0, 0.0, 1.0);
+            m_viewManager.setViewParameters(eye, center, up);
+            
+            if (onActivated) {
+                onActivated(scene);
+            }
+            viewer->requestRedraw();
+        }, this);
     }
 }
 
 void UIHandler::createAtmosphereScene(osgViewer::Viewer* viewer, osg::Group* rootNode)
 {
     if (viewer && rootNode) {
-        // 清除现有的场景
-        rootNode->removeChildren(0, rootNode->getNumChildren());
-        
         // 如果DemoShader还没有创建，则创建它
         if (!m_demoShader.valid()) {
             m_demoShader = new DemoShader();
         }
         
-        
         // 创建体积云天空盒场景
-        osg::ref_ptr<osg::Node> atmosphereScene = m_demoShader->createVolumeCloudSkyScene(viewer);
-        
-        // 将大气渲染场景添加到根节点
-        if (atmosphereScene.valid()) {
-            rootNode->addChild(atmosphereScene);
-        } else {
-            qDebug() << "Failed to create volume cloud sky scene";
-            return;
-        }
-        
-        // 设置默认的视图参数
-        osg::Vec3d eye(0.0, 0.0, 1.0);  // 设置相机位置在原点附近
-        osg::Vec3d center(0.0, 0.0, 0.0);
-        osg::Vec3d up(0.0, 1.0, 0.0);
-        m_viewManager.setViewParameters(eye, center, up);
-        
-        // 设置相机背景色为黑色，避免干扰大气渲染效果
-        if (viewer->getCamera()) {
-            viewer->getCamera()->setClearColor(osg::Vec4(0.0f, 0.0f, 0.0f, 1.0f));
-        }
-        
-        // 强制更新视图
-        viewer->advance();
-        viewer->requestRedraw();
-        
-        qDebug() << "Volume Cloud Sky scene created successfully";
+        osg::ref_ptr<DemoShader> demoShader = m_demoShader;
+        m_sceneManager->request("volumeCloudSky", [demoShader, viewer]() -> osg::Node* {
+            return demoShader->createVolumeCloudSkyScene(viewer);
+        }, [this, viewer](osg::Node*) {
+            // 设置默认的视图参数
+            osg::Vec3d eye(0.0, 0.0, 1.0);  // 设置相机位置在原点附近
+            osg::Vec3d center(0.0, 0.0, 0.0);
+            osg::Vec3d up(0.0, 1.0, 0.0);
+            m_viewManager.setViewParameters(eye, center, up);
+            
+            // 设置相机背景色为黑色，避免干扰大气渲染效果
+            if (viewer->getCamera()) {
+                viewer->getCamera()->setClearColor(osg::Vec4(0.0f, 0.0f, 0.0f, 1.0f));
+            }
+            
+            viewer->requestRedraw();
+            qDebug() << "Volume Cloud Sky scene activated";
+        }, this);
     }
 }
 
@@ -177,36 +183,27 @@ void UIHandler::createAtmosphereScene(osgViewer::Viewer* viewer, osg::Group* roo
 void UIHandler::createSkyboxAtmosphereScene(osgViewer::Viewer* viewer, osg::Group* rootNode)
 {
     if (viewer && rootNode) {
-        // 清除现有的场景
-        rootNode->removeChildren(0, rootNode->getNumChildren());
-        
         // 如果DemoShader还没有创建，则创建它
         if (!m_demoShader.valid()) {
             m_demoShader = new DemoShader();
         }
         
         // 使用DemoShader创建结合天空盒和大气渲染的场景
-        osg::ref_ptr<osg::Node> skyboxAtmosphereScene = m_demoShader->createSkyboxAtmosphereScene(viewer);
-        
-        // 将场景添加到根节点
-        if (skyboxAtmosphereScene.valid()) {
-            rootNode->addChild(skyboxAtmosphereScene);
-        } else {
-            qDebug() << "Failed to create skybox atmosphere scene";
-            return;
-        }
-        
-        // 不需要设置默认视图参数，因为SkyBoxManipulator会处理
-        // 设置相机背景色为深蓝色
-        if (viewer->getCamera()) {
-            viewer->getCamera()->setClearColor(osg::Vec4(0.0f, 0.0f, 0.2f, 1.0f));
-        }
-        
-        // 强制更新视图
-        viewer->advance();
-        viewer->requestRedraw();
-        
-        qDebug() << "Skybox atmosphere scene created successfully";
+        osg::ref_ptr<DemoShader> demoShader = m_demoShader;
+        m_sceneManager->request("skyboxAtmosphere", [demoShader, viewer]() -> osg::Node* {
+            return demoShader->createSkyboxAtmosphereScene(viewer);
+        }, [viewer](osg::Node*) {
+            // 只在大气渲染的天空盒上使用SkyBoxManipulator
+            viewer->setCameraManipulator(new SkyBoxManipulator());
+            
+            // 设置相机背景色为深蓝色
+            if (viewer->getCamera()) {
+                viewer->getCamera()->setClearColor(osg::Vec4(0.0f, 0.0f, 0.2f, 1.0f));
+            }
+            
+            viewer->requestRedraw();
+            qDebug() << "Skybox atmosphere scene activated";
+        }, this);
     }
 }
 
@@ -214,36 +211,24 @@ void UIHandler::createSkyboxAtmosphereScene(osgViewer::Viewer* viewer, osg::Grou
 void UIHandler::createSkyboxAtmosphereWithPBRScene(osgViewer::Viewer* viewer, osg::Group* rootNode)
 {
     if (viewer && rootNode) {
-        // 清除现有的场景
-        rootNode->removeChildren(0, rootNode->getNumChildren());
-        
         // 如果DemoShader还没有创建，则创建它
         if (!m_demoShader.valid()) {
             m_demoShader = new DemoShader();
         }
         
         // 使用DemoShader创建结合天空盒大气和PBR立方体的场景
-        osg::ref_ptr<osg::Node> skyboxAtmosphereWithPBRScene = m_demoShader->createSkyboxAtmosphereWithPBRScene(viewer);
-        
-        // 将场景添加到根节点
-        if (skyboxAtmosphereWithPBRScene.valid()) {
-            rootNode->addChild(skyboxAtmosphereWithPBRScene);
-        } else {
-            qDebug() << "Failed to create skybox atmosphere with PBR scene";
-            return;
-        }
-        
-        // 不需要设置默认视图参数，因为SkyBoxManipulator会处理
-        // 设置相机背景色为深蓝色
-        if (viewer->getCamera()) {
-            viewer->getCamera()->setClearColor(osg::Vec4(0.0f, 0.0f, 0.2f, 1.0f));
-        }
-        
-        // 强制更新视图
-        viewer->advance();
-        viewer->requestRedraw();
-        
-        qDebug() << "Skybox atmosphere with PBR scene created successfully";
+        osg::ref_ptr<DemoShader> demoShader = m_demoShader;
+        m_sceneManager->request("skyboxAtmosphereWithPBR", [demoShader, viewer]() -> osg::Node* {
+            return demoShader->createSkyboxAtmosphereWithPBRScene(viewer);
+        }, [viewer](osg::Node*) {
+            // 设置相机背景色为深蓝色
+            if (viewer->getCamera()) {
+                viewer->getCamera()->setClearColor(osg::Vec4(0.0f, 0.0f, 0.2f, 1.0f));
+            }
+            
+            viewer->requestRedraw();
+            qDebug() << "Skybox atmosphere with PBR scene activated";
+        }, this);
     }
 }
 
@@ -465,73 +450,72 @@ void UIHandler::loadSingleOSGFile(osgViewer::Viewer* viewer, osg::Group* rootNod
     // 将QString转换为std::string
     std::string stdFileName = fullPath.toStdString();
     
-    try {
-        // 使用osgDB加载模型
-        osg::ref_ptr<osg::Node> loadedModel = osgDB::readNodeFile(stdFileName);
-        
-        if (loadedModel) {
-            // 不再清空现有场景，直接添加加载的模型到场景
-            rootNode->addChild(loadedModel);
+    // 读盘、简化和写缓存在后台线程进行，不阻塞GUI线程；裁剪线程可能正在遍历场景，
+    // 模型在渲染线程的帧边界上加入。读取失败时保持现有场景不变
+    m_sceneManager->attach([stdFileName]() -> osg::Node* {
+        // 加载模型，大网格在导入时生成LOD（有缓存时直接读取）
+        osg::ref_ptr<osg::Node> loadedModel = ModelLoader::instance().loadModel(stdFileName);
+        if (!loadedModel) {
+            return nullptr;
+        }
+        // 包上遮挡查询节点，是否查询由渲染器的遮挡剔除开关决定
+        return OcclusionCulling::wrap(loadedModel.get()).release();
+    }, [this, viewer, rootNode](osg::Node* sceneModel) {
+        // 不再清空现有场景，直接添加加载的模型到场景
+        rootNode->addChild(sceneModel);
+        
+        // 大气场景中给模型叠加空气透视
+        if (AerialPerspective* aerial = AerialPerspective::find(rootNode)) {
+            aerial->addModel(sceneModel);
+        }
+        
+        // 获取模型的包围球，用于计算合适的相机位置
+        osg::BoundingSphere bs = sceneModel->getBound();
+        double radius = bs.radius();
+        osg::Vec3d center = bs.center();
+        
+        // 如果模型有有效的边界球，则调整相机位置确保能看到整个模型
+        if (radius > 0) {
+            // 计算合适的视距，确保模型完整显示
+            double viewDistance = radius * 3.0;
             
-            // 获取模型的包围球，用于计算合适的相机位置
-            osg::BoundingSphere bs = loadedModel->getBound();
-            double radius = bs.radius();
-            osg::Vec3d center = bs.center();
+            // 设置相机方向向上为Z轴
+            osg::Vec3d up(0.0, 0.0, 1.0);
             
-            // 如果模型有有效的边界球，则调整相机位置确保能看到整个模型
-            if (radius > 0) {
-                // 计算合适的视距，确保模型完整显示
-                double viewDistance = radius * 3.0;
-                
-                // 设置相机方向向上为Z轴
-                osg::Vec3d up(0.0, 0.0, 1.0);
-                
-                // 从前方观察模型（稍微偏下的角度）
-                osg::Vec3d viewDirection(0.0, -1.0, 0.3);
-                viewDirection.normalize();
-                
-                // 相机位置 = 模型中心 + 视线方向 * 距离
-                osg::Vec3d eye = center + viewDirection * viewDistance;
-                
-                // 更新视图管理器中的相机参数
-                m_viewManager.setViewParameters(eye, center, up);
-                
-                // 同时更新操作器的home位置，确保视角正确
-                osgGA::TrackballManipulator* manipulator = dynamic_cast<osgGA::TrackballManipulator*>(viewer->getCameraManipulator());
-                if (manipulator) {
-                    manipulator->setHomePosition(eye, center, up);
-                    // 立即应用home位置
-                    manipulator->home(0.0);
-                    
-                    // 设置缩放限制，允许更近的缩放距离
-                    manipulator->setMinimumDistance(0.0001, true);  // 设置最小距离为0.0001，true表示相对值
-                }
+            // 从前方观察模型（稍微偏下的角度）
+            osg::Vec3d viewDirection(0.0, -1.0, 0.3);
+            viewDirection.normalize();
+            
+            // 相机位置 = 模型中心 + 视线方向 * 距离
+            osg::Vec3d eye = center + viewDirection * viewDistance;
+            
+            // 更新视图管理器中的相机参数
+            m_viewManager.setViewParameters(eye, center, up);
+            
+            // 同时更新操作器的home位置，确保视角正确
+            osgGA::TrackballManipulator* manipulator = dynamic_cast<osgGA::TrackballManipulator*>(viewer->getCameraManipulator());
+            if (manipulator) {
+                manipulator->setHomePosition(eye, center, up);
+                // 立即应用home位置
+                manipulator->home(0.0);
                 
-                // 调整投影矩阵以适应模型大小
-                float aspectRatio = static_cast<float>(viewer->getCamera()->getViewport()->width()) / 
-                                   static_cast<float>(viewer->getCamera()->getViewport()->height());
-                // 调整投影矩阵以适应模型大小，增加远裁剪面以防止模型消失
-                // 远裁剪面从radius * 100.0f调整为radius * 1000.0f以提供更大的可视范围
-                viewer->getCamera()->setProjectionMatrixAsPerspective(
-                    30.0f, aspectRatio, radius * 0.1f, radius * 1000.0f);
+                // 设置缩放限制，允许更近的缩放距离
+                manipulator->setMinimumDistance(0.0001, true);  // 设置最小距离为0.0001，true表示相对值
             }
-            // 注意：如果模型没有有效的边界球，我们不改变当前的相机位置
             
-            // 强制更新视图
-            viewer->advance();
-            viewer->requestRedraw();
+            // 调整投影矩阵以适应模型大小
+            float aspectRatio = static_cast<float>(viewer->getCamera()->getViewport()->width()) / 
+                               static_cast<float>(viewer->getCamera()->getViewport()->height());
+            // 调整投影矩阵以适应模型大小，增加远裁剪面以防止模型消失
+            // 远裁剪面从radius * 100.0f调整为radius * 1000.0f以提供更大的可视范围
+            viewer->getCamera()->setProjectionMatrixAsPerspective(
+                30.0f, aspectRatio, radius * 0.1f, radius * 1000.0f);
         }
-    }
-    catch (const std::exception& e) {
-        // 如果加载失败，不执行任何操作
-        // 保持现有场景不变
-    }
-    catch (...) {
-        // 如果加载失败，重新创建默认场景
-        rootNode->removeChildren(0, rootNode->getNumChildren());
-        viewer->advance();
+        // 注意：如果模型没有有效的边界球，我们不改变当前的相机位置
+        
+        // 强制更新视图
         viewer->requestRedraw();
-    }
+    }, this);
 }
 
 // 从目录加载所有OSG相关文件
@@ -613,39 +597,50 @@ void UIHandler::setViewType(osgViewer::Viewer* viewer, osg::Group* rootNode, Sim
 void UIHandler::createCloudSeaAtmosphereScene(osgViewer::Viewer* viewer, osg::Group* rootNode)
 {
     if (viewer && rootNode) {
-        // 清除现有的场景
-        rootNode->removeChildren(0, rootNode->getNumChildren());
-        
         // 如果DemoShader还没有创建，则创建它
         if (!m_demoShader.valid()) {
             m_demoShader = new DemoShader();
         }
         
         // 使用DemoShader创建云海大气效果场景
-        osg::ref_ptr<osg::Node> cloudSeaAtmosphereScene = m_demoShader->createCloudSeaAtmosphereScene(viewer);
-        
-        // 将场景添加到根节点
-        if (cloudSeaAtmosphereScene.valid()) {
-            rootNode->addChild(cloudSeaAtmosphereScene);
-        } else {
-            qDebug() << "Failed to create cloud sea atmosphere scene";
-            return;
-        }
-        
-        // 不需要设置默认视图参数，因为SkyBoxManipulator会处理
-        // 设置相机背景色为深蓝色
-        if (viewer->getCamera()) {
-            viewer->getCamera()->setClearColor(osg::Vec4(0.0f, 0.0f, 0.2f, 1.0f));
-        }
-        
-        // 强制更新视图
-        viewer->advance();
-        viewer->requestRedraw();
-        
-        qDebug() << "Cloud sea atmosphere scene created successfully";
+        osg::ref_ptr<DemoShader> demoShader = m_demoShader;
+        m_sceneManager->request("cloudSeaAtmosphere", [demoShader, viewer]() -> osg::Node* {
+            return demoShader->createCloudSeaAtmosphereScene(viewer);
+        }, [demoShader, viewer](osg::Node* scene) {
+            demoShader->activateCloudSeaAtmosphereScene(scene);
+            
+            // 仅在云海大气的天空盒上使用SkyBoxManipulator
+            viewer->setCameraManipulator(new SkyBoxManipulator());
+            
+            // 设置相机背景色为深蓝色
+            if (viewer->getCamera()) {
+                viewer->getCamera()->setClearColor(osg::Vec4(0.0f, 0.0f, 0.2f, 1.0f));
+            }
+            
+            viewer->requestRedraw();
+            qDebug() << "Cloud sea atmosphere scene activated";
+        }, this);
     }
 }
 
+void UIHandler::prewarmScenes(osgViewer::Viewer* viewer)
+{
+    if (!viewer) return;
+    
+    if (!m_demoShader.valid()) {
+        m_demoShader = new DemoShader();
+    }
+    
+    // 预热加载最慢的PBR和大气场景，第一次切换时不再读盘和编译
+    m_sceneManager->prewarm("pbr", []() -> osg::Node* {
+        return ShaderPBR::createPBRSceneWithSkybox(1.0f);
+    });
+    osg::ref_ptr<DemoShader> demoShader = m_demoShader;
+    m_sceneManager->prewarm("volumeCloudSky", [demoShader, viewer]() -> osg::Node* {
+        return demoShader->createVolumeCloudSkyScene(viewer);
+    });
+}
+
 // 添加：更新云海大气参数
 void UIHandler::updateCloudSeaAtmosphereParameters(osgViewer::Viewer* viewer, osg::Group* rootNode,
                                                   float sunZenithAngle, float sunAzimuthAngle,
@@ -12,6 +12,8 @@
 #include "shaderpbr.h"  // 添加PBR头文件
 #include "demoshader.h"  // 添加DemoShader头文件
 #include "viewmanager.h"
+#include "scenemanager.h"
+#include <memory>
 
 class UIHandler : public QObject
 {
@@ -20,13 +22,18 @@ public:
     UIHandler();
     ~UIHandler();
     
-    void createShape(osgViewer::Viewer* viewer, osg::Group* rootNode, osg::ref_ptr<osg::Geode>& shapeNode);
-    void createShapeWithNewSkybox(osgViewer::Viewer* viewer, osg::Group* rootNode, osg::ref_ptr<osg::Geode>& shapeNode);
-    void createPBRScene(osgViewer::Viewer* viewer, osg::Group* rootNode, osg::ref_ptr<osg::Geode>& shapeNode);  // 添加PBR场景创建函数
+    // 场景创建函数只提交切换请求，场景在后台构建，由SceneManager在帧边界切换；onActivated在切换后于渲染线程调用
+    void createShape(osgViewer::Viewer* viewer, osg::Group* rootNode, osg::ref_ptr<osg::Geode>& shapeNode,
+                     const SceneManager::Activator& onActivated = SceneManager::Activator());
+    void createShapeWithNewSkybox(osgViewer::Viewer* viewer, osg::Group* rootNode, osg::ref_ptr<osg::Geode>& shapeNode,
+                                  const SceneManager::Activator& onActivated = SceneManager::Activator());
+    void createPBRScene(osgViewer::Viewer* viewer, osg::Group* rootNode, osg::ref_ptr<osg::Geode>& shapeNode,
+                        const SceneManager::Activator& onActivated = SceneManager::Activator());  // 添加PBR场景创建函数
     void createAtmosphereScene(osgViewer::Viewer* viewer, osg::Group* rootNode);  // 添加大气渲染场景创建函数
     void createSkyboxAtmosphereScene(osgViewer::Viewer* viewer, osg::Group* rootNode); // 添加结合天空盒和大气渲染的场景创建函数
     void createSkyboxAtmosphereWithPBRScene(osgViewer::Viewer* viewer, osg::Group* rootNode); // 添加结合天空盒大气和PBR立方体的场景创建函数
     void createCloudSeaAtmosphereScene(osgViewer::Viewer* viewer, osg::Group* rootNode); // 添加云海大气效果场景创建函数
+    void prewarmScenes(osgViewer::Viewer* viewer);  // 后台预热常用场景
     void resetView(osgViewer::Viewer* viewer, osg::Group* rootNode, SimpleOSGViewer::ViewType viewType);
     void resetToHomeView(osgViewer::Viewer* viewer, osg::Group* rootNode);
     void loadOSGFile(osgViewer::Viewer* viewer, osg::Group* rootNode, const QString& fileName);
@@ -39,6 +46,12 @@ public:
     // 获取视图管理器，用于在UI中显示相机位置信息
     ViewManager* getViewManager() { return &m_viewManager; }
     
+    // 获取场景管理器，渲染线程每帧调用applyPending完成切换
+    SceneManager* getSceneManager() { return m_sceneManager.get(); }
+    
+    // 多视口共享场景：改用共享的场景管理器和DemoShader，需在创建任何场景之前调用
+    void setSharedResources(const std::shared_ptr<SceneManager>& sceneManager, DemoShader* demoShader);
+    
     // 更新大气渲染参数
     void updateAtmosphereParameters(osgViewer::Viewer* viewer, osg::Group* rootNode, 
                                   float sunZenithAngle, float sunAzimuthAngle);
@@ -94,6 +107,7 @@ public:
 private:
     ViewManager m_viewManager;
     osg::ref_ptr<DemoShader> m_demoShader;
+    std::shared_ptr<SceneManager> m_sceneManager;
 };
 
 #endif // UIHANDLER_H
\ No newline at end of file